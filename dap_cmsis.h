@@ -0,0 +1,114 @@
+#pragma once
+#include <stdint.h>
+
+/*
+ * CMSIS-DAP protocol identifiers used by the probe-side engines.
+ * Free-DAP keeps its own copies private to dap.c, so the app needs these
+ * to build requests for dap_process_request() and to parse responses.
+ */
+
+#define DAP_CMD_INFO 0x00
+#define DAP_CMD_HOST_STATUS 0x01
+#define DAP_CMD_CONNECT 0x02
+#define DAP_CMD_DISCONNECT 0x03
+#define DAP_CMD_TRANSFER_CONFIGURE 0x04
+#define DAP_CMD_TRANSFER 0x05
+#define DAP_CMD_TRANSFER_BLOCK 0x06
+#define DAP_CMD_WRITE_ABORT 0x08
+#define DAP_CMD_DELAY 0x09
+#define DAP_CMD_RESET_TARGET 0x0A
+#define DAP_CMD_SWJ_PINS 0x10
+#define DAP_CMD_SWJ_CLOCK 0x11
+#define DAP_CMD_SWJ_SEQUENCE 0x12
+#define DAP_CMD_SWD_CONFIGURE 0x13
+#define DAP_CMD_JTAG_SEQUENCE 0x14
+#define DAP_CMD_SWO_TRANSPORT 0x17
+#define DAP_CMD_SWO_MODE 0x18
+#define DAP_CMD_SWO_BAUDRATE 0x19
+#define DAP_CMD_SWO_CONTROL 0x1A
+#define DAP_CMD_SWO_STATUS 0x1B
+#define DAP_CMD_SWO_DATA 0x1C
+#define DAP_CMD_UART_TRANSPORT 0x1F
+#define DAP_CMD_UART_CONFIGURE 0x20
+#define DAP_CMD_UART_TRANSFER 0x21
+#define DAP_CMD_UART_CONTROL 0x22
+#define DAP_CMD_UART_STATUS 0x23
+#define DAP_CMD_VENDOR_FIRST 0x80
+#define DAP_CMD_VENDOR_LAST 0x9F
+#define DAP_CMD_INVALID 0xFF
+
+#define DAP_INFO_CAPABILITIES 0xF0
+#define DAP_INFO_UART_RX_BUFFER_SIZE 0xFB
+#define DAP_INFO_UART_TX_BUFFER_SIZE 0xFC
+#define DAP_INFO_SWO_BUFFER_SIZE 0xFD
+
+#define DAP_INFO_CAP_SWO_UART (1 << 2)
+#define DAP_INFO_CAP_SWO_MANCHESTER (1 << 3)
+#define DAP_INFO_CAP_SWO_STREAM (1 << 6)
+#define DAP_INFO_CAP_UART (1 << 7)
+
+#define DAP_STATUS_OK 0x00
+#define DAP_STATUS_ERROR 0xFF
+
+#define DAP_CONNECT_SWD 0x01
+#define DAP_CONNECT_JTAG 0x02
+
+#define DAP_TRANSFER_APnDP (1 << 0)
+#define DAP_TRANSFER_RnW (1 << 1)
+#define DAP_TRANSFER_MATCH_VALUE (1 << 4)
+#define DAP_TRANSFER_MATCH_MASK (1 << 5)
+#define DAP_TRANSFER_TIMESTAMP (1 << 7)
+
+#define DAP_TRANSFER_ACK_MASK 0x07
+#define DAP_TRANSFER_ACK_OK 0x01
+#define DAP_TRANSFER_ACK_WAIT 0x02
+#define DAP_TRANSFER_ACK_FAULT 0x04
+#define DAP_TRANSFER_ACK_NONE 0x07
+#define DAP_TRANSFER_ERROR (1 << 3)
+#define DAP_TRANSFER_MISMATCH (1 << 4)
+
+// DAP_UART_Configure control byte, 0 in the data bits field means 8
+#define DAP_UART_FORMAT_DATA_BITS_MASK (7 << 0)
+#define DAP_UART_FORMAT_PARITY_MASK (7 << 3)
+#define DAP_UART_FORMAT_PARITY_NONE (0 << 3)
+#define DAP_UART_FORMAT_PARITY_ODD (1 << 3)
+#define DAP_UART_FORMAT_PARITY_EVEN (2 << 3)
+#define DAP_UART_FORMAT_STOP_BITS_MASK (3 << 6)
+#define DAP_UART_FORMAT_STOP_BITS_1 (0 << 6)
+#define DAP_UART_FORMAT_STOP_BITS_1_5 (1 << 6)
+#define DAP_UART_FORMAT_STOP_BITS_2 (2 << 6)
+
+#define DAP_UART_FORMAT_ERROR_DATA_BITS (1 << 0)
+#define DAP_UART_FORMAT_ERROR_PARITY (1 << 1)
+#define DAP_UART_FORMAT_ERROR_STOP_BITS (1 << 2)
+
+#define DAP_UART_CONTROL_RX_ENABLE (1 << 0)
+#define DAP_UART_CONTROL_RX_DISABLE (1 << 1)
+#define DAP_UART_CONTROL_RX_FLUSH (1 << 2)
+#define DAP_UART_CONTROL_TX_ENABLE (1 << 4)
+#define DAP_UART_CONTROL_TX_DISABLE (1 << 5)
+#define DAP_UART_CONTROL_TX_FLUSH (1 << 6)
+
+#define DAP_UART_STATUS_RX_ENABLED (1 << 0)
+#define DAP_UART_STATUS_RX_DATA_LOST (1 << 1)
+#define DAP_UART_STATUS_TX_ENABLED (1 << 4)
+
+static inline uint16_t dap_get_u16(const uint8_t* buffer) {
+    return buffer[0] | (buffer[1] << 8);
+}
+
+static inline uint32_t dap_get_u32(const uint8_t* buffer) {
+    return buffer[0] | (buffer[1] << 8) | (buffer[2] << 16) | ((uint32_t)buffer[3] << 24);
+}
+
+static inline void dap_put_u16(uint8_t* buffer, uint16_t value) {
+    buffer[0] = value & 0xFF;
+    buffer[1] = (value >> 8) & 0xFF;
+}
+
+static inline void dap_put_u32(uint8_t* buffer, uint32_t value) {
+    buffer[0] = value & 0xFF;
+    buffer[1] = (value >> 8) & 0xFF;
+    buffer[2] = (value >> 16) & 0xFF;
+    buffer[3] = (value >> 24) & 0xFF;
+}
@@ -47,6 +47,8 @@ extern GpioPin flipper_dap_swdio_pin;
 extern GpioPin flipper_dap_reset_pin;
 extern GpioPin flipper_dap_tdo_pin;
 extern GpioPin flipper_dap_tdi_pin;
+extern GpioMode flipper_dap_reset_mode;
+extern bool flipper_dap_tdo_swo;
 
 extern void dap_app_vendor_cmd(uint8_t cmd);
 extern void dap_app_target_reset();
@@ -150,13 +152,23 @@ static inline void DAP_CONFIG_SWDIO_TMS_out(void) {
     LL_GPIO_SetPinMode(flipper_dap_swdio_pin.port, flipper_dap_swdio_pin.pin, LL_GPIO_MODE_OUTPUT);
 }
 
+#ifdef DAP_CONFIG_ENABLE_JTAG
+//-----------------------------------------------------------------------------
+static inline void dap_init_tdo(void) {
+    // TDO doubles as the SWO input of the Manchester capture
+    if(!flipper_dap_tdo_swo) {
+        furi_hal_gpio_init(&flipper_dap_tdo_pin, GpioModeInput, GpioPullNo, GpioSpeedVeryHigh);
+    }
+}
+#endif
+
 //-----------------------------------------------------------------------------
 static inline void DAP_CONFIG_SETUP(void) {
     furi_hal_gpio_init(&flipper_dap_swdio_pin, GpioModeInput, GpioPullNo, GpioSpeedVeryHigh);
     furi_hal_gpio_init(&flipper_dap_swclk_pin, GpioModeInput, GpioPullNo, GpioSpeedVeryHigh);
     furi_hal_gpio_init(&flipper_dap_reset_pin, GpioModeInput, GpioPullNo, GpioSpeedVeryHigh);
 #ifdef DAP_CONFIG_ENABLE_JTAG
-    furi_hal_gpio_init(&flipper_dap_tdo_pin, GpioModeInput, GpioPullNo, GpioSpeedVeryHigh);
+    dap_init_tdo();
     furi_hal_gpio_init(&flipper_dap_tdi_pin, GpioModeInput, GpioPullNo, GpioSpeedVeryHigh);
 #endif
 }
@@ -167,7 +179,7 @@ static inline void DAP_CONFIG_DISCONNECT(void) {
     furi_hal_gpio_init(&flipper_dap_swclk_pin, GpioModeInput, GpioPullNo, GpioSpeedVeryHigh);
     furi_hal_gpio_init(&flipper_dap_reset_pin, GpioModeInput, GpioPullNo, GpioSpeedVeryHigh);
 #ifdef DAP_CONFIG_ENABLE_JTAG
-    furi_hal_gpio_init(&flipper_dap_tdo_pin, GpioModeInput, GpioPullNo, GpioSpeedVeryHigh);
+    dap_init_tdo();
     furi_hal_gpio_init(&flipper_dap_tdi_pin, GpioModeInput, GpioPullNo, GpioSpeedVeryHigh);
 #endif
     dap_app_disconnect();
@@ -184,11 +196,11 @@ static inline void DAP_CONFIG_CONNECT_SWD(void) {
     furi_hal_gpio_write(&flipper_dap_swclk_pin, true);
 
     furi_hal_gpio_init(
-        &flipper_dap_reset_pin, GpioModeOutputPushPull, GpioPullNo, GpioSpeedVeryHigh);
+        &flipper_dap_reset_pin, flipper_dap_reset_mode, GpioPullNo, GpioSpeedVeryHigh);
     furi_hal_gpio_write(&flipper_dap_reset_pin, true);
 
 #ifdef DAP_CONFIG_ENABLE_JTAG
-    furi_hal_gpio_init(&flipper_dap_tdo_pin, GpioModeInput, GpioPullNo, GpioSpeedVeryHigh);
+    dap_init_tdo();
     furi_hal_gpio_init(&flipper_dap_tdi_pin, GpioModeInput, GpioPullNo, GpioSpeedVeryHigh);
 #endif
     dap_app_connect_swd();
@@ -205,7 +217,7 @@ static inline void DAP_CONFIG_CONNECT_JTAG(void) {
     furi_hal_gpio_write(&flipper_dap_swclk_pin, true);
 
     furi_hal_gpio_init(
-        &flipper_dap_reset_pin, GpioModeOutputPushPull, GpioPullNo, GpioSpeedVeryHigh);
+        &flipper_dap_reset_pin, flipper_dap_reset_mode, GpioPullNo, GpioSpeedVeryHigh);
     furi_hal_gpio_write(&flipper_dap_reset_pin, true);
 
 #ifdef DAP_CONFIG_ENABLE_JTAG
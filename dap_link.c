@@ -6,20 +6,62 @@
 #include <furi_hal_console.h>
 #include <furi_hal_resources.h>
 #include <furi_hal_power.h>
+#include <furi_hal_cortex.h>
 #include <stm32wbxx_ll_usart.h>
 #include <stm32wbxx_ll_lpuart.h>
 
 #include "dap_link.h"
 #include "dap_config.h"
+#include "dap_cmsis.h"
+#include "target/dap_target.h"
+#include "target/dap_reset.h"
+#include "target/dap_gang.h"
+#include "target/dap_rtt.h"
+#include "target/dap_semihost.h"
+#include "target/dap_halt.h"
+#include "target/dap_profile.h"
+#include "target/dap_scope.h"
+#include "target/dap_prefetch.h"
+#include "target/dap_script.h"
+#include "target/dap_swo.h"
+#include "vendor/dap_vendor.h"
+#include "offline/dap_program.h"
+#include "offline/dap_dump.h"
+#include "offline/dap_load.h"
+#include "offline/dap_svf.h"
+#include "helpers/dap_recorder.h"
+#include "helpers/dap_uart_dma.h"
 #include "gui/dap_gui.h"
 #include "usb/dap_v2_usb.h"
 #include <dialogs/dialogs.h>
+#include <storage/storage.h>
+#include <toolbox/saved_struct.h>
 #include "dap_link_icons.h"
 
 /***************************************************************************/
 /****************************** DAP COMMON *********************************/
 /***************************************************************************/
 
+// DAP_UART_Transport values
+typedef enum {
+    DapUartTransportNone = 0,
+    DapUartTransportCdc = 1, // USB COM port
+    DapUartTransportDap = 2, // DAP_UART_Transfer
+} DapUartTransport;
+
+// The CDC thread keeps owning the UART, DAP_UART_* only go through the buffers
+typedef struct {
+    DapUartTransport transport;
+    FuriStreamBuffer* rx; // filled from the DMA ring by cdc_bridge_uart_rx()
+    FuriStreamBuffer* tx; // DAP_UART_Transfer output
+    uint32_t baudrate;
+    uint8_t format; // DAP_UART_Configure control byte
+    bool rx_enabled;
+    bool tx_enabled;
+    volatile bool rx_lost;
+    volatile bool tx_flush;
+} DapUart;
+
 struct DapApp {
     FuriThread* dap_thread;
     FuriThread* cdc_thread;
@@ -27,6 +69,23 @@ struct DapApp {
 
     DapState state;
     DapConfig config;
+
+    uint8_t swd_port;
+    bool gang_ready;
+    uint32_t swj_clock; // last DAP_SWJ_Clock of the host
+
+    DapJob job;
+    volatile bool job_cancel;
+
+    DapCdcSource console_source;
+    FuriStreamBuffer* console_up;
+    FuriStreamBuffer* console_down;
+    uint32_t console_next_tick;
+
+    FuriStreamBuffer* stream;
+    DapRecorder* recorder;
+
+    DapUart uart;
 };
 
 void dap_app_get_state(DapApp* app, DapState* state) {
@@ -34,6 +93,19 @@ void dap_app_get_state(DapApp* app, DapState* state) {
 }
 
 #define DAP_PROCESS_THREAD_TICK 500
+#define DAP_CONSOLE_STREAM_SIZE 1024
+#define DAP_CONSOLE_RETRY_MS 1000
+#define DAP_HALT_POLL_MS 1
+#define DAP_STREAM_SIZE 4096
+#define DAP_STREAM_SLICE_US 20000
+#define DAP_SWO_POLL_US 1000
+#define DAP_UART_STREAM_SIZE 1024
+#define DAP_UART_BAUDRATE_MIN 1200
+#define DAP_UART_BAUDRATE_MAX 4000000
+
+#define DAP_USB_PROFILE_PATH DAP_APP_DATA_PATH "/usb_profile.settings"
+#define DAP_USB_PROFILE_MAGIC 0xD5
+#define DAP_USB_PROFILE_VERSION 1
 
 typedef enum {
     DapThreadEventStop = (1 << 0),
@@ -43,11 +115,32 @@ void dap_thread_send_stop(FuriThread* thread) {
     furi_thread_flags_set(furi_thread_get_id(thread), DapThreadEventStop);
 }
 
+static const uint8_t dap_usb_profile_functions[DapUsbProfileCount] = {
+    [DapUsbProfileFull] = DAP_USB_FUNCTIONS_DEFAULT,
+    [DapUsbProfileV2Cdc] = DAP_USB_FUNCTION_V2 | DAP_USB_FUNCTION_CDC,
+    [DapUsbProfileV2] = DAP_USB_FUNCTION_V2,
+    [DapUsbProfileV1Cdc] = DAP_USB_FUNCTION_V1 | DAP_USB_FUNCTION_CDC,
+    [DapUsbProfileDualCdc] = DAP_USB_FUNCTION_V2 | DAP_USB_FUNCTION_CDC | DAP_USB_FUNCTION_CDC_2,
+    [DapUsbProfileV2Swo] = DAP_USB_FUNCTION_V2 | DAP_USB_FUNCTION_STREAM,
+};
+
+// a second COM port bridges the other UART
+static bool dap_app_usb_dual_cdc(DapApp* app) {
+    return dap_usb_profile_functions[app->config.usb_profile] & DAP_USB_FUNCTION_CDC_2;
+}
+
+static void cdc_console_notify(DapApp* app);
+static void cdc_apply_config(DapApp* app);
+static void cdc_uart_tx_notify(DapApp* app);
+static void cdc_uart_configure(DapApp* app);
+
 GpioPin flipper_dap_swclk_pin;
 GpioPin flipper_dap_swdio_pin;
 GpioPin flipper_dap_reset_pin;
 GpioPin flipper_dap_tdo_pin;
 GpioPin flipper_dap_tdi_pin;
+GpioMode flipper_dap_reset_mode = GpioModeOutputPushPull;
+bool flipper_dap_tdo_swo = false;
 
 /***************************************************************************/
 /****************************** DAP PROCESS ********************************/
@@ -65,9 +158,11 @@ typedef enum {
     DAPThreadEventUSBConnect = (1 << 3),
     DAPThreadEventUSBDisconnect = (1 << 4),
     DAPThreadEventApplyConfig = (1 << 5),
+    DAPThreadEventJob = (1 << 6),
+    DAPThreadEventSwo = (1 << 7),
     DAPThreadEventAll = DAPThreadEventStop | DAPThreadEventRxV1 | DAPThreadEventRxV2 |
                         DAPThreadEventUSBConnect | DAPThreadEventUSBDisconnect |
-                        DAPThreadEventApplyConfig,
+                        DAPThreadEventApplyConfig | DAPThreadEventJob | DAPThreadEventSwo,
 } DAPThreadEvent;
 
 #define USB_SERIAL_NUMBER_LEN 16
@@ -100,12 +195,869 @@ static void dap_app_usb_state_callback(bool state, void* context) {
     }
 }
 
+static void dap_app_swo_callback(void* context) {
+    furi_assert(context);
+    FuriThreadId thread_id = (FuriThreadId)context;
+    furi_thread_flags_set(thread_id, DAPThreadEventSwo);
+}
+
+static DapApp* app_handle = NULL;
+
+#define DAP_VENDOR_RESET_FLAG_HALT (1 << 0)
+#define DAP_VENDOR_RESET_STATE_RELEASED (1 << 0)
+#define DAP_VENDOR_RESET_STATE_HALTED (1 << 1)
+
+// openocd -c "cmsis-dap cmd 81"
+size_t dap_app_vendor_power_reset(
+    void* context,
+    const uint8_t* request,
+    size_t request_size,
+    uint8_t* response,
+    size_t response_size) {
+    UNUSED(context);
+    UNUSED(request);
+    UNUSED(request_size);
+    UNUSED(response);
+    UNUSED(response_size);
+    furi_hal_power_reset();
+    return 0;
+}
+
+// openocd -c "cmsis-dap cmd 82 01"
+// request: flags, assert us, settle us, timeout us (zero keeps the default)
+// response: status, state, release us, DHCSR
+size_t dap_app_vendor_reset(
+    void* context,
+    const uint8_t* request,
+    size_t request_size,
+    uint8_t* response,
+    size_t response_size) {
+    UNUSED(response_size);
+    DapApp* app = context;
+    DapResetParams params;
+    DapResetResult result;
+    dap_reset_params_default(&params);
+
+    if(request_size >= 1) params.halt = request[0] & DAP_VENDOR_RESET_FLAG_HALT;
+    if(request_size >= 5 && dap_get_u32(&request[1])) params.assert_us = dap_get_u32(&request[1]);
+    if(request_size >= 9 && dap_get_u32(&request[5])) params.settle_us = dap_get_u32(&request[5]);
+    if(request_size >= 13 && dap_get_u32(&request[9])) {
+        params.timeout_us = dap_get_u32(&request[9]);
+    }
+
+    bool ok = dap_reset_run(&params, &result);
+    app->state.reset_release_us = result.release_us;
+
+    response[0] = ok ? DAP_STATUS_OK : DAP_STATUS_ERROR;
+    response[1] = (result.released ? DAP_VENDOR_RESET_STATE_RELEASED : 0) |
+                  (result.halted ? DAP_VENDOR_RESET_STATE_HALTED : 0);
+    dap_put_u32(&response[2], result.release_us);
+    dap_put_u32(&response[6], result.dhcsr);
+    return 10;
+}
+
+#define DAP_SWD_PORT_A 0
+#define DAP_SWD_PORT_B 1
+#define DAP_SWD_PORT_AUTO 0xFF
+
+static const DapSwdPort dap_swd_ports[DAP_GANG_PORT_COUNT] = {
+    [DAP_SWD_PORT_A] =
+        {
+            .swclk = {.port = GPIOA, .pin = LL_GPIO_PIN_7},
+            .swdio = {.port = GPIOA, .pin = LL_GPIO_PIN_6},
+        },
+    [DAP_SWD_PORT_B] =
+        {
+            .swclk = {.port = GPIOA, .pin = LL_GPIO_PIN_14},
+            .swdio = {.port = GPIOA, .pin = LL_GPIO_PIN_13},
+        },
+};
+
+static void dap_app_select_port(uint8_t port) {
+    if(flipper_dap_swdio_pin.port != dap_swd_ports[port].swdio.port ||
+       flipper_dap_swdio_pin.pin != dap_swd_ports[port].swdio.pin) {
+        dap_prefetch_invalidate();
+    }
+    flipper_dap_swclk_pin = dap_swd_ports[port].swclk;
+    flipper_dap_swdio_pin = dap_swd_ports[port].swdio;
+}
+
+// openocd -c "cmsis-dap cmd 83 01", 0xFF maps V1 to port A and V2 to port B
+size_t dap_app_vendor_select_port(
+    void* context,
+    const uint8_t* request,
+    size_t request_size,
+    uint8_t* response,
+    size_t response_size) {
+    UNUSED(response_size);
+    DapApp* app = context;
+    response[0] = DAP_STATUS_ERROR;
+
+    if(app->config.swd_pins == DapSwdPinsDual && request_size >= 1 &&
+       (request[0] < DAP_GANG_PORT_COUNT || request[0] == DAP_SWD_PORT_AUTO)) {
+        app->swd_port = request[0];
+        response[0] = DAP_STATUS_OK;
+    }
+    return 1;
+}
+
+typedef enum {
+    DapVendorGangConnect,
+    DapVendorGangWrite,
+    DapVendorGangWriteBlock,
+    DapVendorGangStatus,
+} DapVendorGangOp;
+
+// same scale as Free-DAP's DAP_SWJ_Clock, 0 runs without added delays
+static uint32_t dap_app_clock_delay(uint32_t clock) {
+    if(clock == 0 || clock > DAP_CONFIG_FAST_CLOCK) return 0;
+    return (DAP_CONFIG_DELAY_CONSTANT * 1000) / clock;
+}
+
+// request: op, op arguments
+// response: status, active ports, ACK per port, errors per port, DPIDR per port
+size_t dap_app_vendor_gang(
+    void* context,
+    const uint8_t* request,
+    size_t request_size,
+    uint8_t* response,
+    size_t response_size) {
+    UNUSED(response_size);
+    DapApp* app = context;
+    uint32_t idcode[DAP_GANG_PORT_COUNT] = {0};
+    bool ok = false;
+
+    if(app->config.swd_pins == DapSwdPinsDual && request_size >= 1) {
+        switch(request[0]) {
+        case DapVendorGangConnect:
+            app->gang_ready =
+                dap_gang_init(dap_swd_ports, dap_app_clock_delay(app->swj_clock));
+            ok = app->gang_ready && dap_gang_connect(idcode);
+            break;
+        case DapVendorGangWrite:
+            // count, {request, value} * count
+            if(app->gang_ready && request_size >= 2 && request_size >= 2 + request[1] * 5U) {
+                ok = true;
+                for(size_t i = 0; i < request[1]; i++) {
+                    const uint8_t* transfer = &request[2 + i * 5];
+                    ok &= dap_gang_write(transfer[0], dap_get_u32(&transfer[1])) != 0;
+                }
+            }
+            break;
+        case DapVendorGangWriteBlock:
+            // address, data words
+            if(app->gang_ready && request_size >= 9 && (dap_get_u32(&request[1]) & 3) == 0) {
+                uint32_t data[(DAP_CONFIG_PACKET_SIZE - 6) / 4];
+                size_t count = (request_size - 5) / 4;
+                for(size_t i = 0; i < count; i++) {
+                    data[i] = dap_get_u32(&request[5 + i * 4]);
+                }
+                ok = dap_gang_write_block(dap_get_u32(&request[1]), data, count) != 0;
+            }
+            break;
+        case DapVendorGangStatus:
+            ok = app->gang_ready;
+            break;
+        }
+    }
+
+    DapGangStatus status = {0};
+    if(app->gang_ready) dap_gang_get_status(&status);
+
+    response[0] = ok ? DAP_STATUS_OK : DAP_STATUS_ERROR;
+    response[1] = status.active;
+    for(size_t i = 0; i < DAP_GANG_PORT_COUNT; i++) {
+        response[2 + i] = status.ack[i];
+        dap_put_u16(&response[4 + i * 2], status.errors[i]);
+        dap_put_u32(&response[8 + i * 4], idcode[i]);
+    }
+    return 16;
+}
+
+typedef enum {
+    DapVendorRttStart,
+    DapVendorRttStop,
+    DapVendorRttStatus,
+} DapVendorRttOp;
+
+static void dap_app_console_start(
+    DapApp* app,
+    DapCdcSource source,
+    uint32_t address,
+    uint32_t size) {
+    app->console_source = source;
+    app->config.cdc_source = source;
+    dap_rtt_stop();
+    dap_semihost_stop();
+    furi_stream_buffer_reset(app->console_up);
+    furi_stream_buffer_reset(app->console_down);
+    app->console_next_tick = furi_get_tick();
+
+    if(source == DapCdcSourceRtt) {
+        dap_rtt_start(address, size);
+    } else if(source == DapCdcSourceSemihost) {
+        dap_semihost_start();
+    }
+}
+
+// request: op, scan address and scan size for start (optional)
+// response: status, control block, up bytes, down bytes, poll interval in ms
+size_t dap_app_vendor_rtt(
+    void* context,
+    const uint8_t* request,
+    size_t request_size,
+    uint8_t* response,
+    size_t response_size) {
+    UNUSED(response_size);
+    DapApp* app = context;
+    bool ok = false;
+
+    if(request_size >= 1) {
+        switch(request[0]) {
+        case DapVendorRttStart:
+            if(request_size >= 9) {
+                dap_app_console_start(
+                    app, DapCdcSourceRtt, dap_get_u32(&request[1]), dap_get_u32(&request[5]));
+            } else {
+                dap_app_console_start(
+                    app,
+                    DapCdcSourceRtt,
+                    DAP_RTT_SCAN_ADDRESS_DEFAULT,
+                    DAP_RTT_SCAN_SIZE_DEFAULT);
+            }
+            ok = true;
+            break;
+        case DapVendorRttStop:
+            dap_app_console_start(app, DapCdcSourceUart, 0, 0);
+            ok = true;
+            break;
+        case DapVendorRttStatus:
+            ok = dap_rtt_is_active();
+            break;
+        }
+    }
+
+    DapRttStatus status;
+    dap_rtt_get_status(&status);
+
+    response[0] = ok ? DAP_STATUS_OK : DAP_STATUS_ERROR;
+    dap_put_u32(&response[1], status.control_block);
+    dap_put_u32(&response[5], status.up_bytes);
+    dap_put_u32(&response[9], status.down_bytes);
+    dap_put_u32(&response[13], status.interval_ms);
+    return 17;
+}
+
+typedef enum {
+    DapVendorHaltArm,
+    DapVendorHaltWait,
+    DapVendorHaltDisarm,
+    DapVendorHaltStatus,
+} DapVendorHaltOp;
+
+#define DAP_VENDOR_HALT_WAIT_MS_DEFAULT 100
+#define DAP_VENDOR_HALT_FLAG_ARMED (1 << 0)
+#define DAP_VENDOR_HALT_FLAG_HALTED (1 << 1)
+
+// another request is queued, engines hand the DAP thread back so it can run
+static bool dap_app_request_pending(void* context) {
+    UNUSED(context);
+    const uint32_t queued = DAPThreadEventRxV1 | DAPThreadEventRxV2 | DAPThreadEventStop;
+    return (furi_thread_flags_get() & queued) != 0;
+}
+
+// openocd -c "cmsis-dap cmd 8A 01 E8 03"
+// request: op, wait timeout in ms (optional)
+// response: status, flags, DHCSR, DFSR, polls, us since the halt was seen
+size_t dap_app_vendor_halt(
+    void* context,
+    const uint8_t* request,
+    size_t request_size,
+    uint8_t* response,
+    size_t response_size) {
+    UNUSED(context);
+    UNUSED(response_size);
+    bool ok = false;
+
+    if(request_size >= 1) {
+        switch(request[0]) {
+        case DapVendorHaltArm:
+            dap_halt_arm();
+            ok = true;
+            break;
+        case DapVendorHaltWait: {
+            uint32_t timeout_ms = request_size >= 3 ? dap_get_u16(&request[1]) :
+                                                      DAP_VENDOR_HALT_WAIT_MS_DEFAULT;
+            // an armed watcher may already hold the halt
+            DapHaltStatus status;
+            dap_halt_get_status(&status);
+            if(!status.armed) dap_halt_arm();
+            ok = dap_halt_wait(timeout_ms * 1000, dap_app_request_pending, NULL);
+            break;
+        }
+        case DapVendorHaltDisarm:
+            dap_halt_disarm();
+            ok = true;
+            break;
+        case DapVendorHaltStatus:
+            ok = true;
+            break;
+        }
+    }
+
+    DapHaltStatus status;
+    dap_halt_get_status(&status);
+    uint32_t age_us = 0;
+    if(status.halted) {
+        age_us = (DWT->CYCCNT - status.halt_tick) / furi_hal_cortex_instructions_per_microsecond();
+    }
+
+    response[0] = ok ? DAP_STATUS_OK : DAP_STATUS_ERROR;
+    response[1] = (status.armed ? DAP_VENDOR_HALT_FLAG_ARMED : 0) |
+                  (status.halted ? DAP_VENDOR_HALT_FLAG_HALTED : 0);
+    dap_put_u32(&response[2], status.dhcsr);
+    dap_put_u32(&response[6], status.dfsr);
+    dap_put_u32(&response[10], status.polls);
+    dap_put_u32(&response[14], age_us);
+    return 18;
+}
+
+typedef enum {
+    DapStreamOutputUsb,
+    DapStreamOutputFile,
+} DapStreamOutput;
+
+static void dap_app_stream_close(DapApp* app) {
+    if(app->recorder) {
+        uint32_t written = dap_recorder_free(app->recorder);
+        FURI_LOG_I("DAP", "Stream recorded, %lu bytes", written);
+        app->recorder = NULL;
+    }
+}
+
+// the stream has a single producer at a time, a new one stops whoever owns it
+static void dap_app_stream_claim(void) {
+    dap_profile_stop();
+    dap_scope_stop();
+    if(dap_swo_get_transport() == DapSwoTransportStream) dap_swo_control(false);
+}
+
+static bool dap_app_stream_open(DapApp* app, DapStreamOutput output, const char* name) {
+    dap_app_stream_close(app);
+    furi_stream_buffer_reset(app->stream);
+    if(output == DapStreamOutputUsb) return true;
+
+    FuriString* path = furi_string_alloc_printf("%s/%s", DAP_APP_DATA_PATH, name);
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    storage_simply_mkdir(storage, DAP_APP_DATA_PATH);
+    furi_record_close(RECORD_STORAGE);
+
+    app->recorder = dap_recorder_alloc(furi_string_get_cstr(path), app->stream);
+    furi_string_free(path);
+    return app->recorder != NULL;
+}
+
+typedef enum {
+    DapVendorProfileStart,
+    DapVendorProfileStop,
+    DapVendorProfileStatus,
+} DapVendorProfileOp;
+
+#define DAP_VENDOR_PROFILE_FILE "profile.pcs"
+
+// request: op, rate in Hz and output (0 USB stream, 1 SD card) for start
+// response: status, active, samples, dropped, idle samples, errors
+size_t dap_app_vendor_profile(
+    void* context,
+    const uint8_t* request,
+    size_t request_size,
+    uint8_t* response,
+    size_t response_size) {
+    UNUSED(response_size);
+    DapApp* app = context;
+    bool ok = false;
+
+    if(request_size >= 1) {
+        switch(request[0]) {
+        case DapVendorProfileStart:
+            if(request_size >= 6) {
+                dap_app_stream_claim();
+                ok = (app->state.dap_mode == DapModeSWD || dap_target_connect(NULL)) &&
+                     dap_app_stream_open(app, request[5], DAP_VENDOR_PROFILE_FILE) &&
+                     dap_profile_start(dap_get_u32(&request[1]), app->stream);
+            }
+            break;
+        case DapVendorProfileStop:
+            if(dap_profile_is_active()) {
+                dap_profile_stop();
+                dap_app_stream_close(app);
+            }
+            ok = true;
+            break;
+        case DapVendorProfileStatus:
+            ok = true;
+            break;
+        }
+    }
+
+    DapProfileStatus status;
+    dap_profile_get_status(&status);
+
+    response[0] = ok ? DAP_STATUS_OK : DAP_STATUS_ERROR;
+    response[1] = status.active;
+    dap_put_u32(&response[2], status.samples);
+    dap_put_u32(&response[6], status.dropped);
+    dap_put_u32(&response[10], status.idle);
+    dap_put_u32(&response[14], status.errors);
+    return 18;
+}
+
+typedef enum {
+    DapVendorScopeClear,
+    DapVendorScopeAdd,
+    DapVendorScopeStart,
+    DapVendorScopeStop,
+    DapVendorScopeStatus,
+} DapVendorScopeOp;
+
+#define DAP_VENDOR_SCOPE_FILE "scope.dsc"
+
+// request: op, then {address u32, width u8} entries for add,
+// rate in Hz and output (0 USB stream, 1 SD card) for start
+// response: status, active, entries, records, dropped, errors
+size_t dap_app_vendor_scope(
+    void* context,
+    const uint8_t* request,
+    size_t request_size,
+    uint8_t* response,
+    size_t response_size) {
+    UNUSED(response_size);
+    DapApp* app = context;
+    bool ok = false;
+
+    if(request_size >= 1) {
+        switch(request[0]) {
+        case DapVendorScopeClear:
+            dap_scope_clear();
+            ok = !dap_scope_is_active();
+            break;
+        case DapVendorScopeAdd:
+            ok = !dap_scope_is_active();
+            for(size_t i = 1; i + 5 <= request_size && ok; i += 5) {
+                ok = dap_scope_add(dap_get_u32(&request[i]), request[i + 4]);
+            }
+            break;
+        case DapVendorScopeStart:
+            if(request_size >= 6) {
+                dap_app_stream_claim();
+                ok = (app->state.dap_mode == DapModeSWD || dap_target_connect(NULL)) &&
+                     dap_app_stream_open(app, request[5], DAP_VENDOR_SCOPE_FILE) &&
+                     dap_scope_start(dap_get_u32(&request[1]), app->stream);
+            }
+            break;
+        case DapVendorScopeStop:
+            // the stream may belong to another producer
+            if(dap_scope_is_active()) {
+                dap_scope_stop();
+                dap_app_stream_close(app);
+            }
+            ok = true;
+            break;
+        case DapVendorScopeStatus:
+            ok = true;
+            break;
+        }
+    }
+
+    DapScopeStatus status;
+    dap_scope_get_status(&status);
+
+    response[0] = ok ? DAP_STATUS_OK : DAP_STATUS_ERROR;
+    response[1] = status.active;
+    response[2] = status.entries;
+    dap_put_u32(&response[3], status.records);
+    dap_put_u32(&response[7], status.dropped);
+    dap_put_u32(&response[11], status.errors);
+    return 15;
+}
+
+typedef enum {
+    DapVendorScriptLoad,
+    DapVendorScriptLoadFile,
+    DapVendorScriptRun,
+    DapVendorScriptStatus,
+} DapVendorScriptOp;
+
+#define DAP_VENDOR_SCRIPT_NAME_MAX 32
+#define DAP_VENDOR_SCRIPT_ARGS_MAX 8
+
+static bool dap_app_script_load_file(const char* name) {
+    if(strstr(name, "..")) return false;
+
+    FuriString* path = furi_string_alloc_printf("%s/%s", DAP_APP_DATA_PATH, name);
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    File* file = storage_file_alloc(storage);
+    bool ok = storage_file_open(file, furi_string_get_cstr(path), FSAM_READ, FSOM_OPEN_EXISTING);
+
+    uint8_t chunk[64];
+    size_t offset = 0;
+    while(ok) {
+        size_t len = storage_file_read(file, chunk, sizeof(chunk));
+        if(len == 0 && offset > 0) break;
+        ok = len > 0 && dap_script_load(offset, chunk, len);
+        offset += len;
+    }
+
+    storage_file_close(file);
+    storage_file_free(file);
+    furi_record_close(RECORD_STORAGE);
+    furi_string_free(path);
+    return ok;
+}
+
+static size_t dap_app_script_status(uint8_t* response) {
+    DapScriptStatus status;
+    dap_script_get_status(&status);
+
+    response[0] = status.result == DapScriptResultOk ? DAP_STATUS_OK : DAP_STATUS_ERROR;
+    response[1] = status.result;
+    response[2] = status.code;
+    dap_put_u16(&response[3], status.pc);
+    dap_put_u32(&response[5], status.steps);
+    response[9] = status.depth;
+    for(size_t i = 0; i < status.depth; i++) {
+        dap_put_u32(&response[10 + i * 4], status.stack[i]);
+    }
+    return 10 + status.depth * 4;
+}
+
+// request: op, then offset and bytes for load, a name below the app data
+// directory for load file, timeout in ms and arguments for run
+// response: status, script size or result, code, pc, steps, stack
+size_t dap_app_vendor_script(
+    void* context,
+    const uint8_t* request,
+    size_t request_size,
+    uint8_t* response,
+    size_t response_size) {
+    UNUSED(response_size);
+    DapApp* app = context;
+
+    if(request_size >= 1) {
+        switch(request[0]) {
+        case DapVendorScriptLoad: {
+            bool ok = request_size >= 3 &&
+                      dap_script_load(dap_get_u16(&request[1]), &request[3], request_size - 3);
+            response[0] = ok ? DAP_STATUS_OK : DAP_STATUS_ERROR;
+            dap_put_u16(&response[1], dap_script_get_size());
+            return 3;
+        }
+        case DapVendorScriptLoadFile: {
+            char name[DAP_VENDOR_SCRIPT_NAME_MAX + 1];
+            size_t len = MIN(request_size - 1, (size_t)DAP_VENDOR_SCRIPT_NAME_MAX);
+            memcpy(name, &request[1], len);
+            name[len] = '\0';
+
+            bool ok = len > 0 && dap_app_script_load_file(name);
+            response[0] = ok ? DAP_STATUS_OK : DAP_STATUS_ERROR;
+            dap_put_u16(&response[1], ok ? dap_script_get_size() : 0);
+            return 3;
+        }
+        case DapVendorScriptRun: {
+            if(request_size < 3) break;
+            uint32_t args[DAP_VENDOR_SCRIPT_ARGS_MAX];
+            size_t count = MIN((request_size - 3) / 4, (size_t)DAP_VENDOR_SCRIPT_ARGS_MAX);
+            for(size_t i = 0; i < count; i++) {
+                args[i] = dap_get_u32(&request[3 + i * 4]);
+            }
+            dap_script_run(
+                args,
+                count,
+                dap_get_u16(&request[1]),
+                app->state.dap_mode == DapModeSWD,
+                dap_app_request_pending,
+                NULL);
+            return dap_app_script_status(response);
+        }
+        case DapVendorScriptStatus:
+            return dap_app_script_status(response);
+        }
+    }
+
+    response[0] = DAP_STATUS_ERROR;
+    return 1;
+}
+
+// SWO goes to the RX pin of the UART the CDC bridges leave free, if there is one
+static void dap_app_swo_set_uart(DapApp* app) {
+    if(dap_app_usb_dual_cdc(app)) {
+        dap_swo_set_uart(DapSwoUartNone);
+    } else if(app->config.uart_pins == DapUartTypeUSART1) {
+        dap_swo_set_uart(DapSwoUartLpuart1);
+    } else {
+        dap_swo_set_uart(DapSwoUartUsart1);
+    }
+}
+
+// Free-DAP has no SWO, so the DAP_SWO_* commands are answered here
+static bool dap_app_swo_request(
+    DapApp* app,
+    const uint8_t* request,
+    size_t request_size,
+    uint8_t* response,
+    size_t response_size,
+    size_t* len) {
+    bool ok = false;
+    uint32_t count;
+
+    if(request_size < 1) return false;
+    response[0] = request[0];
+
+    switch(request[0]) {
+    case DAP_CMD_INFO:
+        if(request_size < 2 || request[1] != DAP_INFO_SWO_BUFFER_SIZE) return false;
+        response[1] = 4;
+        dap_put_u32(&response[2], DAP_SWO_BUFFER_SIZE);
+        *len = 6;
+        return true;
+    case DAP_CMD_SWO_TRANSPORT:
+        // the stream endpoint is not there in every USB profile
+        ok = request_size >= 2 &&
+             (request[1] != DapSwoTransportStream ||
+              dap_common_usb_has_function(DAP_USB_FUNCTION_STREAM)) &&
+             dap_swo_set_transport(request[1]);
+        break;
+    case DAP_CMD_SWO_MODE:
+        dap_app_swo_set_uart(app);
+        ok = request_size >= 2 && dap_swo_set_mode(request[1]);
+        break;
+    case DAP_CMD_SWO_BAUDRATE:
+        count = request_size >= 5 ? dap_swo_set_baudrate(dap_get_u32(&request[1])) : 0;
+        dap_put_u32(&response[1], count);
+        *len = 5;
+        return true;
+    case DAP_CMD_SWO_CONTROL:
+        if(request_size < 2) break;
+        if(request[1] && dap_swo_get_transport() == DapSwoTransportStream &&
+           !dap_swo_is_active()) {
+            dap_app_stream_claim();
+            dap_app_stream_open(app, DapStreamOutputUsb, NULL);
+        }
+        ok = dap_swo_control(request[1]);
+        break;
+    case DAP_CMD_SWO_STATUS:
+        response[1] = dap_swo_get_status(&count);
+        dap_put_u32(&response[2], count);
+        *len = 6;
+        return true;
+    case DAP_CMD_SWO_DATA: {
+        size_t size = 0;
+        // with the streaming transport the data only goes to the trace endpoint
+        if(request_size >= 3 && dap_swo_get_transport() == DapSwoTransportData) {
+            size = dap_swo_read(&response[4], MIN(dap_get_u16(&request[1]), response_size - 4));
+        }
+        response[1] = dap_swo_get_status(&count);
+        dap_put_u16(&response[2], size);
+        *len = 4 + size;
+        return true;
+    }
+    default:
+        return false;
+    }
+
+    response[1] = ok ? DAP_STATUS_OK : DAP_STATUS_ERROR;
+    *len = 2;
+    return true;
+}
+
+static void dap_app_uart_set_transport(DapApp* app, DapUartTransport transport) {
+    DapUart* uart = &app->uart;
+    uart->rx_enabled = true;
+    uart->tx_enabled = true;
+    uart->transport = transport;
+}
+
+static uint8_t dap_app_uart_check_format(DapApp* app, uint8_t format) {
+    const uint8_t parity = format & DAP_UART_FORMAT_PARITY_MASK;
+    const uint8_t stop_bits = format & DAP_UART_FORMAT_STOP_BITS_MASK;
+    uint8_t errors = 0;
+
+    if(format & DAP_UART_FORMAT_DATA_BITS_MASK) errors |= DAP_UART_FORMAT_ERROR_DATA_BITS;
+    if(parity > DAP_UART_FORMAT_PARITY_EVEN) errors |= DAP_UART_FORMAT_ERROR_PARITY;
+    // LPUART has no 1.5 stop bits
+    if(stop_bits > DAP_UART_FORMAT_STOP_BITS_2 ||
+       (stop_bits == DAP_UART_FORMAT_STOP_BITS_1_5 &&
+        app->config.uart_pins == DapUartTypeLPUART1)) {
+        errors |= DAP_UART_FORMAT_ERROR_STOP_BITS;
+    }
+    return errors;
+}
+
+static void dap_app_uart_control(DapApp* app, uint8_t control) {
+    DapUart* uart = &app->uart;
+
+    if(control & DAP_UART_CONTROL_RX_ENABLE) uart->rx_enabled = true;
+    if(control & DAP_UART_CONTROL_RX_DISABLE) uart->rx_enabled = false;
+    if(control & DAP_UART_CONTROL_TX_ENABLE) uart->tx_enabled = true;
+    if(control & DAP_UART_CONTROL_TX_DISABLE) uart->tx_enabled = false;
+
+    // only the DAP thread reads RX with this transport, TX is always drained by the CDC thread
+    if((control & DAP_UART_CONTROL_RX_FLUSH) && uart->transport == DapUartTransportDap) {
+        furi_stream_buffer_reset(uart->rx);
+        uart->rx_lost = false;
+    }
+    if(control & DAP_UART_CONTROL_TX_FLUSH) {
+        uart->tx_flush = true;
+        cdc_uart_tx_notify(app);
+    }
+}
+
+static uint8_t dap_app_uart_status(DapUart* uart) {
+    uint8_t status = 0;
+    if(uart->rx_enabled) status |= DAP_UART_STATUS_RX_ENABLED;
+    if(uart->rx_lost) status |= DAP_UART_STATUS_RX_DATA_LOST;
+    if(uart->tx_enabled) status |= DAP_UART_STATUS_TX_ENABLED;
+    return status;
+}
+
+// DAP_UART_* reach the target UART of the CDC bridge through the shared buffers
+static bool dap_app_uart_request(
+    DapApp* app,
+    const uint8_t* request,
+    size_t request_size,
+    uint8_t* response,
+    size_t response_size,
+    size_t* len) {
+    DapUart* uart = &app->uart;
+    bool ok = false;
+
+    if(request_size < 1) return false;
+    response[0] = request[0];
+
+    switch(request[0]) {
+    case DAP_CMD_INFO:
+        if(request_size < 2 || (request[1] != DAP_INFO_UART_RX_BUFFER_SIZE &&
+                                request[1] != DAP_INFO_UART_TX_BUFFER_SIZE)) {
+            return false;
+        }
+        response[1] = 4;
+        dap_put_u32(&response[2], DAP_UART_STREAM_SIZE);
+        *len = 6;
+        return true;
+    case DAP_CMD_UART_TRANSPORT:
+        ok = request_size >= 2 && request[1] <= DapUartTransportDap;
+        if(ok) dap_app_uart_set_transport(app, request[1]);
+        break;
+    case DAP_CMD_UART_CONFIGURE: {
+        if(request_size < 6) break;
+        uint32_t baudrate = dap_get_u32(&request[2]);
+        response[1] = dap_app_uart_check_format(app, request[1]);
+        if(baudrate < DAP_UART_BAUDRATE_MIN || baudrate > DAP_UART_BAUDRATE_MAX) baudrate = 0;
+        if(response[1] == 0 && baudrate) {
+            uart->format = request[1];
+            uart->baudrate = baudrate;
+            cdc_uart_configure(app);
+        }
+        dap_put_u32(&response[2], baudrate);
+        *len = 6;
+        return true;
+    }
+    case DAP_CMD_UART_CONTROL:
+        ok = request_size >= 2;
+        if(ok) dap_app_uart_control(app, request[1]);
+        break;
+    case DAP_CMD_UART_STATUS:
+        response[1] = dap_app_uart_status(uart);
+        uart->rx_lost = false;
+        dap_put_u32(&response[2], furi_stream_buffer_bytes_available(uart->rx));
+        dap_put_u32(&response[6], furi_stream_buffer_bytes_available(uart->tx));
+        *len = 10;
+        return true;
+    case DAP_CMD_UART_TRANSFER: {
+        size_t tx_size = 0;
+        size_t rx_size = 0;
+        // whole chunks in both directions, the stream buffers copy across their wrap
+        if(uart->transport == DapUartTransportDap) {
+            if(request_size >= 3 && uart->tx_enabled) {
+                tx_size = MIN(dap_get_u16(&request[1]), request_size - 3);
+                tx_size = furi_stream_buffer_send(uart->tx, &request[3], tx_size, 0);
+                if(tx_size > 0) cdc_uart_tx_notify(app);
+            }
+            rx_size = furi_stream_buffer_receive(uart->rx, &response[6], response_size - 6, 0);
+            app->state.cdc_rx_counter += rx_size;
+        }
+        response[1] = dap_app_uart_status(uart);
+        dap_put_u16(&response[2], tx_size);
+        dap_put_u16(&response[4], rx_size);
+        *len = 6 + rx_size;
+        return true;
+    }
+    default:
+        return false;
+    }
+
+    response[1] = ok ? DAP_STATUS_OK : DAP_STATUS_ERROR;
+    *len = 2;
+    return true;
+}
+
+// Free-DAP only reports SWD and JTAG
+static void dap_app_patch_info(const uint8_t* rx, size_t rx_size, uint8_t* tx) {
+    if(rx_size >= 2 && rx[0] == DAP_CMD_INFO && rx[1] == DAP_INFO_CAPABILITIES && tx[1] >= 1) {
+        tx[2] |= DAP_INFO_CAP_SWO_MANCHESTER | DAP_INFO_CAP_UART;
+        if(!dap_app_usb_dual_cdc(app_handle)) {
+            tx[2] |= DAP_INFO_CAP_SWO_UART;
+        }
+        if(dap_common_usb_has_function(DAP_USB_FUNCTION_STREAM)) {
+            tx[2] |= DAP_INFO_CAP_SWO_STREAM;
+        }
+    }
+}
+
+static size_t dap_app_process_request(uint8_t* rx, size_t rx_size, uint8_t* tx, size_t tx_size) {
+    size_t len;
+    if(dap_prefetch_request(rx, rx_size, tx, &len)) {
+        return len;
+    }
+    if(dap_app_swo_request(app_handle, rx, rx_size, tx, tx_size, &len)) {
+        return len;
+    }
+    if(dap_app_uart_request(app_handle, rx, rx_size, tx, tx_size, &len)) {
+        return len;
+    }
+    // vendor commands drive the SWD engine themselves, so they can't run inside Free-DAP
+    if(dap_vendor_process(app_handle, rx, rx_size, tx, tx_size, &len)) {
+        dap_prefetch_invalidate();
+        return len;
+    }
+    len = dap_process_request(rx, rx_size, tx, tx_size);
+    if(rx_size >= 5 && rx[0] == DAP_CMD_SWJ_CLOCK && tx[1] == DAP_STATUS_OK) {
+        app_handle->swj_clock = dap_get_u32(&rx[1]);
+    }
+    dap_prefetch_observe(rx, rx_size, tx);
+    dap_app_patch_info(rx, rx_size, tx);
+    return len;
+}
+
+static void dap_app_route_port(DapApp* app, DapVersion version) {
+    if(app->config.swd_pins != DapSwdPinsDual) return;
+
+    if(app->swd_port != DAP_SWD_PORT_AUTO) {
+        dap_app_select_port(app->swd_port);
+    } else if(version == DapVersionV1) {
+        dap_app_select_port(DAP_SWD_PORT_A);
+    } else {
+        dap_app_select_port(DAP_SWD_PORT_B);
+    }
+}
+
 static void dap_app_process_v1() {
     DapPacket tx_packet;
     DapPacket rx_packet;
     memset(&tx_packet, 0, sizeof(DapPacket));
     rx_packet.size = dap_v1_usb_rx(rx_packet.data, DAP_CONFIG_PACKET_SIZE);
-    dap_process_request(rx_packet.data, rx_packet.size, tx_packet.data, DAP_CONFIG_PACKET_SIZE);
+    dap_app_process_request(
+        rx_packet.data, rx_packet.size, tx_packet.data, DAP_CONFIG_PACKET_SIZE);
     dap_v1_usb_tx(tx_packet.data, DAP_CONFIG_PACKET_SIZE);
 }
 
@@ -114,31 +1066,37 @@ static void dap_app_process_v2() {
     DapPacket rx_packet;
     memset(&tx_packet, 0, sizeof(DapPacket));
     rx_packet.size = dap_v2_usb_rx(rx_packet.data, DAP_CONFIG_PACKET_SIZE);
-    size_t len = dap_process_request(
+    size_t len = dap_app_process_request(
         rx_packet.data, rx_packet.size, tx_packet.data, DAP_CONFIG_PACKET_SIZE);
     dap_v2_usb_tx(tx_packet.data, len);
 }
 
 void dap_app_vendor_cmd(uint8_t cmd) {
-    // openocd -c "cmsis-dap cmd 81"
-    if(cmd == 0x01) {
-        furi_hal_power_reset();
-    }
+    // registered vendor commands never reach Free-DAP
+    FURI_LOG_W("DAP", "Unhandled vendor command %02X", cmd);
 }
 
 void dap_app_target_reset() {
-    FURI_LOG_I("DAP", "Target reset");
+    DapResetParams params;
+    DapResetResult result;
+    dap_reset_params_default(&params);
+    dap_reset_pulse(&params, &result);
+    app_handle->state.reset_release_us = result.release_us;
+    FURI_LOG_I("DAP", "Target reset, released in %luus", result.release_us);
+}
+
+static GpioMode dap_reset_drive_mode(DapResetDrive drive) {
+    return drive == DapResetDriveOpenDrain ? GpioModeOutputOpenDrain : GpioModeOutputPushPull;
 }
 
 static void dap_init_gpio(DapSwdPins swd_pins) {
     switch(swd_pins) {
     case DapSwdPinsPA7PA6:
-        flipper_dap_swclk_pin = gpio_ext_pa7;
-        flipper_dap_swdio_pin = gpio_ext_pa6;
+    case DapSwdPinsDual:
+        dap_app_select_port(DAP_SWD_PORT_A);
         break;
     case DapSwdPinsPA14PA13:
-        flipper_dap_swclk_pin = (GpioPin){.port = GPIOA, .pin = LL_GPIO_PIN_14};
-        flipper_dap_swdio_pin = (GpioPin){.port = GPIOA, .pin = LL_GPIO_PIN_13};
+        dap_app_select_port(DAP_SWD_PORT_B);
         break;
     }
 
@@ -153,26 +1111,165 @@ static void dap_deinit_gpio(DapSwdPins swd_pins) {
     furi_hal_gpio_init(&flipper_dap_tdo_pin, GpioModeAnalog, GpioPullNo, GpioSpeedLow);
     furi_hal_gpio_init(&flipper_dap_tdi_pin, GpioModeAnalog, GpioPullNo, GpioSpeedLow);
 
-    if(DapSwdPinsPA14PA13 == swd_pins) {
+    if(swd_pins != DapSwdPinsPA7PA6) {
         // PA14 and PA13 are used by SWD
+        const DapSwdPort* port = &dap_swd_ports[DAP_SWD_PORT_B];
         furi_hal_gpio_init_ex(
-            &flipper_dap_swclk_pin,
+            &port->swclk,
             GpioModeAltFunctionPushPull,
             GpioPullDown,
             GpioSpeedLow,
             GpioAltFn0JTCK_SWCLK);
         furi_hal_gpio_init_ex(
-            &flipper_dap_swdio_pin,
+            &port->swdio,
             GpioModeAltFunctionPushPull,
             GpioPullUp,
             GpioSpeedVeryHigh,
             GpioAltFn0JTMS_SWDIO);
+    }
+
+    if(swd_pins != DapSwdPinsPA14PA13) {
+        const DapSwdPort* port = &dap_swd_ports[DAP_SWD_PORT_A];
+        furi_hal_gpio_init(&port->swclk, GpioModeAnalog, GpioPullNo, GpioSpeedLow);
+        furi_hal_gpio_init(&port->swdio, GpioModeAnalog, GpioPullNo, GpioSpeedLow);
+    }
+}
+
+static void dap_app_run_job(DapApp* app) {
+    DapJobProgress* progress = &app->state.job;
+    bool ok = false;
+
+    dap_prefetch_invalidate();
+    switch(app->job.type) {
+    case DapJobTypeProgram:
+        ok = dap_program_run(app->job.image_path, app->job.algo_path, progress, &app->job_cancel);
+        break;
+    case DapJobTypeDump:
+        ok = dap_dump_run(
+            app->job.image_path, app->job.address, app->job.size, progress, &app->job_cancel);
+        break;
+    case DapJobTypeLoad:
+        ok = dap_load_run(app->job.image_path, app->job.address, progress, &app->job_cancel);
+        break;
+    case DapJobTypeSvf:
+        ok = dap_svf_run(app->job.image_path, progress, &app->job_cancel);
+        break;
+    }
+
+    if(app->job_cancel) {
+        progress->status = DapJobStatusCanceled;
     } else {
-        furi_hal_gpio_init(&flipper_dap_swclk_pin, GpioModeAnalog, GpioPullNo, GpioSpeedLow);
-        furi_hal_gpio_init(&flipper_dap_swdio_pin, GpioModeAnalog, GpioPullNo, GpioSpeedLow);
+        progress->status = ok ? DapJobStatusDone : DapJobStatusFailed;
     }
 }
 
+// returns the time until the next poll is due
+static uint32_t dap_app_console_service(DapApp* app) {
+    bool rtt = dap_rtt_is_active();
+    if(!rtt && !dap_semihost_is_active()) return FuriWaitForever;
+
+    uint32_t now = furi_get_tick();
+    if((int32_t)(app->console_next_tick - now) > 0) return app->console_next_tick - now;
+
+    bool linked;
+    if(rtt) {
+        DapRttStatus status;
+        dap_rtt_get_status(&status);
+        linked = status.control_block != 0;
+    } else {
+        DapSemihostStatus status;
+        dap_semihost_get_status(&status);
+        linked = status.attached;
+    }
+
+    uint32_t delay;
+    if(app->state.dap_mode == DapModeJTAG) {
+        delay = DAP_CONSOLE_RETRY_MS;
+    } else if(
+        (app->state.dap_mode != DapModeSWD ||
+         (!linked && app->state.dap_version == DapVersionUnknown)) &&
+        !dap_target_connect(NULL)) {
+        // nobody else talks to the target, so bring the port up ourselves
+        delay = DAP_CONSOLE_RETRY_MS;
+    } else {
+        delay = rtt ? dap_rtt_poll(app->console_up, app->console_down) :
+                      dap_semihost_poll(app->console_up, app->console_down);
+        if(!furi_stream_buffer_is_empty(app->console_up)) cdc_console_notify(app);
+    }
+
+    app->console_next_tick = now + delay;
+    return delay;
+}
+
+// watch for a halt between host commands, only while a host owns the target
+static uint32_t dap_app_halt_service(DapApp* app) {
+    if(!dap_halt_is_pending() || app->state.dap_mode != DapModeSWD) return FuriWaitForever;
+    return dap_halt_poll() ? FuriWaitForever : DAP_HALT_POLL_MS;
+}
+
+// sample in slices, a queued host request ends a slice early
+static uint32_t dap_app_stream_service(DapApp* app) {
+    uint32_t wait_us;
+    if(dap_profile_is_active()) {
+        wait_us = dap_profile_run(DAP_STREAM_SLICE_US, dap_app_request_pending, NULL);
+    } else if(dap_scope_is_active()) {
+        wait_us = dap_scope_run(DAP_STREAM_SLICE_US, dap_app_request_pending, NULL);
+    } else if(dap_swo_is_active()) {
+        // Manchester edges must be decoded even if nobody reads the trace
+        if(dap_swo_get_transport() == DapSwoTransportStream) {
+            dap_swo_stream(app->stream);
+        } else {
+            dap_swo_poll();
+        }
+        wait_us = DAP_SWO_POLL_US;
+    } else {
+        return FuriWaitForever;
+    }
+
+    if(!app->recorder) dap_stream_usb_kick();
+    return wait_us / 1000;
+}
+
+static DapUsbProfile dap_app_usb_profile_load(void) {
+    uint8_t profile = DapUsbProfileFull;
+    if(!saved_struct_load(
+           DAP_USB_PROFILE_PATH,
+           &profile,
+           sizeof(profile),
+           DAP_USB_PROFILE_MAGIC,
+           DAP_USB_PROFILE_VERSION) ||
+       profile >= DapUsbProfileCount) {
+        profile = DapUsbProfileFull;
+    }
+    return profile;
+}
+
+static void dap_app_usb_profile_save(DapUsbProfile profile) {
+    uint8_t data = profile;
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    storage_simply_mkdir(storage, DAP_APP_DATA_PATH);
+    furi_record_close(RECORD_STORAGE);
+
+    if(!saved_struct_save(
+           DAP_USB_PROFILE_PATH,
+           &data,
+           sizeof(data),
+           DAP_USB_PROFILE_MAGIC,
+           DAP_USB_PROFILE_VERSION)) {
+        FURI_LOG_E("DAP", "Failed to save USB profile");
+    }
+}
+
+// the host sees an unplug, the functions only change while the interface is down
+static void dap_app_usb_profile_apply(DapApp* app, DapUsbProfile profile) {
+    dap_app_stream_close(app);
+    dap_swo_control(false);
+
+    furi_hal_usb_set_config(NULL, NULL);
+    dap_common_usb_set_functions(dap_usb_profile_functions[profile]);
+    furi_hal_usb_set_config(&dap_v2_usb_hid, NULL);
+}
+
 static int32_t dap_process(void* p) {
     DapApp* app = p;
     DapState* dap_state = &(app->state);
@@ -180,7 +1277,14 @@ static int32_t dap_process(void* p) {
     // allocate resources
     FuriHalUsbInterface* usb_config_prev;
     app->config.swd_pins = DapSwdPinsPA7PA6;
+    app->config.reset_drive = DapResetDrivePushPull;
+    app->swd_port = DAP_SWD_PORT_AUTO;
+    app->gang_ready = false;
+    app->swj_clock = DAP_CONFIG_DEFAULT_CLOCK;
+    app->console_source = DapCdcSourceUart;
     DapSwdPins swd_pins_prev = app->config.swd_pins;
+    DapUsbProfile usb_profile_prev = app->config.usb_profile;
+    flipper_dap_reset_mode = dap_reset_drive_mode(app->config.reset_drive);
 
     // init pins
     dap_init_gpio(swd_pins_prev);
@@ -202,21 +1306,27 @@ static int32_t dap_process(void* p) {
     dap_v1_usb_set_rx_callback(dap_app_rx1_callback);
     dap_v2_usb_set_rx_callback(dap_app_rx2_callback);
     dap_common_usb_set_state_callback(dap_app_usb_state_callback);
+    dap_stream_usb_set_source(app->stream);
+    dap_swo_set_callback(dap_app_swo_callback, furi_thread_get_id(furi_thread_get_current()));
+    dap_common_usb_set_functions(dap_usb_profile_functions[usb_profile_prev]);
     furi_hal_usb_set_config(&dap_v2_usb_hid, NULL);
 
     // work
     uint32_t events;
+    uint32_t timeout = FuriWaitForever;
     while(1) {
-        events = furi_thread_flags_wait(DAPThreadEventAll, FuriFlagWaitAny, FuriWaitForever);
+        events = furi_thread_flags_wait(DAPThreadEventAll, FuriFlagWaitAny, timeout);
 
         if(!(events & FuriFlagError)) {
             if(events & DAPThreadEventRxV1) {
+                dap_app_route_port(app, DapVersionV1);
                 dap_app_process_v1();
                 dap_state->dap_counter++;
                 dap_state->dap_version = DapVersionV1;
             }
 
             if(events & DAPThreadEventRxV2) {
+                dap_app_route_port(app, DapVersionV2);
                 dap_app_process_v2();
                 dap_state->dap_counter++;
                 dap_state->dap_version = DapVersionV2;
@@ -229,6 +1339,8 @@ static int32_t dap_process(void* p) {
             if(events & DAPThreadEventUSBDisconnect) {
                 dap_state->usb_connected = false;
                 dap_state->dap_version = DapVersionUnknown;
+                // the next host finds the UART on the COM port again
+                dap_app_uart_set_transport(app, DapUartTransportCdc);
             }
 
             if(events & DAPThreadEventApplyConfig) {
@@ -236,18 +1348,60 @@ static int32_t dap_process(void* p) {
                     dap_deinit_gpio(swd_pins_prev);
                     swd_pins_prev = app->config.swd_pins;
                     dap_init_gpio(swd_pins_prev);
+                    app->swd_port = DAP_SWD_PORT_AUTO;
+                    app->gang_ready = false;
+                }
+                flipper_dap_reset_mode = dap_reset_drive_mode(app->config.reset_drive);
+
+                if(usb_profile_prev != app->config.usb_profile) {
+                    usb_profile_prev = app->config.usb_profile;
+                    dap_app_usb_profile_apply(app, usb_profile_prev);
+                    dap_app_usb_profile_save(usb_profile_prev);
+                }
+
+                if(app->config.cdc_source != app->console_source) {
+                    dap_app_console_start(
+                        app,
+                        app->config.cdc_source,
+                        DAP_RTT_SCAN_ADDRESS_DEFAULT,
+                        DAP_RTT_SCAN_SIZE_DEFAULT);
                 }
+
+                // free the UART before the CDC thread may take it over
+                dap_app_swo_set_uart(app);
+                cdc_apply_config(app);
+            }
+
+            if(events & DAPThreadEventJob) {
+                dap_app_run_job(app);
             }
 
             if(events & DAPThreadEventStop) {
                 break;
             }
         }
+
+        timeout = MIN(dap_app_console_service(app), dap_app_halt_service(app));
+        timeout = MIN(timeout, dap_app_stream_service(app));
+
+        // read ahead while the last response is on its way to the host
+        if(app->state.dap_mode == DapModeSWD && !dap_app_request_pending(NULL)) {
+            dap_prefetch_fill();
+        }
     }
 
+    dap_profile_stop();
+    dap_scope_stop();
+    dap_app_stream_close(app);
+    dap_swo_control(false);
+    dap_swo_set_mode(DapSwoModeOff);
+    dap_swo_set_callback(NULL, NULL);
+
     // deinit usb
+    dap_stream_usb_set_source(NULL);
     furi_hal_usb_set_config(usb_config_prev, NULL);
     dap_common_usb_free_name();
+    dap_common_usb_free();
     dap_deinit_gpio(swd_pins_prev);
     return 0;
 }
@@ -262,29 +1416,73 @@ typedef enum {
     CDCThreadEventCDCRx = (1 << 2),
     CDCThreadEventCDCConfig = (1 << 3),
     CDCThreadEventApplyConfig = (1 << 4),
+    CDCThreadEventConsoleRx = (1 << 5),
+    CDCThreadEventUARTTx = (1 << 6),
+    CDCThreadEventUARTConfigure = (1 << 7),
     CDCThreadEventAll = CDCThreadEventStop | CDCThreadEventUARTRx | CDCThreadEventCDCRx |
-                        CDCThreadEventCDCConfig | CDCThreadEventApplyConfig,
+                        CDCThreadEventCDCConfig | CDCThreadEventApplyConfig |
+                        CDCThreadEventConsoleRx | CDCThreadEventUARTTx |
+                        CDCThreadEventUARTConfigure,
 } CDCThreadEvent;
 
+#define CDC_PACKET_SIZE 64
+#define CDC_BAUDRATE_DEFAULT 115200
+// the DMA only reports every half ring, shorter bursts wait for the poll
+#define CDC_POLL_MS 5
+// UART TX is polled by the HAL, a turn sends what fits into this much time
+#define CDC_TX_SLICE_MS 2
+// DMA ring per bridge, must be a power of two
+#define CDC_RX_RING_SIZE 2048
+
+// one USB COM port and the UART behind it
 typedef struct {
-    FuriStreamBuffer* rx_stream;
+    uint8_t port; // CDC port, DMA channel
     FuriThreadId thread_id;
+    bool running;
+    DapUartType type;
     FuriHalUartId uart_id;
+    uint32_t baudrate;
+    uint8_t format; // DAP_UART_FORMAT_* bits
     struct usb_cdc_line_coding line_coding;
+    volatile bool line_coding_set;
+    volatile bool usb_pending; // host data waiting in the OUT endpoint
+    FuriStreamBuffer* tx; // host to UART
+    uint8_t* rx_ring; // UART to host, written by the DMA
+} CDCBridge;
+
+typedef struct {
+    DapApp* dap_app;
+    DapUart* uart; // DAP_UART_* state of the first bridge
+    CDCBridge bridge[DAP_CDC_PORT_COUNT];
+    uint8_t first; // bridge that goes first in the next round
+    uint8_t buffer[CDC_PACKET_SIZE];
 } CDCProcess;
 
-static void cdc_uart_irq_cb(UartIrqEvent ev, uint8_t data, void* ctx) {
-    CDCProcess* app = ctx;
+static void cdc_console_notify(DapApp* app) {
+    furi_thread_flags_set(furi_thread_get_id(app->cdc_thread), CDCThreadEventConsoleRx);
+}
 
-    if(ev == UartIrqEventRXNE) {
-        furi_stream_buffer_send(app->rx_stream, &data, 1, 0);
-        furi_thread_flags_set(app->thread_id, CDCThreadEventUARTRx);
-    }
+static void cdc_apply_config(DapApp* app) {
+    furi_thread_flags_set(furi_thread_get_id(app->cdc_thread), CDCThreadEventApplyConfig);
+}
+
+static void cdc_uart_tx_notify(DapApp* app) {
+    furi_thread_flags_set(furi_thread_get_id(app->cdc_thread), CDCThreadEventUARTTx);
+}
+
+static void cdc_uart_configure(DapApp* app) {
+    furi_thread_flags_set(furi_thread_get_id(app->cdc_thread), CDCThreadEventUARTConfigure);
+}
+
+static void cdc_uart_dma_callback(void* context) {
+    CDCBridge* bridge = context;
+    furi_thread_flags_set(bridge->thread_id, CDCThreadEventUARTRx);
 }
 
 static void cdc_usb_rx_callback(void* context) {
-    CDCProcess* app = context;
-    furi_thread_flags_set(app->thread_id, CDCThreadEventCDCRx);
+    CDCBridge* bridge = context;
+    bridge->usb_pending = true;
+    furi_thread_flags_set(bridge->thread_id, CDCThreadEventCDCRx);
 }
 
 static void cdc_usb_control_line_callback(uint8_t state, void* context) {
@@ -293,19 +1491,14 @@ static void cdc_usb_control_line_callback(uint8_t state, void* context) {
 }
 
 static void cdc_usb_config_callback(struct usb_cdc_line_coding* config, void* context) {
-    CDCProcess* app = context;
-    app->line_coding = *config;
-    furi_thread_flags_set(app->thread_id, CDCThreadEventCDCConfig);
+    CDCBridge* bridge = context;
+    bridge->line_coding = *config;
+    bridge->line_coding_set = true;
+    furi_thread_flags_set(bridge->thread_id, CDCThreadEventCDCConfig);
 }
 
-static FuriHalUartId cdc_init_uart(
-    DapUartType type,
-    DapUartTXRX swap,
-    uint32_t baudrate,
-    void (*cb)(UartIrqEvent ev, uint8_t data, void* ctx),
-    void* ctx) {
+static FuriHalUartId cdc_init_uart(DapUartType type, DapUartTXRX swap, uint32_t baudrate) {
     FuriHalUartId uart_id = FuriHalUartIdUSART1;
-    if(baudrate == 0) baudrate = 115200;
 
     switch(type) {
     case DapUartTypeUSART1:
@@ -318,7 +1511,6 @@ static FuriHalUartId cdc_init_uart(
             LL_USART_SetTXRXSwap(USART1, LL_USART_TXRX_STANDARD);
         }
         furi_hal_uart_init(uart_id, baudrate);
-        furi_hal_uart_set_irq_cb(uart_id, cb, ctx);
         break;
     case DapUartTypeLPUART1:
         uart_id = FuriHalUartIdLPUART1;
@@ -329,13 +1521,51 @@ static FuriHalUartId cdc_init_uart(
             LL_LPUART_SetTXRXSwap(LPUART1, LL_LPUART_TXRX_STANDARD);
         }
         furi_hal_uart_init(uart_id, baudrate);
-        furi_hal_uart_set_irq_cb(uart_id, cb, ctx);
         break;
     }
 
+    // the DMA reads RDR, the byte interrupt would race it
+    furi_hal_uart_set_irq_cb(uart_id, NULL, NULL);
     return uart_id;
 }
 
+// furi_hal_uart always sets up 8N1, parity and stop bits are changed on the disabled UART
+static void cdc_set_format(FuriHalUartId uart_id, uint8_t format) {
+    const uint8_t parity = format & DAP_UART_FORMAT_PARITY_MASK;
+    const uint8_t stop_bits = format & DAP_UART_FORMAT_STOP_BITS_MASK;
+
+    // the parity bit is counted in the data width
+    if(uart_id == FuriHalUartIdUSART1) {
+        uint32_t ll_parity = LL_USART_PARITY_NONE;
+        if(parity == DAP_UART_FORMAT_PARITY_ODD) ll_parity = LL_USART_PARITY_ODD;
+        if(parity == DAP_UART_FORMAT_PARITY_EVEN) ll_parity = LL_USART_PARITY_EVEN;
+        uint32_t ll_stop_bits = LL_USART_STOPBITS_1;
+        if(stop_bits == DAP_UART_FORMAT_STOP_BITS_1_5) ll_stop_bits = LL_USART_STOPBITS_1_5;
+        if(stop_bits == DAP_UART_FORMAT_STOP_BITS_2) ll_stop_bits = LL_USART_STOPBITS_2;
+
+        LL_USART_Disable(USART1);
+        LL_USART_ConfigCharacter(
+            USART1,
+            ll_parity == LL_USART_PARITY_NONE ? LL_USART_DATAWIDTH_8B : LL_USART_DATAWIDTH_9B,
+            ll_parity,
+            ll_stop_bits);
+        LL_USART_Enable(USART1);
+    } else {
+        uint32_t ll_parity = LL_LPUART_PARITY_NONE;
+        if(parity == DAP_UART_FORMAT_PARITY_ODD) ll_parity = LL_LPUART_PARITY_ODD;
+        if(parity == DAP_UART_FORMAT_PARITY_EVEN) ll_parity = LL_LPUART_PARITY_EVEN;
+
+        LL_LPUART_Disable(LPUART1);
+        LL_LPUART_ConfigCharacter(
+            LPUART1,
+            ll_parity == LL_LPUART_PARITY_NONE ? LL_LPUART_DATAWIDTH_8B : LL_LPUART_DATAWIDTH_9B,
+            ll_parity,
+            stop_bits == DAP_UART_FORMAT_STOP_BITS_2 ? LL_LPUART_STOPBITS_2 :
+                                                       LL_LPUART_STOPBITS_1);
+        LL_LPUART_Enable(LPUART1);
+    }
+}
+
 static void cdc_deinit_uart(DapUartType type) {
     switch(type) {
     case DapUartTypeUSART1:
@@ -350,75 +1580,230 @@ static void cdc_deinit_uart(DapUartType type) {
     }
 }
 
+static uint8_t cdc_line_coding_format(const struct usb_cdc_line_coding* coding) {
+    uint8_t format = 0;
+    if(coding->bParityType == USB_CDC_ODD_PARITY) format |= DAP_UART_FORMAT_PARITY_ODD;
+    if(coding->bParityType == USB_CDC_EVEN_PARITY) format |= DAP_UART_FORMAT_PARITY_EVEN;
+    if(coding->bCharFormat == USB_CDC_1_5_STOP_BITS) format |= DAP_UART_FORMAT_STOP_BITS_1_5;
+    if(coding->bCharFormat == USB_CDC_2_STOP_BITS) format |= DAP_UART_FORMAT_STOP_BITS_2;
+    return format;
+}
+
+static void cdc_bridge_start(CDCBridge* bridge, DapUartType type, DapUartTXRX swap) {
+    bridge->type = type;
+    bridge->uart_id = cdc_init_uart(type, swap, bridge->baudrate);
+    if(bridge->format) cdc_set_format(bridge->uart_id, bridge->format);
+    dap_uart_dma_start(
+        bridge->port,
+        bridge->uart_id,
+        bridge->rx_ring,
+        CDC_RX_RING_SIZE,
+        cdc_uart_dma_callback,
+        bridge);
+    bridge->running = true;
+}
+
+static void cdc_bridge_stop(CDCBridge* bridge) {
+    if(!bridge->running) return;
+    dap_uart_dma_stop(bridge->port);
+    cdc_deinit_uart(bridge->type);
+    bridge->running = false;
+}
+
+static void cdc_bridge_set_line(CDCBridge* bridge, uint32_t baudrate, uint8_t format) {
+    if(baudrate > 0 && baudrate != bridge->baudrate) {
+        bridge->baudrate = baudrate;
+        if(bridge->running) furi_hal_uart_set_br(bridge->uart_id, baudrate);
+    }
+    if(format != bridge->format) {
+        bridge->format = format;
+        if(bridge->running) cdc_set_format(bridge->uart_id, format);
+    }
+}
+
+// UART to host, at most one packet
+static bool cdc_bridge_uart_rx(CDCProcess* app, CDCBridge* bridge) {
+    DapApp* dap_app = app->dap_app;
+    DapUart* uart = app->uart;
+    FuriStreamBuffer* stream = NULL;
+    size_t size = sizeof(app->buffer);
+    bool usb = true;
+    bool lost = false;
+
+    if(bridge->port == 0 && uart->transport != DapUartTransportCdc) {
+        // with the DAP transport the input waits for DAP_UART_Transfer
+        usb = false;
+        if(uart->transport == DapUartTransportDap && uart->rx_enabled) stream = uart->rx;
+    } else if(bridge->port == 0 && dap_app->config.cdc_source != DapCdcSourceUart) {
+        // UART input is dropped while the port carries the target console
+        usb = false;
+    }
+
+    // a busy port keeps its data in the ring, the other bridge goes on
+    if(usb && !dap_cdc_usb_tx_ready(bridge->port)) return false;
+    if(stream) size = MIN(size, furi_stream_buffer_spaces_available(stream));
+
+    size_t len = dap_uart_dma_read(bridge->port, app->buffer, size, &lost);
+    if(lost && bridge->port == 0) uart->rx_lost = true;
+    if(len == 0) return false;
+
+    if(usb) {
+        dap_cdc_usb_tx(bridge->port, app->buffer, len);
+        dap_app->state.cdc_rx_counter += len;
+    } else if(stream) {
+        furi_stream_buffer_send(stream, app->buffer, len, 0);
+    }
+
+    return dap_uart_dma_available(bridge->port, NULL) > 0;
+}
+
+// host to UART, the endpoint NAKs the host until a whole packet fits
+static void cdc_bridge_usb_rx(CDCProcess* app, CDCBridge* bridge) {
+    DapApp* dap_app = app->dap_app;
+    FuriStreamBuffer* stream = bridge->tx;
+    bool console = bridge->port == 0 && dap_app->config.cdc_source != DapCdcSourceUart;
+
+    if(!bridge->usb_pending) return;
+    if(console) stream = dap_app->console_down;
+    if(furi_stream_buffer_spaces_available(stream) < CDC_PACKET_SIZE) return;
+
+    bridge->usb_pending = false;
+    size_t len = dap_cdc_usb_rx(bridge->port, app->buffer, sizeof(app->buffer));
+    if(len == 0) return;
+
+    if(console) {
+        furi_stream_buffer_send(stream, app->buffer, len, 0);
+        dap_app->state.cdc_tx_counter += len;
+    } else if(bridge->port != 0 || app->uart->transport == DapUartTransportCdc) {
+        furi_stream_buffer_send(stream, app->buffer, len, 0);
+    }
+}
+
+// one slice of what is queued for the UART
+static bool cdc_bridge_uart_tx(CDCProcess* app, CDCBridge* bridge) {
+    if(bridge->port == 0 && app->uart->tx_flush) {
+        furi_stream_buffer_reset(bridge->tx);
+        app->uart->tx_flush = false;
+    }
+
+    size_t size = bridge->baudrate / 10 * CDC_TX_SLICE_MS / 1000;
+    size = CLAMP(size, sizeof(app->buffer), 1U);
+
+    size_t len = furi_stream_buffer_receive(bridge->tx, app->buffer, size, 0);
+    if(len == 0) return false;
+
+    furi_hal_uart_tx(bridge->uart_id, app->buffer, len);
+    app->dap_app->state.cdc_tx_counter += len;
+    return !furi_stream_buffer_is_empty(bridge->tx);
+}
+
+// one turn of a bridge, true if it has more to do right away
+static bool cdc_bridge_service(CDCProcess* app, CDCBridge* bridge) {
+    bool pending = cdc_bridge_uart_rx(app, bridge);
+    cdc_bridge_usb_rx(app, bridge);
+    pending |= cdc_bridge_uart_tx(app, bridge);
+    return pending;
+}
+
+// the second bridge takes the UART the first one leaves free
+static DapUartType cdc_second_uart(DapUartType type) {
+    return type == DapUartTypeUSART1 ? DapUartTypeLPUART1 : DapUartTypeUSART1;
+}
+
 static int32_t cdc_process(void* p) {
     DapApp* dap_app = p;
     DapState* dap_state = &(dap_app->state);
 
     dap_app->config.uart_pins = DapUartTypeLPUART1;
     dap_app->config.uart_swap = DapUartTXRXNormal;
+    dap_app->config.cdc_source = DapCdcSourceUart;
 
     DapUartType uart_pins_prev = dap_app->config.uart_pins;
     DapUartTXRX uart_swap_prev = dap_app->config.uart_swap;
+    bool dual_prev = dap_app_usb_dual_cdc(dap_app);
 
     CDCProcess* app = malloc(sizeof(CDCProcess));
-    app->thread_id = furi_thread_get_id(furi_thread_get_current());
-    app->rx_stream = furi_stream_buffer_alloc(512, 1);
-
-    const uint8_t rx_buffer_size = 64;
-    uint8_t* rx_buffer = malloc(rx_buffer_size);
-
-    app->uart_id = cdc_init_uart(
-        uart_pins_prev, uart_swap_prev, dap_state->cdc_baudrate, cdc_uart_irq_cb, app);
+    app->dap_app = dap_app;
+    app->uart = &dap_app->uart;
+    app->first = 0;
+    DapUart* uart = app->uart;
+
+    for(uint8_t port = 0; port < DAP_CDC_PORT_COUNT; port++) {
+        CDCBridge* bridge = &app->bridge[port];
+        memset(bridge, 0, sizeof(CDCBridge));
+        bridge->port = port;
+        bridge->thread_id = furi_thread_get_id(furi_thread_get_current());
+        bridge->baudrate = CDC_BAUDRATE_DEFAULT;
+        // DAP_UART_Transfer and the first COM port feed the same queue
+        bridge->tx = port == 0 ? uart->tx : furi_stream_buffer_alloc(DAP_UART_STREAM_SIZE, 1);
+        bridge->rx_ring = malloc(CDC_RX_RING_SIZE);
+
+        dap_cdc_usb_set_context(port, bridge);
+        dap_cdc_usb_set_rx_callback(port, cdc_usb_rx_callback);
+        dap_cdc_usb_set_control_line_callback(port, cdc_usb_control_line_callback);
+        dap_cdc_usb_set_config_callback(port, cdc_usb_config_callback);
+    }
 
-    dap_cdc_usb_set_context(app);
-    dap_cdc_usb_set_rx_callback(cdc_usb_rx_callback);
-    dap_cdc_usb_set_control_line_callback(cdc_usb_control_line_callback);
-    dap_cdc_usb_set_config_callback(cdc_usb_config_callback);
+    cdc_bridge_start(&app->bridge[0], uart_pins_prev, uart_swap_prev);
+    if(dual_prev) {
+        cdc_bridge_start(&app->bridge[1], cdc_second_uart(uart_pins_prev), DapUartTXRXNormal);
+    }
 
     uint32_t events;
+    uint32_t timeout = CDC_POLL_MS;
     while(1) {
-        events = furi_thread_flags_wait(CDCThreadEventAll, FuriFlagWaitAny, FuriWaitForever);
+        events = furi_thread_flags_wait(CDCThreadEventAll, FuriFlagWaitAny, timeout);
 
         if(!(events & FuriFlagError)) {
             if(events & CDCThreadEventCDCConfig) {
-                if(dap_state->cdc_baudrate != app->line_coding.dwDTERate) {
-                    dap_state->cdc_baudrate = app->line_coding.dwDTERate;
-                    if(dap_state->cdc_baudrate > 0) {
-                        furi_hal_uart_set_br(app->uart_id, dap_state->cdc_baudrate);
-                    }
+                for(size_t port = 0; port < DAP_CDC_PORT_COUNT; port++) {
+                    CDCBridge* bridge = &app->bridge[port];
+                    if(!bridge->line_coding_set) continue;
+                    bridge->line_coding_set = false;
+
+                    // the line coding of the first port only applies while it carries the UART
+                    if(port == 0 && uart->transport != DapUartTransportCdc) continue;
+                    cdc_bridge_set_line(
+                        bridge,
+                        bridge->line_coding.dwDTERate,
+                        cdc_line_coding_format(&bridge->line_coding));
+                    if(port == 0) dap_state->cdc_baudrate = bridge->baudrate;
                 }
             }
 
-            if(events & CDCThreadEventUARTRx) {
-                size_t len =
-                    furi_stream_buffer_receive(app->rx_stream, rx_buffer, rx_buffer_size, 0);
-
-                if(len > 0) {
-                    dap_cdc_usb_tx(rx_buffer, len);
-                }
-                dap_state->cdc_rx_counter += len;
+            if(events & CDCThreadEventUARTConfigure) {
+                dap_state->cdc_baudrate = uart->baudrate;
+                cdc_bridge_set_line(&app->bridge[0], uart->baudrate, uart->format);
             }
 
-            if(events & CDCThreadEventCDCRx) {
-                size_t len = dap_cdc_usb_rx(rx_buffer, rx_buffer_size);
-                if(len > 0) {
-                    furi_hal_uart_tx(app->uart_id, rx_buffer, len);
-                }
-                dap_state->cdc_tx_counter += len;
+            if(events & CDCThreadEventConsoleRx) {
+                size_t len;
+                do {
+                    len = furi_stream_buffer_receive(
+                        dap_app->console_up, app->buffer, sizeof(app->buffer), 0);
+                    if(len > 0) {
+                        dap_cdc_usb_tx(0, app->buffer, len);
+                    }
+                    dap_state->cdc_rx_counter += len;
+                } while(len > 0);
             }
 
             if(events & CDCThreadEventApplyConfig) {
+                const bool dual = dap_app_usb_dual_cdc(dap_app);
                 if(uart_pins_prev != dap_app->config.uart_pins ||
-                   uart_swap_prev != dap_app->config.uart_swap) {
-                    cdc_deinit_uart(uart_pins_prev);
+                   uart_swap_prev != dap_app->config.uart_swap || dual_prev != dual) {
+                    cdc_bridge_stop(&app->bridge[1]);
+                    cdc_bridge_stop(&app->bridge[0]);
                     uart_pins_prev = dap_app->config.uart_pins;
                     uart_swap_prev = dap_app->config.uart_swap;
-                    app->uart_id = cdc_init_uart(
-                        uart_pins_prev,
-                        uart_swap_prev,
-                        dap_state->cdc_baudrate,
-                        cdc_uart_irq_cb,
-                        app);
+                    dual_prev = dual;
+                    cdc_bridge_start(&app->bridge[0], uart_pins_prev, uart_swap_prev);
+                    if(dual) {
+                        cdc_bridge_start(
+                            &app->bridge[1],
+                            cdc_second_uart(uart_pins_prev),
+                            DapUartTXRXNormal);
+                    }
                 }
             }
 
@@ -426,11 +1811,24 @@ static int32_t cdc_process(void* p) {
                 break;
             }
         }
+
+        // bridges take turns with one slice each, so a busy one can't starve the other
+        bool pending = false;
+        for(size_t i = 0; i < DAP_CDC_PORT_COUNT; i++) {
+            CDCBridge* bridge = &app->bridge[(app->first + i) % DAP_CDC_PORT_COUNT];
+            if(bridge->running) pending |= cdc_bridge_service(app, bridge);
+        }
+        app->first = (app->first + 1) % DAP_CDC_PORT_COUNT;
+        timeout = pending ? 0 : CDC_POLL_MS;
     }
 
-    cdc_deinit_uart(uart_pins_prev);
-    free(rx_buffer);
-    furi_stream_buffer_free(app->rx_stream);
+    cdc_bridge_stop(&app->bridge[1]);
+    cdc_bridge_stop(&app->bridge[0]);
+    for(uint8_t port = 0; port < DAP_CDC_PORT_COUNT; port++) {
+        dap_uart_dma_clear(port);
+        free(app->bridge[port].rx_ring);
+        if(port > 0) furi_stream_buffer_free(app->bridge[port].tx);
+    }
     free(app);
 
     return 0;
@@ -442,9 +1840,18 @@ static int32_t cdc_process(void* p) {
 
 static DapApp* dap_app_alloc() {
     DapApp* dap_app = malloc(sizeof(DapApp));
-    dap_app->dap_thread = furi_thread_alloc_ex("DAP Process", 1024, dap_process, dap_app);
+    dap_app->dap_thread = furi_thread_alloc_ex("DAP Process", 2048, dap_process, dap_app);
     dap_app->cdc_thread = furi_thread_alloc_ex("DAP CDC", 1024, cdc_process, dap_app);
     dap_app->gui_thread = furi_thread_alloc_ex("DAP GUI", 1024, dap_gui_thread, dap_app);
+    dap_app->console_up = furi_stream_buffer_alloc(DAP_CONSOLE_STREAM_SIZE, 1);
+    dap_app->console_down = furi_stream_buffer_alloc(DAP_CONSOLE_STREAM_SIZE, 1);
+    dap_app->stream = furi_stream_buffer_alloc(DAP_STREAM_SIZE, 1);
+    dap_app->recorder = NULL;
+    // read before the threads start, both build their setup from it
+    dap_app->config.usb_profile = dap_app_usb_profile_load();
+    dap_app->uart.rx = furi_stream_buffer_alloc(DAP_UART_STREAM_SIZE, 1);
+    dap_app->uart.tx = furi_stream_buffer_alloc(DAP_UART_STREAM_SIZE, 1);
+    dap_app_uart_set_transport(dap_app, DapUartTransportCdc);
     return dap_app;
 }
 
@@ -453,11 +1860,14 @@ static void dap_app_free(DapApp* dap_app) {
     furi_thread_free(dap_app->dap_thread);
     furi_thread_free(dap_app->cdc_thread);
     furi_thread_free(dap_app->gui_thread);
+    furi_stream_buffer_free(dap_app->console_up);
+    furi_stream_buffer_free(dap_app->console_down);
+    furi_stream_buffer_free(dap_app->stream);
+    furi_stream_buffer_free(dap_app->uart.rx);
+    furi_stream_buffer_free(dap_app->uart.tx);
     free(dap_app);
 }
 
-static DapApp* app_handle = NULL;
-
 void dap_app_disconnect() {
     app_handle->state.dap_mode = DapModeDisconnected;
 }
@@ -472,14 +1882,26 @@ void dap_app_connect_jtag() {
 
 void dap_app_set_config(DapApp* app, DapConfig* config) {
     app->config = *config;
+    // the DAP thread passes the event on to the CDC thread
     furi_thread_flags_set(furi_thread_get_id(app->dap_thread), DAPThreadEventApplyConfig);
-    furi_thread_flags_set(furi_thread_get_id(app->cdc_thread), CDCThreadEventApplyConfig);
 }
 
 DapConfig* dap_app_get_config(DapApp* app) {
     return &app->config;
 }
 
+void dap_app_start_job(DapApp* app, const DapJob* job) {
+    app->job = *job;
+    app->job_cancel = false;
+    memset(&app->state.job, 0, sizeof(DapJobProgress));
+    app->state.job.status = DapJobStatusRunning;
+    furi_thread_flags_set(furi_thread_get_id(app->dap_thread), DAPThreadEventJob);
+}
+
+void dap_app_cancel_job(DapApp* app) {
+    app->job_cancel = true;
+}
+
 int32_t dap_link_app(void* p) {
     UNUSED(p);
 
@@ -512,7 +1934,8 @@ int32_t dap_link_app(void* p) {
     // wait until gui thread is finished
     furi_thread_join(app->gui_thread);
 
-    // send stop event to threads
+    // send stop event to threads, a running job ends at its next chunk
+    dap_app_cancel_job(app);
     dap_thread_send_stop(app->dap_thread);
     dap_thread_send_stop(app->cdc_thread);
 
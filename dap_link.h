@@ -13,6 +13,56 @@ typedef enum {
     DapVersionV2,
 } DapVersion;
 
+#define DAP_APP_DATA_PATH "/ext/apps_data/dap_link"
+#define DAP_JOB_PATH_SIZE 256
+
+typedef enum {
+    DapJobStatusIdle,
+    DapJobStatusRunning,
+    DapJobStatusDone,
+    DapJobStatusFailed,
+    DapJobStatusCanceled,
+} DapJobStatus;
+
+typedef enum {
+    DapJobStageConnect,
+    DapJobStageScan,
+    DapJobStageCompare,
+    DapJobStageErase,
+    DapJobStageProgram,
+    DapJobStageVerify,
+    DapJobStageDump,
+    DapJobStageLoad,
+    DapJobStageStart,
+} DapJobStage;
+
+typedef struct {
+    DapJobStatus status;
+    DapJobStage stage;
+    uint32_t done; // bytes of the current stage
+    uint32_t total;
+    uint32_t sectors;
+    uint32_t skipped; // sectors already up to date
+    uint32_t elapsed_ms;
+    uint32_t rate; // bytes per second
+    uint32_t entry; // where a loaded image was started
+} DapJobProgress;
+
+typedef enum {
+    DapJobTypeProgram,
+    DapJobTypeDump,
+    DapJobTypeLoad,
+    DapJobTypeSvf,
+} DapJobType;
+
+typedef struct {
+    DapJobType type;
+    char image_path[DAP_JOB_PATH_SIZE];
+    char algo_path[DAP_JOB_PATH_SIZE];
+    uint32_t address;
+    uint32_t size;
+} DapJob;
+
 typedef struct {
     bool usb_connected;
     DapMode dap_mode;
@@ -21,11 +71,14 @@ typedef struct {
     uint32_t cdc_baudrate;
     uint32_t cdc_tx_counter;
     uint32_t cdc_rx_counter;
+    uint32_t reset_release_us;
+    DapJobProgress job;
 } DapState;
 
 typedef enum {
     DapSwdPinsPA7PA6, // Pins 2, 3
     DapSwdPinsPA14PA13, // Pins 10, 12
+    DapSwdPinsDual, // Pins 2, 3 on V1 and 10, 12 on V2
 } DapSwdPins;
 
 typedef enum {
@@ -38,10 +91,35 @@ typedef enum {
     DapUartTXRXSwap,
 } DapUartTXRX;
 
+typedef enum {
+    DapResetDrivePushPull,
+    DapResetDriveOpenDrain,
+} DapResetDrive;
+
+typedef enum {
+    DapCdcSourceUart,
+    DapCdcSourceRtt, // SEGGER RTT channel 0 of the SWD target
+    DapCdcSourceSemihost, // semihosting console of the SWD target
+} DapCdcSource;
+
+// USB functions the probe enumerates with, persisted across runs
+typedef enum {
+    DapUsbProfileFull, // v1 + v2 with SWO stream + COM port
+    DapUsbProfileV2Cdc,
+    DapUsbProfileV2,
+    DapUsbProfileV1Cdc, // hosts without WinUSB/libusb access
+    DapUsbProfileDualCdc, // v2 + two COM ports
+    DapUsbProfileV2Swo, // v2 with SWO stream only
+    DapUsbProfileCount,
+} DapUsbProfile;
+
 typedef struct {
     DapSwdPins swd_pins;
     DapUartType uart_pins;
     DapUartTXRX uart_swap;
+    DapResetDrive reset_drive;
+    DapCdcSource cdc_source;
+    DapUsbProfile usb_profile;
 } DapConfig;
 
 typedef struct DapApp DapApp;
@@ -52,4 +130,11 @@ const char* dap_app_get_serial(DapApp* app);
 
 void dap_app_set_config(DapApp* app, DapConfig* config);
 
-DapConfig* dap_app_get_config(DapApp* app);
\ No newline at end of file
+DapConfig* dap_app_get_config(DapApp* app);
+
+/**
+ * Run a standalone job in the DAP thread, USB requests wait until it ends
+ */
+void dap_app_start_job(DapApp* app, const DapJob* job);
+
+void dap_app_cancel_job(DapApp* app);
\ No newline at end of file
@@ -1,5 +1,7 @@
 #include "dap_gui.h"
 #include "dap_gui_i.h"
+#include <dialogs/dialogs.h>
+#include <storage/storage.h>
 
 #define DAP_GUI_TICK 250
 
@@ -21,6 +23,25 @@ static void dap_gui_tick_event_callback(void* context) {
     scene_manager_handle_tick_event(app->scene_manager);
 }
 
+bool dap_gui_select_file(const char* extension, char* path, size_t path_size) {
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    storage_simply_mkdir(storage, DAP_APP_DATA_PATH);
+    furi_record_close(RECORD_STORAGE);
+
+    FuriString* selected = furi_string_alloc_set(DAP_APP_DATA_PATH);
+    DialogsFileBrowserOptions options;
+    dialog_file_browser_set_basic_options(&options, extension, NULL);
+    options.base_path = DAP_APP_DATA_PATH;
+
+    DialogsApp* dialogs = furi_record_open(RECORD_DIALOGS);
+    bool ok = dialog_file_browser_show(dialogs, selected, selected, &options);
+    furi_record_close(RECORD_DIALOGS);
+
+    if(ok) strlcpy(path, furi_string_get_cstr(selected), path_size);
+    furi_string_free(selected);
+    return ok;
+}
+
 DapGuiApp* dap_gui_alloc() {
     DapGuiApp* app = malloc(sizeof(DapGuiApp));
     app->gui = furi_record_open(RECORD_GUI);
@@ -53,6 +74,20 @@ DapGuiApp* dap_gui_alloc() {
     view_dispatcher_add_view(
         app->view_dispatcher, DapGuiAppViewWidget, widget_get_view(app->widget));
 
+    app->progress_view = dap_progress_view_alloc();
+    view_dispatcher_add_view(
+        app->view_dispatcher,
+        DapGuiAppViewProgress,
+        dap_progress_view_get_view(app->progress_view));
+
+    app->byte_input = byte_input_alloc();
+    view_dispatcher_add_view(
+        app->view_dispatcher, DapGuiAppViewByteInput, byte_input_get_view(app->byte_input));
+
+    // internal flash of most Cortex-M parts, 64 KB
+    app->dump_address[0] = 0x08;
+    app->dump_size[1] = 0x01;
+
     scene_manager_next_scene(app->scene_manager, DapSceneMain);
 
     return app;
@@ -68,6 +103,12 @@ void dap_gui_free(DapGuiApp* app) {
     view_dispatcher_remove_view(app->view_dispatcher, DapGuiAppViewWidget);
     widget_free(app->widget);
 
+    view_dispatcher_remove_view(app->view_dispatcher, DapGuiAppViewProgress);
+    dap_progress_view_free(app->progress_view);
+
+    view_dispatcher_remove_view(app->view_dispatcher, DapGuiAppViewByteInput);
+    byte_input_free(app->byte_input);
+
     // View dispatcher
     view_dispatcher_free(app->view_dispatcher);
     scene_manager_free(app->scene_manager);
@@ -4,4 +4,9 @@ typedef enum {
     DapAppCustomEventConfig,
     DapAppCustomEventHelp,
     DapAppCustomEventAbout,
+    DapAppCustomEventProgram,
+    DapAppCustomEventDump,
+    DapAppCustomEventLoad,
+    DapAppCustomEventSvf,
+    DapAppCustomEventByteInput,
 } DapAppCustomEvent;
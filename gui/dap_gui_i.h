@@ -7,12 +7,14 @@
 #include <notification/notification_messages.h>
 #include <gui/modules/variable_item_list.h>
 #include <gui/modules/widget.h>
+#include <gui/modules/byte_input.h>
 
 #include "dap_gui.h"
 #include "../dap_link.h"
 #include "scenes/config/dap_scene.h"
 #include "dap_gui_custom_event.h"
 #include "views/dap_main_view.h"
+#include "views/dap_progress_view.h"
 
 typedef struct {
     DapApp* dap_app;
@@ -24,11 +26,23 @@ typedef struct {
 
     VariableItemList* var_item_list;
     DapMainView* main_view;
+    DapProgressView* progress_view;
     Widget* widget;
+    ByteInput* byte_input;
+
+    uint8_t dump_address[4]; // big-endian, as edited in byte_input
+    uint8_t dump_size[4];
 } DapGuiApp;
 
+/**
+ * Pick a file below DAP_APP_DATA_PATH, the directory is created if needed
+ */
+bool dap_gui_select_file(const char* extension, char* path, size_t path_size);
+
 typedef enum {
     DapGuiAppViewVarItemList,
     DapGuiAppViewMainView,
     DapGuiAppViewWidget,
+    DapGuiAppViewProgress,
+    DapGuiAppViewByteInput,
 } DapGuiAppView;
@@ -1,4 +1,8 @@
 ADD_SCENE(dap, main, Main)
 ADD_SCENE(dap, config, Config)
+ADD_SCENE(dap, program, Program)
+ADD_SCENE(dap, dump, Dump)
+ADD_SCENE(dap, load, Load)
+ADD_SCENE(dap, svf, Svf)
 ADD_SCENE(dap, help, Help)
 ADD_SCENE(dap, about, About)
\ No newline at end of file
@@ -1,8 +1,29 @@
 #include "../dap_gui_i.h"
 
-static const char* swd_pins[] = {[DapSwdPinsPA7PA6] = "2,3", [DapSwdPinsPA14PA13] = "10,12"};
+static const char* swd_pins[] = {
+    [DapSwdPinsPA7PA6] = "2,3",
+    [DapSwdPinsPA14PA13] = "10,12",
+    [DapSwdPinsDual] = "Both",
+};
 static const char* uart_pins[] = {[DapUartTypeUSART1] = "13,14", [DapUartTypeLPUART1] = "15,16"};
 static const char* uart_swap[] = {[DapUartTXRXNormal] = "No", [DapUartTXRXSwap] = "Yes"};
+static const char* reset_drive[] = {
+    [DapResetDrivePushPull] = "Push-Pull",
+    [DapResetDriveOpenDrain] = "Open-Drain",
+};
+static const char* cdc_source[] = {
+    [DapCdcSourceUart] = "UART",
+    [DapCdcSourceRtt] = "RTT",
+    [DapCdcSourceSemihost] = "Semihost",
+};
+static const char* usb_profile[] = {
+    [DapUsbProfileFull] = "Full",
+    [DapUsbProfileV2Cdc] = "V2+CDC",
+    [DapUsbProfileV2] = "V2",
+    [DapUsbProfileV1Cdc] = "V1+CDC",
+    [DapUsbProfileDualCdc] = "2xCDC",
+    [DapUsbProfileV2Swo] = "V2+SWO",
+};
 
 static void swd_pins_cb(VariableItem* item) {
     DapGuiApp* app = variable_item_get_context(item);
@@ -37,13 +58,58 @@ static void uart_swap_cb(VariableItem* item) {
     dap_app_set_config(app->dap_app, config);
 }
 
+static void reset_drive_cb(VariableItem* item) {
+    DapGuiApp* app = variable_item_get_context(item);
+    uint8_t index = variable_item_get_current_value_index(item);
+
+    variable_item_set_current_value_text(item, reset_drive[index]);
+
+    DapConfig* config = dap_app_get_config(app->dap_app);
+    config->reset_drive = index;
+    dap_app_set_config(app->dap_app, config);
+}
+
+static void cdc_source_cb(VariableItem* item) {
+    DapGuiApp* app = variable_item_get_context(item);
+    uint8_t index = variable_item_get_current_value_index(item);
+
+    variable_item_set_current_value_text(item, cdc_source[index]);
+
+    DapConfig* config = dap_app_get_config(app->dap_app);
+    config->cdc_source = index;
+    dap_app_set_config(app->dap_app, config);
+}
+
+static void usb_profile_cb(VariableItem* item) {
+    DapGuiApp* app = variable_item_get_context(item);
+    uint8_t index = variable_item_get_current_value_index(item);
+
+    variable_item_set_current_value_text(item, usb_profile[index]);
+
+    DapConfig* config = dap_app_get_config(app->dap_app);
+    config->usb_profile = index;
+    dap_app_set_config(app->dap_app, config);
+}
+
 static void ok_cb(void* context, uint32_t index) {
     DapGuiApp* app = context;
     switch(index) {
-    case 3:
+    case 6:
+        view_dispatcher_send_custom_event(app->view_dispatcher, DapAppCustomEventProgram);
+        break;
+    case 7:
+        view_dispatcher_send_custom_event(app->view_dispatcher, DapAppCustomEventDump);
+        break;
+    case 8:
+        view_dispatcher_send_custom_event(app->view_dispatcher, DapAppCustomEventLoad);
+        break;
+    case 9:
+        view_dispatcher_send_custom_event(app->view_dispatcher, DapAppCustomEventSvf);
+        break;
+    case 10:
         view_dispatcher_send_custom_event(app->view_dispatcher, DapAppCustomEventHelp);
         break;
-    case 4:
+    case 11:
         view_dispatcher_send_custom_event(app->view_dispatcher, DapAppCustomEventAbout);
         break;
     default:
@@ -72,6 +138,25 @@ void dap_scene_config_on_enter(void* context) {
     variable_item_set_current_value_index(item, config->uart_swap);
     variable_item_set_current_value_text(item, uart_swap[config->uart_swap]);
 
+    item = variable_item_list_add(
+        var_item_list, "Reset Pin", COUNT_OF(reset_drive), reset_drive_cb, app);
+    variable_item_set_current_value_index(item, config->reset_drive);
+    variable_item_set_current_value_text(item, reset_drive[config->reset_drive]);
+
+    item = variable_item_list_add(
+        var_item_list, "USB Serial", COUNT_OF(cdc_source), cdc_source_cb, app);
+    variable_item_set_current_value_index(item, config->cdc_source);
+    variable_item_set_current_value_text(item, cdc_source[config->cdc_source]);
+
+    item = variable_item_list_add(
+        var_item_list, "USB Mode", COUNT_OF(usb_profile), usb_profile_cb, app);
+    variable_item_set_current_value_index(item, config->usb_profile);
+    variable_item_set_current_value_text(item, usb_profile[config->usb_profile]);
+
+    variable_item_list_add(var_item_list, "Program from SD", 0, NULL, NULL);
+    variable_item_list_add(var_item_list, "Dump to SD", 0, NULL, NULL);
+    variable_item_list_add(var_item_list, "Load to RAM and Run", 0, NULL, NULL);
+    variable_item_list_add(var_item_list, "Play SVF from SD", 0, NULL, NULL);
     variable_item_list_add(var_item_list, "Help and Pinout", 0, NULL, NULL);
     variable_item_list_add(var_item_list, "About", 0, NULL, NULL);
 
@@ -86,7 +171,19 @@ void dap_scene_config_on_enter(void* context) {
 bool dap_scene_config_on_event(void* context, SceneManagerEvent event) {
     DapGuiApp* app = context;
     if(event.type == SceneManagerEventTypeCustom) {
-        if(event.event == DapAppCustomEventHelp) {
+        if(event.event == DapAppCustomEventProgram) {
+            scene_manager_next_scene(app->scene_manager, DapSceneProgram);
+            return true;
+        } else if(event.event == DapAppCustomEventDump) {
+            scene_manager_next_scene(app->scene_manager, DapSceneDump);
+            return true;
+        } else if(event.event == DapAppCustomEventLoad) {
+            scene_manager_next_scene(app->scene_manager, DapSceneLoad);
+            return true;
+        } else if(event.event == DapAppCustomEventSvf) {
+            scene_manager_next_scene(app->scene_manager, DapSceneSvf);
+            return true;
+        } else if(event.event == DapAppCustomEventHelp) {
             scene_manager_next_scene(app->scene_manager, DapSceneHelp);
             return true;
         } else if(event.event == DapAppCustomEventAbout) {
@@ -0,0 +1,163 @@
+#include "../dap_gui_i.h"
+#include <storage/storage.h>
+
+typedef enum {
+    DapSceneDumpStateAddress,
+    DapSceneDumpStateSize,
+    DapSceneDumpStateRunning,
+    DapSceneDumpStateFinished,
+} DapSceneDumpState;
+
+static uint32_t dap_scene_dump_get_u32(const uint8_t* bytes) {
+    return ((uint32_t)bytes[0] << 24) | (bytes[1] << 16) | (bytes[2] << 8) | bytes[3];
+}
+
+static void dap_scene_dump_byte_input_callback(void* context) {
+    DapGuiApp* app = context;
+    view_dispatcher_send_custom_event(app->view_dispatcher, DapAppCustomEventByteInput);
+}
+
+static void dap_scene_dump_input(DapGuiApp* app, DapSceneDumpState state) {
+    scene_manager_set_scene_state(app->scene_manager, DapSceneDump, state);
+
+    if(state == DapSceneDumpStateAddress) {
+        byte_input_set_header_text(app->byte_input, "Start address");
+        byte_input_set_result_callback(
+            app->byte_input,
+            dap_scene_dump_byte_input_callback,
+            NULL,
+            app,
+            app->dump_address,
+            sizeof(app->dump_address));
+    } else {
+        byte_input_set_header_text(app->byte_input, "Size in bytes");
+        byte_input_set_result_callback(
+            app->byte_input,
+            dap_scene_dump_byte_input_callback,
+            NULL,
+            app,
+            app->dump_size,
+            sizeof(app->dump_size));
+    }
+
+    view_dispatcher_switch_to_view(app->view_dispatcher, DapGuiAppViewByteInput);
+}
+
+static void dap_scene_dump_start(DapGuiApp* app) {
+    DapJob* job = malloc(sizeof(DapJob));
+    job->type = DapJobTypeDump;
+    job->address = dap_scene_dump_get_u32(app->dump_address);
+    job->size = dap_scene_dump_get_u32(app->dump_size);
+
+    // the name only depends on the range, so an interrupted dump is picked up again
+    snprintf(
+        job->image_path,
+        sizeof(job->image_path),
+        "%s/dump_%08lX_%08lX.bin",
+        DAP_APP_DATA_PATH,
+        job->address,
+        job->size);
+
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    storage_simply_mkdir(storage, DAP_APP_DATA_PATH);
+    furi_record_close(RECORD_STORAGE);
+
+    scene_manager_set_scene_state(app->scene_manager, DapSceneDump, DapSceneDumpStateRunning);
+    dap_app_start_job(app->dap_app, job);
+    free(job);
+
+    dap_progress_view_set_title(app->progress_view, "Dump to SD");
+    dap_progress_view_set_stage(app->progress_view, "Connecting...");
+    dap_progress_view_set_progress(app->progress_view, 0, 0);
+    view_dispatcher_switch_to_view(app->view_dispatcher, DapGuiAppViewProgress);
+}
+
+static void dap_scene_dump_update(DapGuiApp* app) {
+    DapState state;
+    dap_app_get_state(app->dap_app, &state);
+    DapJobProgress* job = &state.job;
+    char info[32];
+
+    switch(job->status) {
+    case DapJobStatusRunning:
+        dap_progress_view_set_stage(
+            app->progress_view,
+            job->stage == DapJobStageConnect ? "Connecting..." : "Reading...");
+        snprintf(
+            info,
+            sizeof(info),
+            "%lu KB/s  %lu.%lus",
+            job->rate / 1024,
+            job->elapsed_ms / 1000,
+            (job->elapsed_ms % 1000) / 100);
+        break;
+    case DapJobStatusDone:
+        dap_progress_view_set_stage(app->progress_view, "Saved");
+        snprintf(info, sizeof(info), "%lu KB/s, CRC in .crc", job->rate / 1024);
+        break;
+    case DapJobStatusFailed:
+        dap_progress_view_set_stage(app->progress_view, "Failed");
+        snprintf(info, sizeof(info), "Run again to resume");
+        break;
+    case DapJobStatusCanceled:
+        dap_progress_view_set_stage(app->progress_view, "Canceled");
+        snprintf(info, sizeof(info), "Run again to resume");
+        break;
+    default:
+        info[0] = '\0';
+        break;
+    }
+
+    dap_progress_view_set_progress(app->progress_view, job->done, job->total);
+    dap_progress_view_set_info(app->progress_view, info);
+
+    if(job->status != DapJobStatusRunning) {
+        scene_manager_set_scene_state(app->scene_manager, DapSceneDump, DapSceneDumpStateFinished);
+        notification_message(
+            app->notifications,
+            job->status == DapJobStatusDone ? &sequence_success : &sequence_error);
+    }
+}
+
+void dap_scene_dump_on_enter(void* context) {
+    DapGuiApp* app = context;
+    dap_scene_dump_input(app, DapSceneDumpStateAddress);
+}
+
+bool dap_scene_dump_on_event(void* context, SceneManagerEvent event) {
+    DapGuiApp* app = context;
+    uint32_t state = scene_manager_get_scene_state(app->scene_manager, DapSceneDump);
+
+    if(event.type == SceneManagerEventTypeCustom) {
+        if(event.event == DapAppCustomEventByteInput) {
+            if(state == DapSceneDumpStateAddress) {
+                dap_scene_dump_input(app, DapSceneDumpStateSize);
+            } else if(state == DapSceneDumpStateSize) {
+                dap_scene_dump_start(app);
+            }
+            return true;
+        }
+    } else if(event.type == SceneManagerEventTypeTick) {
+        if(state == DapSceneDumpStateRunning) {
+            dap_scene_dump_update(app);
+        }
+        return true;
+    } else if(event.type == SceneManagerEventTypeBack) {
+        if(state == DapSceneDumpStateRunning) {
+            dap_app_cancel_job(app->dap_app);
+            return true;
+        } else if(state == DapSceneDumpStateSize) {
+            dap_scene_dump_input(app, DapSceneDumpStateAddress);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void dap_scene_dump_on_exit(void* context) {
+    DapGuiApp* app = context;
+    byte_input_set_result_callback(app->byte_input, NULL, NULL, NULL, NULL, 0);
+    byte_input_set_header_text(app->byte_input, "");
+    dap_progress_view_set_info(app->progress_view, "");
+}
@@ -25,6 +25,16 @@ void dap_scene_help_on_enter(void* context) {
             "    SWC: 10 [SWC]\r\n"
             "    SWD: 12 [SIO]\r\n");
         break;
+    case DapSwdPinsDual:
+        furi_string_cat(
+            string,
+            "  V1 / port A:\r\n"
+            "    SWC: 2 [A7]\r\n"
+            "    SWD: 3 [A6]\r\n"
+            "  V2 / port B:\r\n"
+            "    SWC: 10 [SWC]\r\n"
+            "    SWD: 12 [SIO]\r\n");
+        break;
     default:
         break;
     }
@@ -32,6 +42,7 @@ void dap_scene_help_on_enter(void* context) {
     furi_string_cat(string, "\e#JTAG:\r\n");
     switch(config->swd_pins) {
     case DapSwdPinsPA7PA6:
+    case DapSwdPinsDual:
         furi_string_cat(
             string,
             "    TCK: 2 [A7]\r\n"
@@ -85,6 +96,33 @@ void dap_scene_help_on_enter(void* context) {
         break;
     }
 
+    // the second COM port and SWO UART both use the other UART
+    if(config->usb_profile == DapUsbProfileDualCdc) {
+        furi_string_cat(string, "\e#UART 2:\r\n");
+        if(config->uart_pins == DapUartTypeUSART1) {
+            furi_string_cat(
+                string,
+                "    TX: 15 [C1]\r\n"
+                "    RX: 16 [C0]\r\n");
+        } else {
+            furi_string_cat(
+                string,
+                "    TX: 13 [TX]\r\n"
+                "    RX: 14 [RX]\r\n");
+        }
+    }
+
+    // Manchester is captured on TDO
+    furi_string_cat(string, "\e#SWO:\r\n");
+    if(config->usb_profile == DapUsbProfileDualCdc) {
+        furi_string_cat(string, "    UART: -\r\n");
+    } else if(config->uart_pins == DapUartTypeUSART1) {
+        furi_string_cat(string, "    UART: 16 [C0]\r\n");
+    } else {
+        furi_string_cat(string, "    UART: 14 [RX]\r\n");
+    }
+    furi_string_cat(string, "    Manchester: 5 [B3]\r\n");
+
     widget_add_text_scroll_element(app->widget, 0, 0, 128, 64, furi_string_get_cstr(string));
     furi_string_free(string);
     view_dispatcher_switch_to_view(app->view_dispatcher, DapGuiAppViewWidget);
@@ -0,0 +1,101 @@
+#include "../dap_gui_i.h"
+
+// raw binaries go to the start of SRAM on most Cortex-M parts
+#define DAP_SCENE_LOAD_BIN_BASE 0x20000000
+
+typedef enum {
+    DapSceneLoadStateRunning,
+    DapSceneLoadStateFinished,
+} DapSceneLoadState;
+
+static void dap_scene_load_update(DapGuiApp* app) {
+    DapState state;
+    dap_app_get_state(app->dap_app, &state);
+    DapJobProgress* job = &state.job;
+    char info[32];
+
+    switch(job->status) {
+    case DapJobStatusRunning:
+        dap_progress_view_set_stage(
+            app->progress_view,
+            job->stage == DapJobStageConnect ? "Connecting..." : "Loading...");
+        snprintf(info, sizeof(info), "%lu KB/s", job->rate / 1024);
+        break;
+    case DapJobStatusDone:
+        dap_progress_view_set_stage(app->progress_view, "Running");
+        snprintf(
+            info,
+            sizeof(info),
+            "at %08lX, %lu.%lus",
+            job->entry,
+            job->elapsed_ms / 1000,
+            (job->elapsed_ms % 1000) / 100);
+        break;
+    case DapJobStatusFailed:
+        dap_progress_view_set_stage(app->progress_view, "Failed");
+        info[0] = '\0';
+        break;
+    case DapJobStatusCanceled:
+        dap_progress_view_set_stage(app->progress_view, "Canceled");
+        info[0] = '\0';
+        break;
+    default:
+        info[0] = '\0';
+        break;
+    }
+
+    dap_progress_view_set_progress(app->progress_view, job->done, 0);
+    dap_progress_view_set_info(app->progress_view, info);
+
+    if(job->status != DapJobStatusRunning) {
+        scene_manager_set_scene_state(app->scene_manager, DapSceneLoad, DapSceneLoadStateFinished);
+        notification_message(
+            app->notifications,
+            job->status == DapJobStatusDone ? &sequence_success : &sequence_error);
+    }
+}
+
+void dap_scene_load_on_enter(void* context) {
+    DapGuiApp* app = context;
+    DapJob* job = malloc(sizeof(DapJob));
+    job->type = DapJobTypeLoad;
+    job->address = DAP_SCENE_LOAD_BIN_BASE;
+
+    if(!dap_gui_select_file("*", job->image_path, sizeof(job->image_path))) {
+        free(job);
+        scene_manager_previous_scene(app->scene_manager);
+        return;
+    }
+
+    scene_manager_set_scene_state(app->scene_manager, DapSceneLoad, DapSceneLoadStateRunning);
+    dap_app_start_job(app->dap_app, job);
+    free(job);
+
+    dap_progress_view_set_title(app->progress_view, "Load to RAM");
+    dap_scene_load_update(app);
+    view_dispatcher_switch_to_view(app->view_dispatcher, DapGuiAppViewProgress);
+}
+
+bool dap_scene_load_on_event(void* context, SceneManagerEvent event) {
+    DapGuiApp* app = context;
+    uint32_t state = scene_manager_get_scene_state(app->scene_manager, DapSceneLoad);
+
+    if(event.type == SceneManagerEventTypeTick) {
+        if(state == DapSceneLoadStateRunning) {
+            dap_scene_load_update(app);
+        }
+        return true;
+    } else if(event.type == SceneManagerEventTypeBack) {
+        if(state == DapSceneLoadStateRunning) {
+            dap_app_cancel_job(app->dap_app);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void dap_scene_load_on_exit(void* context) {
+    DapGuiApp* app = context;
+    dap_progress_view_set_info(app->progress_view, "");
+}
@@ -0,0 +1,123 @@
+#include "../dap_gui_i.h"
+
+#define DAP_SCENE_PROGRAM_ALGO_EXTENSION ".algo"
+
+typedef enum {
+    DapSceneProgramStateRunning,
+    DapSceneProgramStateFinished,
+} DapSceneProgramState;
+
+static const char* dap_scene_program_stages[] = {
+    [DapJobStageConnect] = "Connecting...",
+    [DapJobStageScan] = "Reading image...",
+    [DapJobStageCompare] = "Comparing sectors...",
+    [DapJobStageErase] = "Erasing...",
+    [DapJobStageProgram] = "Programming...",
+    [DapJobStageVerify] = "Verifying...",
+};
+
+static bool dap_scene_program_select(DapJob* job) {
+    return dap_gui_select_file("*", job->image_path, sizeof(job->image_path)) &&
+           dap_gui_select_file(
+               DAP_SCENE_PROGRAM_ALGO_EXTENSION, job->algo_path, sizeof(job->algo_path));
+}
+
+static void dap_scene_program_update(DapGuiApp* app) {
+    DapState state;
+    dap_app_get_state(app->dap_app, &state);
+    DapJobProgress* job = &state.job;
+    char info[32];
+
+    switch(job->status) {
+    case DapJobStatusRunning:
+        dap_progress_view_set_stage(app->progress_view, dap_scene_program_stages[job->stage]);
+        snprintf(
+            info,
+            sizeof(info),
+            "Skip %lu/%lu  %lu.%lus",
+            job->skipped,
+            job->sectors,
+            job->elapsed_ms / 1000,
+            (job->elapsed_ms % 1000) / 100);
+        break;
+    case DapJobStatusDone:
+        dap_progress_view_set_stage(app->progress_view, "Done");
+        snprintf(
+            info,
+            sizeof(info),
+            "%lu/%lu up to date, %lu.%lus",
+            job->skipped,
+            job->sectors,
+            job->elapsed_ms / 1000,
+            (job->elapsed_ms % 1000) / 100);
+        break;
+    case DapJobStatusFailed:
+        dap_progress_view_set_stage(app->progress_view, "Failed");
+        snprintf(info, sizeof(info), "at: %s", dap_scene_program_stages[job->stage]);
+        break;
+    case DapJobStatusCanceled:
+        dap_progress_view_set_stage(app->progress_view, "Canceled");
+        info[0] = '\0';
+        break;
+    default:
+        info[0] = '\0';
+        break;
+    }
+
+    dap_progress_view_set_progress(app->progress_view, job->done, job->total);
+    dap_progress_view_set_info(app->progress_view, info);
+
+    if(job->status != DapJobStatusRunning &&
+       scene_manager_get_scene_state(app->scene_manager, DapSceneProgram) ==
+           DapSceneProgramStateRunning) {
+        scene_manager_set_scene_state(
+            app->scene_manager, DapSceneProgram, DapSceneProgramStateFinished);
+        notification_message(
+            app->notifications,
+            job->status == DapJobStatusDone ? &sequence_success : &sequence_error);
+    }
+}
+
+void dap_scene_program_on_enter(void* context) {
+    DapGuiApp* app = context;
+    DapJob* job = malloc(sizeof(DapJob));
+    job->type = DapJobTypeProgram;
+
+    if(!dap_scene_program_select(job)) {
+        free(job);
+        scene_manager_previous_scene(app->scene_manager);
+        return;
+    }
+
+    scene_manager_set_scene_state(
+        app->scene_manager, DapSceneProgram, DapSceneProgramStateRunning);
+    dap_app_start_job(app->dap_app, job);
+    free(job);
+
+    dap_progress_view_set_title(app->progress_view, "Program from SD");
+    dap_scene_program_update(app);
+    view_dispatcher_switch_to_view(app->view_dispatcher, DapGuiAppViewProgress);
+}
+
+bool dap_scene_program_on_event(void* context, SceneManagerEvent event) {
+    DapGuiApp* app = context;
+
+    if(event.type == SceneManagerEventTypeTick) {
+        dap_scene_program_update(app);
+        return true;
+    } else if(event.type == SceneManagerEventTypeBack) {
+        // a running job must be stopped before the scene can go away
+        if(scene_manager_get_scene_state(app->scene_manager, DapSceneProgram) ==
+           DapSceneProgramStateRunning) {
+            dap_app_cancel_job(app->dap_app);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void dap_scene_program_on_exit(void* context) {
+    DapGuiApp* app = context;
+    dap_progress_view_set_info(app->progress_view, "");
+}
@@ -0,0 +1,96 @@
+#include "../dap_gui_i.h"
+
+typedef enum {
+    DapSceneSvfStateRunning,
+    DapSceneSvfStateFinished,
+} DapSceneSvfState;
+
+static void dap_scene_svf_update(DapGuiApp* app) {
+    DapState state;
+    dap_app_get_state(app->dap_app, &state);
+    DapJobProgress* job = &state.job;
+    char info[32];
+
+    switch(job->status) {
+    case DapJobStatusRunning:
+        dap_progress_view_set_stage(app->progress_view, "Playing...");
+        snprintf(info, sizeof(info), "%lu/%lu KB", job->done / 1024, job->total / 1024);
+        break;
+    case DapJobStatusDone:
+        dap_progress_view_set_stage(app->progress_view, "Done");
+        snprintf(
+            info,
+            sizeof(info),
+            "%lu.%lus, %lu KB/s",
+            job->elapsed_ms / 1000,
+            (job->elapsed_ms % 1000) / 100,
+            job->rate / 1024);
+        break;
+    case DapJobStatusFailed:
+        // the failing statement is in the log
+        dap_progress_view_set_stage(app->progress_view, "Failed");
+        snprintf(info, sizeof(info), "at byte %lu", job->done);
+        break;
+    case DapJobStatusCanceled:
+        dap_progress_view_set_stage(app->progress_view, "Canceled");
+        info[0] = '\0';
+        break;
+    default:
+        info[0] = '\0';
+        break;
+    }
+
+    dap_progress_view_set_progress(app->progress_view, job->done, job->total);
+    dap_progress_view_set_info(app->progress_view, info);
+
+    if(job->status != DapJobStatusRunning) {
+        scene_manager_set_scene_state(app->scene_manager, DapSceneSvf, DapSceneSvfStateFinished);
+        notification_message(
+            app->notifications,
+            job->status == DapJobStatusDone ? &sequence_success : &sequence_error);
+    }
+}
+
+void dap_scene_svf_on_enter(void* context) {
+    DapGuiApp* app = context;
+    DapJob* job = malloc(sizeof(DapJob));
+    job->type = DapJobTypeSvf;
+
+    if(!dap_gui_select_file("*", job->image_path, sizeof(job->image_path))) {
+        free(job);
+        scene_manager_previous_scene(app->scene_manager);
+        return;
+    }
+
+    scene_manager_set_scene_state(app->scene_manager, DapSceneSvf, DapSceneSvfStateRunning);
+    dap_app_start_job(app->dap_app, job);
+    free(job);
+
+    dap_progress_view_set_title(app->progress_view, "Play SVF/XSVF");
+    dap_scene_svf_update(app);
+    view_dispatcher_switch_to_view(app->view_dispatcher, DapGuiAppViewProgress);
+}
+
+bool dap_scene_svf_on_event(void* context, SceneManagerEvent event) {
+    DapGuiApp* app = context;
+    uint32_t state = scene_manager_get_scene_state(app->scene_manager, DapSceneSvf);
+
+    if(event.type == SceneManagerEventTypeTick) {
+        if(state == DapSceneSvfStateRunning) {
+            dap_scene_svf_update(app);
+        }
+        return true;
+    } else if(event.type == SceneManagerEventTypeBack) {
+        if(state == DapSceneSvfStateRunning) {
+            dap_app_cancel_job(app->dap_app);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void dap_scene_svf_on_exit(void* context) {
+    DapGuiApp* app = context;
+    dap_progress_view_set_info(app->progress_view, "");
+}
@@ -0,0 +1,101 @@
+#include "dap_progress_view.h"
+#include <gui/elements.h>
+
+#define DAP_PROGRESS_VIEW_INFO_SIZE 32
+
+struct DapProgressView {
+    View* view;
+};
+
+typedef struct {
+    const char* title;
+    const char* stage;
+    uint32_t done;
+    uint32_t total;
+    char info[DAP_PROGRESS_VIEW_INFO_SIZE];
+} DapProgressViewModel;
+
+static void dap_progress_view_draw_callback(Canvas* canvas, void* _model) {
+    DapProgressViewModel* model = _model;
+    canvas_clear(canvas);
+
+    canvas_set_color(canvas, ColorBlack);
+    canvas_draw_box(canvas, 0, 0, 127, 11);
+    canvas_set_color(canvas, ColorWhite);
+    canvas_draw_str_aligned(
+        canvas, 64, 9, AlignCenter, AlignBottom, model->title ? model->title : "DAP Link");
+
+    canvas_set_color(canvas, ColorBlack);
+    if(model->stage) {
+        canvas_draw_str(canvas, 2, 24, model->stage);
+    }
+
+    float progress = 0;
+    if(model->total > 0) {
+        progress = (float)model->done / (float)model->total;
+    }
+    elements_progress_bar(canvas, 2, 28, 124, progress);
+
+    char size_str[24];
+    if(model->total > 0) {
+        snprintf(
+            size_str, sizeof(size_str), "%lu / %lu KB", model->done / 1024, model->total / 1024);
+    } else {
+        snprintf(size_str, sizeof(size_str), "%lu KB", model->done / 1024);
+    }
+    canvas_draw_str_aligned(canvas, 64, 50, AlignCenter, AlignBottom, size_str);
+
+    canvas_draw_str_aligned(canvas, 64, 62, AlignCenter, AlignBottom, model->info);
+}
+
+DapProgressView* dap_progress_view_alloc() {
+    DapProgressView* dap_progress_view = malloc(sizeof(DapProgressView));
+
+    dap_progress_view->view = view_alloc();
+    view_allocate_model(
+        dap_progress_view->view, ViewModelTypeLocking, sizeof(DapProgressViewModel));
+    view_set_context(dap_progress_view->view, dap_progress_view);
+    view_set_draw_callback(dap_progress_view->view, dap_progress_view_draw_callback);
+    return dap_progress_view;
+}
+
+void dap_progress_view_free(DapProgressView* dap_progress_view) {
+    view_free(dap_progress_view->view);
+    free(dap_progress_view);
+}
+
+View* dap_progress_view_get_view(DapProgressView* dap_progress_view) {
+    return dap_progress_view->view;
+}
+
+void dap_progress_view_set_title(DapProgressView* dap_progress_view, const char* title) {
+    with_view_model(
+        dap_progress_view->view, DapProgressViewModel * model, { model->title = title; }, true);
+}
+
+void dap_progress_view_set_stage(DapProgressView* dap_progress_view, const char* stage) {
+    with_view_model(
+        dap_progress_view->view, DapProgressViewModel * model, { model->stage = stage; }, true);
+}
+
+void dap_progress_view_set_progress(
+    DapProgressView* dap_progress_view,
+    uint32_t done,
+    uint32_t total) {
+    with_view_model(
+        dap_progress_view->view,
+        DapProgressViewModel * model,
+        {
+            model->done = done;
+            model->total = total;
+        },
+        true);
+}
+
+void dap_progress_view_set_info(DapProgressView* dap_progress_view, const char* info) {
+    with_view_model(
+        dap_progress_view->view,
+        DapProgressViewModel * model,
+        { strlcpy(model->info, info, sizeof(model->info)); },
+        true);
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include <gui/view.h>
+
+typedef struct DapProgressView DapProgressView;
+
+DapProgressView* dap_progress_view_alloc();
+
+void dap_progress_view_free(DapProgressView* dap_progress_view);
+
+View* dap_progress_view_get_view(DapProgressView* dap_progress_view);
+
+void dap_progress_view_set_title(DapProgressView* dap_progress_view, const char* title);
+
+void dap_progress_view_set_stage(DapProgressView* dap_progress_view, const char* stage);
+
+void dap_progress_view_set_progress(
+    DapProgressView* dap_progress_view,
+    uint32_t done,
+    uint32_t total);
+
+void dap_progress_view_set_info(DapProgressView* dap_progress_view, const char* info);
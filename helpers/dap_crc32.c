@@ -0,0 +1,49 @@
+#include "dap_crc32.h"
+#include <stdbool.h>
+
+#define DAP_CRC32_POLY 0xEDB88320
+
+static uint32_t dap_crc32_table[4][256];
+static bool dap_crc32_ready = false;
+
+static void dap_crc32_init(void) {
+    for(uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for(size_t bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ ((crc & 1) ? DAP_CRC32_POLY : 0);
+        }
+        dap_crc32_table[0][i] = crc;
+    }
+
+    for(uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = dap_crc32_table[0][i];
+        for(size_t slice = 1; slice < 4; slice++) {
+            crc = (crc >> 8) ^ dap_crc32_table[0][crc & 0xFF];
+            dap_crc32_table[slice][i] = crc;
+        }
+    }
+
+    dap_crc32_ready = true;
+}
+
+uint32_t dap_crc32(uint32_t crc, const uint8_t* data, size_t size) {
+    if(!dap_crc32_ready) dap_crc32_init();
+
+    crc = ~crc;
+    while(size--) {
+        crc = (crc >> 8) ^ dap_crc32_table[0][(crc ^ *data++) & 0xFF];
+    }
+    return ~crc;
+}
+
+uint32_t dap_crc32_words(uint32_t crc, const uint32_t* data, size_t count) {
+    if(!dap_crc32_ready) dap_crc32_init();
+
+    crc = ~crc;
+    while(count--) {
+        crc ^= *data++;
+        crc = dap_crc32_table[3][crc & 0xFF] ^ dap_crc32_table[2][(crc >> 8) & 0xFF] ^
+              dap_crc32_table[1][(crc >> 16) & 0xFF] ^ dap_crc32_table[0][crc >> 24];
+    }
+    return ~crc;
+}
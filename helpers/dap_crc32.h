@@ -0,0 +1,15 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * CRC-32 (IEEE 802.3, reflected 0xEDB88320), zlib compatible:
+ * start with 0 and feed the previous result to continue a stream.
+ */
+
+uint32_t dap_crc32(uint32_t crc, const uint8_t* data, size_t size);
+
+/**
+ * Slice-by-4 update over little-endian words as read from the MEM-AP
+ */
+uint32_t dap_crc32_words(uint32_t crc, const uint32_t* data, size_t count);
@@ -0,0 +1,353 @@
+#include <furi.h>
+
+#include "dap_image.h"
+
+#define TAG "DapImage"
+
+#define DAP_IMAGE_CHUNK_SIZE 256
+// length, address, type, 255 data bytes and the checksum
+#define DAP_IMAGE_RECORD_SIZE (5 + 255)
+#define DAP_IMAGE_LINE_SIZE (1 + 2 * DAP_IMAGE_RECORD_SIZE)
+#define DAP_IMAGE_FILL 0xFF
+
+#define DAP_ELF_MAGIC 0x464C457F
+#define DAP_ELF_CLASS_32 1
+#define DAP_ELF_DATA_LSB 1
+#define DAP_ELF_MACHINE_ARM 40
+#define DAP_ELF_PT_LOAD 1
+#define DAP_ELF_EHDR_SIZE 52
+#define DAP_ELF_PHDR_SIZE 32
+
+typedef enum {
+    DapHexRecordData = 0x00,
+    DapHexRecordEof = 0x01,
+    DapHexRecordSegment = 0x02,
+    DapHexRecordStartSegment = 0x03,
+    DapHexRecordLinear = 0x04,
+    DapHexRecordStartLinear = 0x05,
+} DapHexRecord;
+
+struct DapImage {
+    File* file;
+    DapImageType type;
+    uint32_t base;
+    uint32_t entry;
+    bool end;
+
+    // ELF
+    uint32_t phoff;
+    uint16_t phentsize;
+    uint16_t phnum;
+    uint16_t segment;
+    uint32_t segment_offset;
+    uint32_t segment_address;
+    uint32_t segment_left;
+
+    // raw binary
+    uint32_t offset;
+
+    // HEX
+    uint32_t hex_base;
+    uint32_t hex_line;
+    size_t line_length;
+    size_t read_position;
+    size_t read_size;
+
+    // flat reader
+    DapImageChunk pending;
+    uint32_t last_address;
+
+    uint8_t data[DAP_IMAGE_RECORD_SIZE]; // a whole HEX record, more than a chunk
+    uint8_t read_buffer[DAP_IMAGE_CHUNK_SIZE];
+    char line[DAP_IMAGE_LINE_SIZE];
+};
+
+static uint16_t dap_image_get_u16(const uint8_t* data) {
+    return data[0] | (data[1] << 8);
+}
+
+static uint32_t dap_image_get_u32(const uint8_t* data) {
+    return data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+DapImage* dap_image_alloc(Storage* storage) {
+    DapImage* image = malloc(sizeof(DapImage));
+    image->file = storage_file_alloc(storage);
+    return image;
+}
+
+void dap_image_free(DapImage* image) {
+    dap_image_close(image);
+    storage_file_free(image->file);
+    free(image);
+}
+
+static bool dap_image_read(DapImage* image, uint32_t offset, void* data, size_t size) {
+    return storage_file_seek(image->file, offset, true) &&
+           storage_file_read(image->file, data, size) == size;
+}
+
+static bool dap_image_elf_open(DapImage* image) {
+    uint8_t* ehdr = image->data;
+    if(!dap_image_read(image, 0, ehdr, DAP_ELF_EHDR_SIZE)) return false;
+
+    if(ehdr[4] != DAP_ELF_CLASS_32 || ehdr[5] != DAP_ELF_DATA_LSB ||
+       dap_image_get_u16(&ehdr[18]) != DAP_ELF_MACHINE_ARM) {
+        FURI_LOG_E(TAG, "Not a 32-bit little-endian ARM ELF");
+        return false;
+    }
+
+    image->entry = dap_image_get_u32(&ehdr[24]);
+    image->phoff = dap_image_get_u32(&ehdr[28]);
+    image->phentsize = dap_image_get_u16(&ehdr[42]);
+    image->phnum = dap_image_get_u16(&ehdr[44]);
+    return image->phentsize >= DAP_ELF_PHDR_SIZE;
+}
+
+bool dap_image_open(DapImage* image, const char* path, uint32_t base) {
+    dap_image_close(image);
+    image->base = base;
+    image->entry = 0;
+
+    if(!storage_file_open(image->file, path, FSAM_READ, FSOM_OPEN_EXISTING)) {
+        FURI_LOG_E(TAG, "Can't open %s", path);
+        return false;
+    }
+
+    uint8_t magic[4] = {0};
+    storage_file_read(image->file, magic, sizeof(magic));
+
+    bool ok = true;
+    if(dap_image_get_u32(magic) == DAP_ELF_MAGIC) {
+        image->type = DapImageTypeElf;
+        ok = dap_image_elf_open(image);
+    } else if(magic[0] == ':') {
+        image->type = DapImageTypeHex;
+    } else {
+        image->type = DapImageTypeBin;
+    }
+
+    ok = ok && dap_image_rewind(image);
+    if(!ok) dap_image_close(image);
+    return ok;
+}
+
+void dap_image_close(DapImage* image) {
+    if(storage_file_is_open(image->file)) {
+        storage_file_close(image->file);
+    }
+}
+
+DapImageType dap_image_get_type(DapImage* image) {
+    return image->type;
+}
+
+uint32_t dap_image_get_entry(DapImage* image) {
+    return image->entry;
+}
+
+bool dap_image_rewind(DapImage* image) {
+    image->end = false;
+    image->offset = 0;
+    image->segment = 0;
+    image->segment_left = 0;
+    image->hex_base = 0;
+    image->hex_line = 0;
+    image->line_length = 0;
+    image->read_position = 0;
+    image->read_size = 0;
+    image->pending.size = 0;
+    image->last_address = 0;
+    return storage_file_seek(image->file, 0, true);
+}
+
+static DapImageStatus dap_image_next_bin(DapImage* image, DapImageChunk* chunk) {
+    size_t size = storage_file_read(image->file, image->data, DAP_IMAGE_CHUNK_SIZE);
+    if(size == 0) return DapImageStatusEnd;
+
+    chunk->address = image->base + image->offset;
+    chunk->data = image->data;
+    chunk->size = size;
+    image->offset += size;
+    return DapImageStatusOk;
+}
+
+static DapImageStatus dap_image_next_elf(DapImage* image, DapImageChunk* chunk) {
+    while(image->segment_left == 0) {
+        if(image->segment >= image->phnum) return DapImageStatusEnd;
+
+        uint8_t* phdr = image->data;
+        uint32_t offset = image->phoff + image->segment * image->phentsize;
+        image->segment++;
+        if(!dap_image_read(image, offset, phdr, DAP_ELF_PHDR_SIZE)) return DapImageStatusError;
+
+        // p_type, p_offset, p_vaddr, p_paddr, p_filesz
+        if(dap_image_get_u32(&phdr[0]) != DAP_ELF_PT_LOAD) continue;
+        image->segment_offset = dap_image_get_u32(&phdr[4]);
+        image->segment_address = dap_image_get_u32(&phdr[12]);
+        image->segment_left = dap_image_get_u32(&phdr[16]);
+    }
+
+    size_t size = MIN(image->segment_left, (uint32_t)DAP_IMAGE_CHUNK_SIZE);
+    if(!dap_image_read(image, image->segment_offset, image->data, size)) {
+        return DapImageStatusError;
+    }
+
+    chunk->address = image->segment_address;
+    chunk->data = image->data;
+    chunk->size = size;
+    image->segment_offset += size;
+    image->segment_address += size;
+    image->segment_left -= size;
+    return DapImageStatusOk;
+}
+
+static int dap_image_hex_nibble(char c) {
+    if(c >= '0' && c <= '9') return c - '0';
+    if(c >= 'A' && c <= 'F') return c - 'A' + 10;
+    if(c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+static bool dap_image_hex_getc(DapImage* image, char* c) {
+    if(image->read_position == image->read_size) {
+        image->read_size =
+            storage_file_read(image->file, image->read_buffer, sizeof(image->read_buffer));
+        image->read_position = 0;
+        if(image->read_size == 0) return false;
+    }
+    *c = image->read_buffer[image->read_position++];
+    return true;
+}
+
+static DapImageStatus dap_image_hex_line(DapImage* image) {
+    image->line_length = 0;
+    char c;
+
+    while(dap_image_hex_getc(image, &c)) {
+        if(c == '\r' || c == '\n') {
+            if(image->line_length > 0) return DapImageStatusOk;
+            continue;
+        }
+        if(image->line_length >= DAP_IMAGE_LINE_SIZE) {
+            FURI_LOG_E(TAG, "Line %lu too long", image->hex_line + 1);
+            return DapImageStatusError;
+        }
+        image->line[image->line_length++] = c;
+    }
+
+    return image->line_length > 0 ? DapImageStatusOk : DapImageStatusEnd;
+}
+
+// decode ":LLAAAATT<data>CC" into image->data, returns byte count or -1
+static int dap_image_hex_decode(DapImage* image) {
+    const char* line = image->line;
+    size_t length = image->line_length;
+    if(length < 11 || line[0] != ':' || (length & 1) == 0) return -1;
+
+    size_t bytes = (length - 1) / 2;
+    if(bytes > sizeof(image->data)) return -1;
+
+    uint8_t sum = 0;
+    for(size_t i = 0; i < bytes; i++) {
+        int hi = dap_image_hex_nibble(line[1 + i * 2]);
+        int lo = dap_image_hex_nibble(line[2 + i * 2]);
+        if(hi < 0 || lo < 0) return -1;
+        image->data[i] = (hi << 4) | lo;
+        sum += image->data[i];
+    }
+
+    if(sum != 0 || image->data[0] + 5U != bytes) return -1;
+    return bytes;
+}
+
+static DapImageStatus dap_image_next_hex(DapImage* image, DapImageChunk* chunk) {
+    while(!image->end) {
+        DapImageStatus status = dap_image_hex_line(image);
+        if(status != DapImageStatusOk) return status;
+        image->hex_line++;
+        if(dap_image_hex_decode(image) < 0) {
+            FURI_LOG_E(TAG, "Bad record in line %lu", image->hex_line);
+            return DapImageStatusError;
+        }
+
+        // fields: length, address, type, data
+        uint8_t* record = image->data;
+        uint8_t length = record[0];
+        uint16_t address = (record[1] << 8) | record[2];
+        uint8_t* data = &record[4];
+
+        switch(record[3]) {
+        case DapHexRecordData:
+            if(length == 0) break;
+            chunk->address = image->hex_base + address;
+            chunk->data = data;
+            chunk->size = length;
+            return DapImageStatusOk;
+        case DapHexRecordEof:
+            image->end = true;
+            break;
+        case DapHexRecordSegment:
+            image->hex_base = ((data[0] << 8) | data[1]) << 4;
+            break;
+        case DapHexRecordLinear:
+            image->hex_base = ((data[0] << 8) | data[1]) << 16;
+            break;
+        case DapHexRecordStartSegment:
+            image->entry = (((data[0] << 8) | data[1]) << 4) + ((data[2] << 8) | data[3]);
+            break;
+        case DapHexRecordStartLinear:
+            image->entry = ((uint32_t)data[0] << 24) | (data[1] << 16) | (data[2] << 8) | data[3];
+            break;
+        default:
+            return DapImageStatusError;
+        }
+    }
+
+    return DapImageStatusEnd;
+}
+
+DapImageStatus dap_image_next(DapImage* image, DapImageChunk* chunk) {
+    switch(image->type) {
+    case DapImageTypeBin:
+        return dap_image_next_bin(image, chunk);
+    case DapImageTypeHex:
+        return dap_image_next_hex(image, chunk);
+    case DapImageTypeElf:
+        return dap_image_next_elf(image, chunk);
+    }
+    return DapImageStatusError;
+}
+
+bool dap_image_read_flat(DapImage* image, uint32_t address, uint8_t* data, size_t size) {
+    DapImageChunk* pending = &image->pending;
+    const uint32_t end = address + size;
+    memset(data, DAP_IMAGE_FILL, size);
+
+    while(true) {
+        if(pending->size == 0) {
+            DapImageStatus status = dap_image_next(image, pending);
+            if(status == DapImageStatusEnd) return true;
+            if(status == DapImageStatusError) return false;
+
+            if(pending->address < image->last_address) {
+                FURI_LOG_E(TAG, "Unsorted data at %08lX", pending->address);
+                return false;
+            }
+            image->last_address = pending->address + pending->size;
+        }
+
+        const uint32_t pending_end = pending->address + pending->size;
+        if(pending->address >= end) return true;
+
+        if(pending_end > address) {
+            uint32_t from = MAX(pending->address, address);
+            uint32_t to = MIN(pending_end, end);
+            memcpy(&data[from - address], &pending->data[from - pending->address], to - from);
+        }
+
+        // keep a chunk that continues past this window for the next call
+        if(pending_end > end) return true;
+        pending->size = 0;
+    }
+}
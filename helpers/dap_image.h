@@ -0,0 +1,63 @@
+#pragma once
+#include <storage/storage.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Streaming firmware image reader for raw binaries, Intel HEX and ELF.
+ *
+ * The file is never loaded as a whole: data comes out in small chunks with
+ * their load addresses (ELF uses the physical address of PT_LOAD segments).
+ * Chunks are expected in ascending address order, as produced by linkers
+ * and objcopy.
+ */
+
+typedef struct DapImage DapImage;
+
+typedef enum {
+    DapImageTypeBin,
+    DapImageTypeHex,
+    DapImageTypeElf,
+} DapImageType;
+
+typedef enum {
+    DapImageStatusOk,
+    DapImageStatusEnd,
+    DapImageStatusError,
+} DapImageStatus;
+
+typedef struct {
+    uint32_t address;
+    const uint8_t* data; // valid until the next call
+    size_t size;
+} DapImageChunk;
+
+DapImage* dap_image_alloc(Storage* storage);
+
+void dap_image_free(DapImage* image);
+
+/**
+ * Open an image, the type is detected from the file contents.
+ * @param base load address of a raw binary
+ */
+bool dap_image_open(DapImage* image, const char* path, uint32_t base);
+
+void dap_image_close(DapImage* image);
+
+DapImageType dap_image_get_type(DapImage* image);
+
+/**
+ * Entry point from the ELF header or HEX start address record, 0 if none
+ */
+uint32_t dap_image_get_entry(DapImage* image);
+
+bool dap_image_rewind(DapImage* image);
+
+DapImageStatus dap_image_next(DapImage* image, DapImageChunk* chunk);
+
+/**
+ * Fill [address, address + size) from the chunk stream, gaps read as 0xFF.
+ * Consecutive calls must not go backwards.
+ */
+bool dap_image_read_flat(DapImage* image, uint32_t address, uint8_t* data, size_t size);
@@ -0,0 +1,92 @@
+#include "dap_manchester.h"
+
+// the period is averaged in fractions of a tick, integer steps would drift
+#define DAP_MANCHESTER_FRAC 16
+
+void dap_manchester_reset(DapManchester* decoder, bool level) {
+    const uint32_t half = decoder->half;
+    *decoder = (DapManchester){
+        .state = level ? DapManchesterStateLost : DapManchesterStateIdle,
+        .level = level,
+        .half = half, // a known rate is still right after a resync
+    };
+}
+
+static void dap_manchester_start(DapManchester* decoder) {
+    if(decoder->bits) decoder->errors++;
+    decoder->byte = 0;
+    decoder->bits = 0;
+    decoder->state = DapManchesterStateStart;
+    decoder->level = true;
+}
+
+static size_t dap_manchester_bit(DapManchester* decoder, bool bit, uint8_t* out) {
+    decoder->byte |= bit << decoder->bits;
+    if(++decoder->bits < 8) return 0;
+
+    *out = decoder->byte;
+    decoder->byte = 0;
+    decoder->bits = 0;
+    return 1;
+}
+
+size_t dap_manchester_decode(
+    DapManchester* decoder,
+    const uint32_t* edges,
+    size_t count,
+    uint8_t* out) {
+    size_t size = 0;
+
+    for(size_t i = 0; i < count; i++) {
+        const uint32_t delta = edges[i] - decoder->last;
+        const bool before = decoder->level;
+        decoder->last = edges[i];
+        decoder->level = !before;
+
+        // distance to the last edge in half bit periods, rounded
+        uint32_t halves = 0;
+        if(decoder->half) {
+            halves = (2 * DAP_MANCHESTER_FRAC * delta + decoder->half) / (2 * decoder->half);
+        }
+
+        switch(decoder->state) {
+        case DapManchesterStateIdle:
+            dap_manchester_start(decoder);
+            break;
+        case DapManchesterStateStart:
+            decoder->half = decoder->half ? (3 * decoder->half + delta * DAP_MANCHESTER_FRAC) / 4 :
+                                            delta * DAP_MANCHESTER_FRAC;
+            decoder->state = DapManchesterStateMid;
+            decoder->frames++;
+            break;
+        case DapManchesterStateMid:
+        case DapManchesterStateBoundary:
+            if(decoder->state == DapManchesterStateMid && halves == 1) {
+                decoder->state = DapManchesterStateBoundary;
+            } else if(
+                (decoder->state == DapManchesterStateMid && halves == 2) ||
+                (decoder->state == DapManchesterStateBoundary && halves == 1)) {
+                // the level of the first half is the bit
+                size += dap_manchester_bit(decoder, before, &out[size]);
+                decoder->state = DapManchesterStateMid;
+            } else if(!before && halves >= 2) {
+                // the frame ended with the line low, this is the next start bit
+                dap_manchester_start(decoder);
+            } else {
+                decoder->errors++;
+                decoder->state = DapManchesterStateLost;
+            }
+            break;
+        case DapManchesterStateLost:
+            // only an idle line stays at one level for over a bit period
+            if(!decoder->half || halves >= 3) dap_manchester_start(decoder);
+            break;
+        }
+    }
+
+    return size;
+}
+
+uint32_t dap_manchester_get_rate(const DapManchester* decoder, uint32_t clock) {
+    return decoder->half ? (uint64_t)clock * DAP_MANCHESTER_FRAC / (2 * decoder->half) : 0;
+}
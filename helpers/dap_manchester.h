@@ -0,0 +1,56 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Decoder for SWO Manchester encoding, fed with edge timestamps.
+ *
+ * The line idles low. A frame is a start bit of 1 followed by bytes LSB
+ * first and ends with the line low for at least one bit period. Every bit
+ * has an edge in the middle, falling for 1 and rising for 0, plus an edge
+ * on the bit boundary between equal bits. The high half of each start bit
+ * is the half bit period, so the bit rate follows the target without any
+ * configuration. Edges that fit no bit drop the decoder out of sync until
+ * the line has been idle again.
+ */
+
+typedef enum {
+    DapManchesterStateIdle,
+    DapManchesterStateStart, // high half of the start bit
+    DapManchesterStateMid, // last edge was in the middle of a bit
+    DapManchesterStateBoundary, // last edge was between two bits
+    DapManchesterStateLost,
+} DapManchesterState;
+
+typedef struct {
+    DapManchesterState state;
+    bool level; // after the last edge
+    uint32_t last; // timestamp of the last edge
+    uint32_t half; // half bit period in 1/16 ticks, 0 until the first start bit
+    uint8_t byte;
+    uint8_t bits;
+    uint32_t frames;
+    uint32_t errors;
+} DapManchester;
+
+/**
+ * @param level line level now, a high line starts out of sync
+ */
+void dap_manchester_reset(DapManchester* decoder, bool level);
+
+/**
+ * Decode a chunk of edges, state carries over to the next chunk.
+ * @param out room for count / 8 + 1 bytes
+ * @return decoded bytes
+ */
+size_t dap_manchester_decode(
+    DapManchester* decoder,
+    const uint32_t* edges,
+    size_t count,
+    uint8_t* out);
+
+/**
+ * @return bit rate measured on the last start bits, 0 if none seen yet
+ */
+uint32_t dap_manchester_get_rate(const DapManchester* decoder, uint32_t clock);
@@ -0,0 +1,188 @@
+#include "dap_pack.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#define DAP_PACK_LITERAL_MAX 128
+#define DAP_PACK_REPEAT_MIN 3
+#define DAP_PACK_REPEAT_MAX (0x3F + DAP_PACK_REPEAT_MIN)
+
+#define DAP_PACK_TOKEN_RUN 0x80
+#define DAP_PACK_TOKEN_MATCH 0xC0
+
+typedef enum {
+    DapPackStateToken,
+    DapPackStateLiteral,
+    DapPackStateRunValue,
+    DapPackStateRun,
+    DapPackStateMatchDistance,
+    DapPackStateMatch,
+} DapPackState;
+
+static size_t dap_pack_run(const uint8_t* data, size_t size) {
+    size_t limit = size < DAP_PACK_REPEAT_MAX ? size : DAP_PACK_REPEAT_MAX;
+    size_t length = 1;
+    while(length < limit && data[length] == data[0]) {
+        length++;
+    }
+    return length;
+}
+
+static size_t dap_pack_match(const uint8_t* data, size_t pos, size_t size, size_t* distance) {
+    size_t limit = size - pos < DAP_PACK_REPEAT_MAX ? size - pos : DAP_PACK_REPEAT_MAX;
+    size_t best = 0;
+
+    for(size_t d = 1; d <= DAP_PACK_WINDOW && d <= pos && best < limit; d++) {
+        const uint8_t* from = &data[pos - d];
+        size_t length = 0;
+        // overlapping copies are fine, the decoder copies byte by byte
+        while(length < limit && from[length] == data[pos + length]) {
+            length++;
+        }
+        if(length > best) {
+            best = length;
+            *distance = d;
+        }
+    }
+
+    return best;
+}
+
+size_t dap_pack_encode(
+    const uint8_t* data,
+    size_t size,
+    size_t* consumed,
+    uint8_t* out,
+    size_t out_size) {
+    size_t pos = 0;
+    size_t used = 0;
+    size_t literal = 0; // pending literal bytes before pos
+
+    while(pos < size) {
+        size_t distance = 0;
+        size_t run = dap_pack_run(&data[pos], size - pos);
+        size_t match = run < DAP_PACK_REPEAT_MAX ? dap_pack_match(data, pos, size, &distance) : 0;
+        size_t repeat = run >= match ? run : match;
+
+        if(repeat >= DAP_PACK_REPEAT_MIN) {
+            if(literal) {
+                out[used] = literal - 1;
+                memcpy(&out[used + 1], &data[pos - literal], literal);
+                used += literal + 1;
+                literal = 0;
+            }
+            if(used + 2 > out_size) break;
+
+            if(run >= match) {
+                out[used++] = DAP_PACK_TOKEN_RUN | (run - DAP_PACK_REPEAT_MIN);
+                out[used++] = data[pos];
+            } else {
+                out[used++] = DAP_PACK_TOKEN_MATCH | (match - DAP_PACK_REPEAT_MIN);
+                out[used++] = distance - 1;
+            }
+            pos += repeat;
+        } else {
+            // room for the literal token and every byte in it
+            if(used + literal + 2 > out_size) break;
+            literal++;
+            pos++;
+            if(literal == DAP_PACK_LITERAL_MAX) {
+                out[used] = literal - 1;
+                memcpy(&out[used + 1], &data[pos - literal], literal);
+                used += literal + 1;
+                literal = 0;
+            }
+        }
+    }
+
+    if(literal) {
+        out[used] = literal - 1;
+        memcpy(&out[used + 1], &data[pos - literal], literal);
+        used += literal + 1;
+    }
+
+    *consumed = pos;
+    return used;
+}
+
+void dap_pack_decoder_reset(DapPackDecoder* decoder) {
+    decoder->head = 0;
+    decoder->state = DapPackStateToken;
+    decoder->count = 0;
+}
+
+static inline void dap_pack_emit(DapPackDecoder* decoder, uint8_t* out, uint8_t byte) {
+    *out = byte;
+    decoder->window[decoder->head++] = byte;
+}
+
+size_t dap_pack_decode(
+    DapPackDecoder* decoder,
+    const uint8_t* in,
+    size_t* in_size,
+    uint8_t* out,
+    size_t out_size) {
+    size_t read = 0;
+    size_t written = 0;
+    bool starved = false;
+
+    while(!starved && written < out_size) {
+        switch(decoder->state) {
+        case DapPackStateToken: {
+            if(read == *in_size) {
+                starved = true;
+                break;
+            }
+            uint8_t token = in[read++];
+            if(token < DAP_PACK_TOKEN_RUN) {
+                decoder->count = token + 1;
+                decoder->state = DapPackStateLiteral;
+            } else {
+                decoder->count = (token & 0x3F) + DAP_PACK_REPEAT_MIN;
+                decoder->state = token < DAP_PACK_TOKEN_MATCH ? DapPackStateRunValue :
+                                                                DapPackStateMatchDistance;
+            }
+            break;
+        }
+        case DapPackStateLiteral:
+            if(read == *in_size) {
+                starved = true;
+                break;
+            }
+            dap_pack_emit(decoder, &out[written++], in[read++]);
+            if(--decoder->count == 0) decoder->state = DapPackStateToken;
+            break;
+        case DapPackStateRunValue:
+            if(read == *in_size) {
+                starved = true;
+                break;
+            }
+            decoder->value = in[read++];
+            decoder->state = DapPackStateRun;
+            break;
+        case DapPackStateRun:
+            dap_pack_emit(decoder, &out[written++], decoder->value);
+            if(--decoder->count == 0) decoder->state = DapPackStateToken;
+            break;
+        case DapPackStateMatchDistance:
+            if(read == *in_size) {
+                starved = true;
+                break;
+            }
+            decoder->value = in[read++];
+            decoder->state = DapPackStateMatch;
+            break;
+        case DapPackStateMatch:
+            // distance - 1 is stored, head - 1 - value is the source byte
+            dap_pack_emit(
+                decoder,
+                &out[written++],
+                decoder->window[(uint8_t)(decoder->head - 1 - decoder->value)]);
+            if(--decoder->count == 0) decoder->state = DapPackStateToken;
+            break;
+        }
+    }
+
+    *in_size = read;
+    return written;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Byte oriented run-length/LZ codec for memory transfers.
+ *
+ * Token 0x00..0x7F: literal, token + 1 bytes follow
+ * Token 0x80..0xBF: byte run, (token & 0x3F) + 3 copies of the next byte
+ * Token 0xC0..0xFF: match, (token & 0x3F) + 3 bytes copied from
+ *                   next byte + 1 positions back in the output
+ *
+ * Matches reach at most 256 bytes back, so the decoder only needs a 256 byte
+ * history and can run on a stream split at any byte.
+ */
+
+#define DAP_PACK_WINDOW 256
+
+typedef struct {
+    uint8_t window[DAP_PACK_WINDOW];
+    uint8_t head;
+    uint8_t state;
+    uint8_t count;
+    uint8_t value; // run byte or match distance
+} DapPackDecoder;
+
+/**
+ * Compress from the start of data until either the input or the output runs out.
+ * @param consumed input bytes covered by the output
+ * @return output size
+ */
+size_t dap_pack_encode(
+    const uint8_t* data,
+    size_t size,
+    size_t* consumed,
+    uint8_t* out,
+    size_t out_size);
+
+void dap_pack_decoder_reset(DapPackDecoder* decoder);
+
+/**
+ * Decode as much of the input as fits into the output, tokens may be split
+ * across calls.
+ * @param in_size available input, set to the number of bytes consumed
+ * @return output size
+ */
+size_t dap_pack_decode(
+    DapPackDecoder* decoder,
+    const uint8_t* in,
+    size_t* in_size,
+    uint8_t* out,
+    size_t out_size);
@@ -0,0 +1,108 @@
+#include <furi.h>
+
+#include "dap_pipe.h"
+
+#define TAG "DapPipe"
+
+#define DAP_PIPE_BUFFER_COUNT 2
+#define DAP_PIPE_STACK_SIZE 2048
+#define DAP_PIPE_STOP 0xFF
+
+struct DapPipe {
+    FuriThread* thread;
+    FuriMessageQueue* to_worker;
+    FuriMessageQueue* to_owner;
+    DapPipeWorker worker;
+    void* context;
+    DapPipeMode mode;
+    bool failed;
+    bool finished;
+    DapPipeBuffer buffers[DAP_PIPE_BUFFER_COUNT];
+};
+
+static int32_t dap_pipe_thread(void* context) {
+    DapPipe* pipe = context;
+    uint8_t index;
+
+    while(furi_message_queue_get(pipe->to_worker, &index, FuriWaitForever) == FuriStatusOk) {
+        if(index == DAP_PIPE_STOP) break;
+
+        DapPipeBuffer* buffer = &pipe->buffers[index];
+        if(!pipe->worker(pipe->context, buffer)) {
+            pipe->failed = true;
+            index = DAP_PIPE_STOP;
+        } else if(pipe->mode == DapPipeModeRead && buffer->size == 0) {
+            index = DAP_PIPE_STOP;
+        }
+
+        furi_message_queue_put(pipe->to_owner, &index, FuriWaitForever);
+        if(index == DAP_PIPE_STOP) break;
+    }
+
+    return 0;
+}
+
+DapPipe* dap_pipe_alloc(
+    DapPipeMode mode,
+    size_t buffer_size,
+    DapPipeWorker worker,
+    void* context) {
+    DapPipe* pipe = malloc(sizeof(DapPipe));
+    pipe->worker = worker;
+    pipe->context = context;
+    pipe->mode = mode;
+    pipe->failed = false;
+    pipe->finished = false;
+
+    // one extra slot for the stop marker
+    pipe->to_worker = furi_message_queue_alloc(DAP_PIPE_BUFFER_COUNT + 1, sizeof(uint8_t));
+    pipe->to_owner = furi_message_queue_alloc(DAP_PIPE_BUFFER_COUNT + 1, sizeof(uint8_t));
+
+    FuriMessageQueue* start = mode == DapPipeModeRead ? pipe->to_worker : pipe->to_owner;
+    for(uint8_t i = 0; i < DAP_PIPE_BUFFER_COUNT; i++) {
+        pipe->buffers[i].data = malloc(buffer_size);
+        pipe->buffers[i].size = 0;
+        pipe->buffers[i].address = 0;
+        furi_message_queue_put(start, &i, FuriWaitForever);
+    }
+
+    pipe->thread = furi_thread_alloc_ex("DapPipe", DAP_PIPE_STACK_SIZE, dap_pipe_thread, pipe);
+    furi_thread_start(pipe->thread);
+    return pipe;
+}
+
+bool dap_pipe_free(DapPipe* pipe) {
+    uint8_t index = DAP_PIPE_STOP;
+    furi_message_queue_put(pipe->to_worker, &index, FuriWaitForever);
+    furi_thread_join(pipe->thread);
+    furi_thread_free(pipe->thread);
+
+    bool ok = !pipe->failed;
+    if(!ok) FURI_LOG_W(TAG, "Worker failed");
+
+    for(size_t i = 0; i < DAP_PIPE_BUFFER_COUNT; i++) {
+        free(pipe->buffers[i].data);
+    }
+    furi_message_queue_free(pipe->to_worker);
+    furi_message_queue_free(pipe->to_owner);
+    free(pipe);
+    return ok;
+}
+
+DapPipeBuffer* dap_pipe_acquire(DapPipe* pipe) {
+    if(pipe->finished) return NULL;
+
+    uint8_t index;
+    if(furi_message_queue_get(pipe->to_owner, &index, FuriWaitForever) != FuriStatusOk ||
+       index == DAP_PIPE_STOP) {
+        pipe->finished = true;
+        return NULL;
+    }
+    return &pipe->buffers[index];
+}
+
+void dap_pipe_release(DapPipe* pipe, DapPipeBuffer* buffer) {
+    uint8_t index = buffer - pipe->buffers;
+    furi_assert(index < DAP_PIPE_BUFFER_COUNT);
+    furi_message_queue_put(pipe->to_worker, &index, FuriWaitForever);
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Two buffers passed back and forth between the DAP thread and a worker
+ * thread, so SD card access on one side overlaps SWD traffic on the other.
+ *
+ * In read mode the worker fills buffers and the DAP thread consumes them,
+ * in write mode the DAP thread fills buffers and the worker consumes them.
+ */
+
+typedef struct DapPipe DapPipe;
+
+typedef enum {
+    DapPipeModeRead,
+    DapPipeModeWrite,
+} DapPipeMode;
+
+typedef struct {
+    uint8_t* data;
+    size_t size; // payload size, a read worker sets 0 at the end of data
+    uint32_t address;
+} DapPipeBuffer;
+
+/**
+ * Worker callback, runs in the pipe thread.
+ * @return false to abort the pipe
+ */
+typedef bool (*DapPipeWorker)(void* context, DapPipeBuffer* buffer);
+
+DapPipe* dap_pipe_alloc(DapPipeMode mode, size_t buffer_size, DapPipeWorker worker, void* context);
+
+/**
+ * Stop the worker after the buffers already handed over.
+ * @return false if the worker failed
+ */
+bool dap_pipe_free(DapPipe* pipe);
+
+/**
+ * Next filled (read mode) or empty (write mode) buffer.
+ * @return NULL when the worker finished or failed
+ */
+DapPipeBuffer* dap_pipe_acquire(DapPipe* pipe);
+
+void dap_pipe_release(DapPipe* pipe, DapPipeBuffer* buffer);
@@ -0,0 +1,83 @@
+#include <furi.h>
+#include <storage/storage.h>
+
+#include "dap_recorder.h"
+
+#define TAG "DapRecorder"
+
+#define DAP_RECORDER_BUFFER_SIZE 1024
+#define DAP_RECORDER_STACK_SIZE 2048
+#define DAP_RECORDER_WAIT_MS 50
+
+#define DAP_RECORDER_EVENT_STOP (1 << 0)
+
+struct DapRecorder {
+    FuriThread* thread;
+    Storage* storage;
+    File* file;
+    FuriStreamBuffer* source;
+    uint32_t written;
+    bool failed;
+};
+
+static int32_t dap_recorder_thread(void* context) {
+    DapRecorder* recorder = context;
+    uint8_t* buffer = malloc(DAP_RECORDER_BUFFER_SIZE);
+    bool stop = false;
+
+    while(!recorder->failed) {
+        size_t len = furi_stream_buffer_receive(
+            recorder->source, buffer, DAP_RECORDER_BUFFER_SIZE, DAP_RECORDER_WAIT_MS);
+
+        if(len > 0) {
+            if(storage_file_write(recorder->file, buffer, len) != len) {
+                FURI_LOG_E(TAG, "Write failed after %lu bytes", recorder->written);
+                recorder->failed = true;
+            }
+            recorder->written += len;
+        } else if(stop) {
+            break;
+        }
+
+        // keep going until the buffer is empty once stop was requested
+        if(furi_thread_flags_get() & DAP_RECORDER_EVENT_STOP) stop = true;
+    }
+
+    free(buffer);
+    return 0;
+}
+
+DapRecorder* dap_recorder_alloc(const char* path, FuriStreamBuffer* source) {
+    DapRecorder* recorder = malloc(sizeof(DapRecorder));
+    recorder->storage = furi_record_open(RECORD_STORAGE);
+    recorder->file = storage_file_alloc(recorder->storage);
+    recorder->source = source;
+    recorder->written = 0;
+    recorder->failed = false;
+
+    if(!storage_file_open(recorder->file, path, FSAM_WRITE, FSOM_CREATE_ALWAYS)) {
+        FURI_LOG_E(TAG, "Can't create %s", path);
+        storage_file_free(recorder->file);
+        furi_record_close(RECORD_STORAGE);
+        free(recorder);
+        return NULL;
+    }
+
+    recorder->thread = furi_thread_alloc_ex(
+        "DapRecorder", DAP_RECORDER_STACK_SIZE, dap_recorder_thread, recorder);
+    furi_thread_start(recorder->thread);
+    return recorder;
+}
+
+uint32_t dap_recorder_free(DapRecorder* recorder) {
+    furi_thread_flags_set(furi_thread_get_id(recorder->thread), DAP_RECORDER_EVENT_STOP);
+    furi_thread_join(recorder->thread);
+    furi_thread_free(recorder->thread);
+
+    uint32_t written = recorder->written;
+    storage_file_close(recorder->file);
+    storage_file_free(recorder->file);
+    furi_record_close(RECORD_STORAGE);
+    free(recorder);
+    return written;
+}
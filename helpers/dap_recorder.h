@@ -0,0 +1,23 @@
+#pragma once
+#include <furi.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Drains a stream buffer into a file from its own thread, so a producer in
+ * the DAP thread never waits for the SD card.
+ */
+
+typedef struct DapRecorder DapRecorder;
+
+/**
+ * Create the file and start draining.
+ * @return NULL if the file could not be created
+ */
+DapRecorder* dap_recorder_alloc(const char* path, FuriStreamBuffer* source);
+
+/**
+ * Write what is still buffered and close the file.
+ * @return bytes written
+ */
+uint32_t dap_recorder_free(DapRecorder* recorder);
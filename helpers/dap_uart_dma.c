@@ -0,0 +1,277 @@
+#include <furi.h>
+#include <furi_hal_interrupt.h>
+#include <stm32wbxx_ll_bus.h>
+#include <stm32wbxx_ll_dma.h>
+#include <stm32wbxx_ll_usart.h>
+#include <stm32wbxx_ll_lpuart.h>
+
+#include "dap_uart_dma.h"
+
+// not used by the firmware HAL
+#define DAP_UART_DMA DMA2
+
+typedef struct {
+    uint32_t dma_channel;
+    FuriHalInterruptId irq;
+    uint32_t priority;
+} DapUartDmaLine;
+
+// the trace can't be asked to slow down, the bridges have the hardware FIFO
+static const DapUartDmaLine dap_uart_dma_lines[DAP_UART_DMA_CHANNEL_COUNT] = {
+    {LL_DMA_CHANNEL_5, FuriHalInterruptIdDma2Ch5, LL_DMA_PRIORITY_MEDIUM},
+    {LL_DMA_CHANNEL_6, FuriHalInterruptIdDma2Ch6, LL_DMA_PRIORITY_MEDIUM},
+    {LL_DMA_CHANNEL_7, FuriHalInterruptIdDma2Ch7, LL_DMA_PRIORITY_HIGH},
+};
+
+typedef struct {
+    const DapUartDmaLine* line;
+    bool uart; // the DMA request of uart_id is ours to switch
+    FuriHalUartId uart_id;
+    bool active;
+    uint8_t* buffer;
+    uint32_t size; // transfers per lap
+    uint32_t width; // bytes per transfer
+    volatile uint32_t halves; // DMA half and full transfer events
+    uint32_t head; // transfers at the stop
+    uint32_t tail; // transfers handed to the reader
+    bool lost;
+    DapUartDmaCallback callback;
+    void* context;
+} DapUartDmaChannel;
+
+static DapUartDmaChannel dap_uart_dma[DAP_UART_DMA_CHANNEL_COUNT] = {
+    {.line = &dap_uart_dma_lines[0]},
+    {.line = &dap_uart_dma_lines[1]},
+    {.line = &dap_uart_dma_lines[2]},
+};
+
+static DapUartDmaChannel* dap_uart_dma_get(uint8_t index) {
+    furi_assert(index < DAP_UART_DMA_CHANNEL_COUNT);
+    return &dap_uart_dma[index];
+}
+
+// flags of DMA channel n sit 4 bits above the ones of channel n - 1
+static inline uint32_t dap_uart_dma_flag_shift(const DapUartDmaChannel* channel) {
+    return channel->line->dma_channel * 4;
+}
+
+static void dap_uart_dma_isr(void* context) {
+    DapUartDmaChannel* channel = context;
+    const uint32_t shift = dap_uart_dma_flag_shift(channel);
+    const uint32_t flags = (READ_REG(DAP_UART_DMA->ISR) >> shift) &
+                           (DMA_ISR_HTIF1 | DMA_ISR_TCIF1);
+
+    if(flags & DMA_ISR_HTIF1) channel->halves++;
+    if(flags & DMA_ISR_TCIF1) channel->halves++;
+    WRITE_REG(DAP_UART_DMA->IFCR, flags << shift);
+
+    if(channel->callback) channel->callback(channel->context);
+}
+
+// turn the DMA position into a running transfer count
+static uint32_t dap_uart_dma_count(DapUartDmaChannel* channel) {
+    if(!channel->active) return channel->head;
+
+    const uint32_t half = channel->size / 2;
+    uint32_t halves;
+    uint32_t remaining;
+    do {
+        halves = channel->halves;
+        remaining = LL_DMA_GetDataLength(DAP_UART_DMA, channel->line->dma_channel);
+    } while(halves != channel->halves);
+
+    const uint32_t position = channel->size - remaining;
+    // a half just crossed may still wait for its interrupt
+    if((halves & 1) != position / half) halves++;
+    return halves * half + position % half;
+}
+
+static uint32_t dap_uart_dma_sync(DapUartDmaChannel* channel) {
+    const uint32_t head = dap_uart_dma_count(channel);
+    if(head - channel->tail > channel->size) {
+        // the DMA lapped the reader, whatever is left is mixed up
+        channel->lost = true;
+        channel->tail = head;
+    }
+    return head;
+}
+
+static void dap_uart_dma_take_lost(DapUartDmaChannel* channel, bool* lost) {
+    if(lost) {
+        *lost = channel->lost;
+        channel->lost = false;
+    }
+}
+
+void dap_uart_dma_start_register(
+    uint8_t index,
+    uint32_t request,
+    uint32_t source,
+    void* buffer,
+    size_t size,
+    size_t width,
+    DapUartDmaCallback callback,
+    void* context) {
+    DapUartDmaChannel* channel = dap_uart_dma_get(index);
+    const uint32_t dma_channel = channel->line->dma_channel;
+    const uint32_t shift = dap_uart_dma_flag_shift(channel);
+    furi_assert(size >= 2 && (size & (size - 1)) == 0 && size <= 0xFFFF);
+    furi_assert(width == 1 || width == 4);
+    dap_uart_dma_stop(index);
+
+    channel->uart = false;
+    channel->buffer = buffer;
+    channel->size = size;
+    channel->width = width;
+    channel->callback = callback;
+    channel->context = context;
+    channel->halves = 0;
+    channel->head = 0;
+    channel->tail = 0;
+    channel->lost = false;
+
+    LL_AHB1_GRP1_EnableClock(LL_AHB1_GRP1_PERIPH_DMAMUX1 | LL_AHB1_GRP1_PERIPH_DMA2);
+    LL_DMA_DisableChannel(DAP_UART_DMA, dma_channel);
+    LL_DMA_ConfigTransfer(
+        DAP_UART_DMA,
+        dma_channel,
+        LL_DMA_DIRECTION_PERIPH_TO_MEMORY | LL_DMA_MODE_CIRCULAR | LL_DMA_PERIPH_NOINCREMENT |
+            LL_DMA_MEMORY_INCREMENT | channel->line->priority |
+            (width == 4 ? LL_DMA_PDATAALIGN_WORD | LL_DMA_MDATAALIGN_WORD :
+                          LL_DMA_PDATAALIGN_BYTE | LL_DMA_MDATAALIGN_BYTE));
+    LL_DMA_SetPeriphRequest(DAP_UART_DMA, dma_channel, request);
+    LL_DMA_SetPeriphAddress(DAP_UART_DMA, dma_channel, source);
+    LL_DMA_SetMemoryAddress(DAP_UART_DMA, dma_channel, (uint32_t)buffer);
+    LL_DMA_SetDataLength(DAP_UART_DMA, dma_channel, size);
+    WRITE_REG(DAP_UART_DMA->IFCR, DMA_IFCR_CGIF1 << shift);
+
+    furi_hal_interrupt_set_isr(channel->line->irq, dap_uart_dma_isr, channel);
+    LL_DMA_EnableIT_HT(DAP_UART_DMA, dma_channel);
+    LL_DMA_EnableIT_TC(DAP_UART_DMA, dma_channel);
+    LL_DMA_EnableChannel(DAP_UART_DMA, dma_channel);
+
+    channel->active = true;
+}
+
+void dap_uart_dma_start(
+    uint8_t index,
+    FuriHalUartId uart_id,
+    uint8_t* buffer,
+    size_t size,
+    DapUartDmaCallback callback,
+    void* context) {
+    DapUartDmaChannel* channel = dap_uart_dma_get(index);
+    dap_uart_dma_stop(index);
+
+    // an overrun must not stop reception, a slow reader just loses bytes
+    uint32_t request;
+    uint32_t source;
+    if(uart_id == FuriHalUartIdUSART1) {
+        LL_USART_Disable(USART1);
+        LL_USART_DisableOverrunDetect(USART1);
+        LL_USART_Enable(USART1);
+        request = LL_DMAMUX_REQ_USART1_RX;
+        source = (uint32_t)&USART1->RDR;
+    } else {
+        LL_LPUART_Disable(LPUART1);
+        LL_LPUART_DisableOverrunDetect(LPUART1);
+        LL_LPUART_Enable(LPUART1);
+        request = LL_DMAMUX_REQ_LPUART1_RX;
+        source = (uint32_t)&LPUART1->RDR;
+    }
+
+    dap_uart_dma_start_register(index, request, source, buffer, size, 1, callback, context);
+    channel->uart = true;
+    channel->uart_id = uart_id;
+
+    // stale bytes and error flags from before the start
+    if(uart_id == FuriHalUartIdUSART1) {
+        LL_USART_RequestRxDataFlush(USART1);
+        LL_USART_ClearFlag_ORE(USART1);
+        LL_USART_ClearFlag_FE(USART1);
+        LL_USART_ClearFlag_NE(USART1);
+        LL_USART_EnableDMAReq_RX(USART1);
+    } else {
+        LL_LPUART_RequestRxDataFlush(LPUART1);
+        LL_LPUART_ClearFlag_ORE(LPUART1);
+        LL_LPUART_ClearFlag_FE(LPUART1);
+        LL_LPUART_ClearFlag_NE(LPUART1);
+        LL_LPUART_EnableDMAReq_RX(LPUART1);
+    }
+}
+
+void dap_uart_dma_stop(uint8_t index) {
+    DapUartDmaChannel* channel = dap_uart_dma_get(index);
+    if(!channel->active) return;
+
+    if(channel->uart && channel->uart_id == FuriHalUartIdUSART1) {
+        LL_USART_DisableDMAReq_RX(USART1);
+    } else if(channel->uart) {
+        LL_LPUART_DisableDMAReq_RX(LPUART1);
+    }
+
+    LL_DMA_DisableIT_HT(DAP_UART_DMA, channel->line->dma_channel);
+    LL_DMA_DisableIT_TC(DAP_UART_DMA, channel->line->dma_channel);
+    // the last lap may not have been counted by the interrupt
+    channel->head = dap_uart_dma_count(channel);
+    LL_DMA_DisableChannel(DAP_UART_DMA, channel->line->dma_channel);
+    furi_hal_interrupt_set_isr(channel->line->irq, NULL, NULL);
+    channel->active = false;
+}
+
+void dap_uart_dma_clear(uint8_t index) {
+    DapUartDmaChannel* channel = dap_uart_dma_get(index);
+    furi_check(!channel->active);
+    channel->buffer = NULL;
+    channel->head = channel->tail = 0;
+    channel->lost = false;
+}
+
+size_t dap_uart_dma_available(uint8_t index, bool* lost) {
+    DapUartDmaChannel* channel = dap_uart_dma_get(index);
+    const uint32_t head = dap_uart_dma_sync(channel);
+    dap_uart_dma_take_lost(channel, lost);
+    return head - channel->tail;
+}
+
+size_t dap_uart_dma_peek(uint8_t index, const void** data, bool* lost) {
+    DapUartDmaChannel* channel = dap_uart_dma_get(index);
+    const uint32_t head = dap_uart_dma_sync(channel);
+    const size_t offset = channel->tail & (channel->size - 1);
+    dap_uart_dma_take_lost(channel, lost);
+
+    *data = &channel->buffer[offset * channel->width];
+    return MIN(head - channel->tail, channel->size - offset);
+}
+
+void dap_uart_dma_skip(uint8_t index, size_t count) {
+    DapUartDmaChannel* channel = dap_uart_dma_get(index);
+    const uint32_t tail = channel->tail;
+    channel->tail += count;
+
+    // the DMA may have overtaken the reader while it was at the data
+    if(dap_uart_dma_count(channel) - tail > channel->size) channel->lost = true;
+}
+
+size_t dap_uart_dma_read(uint8_t index, uint8_t* data, size_t size, bool* lost) {
+    DapUartDmaChannel* channel = dap_uart_dma_get(index);
+    furi_assert(channel->width == 1);
+    size_t done = 0;
+    bool dropped = false;
+
+    while(done < size) {
+        const void* ring;
+        bool ring_lost;
+        const size_t chunk = MIN(size - done, dap_uart_dma_peek(index, &ring, &ring_lost));
+        dropped |= ring_lost;
+        if(chunk == 0) break;
+
+        memcpy(&data[done], ring, chunk);
+        dap_uart_dma_skip(index, chunk);
+        done += chunk;
+    }
+
+    // an overtaken copy shows up at the next read
+    if(lost) *lost = dropped;
+    return done;
+}
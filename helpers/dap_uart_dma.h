@@ -0,0 +1,89 @@
+#pragma once
+#include <furi.h>
+#include <furi_hal_uart.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Peripheral receive through circular DMA, for the CDC bridges and the SWO
+ * capture.
+ *
+ * Every channel has a DMA2 channel of its own writing into a ring the caller
+ * owns, and the reader only takes what the DMA has written so far. Half and
+ * full transfer interrupts count laps, which turns the DMA position into a
+ * running transfer count; a reader more than one ring behind loses the
+ * backlog. There is no idle line event, data that doesn't fill half a ring
+ * is picked up by polling.
+ */
+
+#define DAP_UART_DMA_CHANNEL_COUNT 3
+
+// channels 0 and 1 belong to the CDC bridges of the same number
+#define DAP_UART_DMA_CHANNEL_SWO 2
+
+/**
+ * Called from the DMA interrupt each time half of a ring is filled
+ */
+typedef void (*DapUartDmaCallback)(void* context);
+
+/**
+ * Start receiving on an initialised UART. Takes over RDR, so the UART must
+ * not have a byte interrupt callback. Overrun detection is turned off.
+ * @param size ring size in bytes, a power of two
+ */
+void dap_uart_dma_start(
+    uint8_t channel,
+    FuriHalUartId uart_id,
+    uint8_t* buffer,
+    size_t size,
+    DapUartDmaCallback callback,
+    void* context);
+
+/**
+ * Start a ring on any other peripheral register, the caller enables and
+ * disables the DMA request of the peripheral
+ * @param width bytes per transfer, 1 or 4
+ * @param size ring size in transfers, a power of two
+ */
+void dap_uart_dma_start_register(
+    uint8_t channel,
+    uint32_t request,
+    uint32_t source,
+    void* buffer,
+    size_t size,
+    size_t width,
+    DapUartDmaCallback callback,
+    void* context);
+
+/**
+ * Data received before the stop stays readable until the next start
+ */
+void dap_uart_dma_stop(uint8_t channel);
+
+/**
+ * Forget what a stopped channel holds, before its ring is freed
+ */
+void dap_uart_dma_clear(uint8_t channel);
+
+/**
+ * @param lost as for read, with NULL the flag waits for the next read
+ * @return transfers waiting in the ring
+ */
+size_t dap_uart_dma_available(uint8_t channel, bool* lost);
+
+/**
+ * @param lost set if received data was dropped since the last read
+ * @return bytes copied
+ */
+size_t dap_uart_dma_read(uint8_t channel, uint8_t* data, size_t size, bool* lost);
+
+/**
+ * Unread transfers in place, up to the end of the ring. Hand them back with
+ * dap_uart_dma_skip().
+ * @param lost set if received data was dropped since the last read
+ * @return transfers at data
+ */
+size_t dap_uart_dma_peek(uint8_t channel, const void** data, bool* lost);
+
+void dap_uart_dma_skip(uint8_t channel, size_t count);
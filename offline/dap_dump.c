@@ -0,0 +1,165 @@
+#include <furi.h>
+#include <storage/storage.h>
+
+#include "dap_dump.h"
+#include "../helpers/dap_crc32.h"
+#include "../helpers/dap_pipe.h"
+#include "../target/dap_target.h"
+
+#define TAG "DapDump"
+
+#define DAP_DUMP_BUFFER_SIZE 4096
+
+typedef struct {
+    Storage* storage;
+    File* file;
+    uint32_t offset; // bytes already in the file
+    uint32_t crc;
+} DapDump;
+
+static bool dap_dump_write_worker(void* context, DapPipeBuffer* buffer) {
+    DapDump* dump = context;
+    return storage_file_write(dump->file, buffer->data, buffer->size) == buffer->size;
+}
+
+static bool dap_dump_open(DapDump* dump, const char* path, const char* crc_path, uint32_t size) {
+    dump->offset = 0;
+    dump->crc = 0;
+
+    // a finished dump is never extended, only replaced
+    if(storage_common_stat(dump->storage, crc_path, NULL) == FSE_OK ||
+       !storage_file_open(dump->file, path, FSAM_READ_WRITE, FSOM_OPEN_EXISTING)) {
+        storage_simply_remove(dump->storage, crc_path);
+        return storage_file_open(dump->file, path, FSAM_WRITE, FSOM_CREATE_ALWAYS);
+    }
+
+    uint32_t existing = storage_file_size(dump->file);
+    existing = MIN(existing, size) & ~3UL;
+
+    // the CRC has to cover the part written by the previous run
+    uint8_t* buffer = malloc(DAP_DUMP_BUFFER_SIZE);
+    bool ok = true;
+    while(ok && dump->offset < existing) {
+        size_t chunk = MIN(existing - dump->offset, (uint32_t)DAP_DUMP_BUFFER_SIZE);
+        ok = storage_file_read(dump->file, buffer, chunk) == chunk;
+        dump->crc = dap_crc32(dump->crc, buffer, chunk);
+        dump->offset += chunk;
+    }
+    free(buffer);
+
+    ok = ok && storage_file_seek(dump->file, dump->offset, true) &&
+         storage_file_truncate(dump->file);
+    if(ok && dump->offset > 0) FURI_LOG_I(TAG, "Resuming at %lu", dump->offset);
+    return ok;
+}
+
+static bool
+    dap_dump_write_crc(DapDump* dump, const char* crc_path, uint32_t address, uint32_t size) {
+    FuriString* text = furi_string_alloc_printf(
+        "CRC32 %08lX\nAddress %08lX\nSize %lu\n", dump->crc, address, size);
+    File* file = storage_file_alloc(dump->storage);
+
+    bool ok = storage_file_open(file, crc_path, FSAM_WRITE, FSOM_CREATE_ALWAYS) &&
+              storage_file_write(file, furi_string_get_cstr(text), furi_string_size(text)) ==
+                  furi_string_size(text);
+
+    storage_file_close(file);
+    storage_file_free(file);
+    furi_string_free(text);
+    return ok;
+}
+
+static bool dap_dump_read(
+    DapDump* dump,
+    uint32_t address,
+    uint32_t size,
+    DapJobProgress* progress,
+    const volatile bool* cancel) {
+    DapPipe* pipe =
+        dap_pipe_alloc(DapPipeModeWrite, DAP_DUMP_BUFFER_SIZE, dap_dump_write_worker, dump);
+    const uint32_t start_tick = furi_get_tick();
+    const uint32_t start_offset = dump->offset;
+    bool ok = true;
+
+    while(ok && dump->offset < size && !*cancel) {
+        DapPipeBuffer* buffer = dap_pipe_acquire(pipe);
+        if(!buffer) {
+            ok = false;
+            break;
+        }
+
+        // the SD card takes the previous buffer while this one is read
+        buffer->size = MIN(size - dump->offset, (uint32_t)DAP_DUMP_BUFFER_SIZE);
+        ok = dap_target_read_block(
+            address + dump->offset, (uint32_t*)buffer->data, (buffer->size + 3) / 4);
+        if(ok) {
+            dump->crc = dap_crc32(dump->crc, buffer->data, buffer->size);
+            dump->offset += buffer->size;
+        } else {
+            buffer->size = 0;
+        }
+        dap_pipe_release(pipe, buffer);
+
+        uint32_t elapsed = furi_get_tick() - start_tick;
+        progress->done = dump->offset;
+        progress->elapsed_ms = elapsed;
+        if(elapsed > 0) {
+            progress->rate = (uint64_t)(dump->offset - start_offset) * 1000 / elapsed;
+        }
+    }
+
+    return dap_pipe_free(pipe) && ok && dump->offset == size;
+}
+
+bool dap_dump_run(
+    const char* path,
+    uint32_t address,
+    uint32_t size,
+    DapJobProgress* progress,
+    const volatile bool* cancel) {
+    if(address & 3) return false;
+
+    DapDump* dump = malloc(sizeof(DapDump));
+    dump->storage = furi_record_open(RECORD_STORAGE);
+    dump->file = storage_file_alloc(dump->storage);
+    FuriString* crc_path = furi_string_alloc_printf("%s%s", path, DAP_DUMP_CRC_EXTENSION);
+    bool ok = false;
+
+    progress->stage = DapJobStageConnect;
+    progress->total = size;
+
+    do {
+        if(!dap_target_connect(NULL)) {
+            FURI_LOG_E(TAG, "Target not responding");
+            break;
+        }
+
+        if(!dap_dump_open(dump, path, furi_string_get_cstr(crc_path), size)) {
+            FURI_LOG_E(TAG, "Can't open %s", path);
+            break;
+        }
+
+        progress->stage = DapJobStageDump;
+        progress->done = dump->offset;
+        if(!dap_dump_read(dump, address, size, progress, cancel)) break;
+
+        storage_file_close(dump->file);
+        ok = dap_dump_write_crc(dump, furi_string_get_cstr(crc_path), address, size);
+    } while(false);
+
+    FURI_LOG_I(
+        TAG,
+        "Dumped %lu of %lu bytes, CRC %08lX, %luB/s",
+        dump->offset,
+        size,
+        dump->crc,
+        progress->rate);
+
+    dap_target_disconnect();
+    // closes the file if the dump didn't get that far
+    storage_file_free(dump->file);
+    furi_string_free(crc_path);
+    furi_record_close(RECORD_STORAGE);
+    free(dump);
+    return ok;
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "../dap_link.h"
+
+/*
+ * Target memory dump to the SD card.
+ *
+ * A partial dump of the same range (no ".crc" sidecar yet) is resumed where
+ * it stopped. On success "<path>.crc" is written with the CRC32, address
+ * and size of the whole range.
+ */
+
+#define DAP_DUMP_CRC_EXTENSION ".crc"
+
+bool dap_dump_run(
+    const char* path,
+    uint32_t address,
+    uint32_t size,
+    DapJobProgress* progress,
+    const volatile bool* cancel);
@@ -0,0 +1,137 @@
+#include <furi.h>
+#include <storage/storage.h>
+
+#include "dap_load.h"
+#include "../helpers/dap_image.h"
+#include "../helpers/dap_pipe.h"
+#include "../target/dap_target.h"
+
+#define TAG "DapLoad"
+
+#define DAP_LOAD_BUFFER_SIZE 1024
+#define DAP_LOAD_HALT_TIMEOUT_US 100000
+
+typedef struct {
+    DapImage* image;
+    DapImageChunk pending;
+    uint32_t lowest;
+} DapLoad;
+
+// runs in the pipe thread, merges contiguous chunks into one buffer
+static bool dap_load_read_worker(void* context, DapPipeBuffer* buffer) {
+    DapLoad* load = context;
+    DapImageChunk* pending = &load->pending;
+    buffer->size = 0;
+
+    while(buffer->size < DAP_LOAD_BUFFER_SIZE) {
+        if(pending->size == 0) {
+            DapImageStatus status = dap_image_next(load->image, pending);
+            if(status == DapImageStatusEnd) break;
+            if(status == DapImageStatusError) return false;
+        }
+
+        if(buffer->size == 0) {
+            buffer->address = pending->address;
+        } else if(pending->address != buffer->address + buffer->size) {
+            break;
+        }
+
+        size_t size = MIN(pending->size, DAP_LOAD_BUFFER_SIZE - buffer->size);
+        memcpy(&buffer->data[buffer->size], pending->data, size);
+        buffer->size += size;
+        pending->data += size;
+        pending->address += size;
+        pending->size -= size;
+    }
+
+    return true;
+}
+
+static bool dap_load_write(uint32_t address, const uint8_t* data, size_t size) {
+    // whole-word runs go out in one block, only ragged edges take the slow path
+    if((address & 3) == 0 && (size & 3) == 0) {
+        return dap_target_write_block(address, (const uint32_t*)data, size / 4);
+    }
+    return dap_target_write_bytes(address, data, size);
+}
+
+static bool dap_load_start(DapLoad* load, DapJobProgress* progress) {
+    uint32_t vectors[2];
+    if(!dap_target_read_block(load->lowest, vectors, COUNT_OF(vectors))) return false;
+
+    uint32_t entry = dap_image_get_entry(load->image);
+    if(entry == 0) entry = vectors[1];
+    progress->entry = entry & ~1UL;
+
+    FURI_LOG_I(TAG, "Starting at %08lX, SP %08lX", progress->entry, vectors[0]);
+
+    bool ok = dap_target_write32(DAP_TARGET_VTOR, load->lowest);
+    if(vectors[0] != 0 && (vectors[0] & 3) == 0) {
+        ok = ok && dap_target_write_reg(DAP_TARGET_REG_MSP, vectors[0]);
+    }
+
+    return ok && dap_target_write_reg(DAP_TARGET_REG_PC, progress->entry) &&
+           dap_target_write_reg(DAP_TARGET_REG_XPSR, DAP_TARGET_XPSR_THUMB) &&
+           dap_target_write32(DAP_TARGET_DFSR, DAP_TARGET_DFSR_CLEAR) &&
+           dap_target_resume(false);
+}
+
+static bool dap_load_image(DapLoad* load, DapJobProgress* progress, const volatile bool* cancel) {
+    DapPipe* pipe =
+        dap_pipe_alloc(DapPipeModeRead, DAP_LOAD_BUFFER_SIZE, dap_load_read_worker, load);
+    const uint32_t start_tick = furi_get_tick();
+    bool ok = true;
+
+    DapPipeBuffer* buffer;
+    while(ok && !*cancel && (buffer = dap_pipe_acquire(pipe)) != NULL) {
+        load->lowest = MIN(load->lowest, buffer->address);
+        ok = dap_load_write(buffer->address, buffer->data, buffer->size);
+        progress->done += buffer->size;
+        dap_pipe_release(pipe, buffer);
+
+        progress->elapsed_ms = furi_get_tick() - start_tick;
+        if(progress->elapsed_ms > 0) {
+            progress->rate = (uint64_t)progress->done * 1000 / progress->elapsed_ms;
+        }
+    }
+
+    return dap_pipe_free(pipe) && ok && !*cancel && progress->done > 0;
+}
+
+bool dap_load_run(
+    const char* path,
+    uint32_t base,
+    DapJobProgress* progress,
+    const volatile bool* cancel) {
+    DapLoad* load = malloc(sizeof(DapLoad));
+    memset(load, 0, sizeof(DapLoad));
+    load->lowest = UINT32_MAX;
+
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    load->image = dap_image_alloc(storage);
+    bool ok = false;
+
+    do {
+        progress->stage = DapJobStageConnect;
+        if(!dap_target_connect(NULL) || !dap_target_halt(DAP_LOAD_HALT_TIMEOUT_US)) {
+            FURI_LOG_E(TAG, "Target not responding");
+            break;
+        }
+
+        if(!dap_image_open(load->image, path, base)) break;
+
+        progress->stage = DapJobStageLoad;
+        if(!dap_load_image(load, progress, cancel)) break;
+
+        progress->stage = DapJobStageStart;
+        ok = dap_load_start(load, progress);
+    } while(false);
+
+    FURI_LOG_I(TAG, "Loaded %lu bytes in %lums", progress->done, progress->elapsed_ms);
+
+    dap_target_disconnect();
+    dap_image_free(load->image);
+    furi_record_close(RECORD_STORAGE);
+    free(load);
+    return ok;
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "../dap_link.h"
+
+/*
+ * Load-and-run of RAM images from the SD card.
+ *
+ * The image is streamed into target RAM with adjacent records coalesced
+ * into long block writes. The lowest loaded address is taken as the vector
+ * table: VTOR and MSP are set from it and the core starts at the ELF or HEX
+ * entry point, or at the reset vector if the image has none.
+ */
+
+/**
+ * @param base load address of a raw binary
+ */
+bool dap_load_run(
+    const char* path,
+    uint32_t base,
+    DapJobProgress* progress,
+    const volatile bool* cancel);
@@ -0,0 +1,383 @@
+#include <furi.h>
+#include <storage/storage.h>
+
+#include "dap_program.h"
+#include "../dap_cmsis.h"
+#include "../helpers/dap_crc32.h"
+#include "../helpers/dap_image.h"
+#include "../helpers/dap_pipe.h"
+#include "../target/dap_flash.h"
+#include "../target/dap_stub.h"
+#include "../target/dap_target.h"
+
+#define TAG "DapProgram"
+
+#define DAP_PROGRAM_ALGO_MAGIC 0x41504144
+#define DAP_PROGRAM_ALGO_HEADER_SIZE 60
+#define DAP_PROGRAM_CHUNK_MAX 2048
+#define DAP_PROGRAM_WORDS 64
+#define DAP_PROGRAM_HALT_TIMEOUT_US 100000
+#define DAP_PROGRAM_STUB_TIMEOUT_US 2000000
+
+typedef struct {
+    DapImage* image;
+    DapFlashAlgo algo;
+    uint32_t sector_size;
+    uint32_t flash_start;
+    uint32_t flash_size;
+    uint32_t code_size;
+
+    uint32_t sector_count;
+    uint8_t* touched; // sectors covered by the image
+    uint8_t* dirty; // sectors that differ from the image
+    bool use_stub;
+
+    // read worker position
+    const uint8_t* walk;
+    uint32_t walk_sector;
+    uint32_t walk_offset;
+    size_t chunk_size;
+
+    DapJobProgress* progress;
+    const volatile bool* cancel;
+    uint32_t start_tick;
+} DapProgram;
+
+static uint32_t dap_program_buffer[DAP_PROGRAM_WORDS];
+
+static inline bool dap_program_test(const uint8_t* bitmap, uint32_t sector) {
+    return bitmap[sector / 8] & (1 << (sector % 8));
+}
+
+static inline void dap_program_mark(uint8_t* bitmap, uint32_t sector) {
+    bitmap[sector / 8] |= (1 << (sector % 8));
+}
+
+static uint32_t dap_program_count(DapProgram* program, const uint8_t* bitmap) {
+    uint32_t count = 0;
+    for(uint32_t i = 0; i < program->sector_count; i++) {
+        if(dap_program_test(bitmap, i)) count++;
+    }
+    return count;
+}
+
+static bool dap_program_step(DapProgram* program, DapJobStage stage, uint32_t total) {
+    DapJobProgress* progress = program->progress;
+    progress->stage = stage;
+    progress->done = 0;
+    progress->total = total;
+    progress->elapsed_ms = furi_get_tick() - program->start_tick;
+    return !*program->cancel;
+}
+
+static bool dap_program_advance(DapProgram* program, uint32_t bytes) {
+    program->progress->done += bytes;
+    program->progress->elapsed_ms = furi_get_tick() - program->start_tick;
+    return !*program->cancel;
+}
+
+static bool dap_program_load_algo(DapProgram* program, Storage* storage, const char* path) {
+    File* file = storage_file_alloc(storage);
+    uint8_t* header = (uint8_t*)dap_program_buffer;
+    bool ok = false;
+
+    do {
+        if(!storage_file_open(file, path, FSAM_READ, FSOM_OPEN_EXISTING)) break;
+        if(storage_file_read(file, header, DAP_PROGRAM_ALGO_HEADER_SIZE) !=
+           DAP_PROGRAM_ALGO_HEADER_SIZE) {
+            break;
+        }
+        if(dap_get_u32(&header[0]) != DAP_PROGRAM_ALGO_MAGIC) break;
+
+        DapFlashAlgo* algo = &program->algo;
+        algo->load_address = dap_get_u32(&header[4]);
+        algo->pc_init = dap_get_u32(&header[8]);
+        algo->pc_uninit = dap_get_u32(&header[12]);
+        algo->pc_program_page = dap_get_u32(&header[16]);
+        algo->pc_erase_sector = dap_get_u32(&header[20]);
+        algo->static_base = dap_get_u32(&header[24]);
+        algo->stack_pointer = dap_get_u32(&header[28]);
+        algo->buffer[0] = dap_get_u32(&header[32]);
+        algo->buffer[1] = dap_get_u32(&header[36]);
+        algo->page_size = dap_get_u32(&header[40]);
+        program->sector_size = dap_get_u32(&header[44]);
+        program->flash_start = dap_get_u32(&header[48]);
+        program->flash_size = dap_get_u32(&header[52]);
+        program->code_size = dap_get_u32(&header[56]);
+
+        // chunks must tile sectors and sectors must tile pages
+        if(algo->page_size == 0 || program->sector_size < algo->page_size ||
+           program->sector_size % algo->page_size || program->flash_size == 0 ||
+           program->flash_size % program->sector_size) {
+            break;
+        }
+        program->chunk_size = MIN(program->sector_size, (uint32_t)DAP_PROGRAM_CHUNK_MAX);
+        if(program->sector_size % program->chunk_size) break;
+
+        // the code goes to target RAM right away
+        uint32_t address = algo->load_address;
+        uint32_t left = program->code_size;
+        ok = true;
+        while(ok && left > 0) {
+            size_t size = MIN(left, sizeof(dap_program_buffer));
+            memset(dap_program_buffer, 0, sizeof(dap_program_buffer));
+            ok = storage_file_read(file, dap_program_buffer, size) == size &&
+                 dap_target_write_block(address, dap_program_buffer, (size + 3) / 4);
+            address += size;
+            left -= size;
+        }
+    } while(false);
+
+    if(!ok) FURI_LOG_E(TAG, "Can't load algorithm %s", path);
+    storage_file_close(file);
+    storage_file_free(file);
+    return ok;
+}
+
+static bool dap_program_scan(DapProgram* program) {
+    const uint32_t flash_end = program->flash_start + program->flash_size;
+    DapImageChunk chunk;
+    DapImageStatus status;
+
+    if(!dap_image_rewind(program->image)) return false;
+
+    while((status = dap_image_next(program->image, &chunk)) == DapImageStatusOk) {
+        if(chunk.address < program->flash_start || chunk.address + chunk.size > flash_end) {
+            FURI_LOG_E(TAG, "Data at %08lX is outside of flash", chunk.address);
+            return false;
+        }
+
+        uint32_t first = (chunk.address - program->flash_start) / program->sector_size;
+        uint32_t last = (chunk.address + chunk.size - 1 - program->flash_start) /
+                        program->sector_size;
+        for(uint32_t sector = first; sector <= last; sector++) {
+            dap_program_mark(program->touched, sector);
+        }
+
+        if(!dap_program_advance(program, chunk.size)) return false;
+    }
+
+    program->progress->sectors = dap_program_count(program, program->touched);
+    return status == DapImageStatusEnd;
+}
+
+// runs in the pipe thread, walks the selected sectors chunk by chunk
+static bool dap_program_read_worker(void* context, DapPipeBuffer* buffer) {
+    DapProgram* program = context;
+
+    while(program->walk_sector < program->sector_count &&
+          !dap_program_test(program->walk, program->walk_sector)) {
+        program->walk_sector++;
+    }
+
+    if(program->walk_sector == program->sector_count) {
+        buffer->size = 0;
+        return true;
+    }
+
+    buffer->address = program->flash_start + program->walk_sector * program->sector_size +
+                      program->walk_offset;
+    buffer->size = program->chunk_size;
+
+    program->walk_offset += program->chunk_size;
+    if(program->walk_offset == program->sector_size) {
+        program->walk_offset = 0;
+        program->walk_sector++;
+    }
+
+    return dap_image_read_flat(program->image, buffer->address, buffer->data, buffer->size);
+}
+
+static DapPipe* dap_program_walk(DapProgram* program, const uint8_t* sectors) {
+    if(!dap_image_rewind(program->image)) return NULL;
+    program->walk = sectors;
+    program->walk_sector = 0;
+    program->walk_offset = 0;
+    return dap_pipe_alloc(DapPipeModeRead, program->chunk_size, dap_program_read_worker, program);
+}
+
+static bool dap_program_target_crc(DapProgram* program, uint32_t address, uint32_t* crc) {
+    if(program->use_stub) {
+        if(dap_stub_crc32(
+               program->algo.buffer[0],
+               address,
+               program->sector_size,
+               DAP_PROGRAM_STUB_TIMEOUT_US,
+               crc)) {
+            return true;
+        }
+        FURI_LOG_W(TAG, "CRC stub failed, reading back instead");
+        program->use_stub = false;
+    }
+
+    *crc = 0;
+    for(uint32_t offset = 0; offset < program->sector_size; offset += sizeof(dap_program_buffer)) {
+        size_t words = MIN(program->sector_size - offset, sizeof(dap_program_buffer)) / 4;
+        if(!dap_target_read_block(address + offset, dap_program_buffer, words)) return false;
+        *crc = dap_crc32_words(*crc, dap_program_buffer, words);
+    }
+    return true;
+}
+
+static bool dap_program_compare(
+    DapProgram* program,
+    DapJobStage stage,
+    const uint8_t* sectors,
+    uint8_t* mismatch) {
+    uint32_t count = dap_program_count(program, sectors);
+    if(!dap_program_step(program, stage, count * program->sector_size)) return false;
+
+    DapPipe* pipe = dap_program_walk(program, sectors);
+    if(!pipe) return false;
+
+    bool ok = true;
+    uint32_t image_crc = 0;
+    DapPipeBuffer* buffer;
+    while(ok && (buffer = dap_pipe_acquire(pipe)) != NULL) {
+        uint32_t offset = (buffer->address - program->flash_start) % program->sector_size;
+        image_crc = dap_crc32(offset ? image_crc : 0, buffer->data, buffer->size);
+
+        if(offset + buffer->size == program->sector_size) {
+            uint32_t sector_address = buffer->address - offset;
+            uint32_t target_crc;
+            ok = dap_program_target_crc(program, sector_address, &target_crc);
+            if(ok && target_crc != image_crc) {
+                uint32_t sector = (sector_address - program->flash_start) / program->sector_size;
+                dap_program_mark(mismatch, sector);
+            }
+        }
+
+        ok = ok && dap_program_advance(program, buffer->size);
+        dap_pipe_release(pipe, buffer);
+    }
+
+    return dap_pipe_free(pipe) && ok;
+}
+
+static bool dap_program_erase(DapProgram* program) {
+    uint32_t count = dap_program_count(program, program->dirty);
+    if(!dap_program_step(program, DapJobStageErase, count * program->sector_size)) return false;
+    if(!dap_flash_init(program->flash_start, 0, DapFlashFunctionErase)) return false;
+
+    bool ok = true;
+    for(uint32_t sector = 0; ok && sector < program->sector_count; sector++) {
+        if(!dap_program_test(program->dirty, sector)) continue;
+        ok = dap_flash_erase_sector(program->flash_start + sector * program->sector_size) &&
+             dap_program_advance(program, program->sector_size);
+    }
+
+    return dap_flash_uninit(DapFlashFunctionErase) && ok;
+}
+
+static bool dap_program_write(DapProgram* program) {
+    uint32_t count = dap_program_count(program, program->dirty);
+    if(!dap_program_step(program, DapJobStageProgram, count * program->sector_size)) {
+        return false;
+    }
+    if(!dap_flash_init(program->flash_start, 0, DapFlashFunctionProgram)) return false;
+
+    DapPipe* pipe = dap_program_walk(program, program->dirty);
+    if(!pipe) return false;
+
+    bool ok = true;
+    bool streaming = false;
+    uint32_t next_address = 0;
+    DapPipeBuffer* buffer;
+    while(ok && (buffer = dap_pipe_acquire(pipe)) != NULL) {
+        // restart the stream after a run of skipped sectors
+        if(!streaming || buffer->address != next_address) {
+            ok = (!streaming || dap_flash_finish()) && dap_flash_begin(buffer->address);
+            streaming = true;
+        }
+
+        ok = ok && dap_flash_write(buffer->data, buffer->size) &&
+             dap_program_advance(program, buffer->size);
+        next_address = buffer->address + buffer->size;
+        dap_pipe_release(pipe, buffer);
+    }
+
+    ok = dap_pipe_free(pipe) && ok;
+    if(streaming) ok = dap_flash_finish() && ok;
+    return dap_flash_uninit(DapFlashFunctionProgram) && ok;
+}
+
+static bool dap_program_flash(DapProgram* program) {
+    const uint32_t bitmap_size = (program->sector_count + 7) / 8;
+    DapJobProgress* progress = program->progress;
+
+    if(!dap_program_step(program, DapJobStageScan, 0) || !dap_program_scan(program)) {
+        return false;
+    }
+
+    if(!dap_program_compare(program, DapJobStageCompare, program->touched, program->dirty)) {
+        return false;
+    }
+
+    progress->skipped = progress->sectors - dap_program_count(program, program->dirty);
+    FURI_LOG_I(TAG, "%lu of %lu sectors up to date", progress->skipped, progress->sectors);
+    if(progress->skipped == progress->sectors) return true;
+
+    if(!dap_flash_setup(&program->algo) || !dap_program_erase(program) ||
+       !dap_program_write(program)) {
+        return false;
+    }
+
+    // everything that was written must read back with the image CRC now
+    uint8_t* mismatch = malloc(bitmap_size);
+    memset(mismatch, 0, bitmap_size);
+    bool ok = dap_program_compare(program, DapJobStageVerify, program->dirty, mismatch) &&
+              dap_program_count(program, mismatch) == 0;
+    free(mismatch);
+    return ok;
+}
+
+bool dap_program_run(
+    const char* image_path,
+    const char* algo_path,
+    DapJobProgress* progress,
+    const volatile bool* cancel) {
+    DapProgram* program = malloc(sizeof(DapProgram));
+    memset(program, 0, sizeof(DapProgram));
+    program->progress = progress;
+    program->cancel = cancel;
+    program->start_tick = furi_get_tick();
+
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    program->image = dap_image_alloc(storage);
+    bool ok = false;
+
+    do {
+        dap_program_step(program, DapJobStageConnect, 0);
+        if(!dap_target_connect(NULL) || !dap_target_halt(DAP_PROGRAM_HALT_TIMEOUT_US)) {
+            FURI_LOG_E(TAG, "Target not responding");
+            break;
+        }
+
+        if(!dap_program_load_algo(program, storage, algo_path)) break;
+        if(!dap_image_open(program->image, image_path, program->flash_start)) break;
+
+        program->sector_count = program->flash_size / program->sector_size;
+        program->touched = malloc((program->sector_count + 7) / 8);
+        program->dirty = malloc((program->sector_count + 7) / 8);
+        memset(program->touched, 0, (program->sector_count + 7) / 8);
+        memset(program->dirty, 0, (program->sector_count + 7) / 8);
+
+        // the first page buffer doubles as the CRC stub work area
+        program->use_stub = program->algo.page_size >= DAP_STUB_WORKAREA_SIZE &&
+                            dap_stub_is_supported();
+
+        ok = dap_program_flash(program);
+        if(ok) dap_target_run_reset();
+    } while(false);
+
+    progress->elapsed_ms = furi_get_tick() - program->start_tick;
+    FURI_LOG_I(TAG, "Finished %d in %lums", ok, progress->elapsed_ms);
+
+    dap_target_disconnect();
+    free(program->touched);
+    free(program->dirty);
+    dap_image_free(program->image);
+    furi_record_close(RECORD_STORAGE);
+    free(program);
+    return ok;
+}
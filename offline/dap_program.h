@@ -0,0 +1,25 @@
+#pragma once
+#include <stdbool.h>
+
+#include "../dap_link.h"
+
+/*
+ * Offline programmer: writes a bin, HEX or ELF image from the SD card to
+ * target flash with a flash algorithm blob, no USB host involved.
+ *
+ * Algorithm blob (".algo"), little-endian words followed by the code:
+ *   magic "DAPA", load address, Init, UnInit, ProgramPage, EraseSector,
+ *   static base, stack pointer, buffer 0, buffer 1, page size,
+ *   sector size, flash start, flash size, code size
+ * Entry points are absolute, the code is loaded at the load address and
+ * must start with a BKPT the algorithm functions return to.
+ *
+ * Sectors whose CRC32 already matches the image are neither erased nor
+ * programmed. Raw binaries are placed at the flash start address.
+ */
+
+bool dap_program_run(
+    const char* image_path,
+    const char* algo_path,
+    DapJobProgress* progress,
+    const volatile bool* cancel);
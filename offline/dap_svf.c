@@ -0,0 +1,483 @@
+#include <furi.h>
+#include <storage/storage.h>
+#include <ctype.h>
+#include <stdlib.h>
+
+#include "dap_svf.h"
+#include "dap_xsvf.h"
+#include "../target/dap_jtag.h"
+
+#define TAG "DapSvf"
+
+#define DAP_SVF_READ_SIZE 512
+#define DAP_SVF_DIGITS_CACHE 64
+#define DAP_SVF_CHUNK_BITS 1024
+#define DAP_SVF_CHUNK_BYTES (DAP_SVF_CHUNK_BITS / 8)
+#define DAP_SVF_WORD_MAX 24
+
+typedef enum {
+    DapSvfScanHir,
+    DapSvfScanHdr,
+    DapSvfScanTir,
+    DapSvfScanTdr,
+    DapSvfScanSir,
+    DapSvfScanSdr,
+    DapSvfScanCount,
+} DapSvfScanType;
+
+// offsets of the digits between the parentheses, empty if not given
+typedef struct {
+    uint32_t start;
+    uint32_t end;
+} DapSvfHex;
+
+typedef struct {
+    uint32_t length;
+    DapSvfHex tdi;
+    DapSvfHex tdo;
+    DapSvfHex mask;
+} DapSvfScan;
+
+// reads the digits of one hex string backwards, least significant first
+typedef struct {
+    DapSvfHex hex;
+    uint32_t cursor;
+    uint32_t cache_start;
+    size_t cache_size;
+    uint8_t cache[DAP_SVF_DIGITS_CACHE];
+} DapSvfDigits;
+
+typedef enum {
+    DapSvfTokenEnd,
+    DapSvfTokenWord,
+    DapSvfTokenHex,
+    DapSvfTokenSemicolon,
+    DapSvfTokenError,
+} DapSvfTokenType;
+
+typedef struct {
+    DapSvfTokenType type;
+    char word[DAP_SVF_WORD_MAX + 1];
+    DapSvfHex hex;
+} DapSvfToken;
+
+typedef struct {
+    File* file;
+    bool error;
+
+    uint8_t buffer[DAP_SVF_READ_SIZE];
+    uint32_t buffer_start;
+    size_t buffer_size;
+    size_t buffer_pos;
+
+    DapSvfScan scans[DapSvfScanCount];
+    DapJtagState end_ir;
+    DapJtagState end_dr;
+    DapJtagState run_state;
+
+    DapSvfDigits tdi_digits;
+    DapSvfDigits tdo_digits;
+    DapSvfDigits mask_digits;
+    uint8_t tdi[DAP_SVF_CHUNK_BYTES];
+    uint8_t tdo[DAP_SVF_CHUNK_BYTES];
+    uint8_t mask[DAP_SVF_CHUNK_BYTES];
+    uint8_t captured[DAP_SVF_CHUNK_BYTES];
+} DapSvf;
+
+static const char* const dap_svf_states[DapJtagStateCount] = {
+    "RESET",
+    "IDLE",
+    "DRSELECT",
+    "DRCAPTURE",
+    "DRSHIFT",
+    "DREXIT1",
+    "DRPAUSE",
+    "DREXIT2",
+    "DRUPDATE",
+    "IRSELECT",
+    "IRCAPTURE",
+    "IRSHIFT",
+    "IREXIT1",
+    "IRPAUSE",
+    "IREXIT2",
+    "IRUPDATE",
+};
+
+static int dap_svf_peek(DapSvf* svf) {
+    if(svf->buffer_pos == svf->buffer_size) {
+        svf->buffer_start += svf->buffer_size;
+        svf->buffer_pos = 0;
+        // scans move the file position, so every refill seeks
+        storage_file_seek(svf->file, svf->buffer_start, true);
+        svf->buffer_size = storage_file_read(svf->file, svf->buffer, DAP_SVF_READ_SIZE);
+        if(svf->buffer_size == 0) return -1;
+    }
+    return svf->buffer[svf->buffer_pos];
+}
+
+static int dap_svf_getc(DapSvf* svf) {
+    int c = dap_svf_peek(svf);
+    if(c >= 0) svf->buffer_pos++;
+    return c;
+}
+
+static uint32_t dap_svf_tell(DapSvf* svf) {
+    return svf->buffer_start + svf->buffer_pos;
+}
+
+// whitespace and comments, "!" or "//" up to the end of the line
+static void dap_svf_skip(DapSvf* svf) {
+    int c;
+    while((c = dap_svf_peek(svf)) >= 0) {
+        if(c == '!' || c == '/') {
+            while((c = dap_svf_getc(svf)) >= 0 && c != '\n') {
+            }
+        } else if(isspace(c)) {
+            dap_svf_getc(svf);
+        } else {
+            break;
+        }
+    }
+}
+
+static DapSvfTokenType dap_svf_next(DapSvf* svf, DapSvfToken* token) {
+    dap_svf_skip(svf);
+    int c = dap_svf_getc(svf);
+
+    if(c < 0) {
+        token->type = DapSvfTokenEnd;
+    } else if(c == ';') {
+        token->type = DapSvfTokenSemicolon;
+    } else if(c == '(') {
+        token->hex.start = dap_svf_tell(svf);
+        while((c = dap_svf_getc(svf)) >= 0 && c != ')') {
+        }
+        token->hex.end = dap_svf_tell(svf) - 1;
+        token->type = c < 0 ? DapSvfTokenError : DapSvfTokenHex;
+    } else {
+        size_t len = 0;
+        token->word[len++] = toupper(c);
+        while((c = dap_svf_peek(svf)) >= 0 && !isspace(c) && c != ';' && c != '(') {
+            dap_svf_getc(svf);
+            if(len < DAP_SVF_WORD_MAX) token->word[len++] = toupper(c);
+        }
+        token->word[len] = '\0';
+        token->type = DapSvfTokenWord;
+    }
+
+    return token->type;
+}
+
+static bool dap_svf_parse_state(const char* word, DapJtagState* state) {
+    for(size_t i = 0; i < DapJtagStateCount; i++) {
+        if(strcmp(word, dap_svf_states[i]) == 0) {
+            *state = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool dap_svf_is_stable(DapJtagState state) {
+    return state == DapJtagStateReset || state == DapJtagStateIdle ||
+           state == DapJtagStateDrPause || state == DapJtagStateIrPause;
+}
+
+static void dap_svf_digits_start(DapSvfDigits* digits, const DapSvfHex* hex) {
+    digits->hex = *hex;
+    digits->cursor = hex->end;
+    digits->cache_size = 0;
+}
+
+static uint8_t dap_svf_digit(DapSvf* svf, DapSvfDigits* digits) {
+    while(digits->cursor > digits->hex.start) {
+        const uint32_t pos = digits->cursor - 1;
+
+        if(digits->cache_size == 0 || pos < digits->cache_start) {
+            digits->cache_start = pos + 1 - MIN(pos + 1 - digits->hex.start, DAP_SVF_DIGITS_CACHE);
+            const size_t size = pos + 1 - digits->cache_start;
+            storage_file_seek(svf->file, digits->cache_start, true);
+            digits->cache_size = storage_file_read(svf->file, digits->cache, size);
+            if(digits->cache_size != size) {
+                svf->error = true;
+                return 0;
+            }
+        }
+
+        const char c = digits->cache[pos - digits->cache_start];
+        digits->cursor = pos;
+        if(isxdigit((int)c)) return isdigit((int)c) ? c - '0' : toupper((int)c) - 'A' + 10;
+        if(!isspace((int)c)) svf->error = true;
+    }
+
+    // missing digits are leading zeros
+    return 0;
+}
+
+static void dap_svf_fill(DapSvf* svf, DapSvfDigits* digits, uint8_t* data, size_t bits) {
+    for(size_t i = 0; i < (bits + 7) / 8; i++) {
+        uint8_t low = dap_svf_digit(svf, digits);
+        uint8_t high = (i * 8 + 4 < bits) ? dap_svf_digit(svf, digits) : 0;
+        data[i] = low | (high << 4);
+    }
+}
+
+static bool dap_svf_compare(DapSvf* svf, size_t bits) {
+    for(size_t i = 0; i < (bits + 7) / 8; i++) {
+        uint8_t mask = svf->mask[i];
+        if(i == bits / 8) mask &= (1 << (bits % 8)) - 1;
+        if((svf->captured[i] ^ svf->tdo[i]) & mask) return false;
+    }
+    return true;
+}
+
+static bool dap_svf_shift(DapSvf* svf, const DapSvfScan* scan, bool compare, bool last) {
+    const bool check = compare && scan->tdo.end > scan->tdo.start;
+    const bool masked = scan->mask.end > scan->mask.start;
+    uint32_t left = scan->length;
+
+    dap_svf_digits_start(&svf->tdi_digits, &scan->tdi);
+    dap_svf_digits_start(&svf->tdo_digits, &scan->tdo);
+    dap_svf_digits_start(&svf->mask_digits, &scan->mask);
+
+    while(left > 0) {
+        const size_t bits = MIN(left, (uint32_t)DAP_SVF_CHUNK_BITS);
+        left -= bits;
+
+        dap_svf_fill(svf, &svf->tdi_digits, svf->tdi, bits);
+        if(check) {
+            dap_svf_fill(svf, &svf->tdo_digits, svf->tdo, bits);
+            if(masked) {
+                dap_svf_fill(svf, &svf->mask_digits, svf->mask, bits);
+            } else {
+                memset(svf->mask, 0xFF, sizeof(svf->mask));
+            }
+        }
+        if(svf->error) return false;
+
+        dap_jtag_shift(svf->tdi, check ? svf->captured : NULL, bits, last && left == 0);
+
+        if(check && !dap_svf_compare(svf, bits)) {
+            FURI_LOG_E(TAG, "TDO mismatch, %lu bits before the end", left);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// header, data and trailer go out as one scan, header first
+static bool dap_svf_scan(DapSvf* svf, bool ir) {
+    const DapSvfScan* header = &svf->scans[ir ? DapSvfScanHir : DapSvfScanHdr];
+    const DapSvfScan* data = &svf->scans[ir ? DapSvfScanSir : DapSvfScanSdr];
+    const DapSvfScan* trailer = &svf->scans[ir ? DapSvfScanTir : DapSvfScanTdr];
+
+    if(header->length + data->length + trailer->length == 0) return true;
+
+    dap_jtag_goto(ir ? DapJtagStateIrShift : DapJtagStateDrShift);
+    bool ok = dap_svf_shift(svf, header, false, data->length + trailer->length == 0) &&
+              dap_svf_shift(svf, data, true, trailer->length == 0) &&
+              dap_svf_shift(svf, trailer, false, true);
+
+    if(ok) dap_jtag_goto(ir ? svf->end_ir : svf->end_dr);
+    return ok;
+}
+
+static bool dap_svf_parse_scan(DapSvf* svf, DapSvfScan* scan, DapSvfToken* token) {
+    char* end;
+    if(dap_svf_next(svf, token) != DapSvfTokenWord) return false;
+    uint32_t length = strtoul(token->word, &end, 10);
+    if(*end) return false;
+
+    // TDI and MASK carry over to scans of the same length, TDO never does
+    if(length != scan->length) {
+        memset(scan, 0, sizeof(DapSvfScan));
+        scan->length = length;
+    }
+    scan->tdo.start = scan->tdo.end = 0;
+
+    while(dap_svf_next(svf, token) == DapSvfTokenWord) {
+        DapSvfHex* hex = NULL;
+        if(strcmp(token->word, "TDI") == 0) {
+            hex = &scan->tdi;
+        } else if(strcmp(token->word, "TDO") == 0) {
+            hex = &scan->tdo;
+        } else if(strcmp(token->word, "MASK") == 0) {
+            hex = &scan->mask;
+        } else if(strcmp(token->word, "SMASK") != 0) {
+            return false;
+        }
+
+        if(dap_svf_next(svf, token) != DapSvfTokenHex) return false;
+        if(hex) *hex = token->hex;
+    }
+
+    return token->type == DapSvfTokenSemicolon;
+}
+
+static void dap_svf_wait(float seconds) {
+    uint32_t us = seconds * 1000000.0f;
+    if(us >= 1000) {
+        furi_delay_ms((us + 999) / 1000);
+    } else if(us > 0) {
+        furi_delay_us(us);
+    }
+}
+
+static bool dap_svf_runtest(DapSvf* svf, DapSvfToken* token) {
+    DapJtagState end_state;
+    bool end_given = false;
+    bool maximum = false;
+    bool have_number = false;
+    float number = 0;
+    uint32_t clocks = 0;
+    float min_time = 0;
+
+    while(dap_svf_next(svf, token) == DapSvfTokenWord) {
+        const char* word = token->word;
+        DapJtagState state;
+
+        if(have_number) {
+            have_number = false;
+            if(strcmp(word, "TCK") == 0 || strcmp(word, "SCK") == 0) {
+                clocks = number;
+            } else if(strcmp(word, "SEC") == 0) {
+                if(!maximum) min_time = number;
+            } else {
+                return false;
+            }
+        } else if(strcmp(word, "MAXIMUM") == 0) {
+            maximum = true;
+        } else if(strcmp(word, "ENDSTATE") == 0) {
+            if(dap_svf_next(svf, token) != DapSvfTokenWord ||
+               !dap_svf_parse_state(token->word, &end_state) || !dap_svf_is_stable(end_state)) {
+                return false;
+            }
+            end_given = true;
+        } else if(dap_svf_parse_state(word, &state)) {
+            if(!dap_svf_is_stable(state)) return false;
+            svf->run_state = state;
+        } else {
+            char* end;
+            number = strtof(word, &end);
+            if(*end) return false;
+            have_number = true;
+        }
+    }
+    if(token->type != DapSvfTokenSemicolon || have_number) return false;
+
+    dap_jtag_goto(svf->run_state);
+    dap_jtag_clocks(clocks);
+    dap_svf_wait(min_time);
+    dap_jtag_goto(end_given ? end_state : svf->run_state);
+    return true;
+}
+
+static bool dap_svf_end_state(DapSvf* svf, DapSvfToken* token, DapJtagState* state) {
+    return dap_svf_next(svf, token) == DapSvfTokenWord &&
+           dap_svf_parse_state(token->word, state) && dap_svf_is_stable(*state) &&
+           dap_svf_next(svf, token) == DapSvfTokenSemicolon;
+}
+
+static bool dap_svf_statement(DapSvf* svf, const char* command, DapSvfToken* token) {
+    static const char* const scans[DapSvfScanCount] = {"HIR", "HDR", "TIR", "TDR", "SIR", "SDR"};
+
+    for(size_t i = 0; i < DapSvfScanCount; i++) {
+        if(strcmp(command, scans[i]) != 0) continue;
+        if(!dap_svf_parse_scan(svf, &svf->scans[i], token)) return false;
+        if(i == DapSvfScanSir || i == DapSvfScanSdr) {
+            return dap_svf_scan(svf, i == DapSvfScanSir);
+        }
+        return true;
+    }
+
+    if(strcmp(command, "RUNTEST") == 0) {
+        return dap_svf_runtest(svf, token);
+    } else if(strcmp(command, "ENDIR") == 0) {
+        return dap_svf_end_state(svf, token, &svf->end_ir);
+    } else if(strcmp(command, "ENDDR") == 0) {
+        return dap_svf_end_state(svf, token, &svf->end_dr);
+    } else if(strcmp(command, "STATE") == 0) {
+        DapJtagState state;
+        while(dap_svf_next(svf, token) == DapSvfTokenWord) {
+            if(!dap_svf_parse_state(token->word, &state)) return false;
+            dap_jtag_goto(state);
+        }
+        return token->type == DapSvfTokenSemicolon;
+    } else if(strcmp(command, "FREQUENCY") == 0) {
+        uint32_t frequency = 0;
+        while(dap_svf_next(svf, token) == DapSvfTokenWord) {
+            if(strcmp(token->word, "HZ") != 0) frequency = strtof(token->word, NULL);
+        }
+        dap_jtag_set_frequency(frequency);
+        return token->type == DapSvfTokenSemicolon;
+    } else if(strcmp(command, "TRST") == 0) {
+        // no TRST pin
+        while(dap_svf_next(svf, token) == DapSvfTokenWord) {
+        }
+        return token->type == DapSvfTokenSemicolon;
+    }
+
+    return false;
+}
+
+static bool dap_svf_play(File* file, DapJobProgress* progress, const volatile bool* cancel) {
+    DapSvf* svf = malloc(sizeof(DapSvf));
+    memset(svf, 0, sizeof(DapSvf));
+    svf->file = file;
+    svf->end_ir = DapJtagStateIdle;
+    svf->end_dr = DapJtagStateIdle;
+    svf->run_state = DapJtagStateIdle;
+
+    DapSvfToken token;
+    char command[DAP_SVF_WORD_MAX + 1];
+    bool ok = true;
+
+    while(ok && !*cancel) {
+        DapSvfTokenType type = dap_svf_next(svf, &token);
+        if(type == DapSvfTokenEnd) break;
+
+        const uint32_t offset = dap_svf_tell(svf);
+        strlcpy(command, token.word, sizeof(command));
+        ok = type == DapSvfTokenWord && dap_svf_statement(svf, command, &token) && !svf->error;
+        if(!ok) FURI_LOG_E(TAG, "%s at byte %lu failed", command, offset);
+
+        progress->done = dap_svf_tell(svf);
+    }
+
+    free(svf);
+    return ok && !*cancel;
+}
+
+static bool dap_svf_is_xsvf(const char* path) {
+    const char* ext = strrchr(path, '.');
+    return ext && strcasecmp(ext, ".xsvf") == 0;
+}
+
+bool dap_svf_run(const char* path, DapJobProgress* progress, const volatile bool* cancel) {
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    File* file = storage_file_alloc(storage);
+    const uint32_t start_tick = furi_get_tick();
+    bool ok = false;
+
+    if(storage_file_open(file, path, FSAM_READ, FSOM_OPEN_EXISTING)) {
+        progress->total = storage_file_size(file);
+        progress->stage = DapJobStageProgram;
+
+        dap_jtag_init(0);
+        ok = dap_svf_is_xsvf(path) ? dap_xsvf_play(file, progress, cancel) :
+                                     dap_svf_play(file, progress, cancel);
+        dap_jtag_deinit();
+
+        progress->elapsed_ms = furi_get_tick() - start_tick;
+        if(progress->elapsed_ms > 0) {
+            progress->rate = (uint64_t)progress->done * 1000 / progress->elapsed_ms;
+        }
+        FURI_LOG_I(TAG, "Played %lu bytes in %lums", progress->done, progress->elapsed_ms);
+    }
+
+    storage_file_close(file);
+    storage_file_free(file);
+    furi_record_close(RECORD_STORAGE);
+    return ok;
+}
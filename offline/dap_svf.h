@@ -0,0 +1,22 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "../dap_link.h"
+
+/*
+ * SVF and XSVF playback from the SD card for CPLDs and FPGAs.
+ *
+ * Scans are driven by the bit-banged TAP engine at full TCK rate unless the
+ * file asks for a FREQUENCY, and TDO is compared under MASK on the probe.
+ * SVF scan data is never loaded as a whole: only the file offsets of each
+ * hex string are kept and the bits are streamed from its end in chunks, so
+ * even bitstream-sized SDRs fit. Header and trailer scans shift TDI only,
+ * STATE follows the shortest path instead of the listed one, TRST is
+ * ignored and PIO is not supported.
+ */
+
+/**
+ * Files ending in .xsvf are played as XSVF, anything else as SVF
+ */
+bool dap_svf_run(const char* path, DapJobProgress* progress, const volatile bool* cancel);
@@ -0,0 +1,285 @@
+#include <furi.h>
+#include <stdlib.h>
+
+#include "dap_xsvf.h"
+#include "../target/dap_jtag.h"
+
+#define TAG "DapXsvf"
+
+#define DAP_XSVF_BYTES_MAX (DAP_XSVF_BITS_MAX / 8)
+#define DAP_XSVF_READ_SIZE 256
+
+typedef enum {
+    DapXsvfCompleteCmd = 0,
+    DapXsvfTdoMaskCmd = 1,
+    DapXsvfSirCmd = 2,
+    DapXsvfSdrCmd = 3,
+    DapXsvfRunTestCmd = 4,
+    DapXsvfRepeatCmd = 7,
+    DapXsvfSdrSizeCmd = 8,
+    DapXsvfSdrTdoCmd = 9,
+    DapXsvfSdrBCmd = 12,
+    DapXsvfSdrCCmd = 13,
+    DapXsvfSdrECmd = 14,
+    DapXsvfSdrTdoBCmd = 15,
+    DapXsvfSdrTdoCCmd = 16,
+    DapXsvfSdrTdoECmd = 17,
+    DapXsvfStateCmd = 18,
+    DapXsvfEndIrCmd = 19,
+    DapXsvfEndDrCmd = 20,
+    DapXsvfSir2Cmd = 21,
+    DapXsvfCommentCmd = 22,
+    DapXsvfWaitCmd = 23,
+} DapXsvfCmd;
+
+typedef struct {
+    File* file;
+    bool error;
+    uint32_t offset;
+
+    uint8_t buffer[DAP_XSVF_READ_SIZE];
+    size_t buffer_size;
+    size_t buffer_pos;
+
+    uint32_t sdr_size;
+    uint32_t runtest;
+    uint8_t repeat;
+    DapJtagState end_ir;
+    DapJtagState end_dr;
+
+    uint8_t tdi[DAP_XSVF_BYTES_MAX];
+    uint8_t tdo[DAP_XSVF_BYTES_MAX];
+    uint8_t mask[DAP_XSVF_BYTES_MAX];
+    uint8_t captured[DAP_XSVF_BYTES_MAX];
+} DapXsvf;
+
+static uint8_t dap_xsvf_u8(DapXsvf* xsvf) {
+    if(xsvf->buffer_pos == xsvf->buffer_size) {
+        xsvf->buffer_pos = 0;
+        xsvf->buffer_size = storage_file_read(xsvf->file, xsvf->buffer, DAP_XSVF_READ_SIZE);
+        if(xsvf->buffer_size == 0) {
+            xsvf->error = true;
+            return 0;
+        }
+    }
+    xsvf->offset++;
+    return xsvf->buffer[xsvf->buffer_pos++];
+}
+
+static uint32_t dap_xsvf_u32(DapXsvf* xsvf, size_t size) {
+    uint32_t value = 0;
+    for(size_t i = 0; i < size; i++) {
+        value = (value << 8) | dap_xsvf_u8(xsvf);
+    }
+    return value;
+}
+
+// vectors are stored MSB first, the TAP engine wants bit 0 in byte 0
+static void dap_xsvf_vector(DapXsvf* xsvf, uint8_t* data, uint32_t bits) {
+    const size_t size = (bits + 7) / 8;
+    for(size_t i = size; i > 0; i--) {
+        data[i - 1] = dap_xsvf_u8(xsvf);
+    }
+}
+
+static bool dap_xsvf_check_size(DapXsvf* xsvf, uint32_t bits) {
+    if(bits > DAP_XSVF_BITS_MAX) {
+        FURI_LOG_E(TAG, "%lu bit scan is over the %u bit limit", bits, DAP_XSVF_BITS_MAX);
+        xsvf->error = true;
+        return false;
+    }
+    return true;
+}
+
+static bool dap_xsvf_compare(DapXsvf* xsvf, uint32_t bits) {
+    for(size_t i = 0; i < (bits + 7) / 8; i++) {
+        uint8_t mask = xsvf->mask[i];
+        if(i == bits / 8) mask &= (1 << (bits % 8)) - 1;
+        if((xsvf->captured[i] ^ xsvf->tdo[i]) & mask) return false;
+    }
+    return true;
+}
+
+static void dap_xsvf_delay(uint32_t us) {
+    if(us >= 1000) {
+        furi_delay_ms((us + 999) / 1000);
+    } else if(us > 0) {
+        furi_delay_us(us);
+    }
+}
+
+// XRUNTEST counts microseconds, clocked in Run-Test/Idle for TCK-only parts
+static void dap_xsvf_wait(uint32_t us) {
+    dap_jtag_goto(DapJtagStateIdle);
+    dap_jtag_clocks(us);
+    dap_xsvf_delay(us);
+}
+
+static bool dap_xsvf_sir(DapXsvf* xsvf, uint32_t bits) {
+    if(!dap_xsvf_check_size(xsvf, bits)) return false;
+    dap_xsvf_vector(xsvf, xsvf->tdi, bits);
+    if(xsvf->error) return false;
+
+    dap_jtag_goto(DapJtagStateIrShift);
+    dap_jtag_shift(xsvf->tdi, NULL, bits, true);
+
+    if(xsvf->runtest > 0) {
+        dap_xsvf_wait(xsvf->runtest);
+    } else {
+        dap_jtag_goto(xsvf->end_ir);
+    }
+    return true;
+}
+
+// a failed compare is retried through Pause-DR, each attempt waits 25% longer
+static bool dap_xsvf_sdr(DapXsvf* xsvf, bool compare) {
+    uint32_t runtest = xsvf->runtest;
+    const uint32_t bits = xsvf->sdr_size;
+
+    for(uint8_t attempt = 0; attempt <= xsvf->repeat; attempt++) {
+        dap_jtag_goto(DapJtagStateDrShift);
+        dap_jtag_shift(xsvf->tdi, compare ? xsvf->captured : NULL, bits, true);
+        const bool match = !compare || dap_xsvf_compare(xsvf, bits);
+
+        // as in the Xilinx player, a retry re-enters Shift-DR through Pause-DR
+        // and still gets its Run-Test/Idle wait before the next shift
+        if(!match && attempt < xsvf->repeat) {
+            dap_jtag_goto(DapJtagStateDrPause);
+            dap_jtag_goto(DapJtagStateDrShift);
+            runtest += runtest >> 2;
+        } else if(runtest == 0) {
+            dap_jtag_goto(xsvf->end_dr);
+        }
+        if(runtest > 0) dap_xsvf_wait(runtest);
+
+        if(match) return true;
+    }
+
+    FURI_LOG_E(TAG, "TDO mismatch after %u retries", xsvf->repeat);
+    return false;
+}
+
+// XSDRB/C/E shift one part of a long scan, only E leaves Shift-DR
+static bool dap_xsvf_sdr_part(DapXsvf* xsvf, bool begin, bool end, bool compare) {
+    const uint32_t bits = xsvf->sdr_size;
+    dap_xsvf_vector(xsvf, xsvf->tdi, bits);
+    if(compare) dap_xsvf_vector(xsvf, xsvf->tdo, bits);
+    if(xsvf->error) return false;
+
+    if(begin) dap_jtag_goto(DapJtagStateDrShift);
+    dap_jtag_shift(xsvf->tdi, compare ? xsvf->captured : NULL, bits, end);
+
+    if(compare && !dap_xsvf_compare(xsvf, bits)) {
+        FURI_LOG_E(TAG, "TDO mismatch");
+        return false;
+    }
+    if(end) {
+        if(xsvf->runtest > 0) {
+            dap_xsvf_wait(xsvf->runtest);
+        } else {
+            dap_jtag_goto(xsvf->end_dr);
+        }
+    }
+    return true;
+}
+
+static bool dap_xsvf_command(DapXsvf* xsvf, uint8_t command, bool* complete) {
+    switch(command) {
+    case DapXsvfCompleteCmd:
+        *complete = true;
+        return true;
+    case DapXsvfTdoMaskCmd:
+        dap_xsvf_vector(xsvf, xsvf->mask, xsvf->sdr_size);
+        return true;
+    case DapXsvfSirCmd:
+        return dap_xsvf_sir(xsvf, dap_xsvf_u8(xsvf));
+    case DapXsvfSir2Cmd:
+        return dap_xsvf_sir(xsvf, dap_xsvf_u32(xsvf, 2));
+    case DapXsvfSdrCmd:
+        dap_xsvf_vector(xsvf, xsvf->tdi, xsvf->sdr_size);
+        return !xsvf->error && dap_xsvf_sdr(xsvf, true);
+    case DapXsvfSdrTdoCmd:
+        dap_xsvf_vector(xsvf, xsvf->tdi, xsvf->sdr_size);
+        dap_xsvf_vector(xsvf, xsvf->tdo, xsvf->sdr_size);
+        return !xsvf->error && dap_xsvf_sdr(xsvf, true);
+    case DapXsvfRunTestCmd:
+        xsvf->runtest = dap_xsvf_u32(xsvf, 4);
+        return true;
+    case DapXsvfRepeatCmd:
+        xsvf->repeat = dap_xsvf_u8(xsvf);
+        return true;
+    case DapXsvfSdrSizeCmd:
+        xsvf->sdr_size = dap_xsvf_u32(xsvf, 4);
+        return dap_xsvf_check_size(xsvf, xsvf->sdr_size);
+    case DapXsvfSdrBCmd:
+        return dap_xsvf_sdr_part(xsvf, true, false, false);
+    case DapXsvfSdrCCmd:
+        return dap_xsvf_sdr_part(xsvf, false, false, false);
+    case DapXsvfSdrECmd:
+        return dap_xsvf_sdr_part(xsvf, false, true, false);
+    case DapXsvfSdrTdoBCmd:
+        return dap_xsvf_sdr_part(xsvf, true, false, true);
+    case DapXsvfSdrTdoCCmd:
+        return dap_xsvf_sdr_part(xsvf, false, false, true);
+    case DapXsvfSdrTdoECmd:
+        return dap_xsvf_sdr_part(xsvf, false, true, true);
+    case DapXsvfStateCmd: {
+        uint8_t state = dap_xsvf_u8(xsvf);
+        if(state >= DapJtagStateCount) return false;
+        dap_jtag_goto(state);
+        return true;
+    }
+    case DapXsvfEndIrCmd:
+        xsvf->end_ir = dap_xsvf_u8(xsvf) ? DapJtagStateIrPause : DapJtagStateIdle;
+        return true;
+    case DapXsvfEndDrCmd:
+        xsvf->end_dr = dap_xsvf_u8(xsvf) ? DapJtagStateDrPause : DapJtagStateIdle;
+        return true;
+    case DapXsvfCommentCmd:
+        while(dap_xsvf_u8(xsvf) && !xsvf->error) {
+        }
+        return true;
+    case DapXsvfWaitCmd: {
+        uint8_t wait_state = dap_xsvf_u8(xsvf);
+        uint8_t end_state = dap_xsvf_u8(xsvf);
+        uint32_t us = dap_xsvf_u32(xsvf, 4);
+        if(wait_state >= DapJtagStateCount || end_state >= DapJtagStateCount) return false;
+        dap_jtag_goto(wait_state);
+        dap_xsvf_delay(us);
+        dap_jtag_goto(end_state);
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+bool dap_xsvf_play(File* file, DapJobProgress* progress, const volatile bool* cancel) {
+    DapXsvf* xsvf = malloc(sizeof(DapXsvf));
+    memset(xsvf, 0, sizeof(DapXsvf));
+    xsvf->file = file;
+    xsvf->end_ir = DapJtagStateIdle;
+    xsvf->end_dr = DapJtagStateIdle;
+    memset(xsvf->mask, 0xFF, sizeof(xsvf->mask));
+
+    bool complete = false;
+    bool ok = true;
+
+    while(ok && !complete && !*cancel) {
+        const uint32_t offset = xsvf->offset;
+        const uint8_t command = dap_xsvf_u8(xsvf);
+        if(xsvf->error) {
+            FURI_LOG_E(TAG, "Missing XCOMPLETE");
+            ok = false;
+            break;
+        }
+
+        ok = dap_xsvf_command(xsvf, command, &complete) && !xsvf->error;
+        if(!ok) FURI_LOG_E(TAG, "Command %u at byte %lu failed", command, offset);
+
+        progress->done = xsvf->offset;
+    }
+
+    free(xsvf);
+    return ok && complete && !*cancel;
+}
@@ -0,0 +1,16 @@
+#pragma once
+#include <storage/storage.h>
+
+#include "../dap_link.h"
+
+/*
+ * XSVF player, scans are limited to DAP_XSVF_BITS_MAX bits since XSVF keeps
+ * every vector in RAM.
+ */
+
+#define DAP_XSVF_BITS_MAX 8192
+
+/**
+ * Play from the current position, the TAP engine must be initialized
+ */
+bool dap_xsvf_play(File* file, DapJobProgress* progress, const volatile bool* cancel);
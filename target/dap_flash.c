@@ -0,0 +1,245 @@
+#include <furi.h>
+#include <furi_hal_cortex.h>
+
+#include "dap_flash.h"
+#include "dap_target.h"
+
+#define TAG "DapFlash"
+
+#define DAP_FLASH_TIMEOUT_CALL_US 100000
+#define DAP_FLASH_TIMEOUT_PROGRAM_US 1000000
+#define DAP_FLASH_TIMEOUT_ERASE_US 5000000
+
+#define DAP_FLASH_REG_R9 9
+#define DAP_FLASH_STAGE_WORDS 16
+#define DAP_FLASH_ERASED 0xFF
+
+typedef struct {
+    DapFlashAlgo algo;
+    bool ready;
+
+    // stream state
+    uint8_t current; // buffer being filled
+    uint32_t fill; // bytes in the current buffer
+    uint32_t stage[DAP_FLASH_STAGE_WORDS];
+    size_t staged_bytes;
+
+    // page the target is programming right now
+    bool running;
+    uint32_t running_address;
+
+    DapFlashStatus status;
+} DapFlash;
+
+static DapFlash dap_flash;
+
+static bool dap_flash_start(uint32_t pc, uint32_t r0, uint32_t r1, uint32_t r2) {
+    const DapFlashAlgo* algo = &dap_flash.algo;
+
+    return dap_target_write_reg(DAP_TARGET_REG_R0, r0) &&
+           dap_target_write_reg(DAP_TARGET_REG_R0 + 1, r1) &&
+           dap_target_write_reg(DAP_TARGET_REG_R0 + 2, r2) &&
+           dap_target_write_reg(DAP_FLASH_REG_R9, algo->static_base) &&
+           dap_target_write_reg(DAP_TARGET_REG_SP, algo->stack_pointer) &&
+           dap_target_write_reg(DAP_TARGET_REG_LR, algo->load_address | 1) &&
+           dap_target_write_reg(DAP_TARGET_REG_PC, pc) &&
+           dap_target_write_reg(DAP_TARGET_REG_XPSR, DAP_TARGET_XPSR_THUMB) &&
+           dap_target_resume(true);
+}
+
+static bool dap_flash_wait(uint32_t timeout_us, uint32_t* result) {
+    FuriHalCortexTimer timer = furi_hal_cortex_timer_get(timeout_us);
+    bool halted = false;
+    do {
+        if(!dap_target_is_halted(&halted)) return false;
+    } while(!halted && !furi_hal_cortex_timer_is_expired(timer));
+
+    if(!halted) {
+        FURI_LOG_W(TAG, "Algorithm timeout");
+        dap_target_halt(DAP_FLASH_TIMEOUT_CALL_US);
+        return false;
+    }
+
+    uint32_t pc;
+    dap_target_write32(DAP_TARGET_DFSR, DAP_TARGET_DFSR_CLEAR);
+    if(!dap_target_read_reg(DAP_TARGET_REG_PC, &pc) || pc != dap_flash.algo.load_address) {
+        FURI_LOG_W(TAG, "Algorithm stopped at %08lX", pc);
+        return false;
+    }
+
+    return dap_target_read_reg(DAP_TARGET_REG_R0, result) && *result == 0;
+}
+
+static bool dap_flash_call(
+    uint32_t pc,
+    uint32_t r0,
+    uint32_t r1,
+    uint32_t r2,
+    uint32_t timeout_us,
+    uint32_t* result) {
+    if(!dap_flash.ready || dap_flash.running) return false;
+    *result = UINT32_MAX;
+    return dap_flash_start(pc, r0, r1, r2) && dap_flash_wait(timeout_us, result);
+}
+
+bool dap_flash_setup(const DapFlashAlgo* algo) {
+    memset(&dap_flash, 0, sizeof(DapFlash));
+
+    if(algo->page_size == 0 || (algo->page_size & 3) || (algo->buffer[0] & 3) ||
+       (algo->buffer[1] & 3) || algo->buffer[0] == algo->buffer[1]) {
+        FURI_LOG_E(TAG, "Invalid descriptor");
+        return false;
+    }
+
+    dap_flash.algo = *algo;
+    dap_flash.ready = dap_target_halt(DAP_FLASH_TIMEOUT_CALL_US);
+    return dap_flash.ready;
+}
+
+bool dap_flash_init(uint32_t address, uint32_t clock, DapFlashFunction function) {
+    uint32_t result;
+    return dap_flash_call(
+        dap_flash.algo.pc_init, address, clock, function, DAP_FLASH_TIMEOUT_CALL_US, &result);
+}
+
+bool dap_flash_uninit(DapFlashFunction function) {
+    uint32_t result;
+    return dap_flash_call(
+        dap_flash.algo.pc_uninit, function, 0, 0, DAP_FLASH_TIMEOUT_CALL_US, &result);
+}
+
+bool dap_flash_erase_sector(uint32_t address) {
+    bool ok = dap_flash_call(
+        dap_flash.algo.pc_erase_sector,
+        address,
+        0,
+        0,
+        DAP_FLASH_TIMEOUT_ERASE_US,
+        &dap_flash.status.result);
+
+    if(!ok) {
+        dap_flash.status.error = true;
+        dap_flash.status.error_address = address;
+    }
+    return ok;
+}
+
+bool dap_flash_begin(uint32_t address) {
+    if(!dap_flash.ready || dap_flash.running || (address % dap_flash.algo.page_size)) {
+        return false;
+    }
+
+    dap_flash.current = 0;
+    dap_flash.fill = 0;
+    dap_flash.staged_bytes = 0;
+    memset(&dap_flash.status, 0, sizeof(DapFlashStatus));
+    dap_flash.status.address = address;
+    return true;
+}
+
+static bool dap_flash_flush_stage(void) {
+    size_t words = dap_flash.staged_bytes / 4;
+    if(words == 0) return true;
+
+    uint32_t offset = dap_flash.fill - words * 4;
+    bool ok = dap_target_write_block(
+        dap_flash.algo.buffer[dap_flash.current] + offset, dap_flash.stage, words);
+
+    dap_flash.staged_bytes = 0;
+    return ok;
+}
+
+static bool dap_flash_collect(void) {
+    if(!dap_flash.running) return true;
+    dap_flash.running = false;
+
+    if(!dap_flash_wait(DAP_FLASH_TIMEOUT_PROGRAM_US, &dap_flash.status.result)) {
+        dap_flash.status.error = true;
+        dap_flash.status.error_address = dap_flash.running_address;
+        return false;
+    }
+
+    dap_flash.status.pages++;
+    return true;
+}
+
+static bool dap_flash_submit(void) {
+    const uint32_t address = dap_flash.status.address;
+    const uint32_t buffer = dap_flash.algo.buffer[dap_flash.current];
+
+    // the other buffer is free once the previous page is done
+    if(!dap_flash_flush_stage() || !dap_flash_collect()) return false;
+
+    if(!dap_flash_start(dap_flash.algo.pc_program_page, address, dap_flash.fill, buffer)) {
+        dap_flash.status.error = true;
+        dap_flash.status.error_address = address;
+        return false;
+    }
+
+    dap_flash.running = true;
+    dap_flash.running_address = address;
+    dap_flash.status.address += dap_flash.algo.page_size;
+    dap_flash.current ^= 1;
+    dap_flash.fill = 0;
+    return true;
+}
+
+bool dap_flash_write(const uint8_t* data, size_t size) {
+    if(!dap_flash.ready || dap_flash.status.error) return false;
+
+    uint8_t* stage = (uint8_t*)dap_flash.stage;
+    while(size > 0) {
+        stage[dap_flash.staged_bytes++] = *data++;
+        dap_flash.fill++;
+        size--;
+
+        if(dap_flash.fill == dap_flash.algo.page_size) {
+            if(!dap_flash_submit()) return false;
+        } else if(dap_flash.staged_bytes == sizeof(dap_flash.stage)) {
+            if(!dap_flash_flush_stage()) return false;
+        }
+    }
+
+    // keep the unaligned tail staged until the next call completes the word
+    if(dap_flash.staged_bytes >= 4) {
+        size_t tail = dap_flash.staged_bytes & 3;
+        uint32_t last = dap_flash.stage[dap_flash.staged_bytes / 4];
+
+        dap_flash.fill -= tail;
+        dap_flash.staged_bytes -= tail;
+        bool ok = dap_flash_flush_stage();
+        dap_flash.fill += tail;
+        dap_flash.staged_bytes = tail;
+        dap_flash.stage[0] = last;
+        if(!ok) return false;
+    }
+
+    return true;
+}
+
+bool dap_flash_finish(void) {
+    if(!dap_flash.ready) return false;
+
+    uint8_t erased[sizeof(dap_flash.stage)];
+    memset(erased, DAP_FLASH_ERASED, sizeof(erased));
+
+    while(!dap_flash.status.error && dap_flash.fill > 0) {
+        size_t pad = MIN(dap_flash.algo.page_size - dap_flash.fill, sizeof(erased));
+        if(!dap_flash_write(erased, pad)) break;
+    }
+
+    dap_flash_collect();
+
+    FURI_LOG_D(
+        TAG,
+        "Programmed %lu pages, error %d at %08lX",
+        dap_flash.status.pages,
+        dap_flash.status.error,
+        dap_flash.status.error_address);
+
+    return !dap_flash.status.error;
+}
+
+void dap_flash_get_status(DapFlashStatus* status) {
+    *status = dap_flash.status;
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Double-buffered flash programming with a CMSIS-Pack style algorithm.
+ *
+ * The algorithm is placed in target RAM by the host, its first halfword
+ * must be a BKPT which the functions return to. Page data is streamed into
+ * one RAM buffer over SWD while the target programs the other, so SWD and
+ * the flash controller work in parallel. Errors are latched and reported
+ * by dap_flash_finish().
+ */
+
+typedef struct {
+    uint32_t load_address; // algorithm base, BKPT at offset 0
+    uint32_t pc_init;
+    uint32_t pc_uninit;
+    uint32_t pc_program_page;
+    uint32_t pc_erase_sector;
+    uint32_t static_base;
+    uint32_t stack_pointer;
+    uint32_t buffer[2];
+    uint32_t page_size;
+} DapFlashAlgo;
+
+typedef enum {
+    DapFlashFunctionErase = 1,
+    DapFlashFunctionProgram = 2,
+    DapFlashFunctionVerify = 3,
+} DapFlashFunction;
+
+typedef struct {
+    uint32_t pages; // pages programmed since dap_flash_begin
+    uint32_t address; // next page address
+    uint32_t error_address; // page or sector that failed
+    uint32_t result; // algorithm return code, 0 on success
+    bool error;
+} DapFlashStatus;
+
+/**
+ * Validate the descriptor and halt the core
+ */
+bool dap_flash_setup(const DapFlashAlgo* algo);
+
+bool dap_flash_init(uint32_t address, uint32_t clock, DapFlashFunction function);
+
+bool dap_flash_uninit(DapFlashFunction function);
+
+bool dap_flash_erase_sector(uint32_t address);
+
+/**
+ * Start a programming stream at a page aligned address
+ */
+bool dap_flash_begin(uint32_t address);
+
+/**
+ * Append data to the stream. Returns as soon as the data is in target RAM,
+ * blocks only while both buffers are busy.
+ */
+bool dap_flash_write(const uint8_t* data, size_t size);
+
+/**
+ * Pad and program the last page, wait for the target to finish.
+ */
+bool dap_flash_finish(void);
+
+void dap_flash_get_status(DapFlashStatus* status);
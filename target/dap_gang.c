@@ -0,0 +1,278 @@
+#include <furi.h>
+
+#include "dap_gang.h"
+#include "dap_target.h"
+#include "../dap_cmsis.h"
+#include "../dap_config.h"
+
+#define TAG "DapGang"
+
+#define DAP_GANG_RETRY_COUNT 100
+#define DAP_GANG_POWER_UP_RETRY 1000
+
+#define DAP_GANG_ALL ((1 << DAP_GANG_PORT_COUNT) - 1)
+#define DAP_GANG_CSW_VALUE 0x23000052
+#define DAP_GANG_POWER_UP_REQ 0x50000000
+#define DAP_GANG_POWER_UP_ACK 0xA0000000
+#define DAP_GANG_ABORT_CLEAR 0x1E
+
+typedef struct {
+    GPIO_TypeDef* gpio;
+    uint32_t swclk_mask[DAP_GANG_PORT_COUNT];
+    uint32_t swdio_mask[DAP_GANG_PORT_COUNT];
+    uint32_t delay;
+    DapGangStatus status;
+} DapGang;
+
+static DapGang dap_gang;
+
+static inline void dap_gang_delay(void) {
+    if(dap_gang.delay) DAP_CONFIG_DELAY(dap_gang.delay);
+}
+
+static uint32_t dap_gang_swclk(uint8_t ports) {
+    uint32_t mask = 0;
+    for(size_t i = 0; i < DAP_GANG_PORT_COUNT; i++) {
+        if(ports & (1 << i)) mask |= dap_gang.swclk_mask[i];
+    }
+    return mask;
+}
+
+static uint32_t dap_gang_swdio(uint8_t ports) {
+    uint32_t mask = 0;
+    for(size_t i = 0; i < DAP_GANG_PORT_COUNT; i++) {
+        if(ports & (1 << i)) mask |= dap_gang.swdio_mask[i];
+    }
+    return mask;
+}
+
+static void dap_gang_swdio_out(uint8_t ports, bool out) {
+    for(size_t i = 0; i < DAP_GANG_PORT_COUNT; i++) {
+        if(ports & (1 << i)) {
+            LL_GPIO_SetPinMode(
+                dap_gang.gpio,
+                dap_gang.swdio_mask[i],
+                out ? LL_GPIO_MODE_OUTPUT : LL_GPIO_MODE_INPUT);
+        }
+    }
+}
+
+static void dap_gang_write_bits(uint8_t ports, uint32_t value, size_t bits) {
+    const uint32_t swclk = dap_gang_swclk(ports);
+    const uint32_t swdio = dap_gang_swdio(ports);
+
+    for(size_t i = 0; i < bits; i++) {
+        dap_gang.gpio->BSRR = (value & 1) ? swdio : (swdio << 16);
+        dap_gang.gpio->BSRR = swclk << 16;
+        dap_gang_delay();
+        dap_gang.gpio->BSRR = swclk;
+        dap_gang_delay();
+        value >>= 1;
+    }
+}
+
+static void dap_gang_read_bits(uint8_t ports, uint32_t values[DAP_GANG_PORT_COUNT], size_t bits) {
+    const uint32_t swclk = dap_gang_swclk(ports);
+
+    for(size_t i = 0; i < DAP_GANG_PORT_COUNT; i++) {
+        values[i] = 0;
+    }
+
+    for(size_t bit = 0; bit < bits; bit++) {
+        dap_gang.gpio->BSRR = swclk << 16;
+        dap_gang_delay();
+        uint32_t idr = dap_gang.gpio->IDR;
+        dap_gang.gpio->BSRR = swclk;
+        dap_gang_delay();
+
+        for(size_t i = 0; i < DAP_GANG_PORT_COUNT; i++) {
+            if(idr & dap_gang.swdio_mask[i]) values[i] |= (1UL << bit);
+        }
+    }
+}
+
+static uint32_t dap_gang_parity(uint32_t value) {
+    value ^= value >> 16;
+    value ^= value >> 8;
+    value ^= value >> 4;
+    value ^= value >> 2;
+    value ^= value >> 1;
+    return value & 1;
+}
+
+static void dap_gang_packet(
+    uint8_t ports,
+    uint8_t request,
+    uint32_t value,
+    uint32_t results[DAP_GANG_PORT_COUNT],
+    uint8_t acks[DAP_GANG_PORT_COUNT]) {
+    uint32_t bits[DAP_GANG_PORT_COUNT];
+    uint8_t header = 0x81 | ((request & 0x0F) << 1) | (dap_gang_parity(request & 0x0F) << 5);
+
+    dap_gang_write_bits(ports, header, 8);
+    dap_gang_swdio_out(ports, false);
+    dap_gang_read_bits(ports, bits, 1);
+    dap_gang_read_bits(ports, bits, 3);
+
+    uint8_t ok = 0;
+    for(size_t i = 0; i < DAP_GANG_PORT_COUNT; i++) {
+        if(!(ports & (1 << i))) continue;
+        acks[i] = bits[i] & DAP_TRANSFER_ACK_MASK;
+        if(acks[i] == DAP_TRANSFER_ACK_OK) ok |= (1 << i);
+    }
+
+    if(request & DAP_TRANSFER_RnW) {
+        uint32_t parity[DAP_GANG_PORT_COUNT];
+        dap_gang_read_bits(ok, results, 32);
+        dap_gang_read_bits(ok, parity, 1);
+        for(size_t i = 0; i < DAP_GANG_PORT_COUNT; i++) {
+            if((ok & (1 << i)) && parity[i] != dap_gang_parity(results[i])) {
+                acks[i] |= DAP_TRANSFER_ERROR;
+            }
+        }
+        dap_gang_read_bits(ports, bits, 1);
+        dap_gang_swdio_out(ports, true);
+    } else {
+        dap_gang_read_bits(ports, bits, 1);
+        dap_gang_swdio_out(ports, true);
+        dap_gang_write_bits(ok, value, 32);
+        dap_gang_write_bits(ok, dap_gang_parity(value), 1);
+    }
+}
+
+static uint8_t dap_gang_transfer(uint8_t request, uint32_t value, uint32_t* results) {
+    uint32_t values[DAP_GANG_PORT_COUNT] = {0};
+    uint8_t acks[DAP_GANG_PORT_COUNT];
+    uint8_t pending = dap_gang.status.active;
+    uint8_t done = 0;
+
+    for(size_t retry = 0; retry < DAP_GANG_RETRY_COUNT && pending; retry++) {
+        dap_gang_packet(pending, request, value, values, acks);
+
+        for(size_t i = 0; i < DAP_GANG_PORT_COUNT; i++) {
+            uint8_t port = 1 << i;
+            if(!(pending & port)) continue;
+
+            dap_gang.status.ack[i] = acks[i];
+            if(acks[i] == DAP_TRANSFER_ACK_OK) {
+                if(results) results[i] = values[i];
+                done |= port;
+                pending &= ~port;
+            } else if(acks[i] != DAP_TRANSFER_ACK_WAIT) {
+                pending &= ~port;
+                dap_gang.status.errors[i]++;
+                dap_gang.status.active &= ~port;
+            }
+        }
+    }
+
+    // ports still waiting after all retries leave the gang too
+    for(size_t i = 0; i < DAP_GANG_PORT_COUNT; i++) {
+        if(pending & (1 << i)) {
+            dap_gang.status.errors[i]++;
+            dap_gang.status.active &= ~(1 << i);
+        }
+    }
+
+    return done;
+}
+
+bool dap_gang_init(const DapSwdPort ports[DAP_GANG_PORT_COUNT], uint32_t delay) {
+    for(size_t i = 0; i < DAP_GANG_PORT_COUNT; i++) {
+        if(ports[i].swclk.port != ports[0].swclk.port ||
+           ports[i].swdio.port != ports[0].swclk.port) {
+            FURI_LOG_E(TAG, "Ports are on different GPIO banks");
+            return false;
+        }
+    }
+
+    memset(&dap_gang, 0, sizeof(DapGang));
+    dap_gang.gpio = ports[0].swclk.port;
+    dap_gang.delay = delay;
+
+    for(size_t i = 0; i < DAP_GANG_PORT_COUNT; i++) {
+        dap_gang.swclk_mask[i] = ports[i].swclk.pin;
+        dap_gang.swdio_mask[i] = ports[i].swdio.pin;
+
+        // pull-up turns a missing target into a "no ACK" instead of noise
+        furi_hal_gpio_init(
+            &ports[i].swclk, GpioModeOutputPushPull, GpioPullNo, GpioSpeedVeryHigh);
+        furi_hal_gpio_write(&ports[i].swclk, true);
+        furi_hal_gpio_init(
+            &ports[i].swdio, GpioModeOutputPushPull, GpioPullUp, GpioSpeedVeryHigh);
+        furi_hal_gpio_write(&ports[i].swdio, true);
+    }
+
+    return true;
+}
+
+uint8_t dap_gang_connect(uint32_t idcode[DAP_GANG_PORT_COUNT]) {
+    dap_gang.status.active = DAP_GANG_ALL;
+    for(size_t i = 0; i < DAP_GANG_PORT_COUNT; i++) {
+        dap_gang.status.ack[i] = 0;
+        dap_gang.status.errors[i] = 0;
+        idcode[i] = 0;
+    }
+
+    dap_gang_write_bits(DAP_GANG_ALL, 0xFFFFFFFF, 32);
+    dap_gang_write_bits(DAP_GANG_ALL, 0xFFFFFFFF, 19);
+    dap_gang_write_bits(DAP_GANG_ALL, 0xE79E, 16);
+    dap_gang_write_bits(DAP_GANG_ALL, 0xFFFFFFFF, 32);
+    dap_gang_write_bits(DAP_GANG_ALL, 0xFFFFFFFF, 19);
+    dap_gang_write_bits(DAP_GANG_ALL, 0x00, 8);
+
+    dap_gang_transfer(DAP_TRANSFER_RnW | DAP_TARGET_DP_IDCODE, 0, idcode);
+    dap_gang_write(DAP_TARGET_DP_ABORT, DAP_GANG_ABORT_CLEAR);
+    dap_gang_write(DAP_TARGET_DP_SELECT, 0);
+    dap_gang_write(DAP_TARGET_DP_CTRL_STAT, DAP_GANG_POWER_UP_REQ);
+
+    uint8_t powered = 0;
+    for(size_t retry = 0; retry < DAP_GANG_POWER_UP_RETRY; retry++) {
+        uint32_t ctrl_stat[DAP_GANG_PORT_COUNT] = {0};
+        uint8_t done =
+            dap_gang_transfer(DAP_TRANSFER_RnW | DAP_TARGET_DP_CTRL_STAT, 0, ctrl_stat);
+        for(size_t i = 0; i < DAP_GANG_PORT_COUNT; i++) {
+            if((done & (1 << i)) &&
+               (ctrl_stat[i] & DAP_GANG_POWER_UP_ACK) == DAP_GANG_POWER_UP_ACK) {
+                powered |= (1 << i);
+            }
+        }
+        if(powered == dap_gang.status.active) break;
+    }
+
+    dap_gang.status.active &= powered;
+    FURI_LOG_D(TAG, "Connected ports %02X", dap_gang.status.active);
+    return dap_gang.status.active;
+}
+
+uint8_t dap_gang_write(uint8_t request, uint32_t value) {
+    return dap_gang_transfer(request & ~DAP_TRANSFER_RnW, value, NULL);
+}
+
+uint8_t dap_gang_write_block(uint32_t address, const uint32_t* data, size_t count) {
+    furi_assert((address & 3) == 0);
+
+    const uint8_t select = DAP_TARGET_DP_SELECT;
+    const uint8_t csw = DAP_TRANSFER_APnDP | DAP_TARGET_AP_CSW;
+    const uint8_t tar = DAP_TRANSFER_APnDP | DAP_TARGET_AP_TAR;
+    const uint8_t drw = DAP_TRANSFER_APnDP | DAP_TARGET_AP_DRW;
+
+    dap_gang_write(select, 0);
+    dap_gang_write(csw, DAP_GANG_CSW_VALUE);
+
+    for(size_t i = 0; i < count && dap_gang.status.active; i++) {
+        if(i == 0 || (address & (DAP_TARGET_TAR_WRAP - 1)) == 0) {
+            dap_gang_write(tar, address);
+        }
+        dap_gang_write(drw, data[i]);
+        address += 4;
+    }
+
+    // a few idle cycles let the last posted write complete
+    dap_gang_write_bits(dap_gang.status.active, 0x00, 8);
+    return dap_gang.status.active;
+}
+
+void dap_gang_get_status(DapGangStatus* status) {
+    *status = dap_gang.status;
+}
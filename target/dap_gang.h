@@ -0,0 +1,53 @@
+#pragma once
+#include <furi_hal_gpio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Lockstep SWD engine for two targets.
+ *
+ * Both ports must live on the same GPIO bank, so every clock edge and data
+ * bit is a single BSRR write for both targets. A port that answers with
+ * FAULT or no ACK drops out of the gang until the next connect; WAIT is
+ * retried for the waiting port only.
+ */
+
+#define DAP_GANG_PORT_COUNT 2
+
+typedef struct {
+    GpioPin swclk;
+    GpioPin swdio;
+} DapSwdPort;
+
+typedef struct {
+    uint8_t active; // bitmask of ports still in lockstep
+    uint8_t ack[DAP_GANG_PORT_COUNT]; // last ACK per port
+    uint16_t errors[DAP_GANG_PORT_COUNT]; // failed transfers per port
+} DapGangStatus;
+
+/**
+ * Take over both ports. Ports must share one GPIO bank.
+ * @param delay SWCLK half period in DAP_CONFIG_DELAY cycles, 0 for full speed
+ */
+bool dap_gang_init(const DapSwdPort ports[DAP_GANG_PORT_COUNT], uint32_t delay);
+
+/**
+ * Line reset, JTAG-to-SWD switch, DPIDR read and debug power-up on both ports.
+ * @return bitmask of ports that answered
+ */
+uint8_t dap_gang_connect(uint32_t idcode[DAP_GANG_PORT_COUNT]);
+
+/**
+ * Broadcast one DP/AP write (CMSIS-DAP request byte) to all active ports.
+ * @return bitmask of ports that accepted it
+ */
+uint8_t dap_gang_write(uint8_t request, uint32_t value);
+
+/**
+ * Broadcast a word-aligned MEM-AP block write to all active ports.
+ * @return bitmask of ports that accepted every word
+ */
+uint8_t dap_gang_write_block(uint32_t address, const uint32_t* data, size_t count);
+
+void dap_gang_get_status(DapGangStatus* status);
@@ -0,0 +1,67 @@
+#include <furi.h>
+#include <furi_hal_cortex.h>
+
+#include "dap_halt.h"
+#include "dap_target.h"
+
+#define TAG "DapHalt"
+
+static DapHaltStatus dap_halt;
+
+void dap_halt_arm(void) {
+    memset(&dap_halt, 0, sizeof(DapHaltStatus));
+    dap_halt.armed = true;
+}
+
+void dap_halt_disarm(void) {
+    dap_halt.armed = false;
+}
+
+bool dap_halt_is_pending(void) {
+    return dap_halt.armed && !dap_halt.halted;
+}
+
+void dap_halt_get_status(DapHaltStatus* status) {
+    *status = dap_halt;
+}
+
+static bool dap_halt_check(void) {
+    if(!dap_halt.armed) return false;
+    if(dap_halt.halted) return true;
+
+    uint32_t dhcsr;
+    dap_halt.polls++;
+    if(!dap_target_read32(DAP_TARGET_DHCSR, &dhcsr)) return false;
+    if(!(dhcsr & DAP_TARGET_DHCSR_S_HALT)) return false;
+
+    dap_halt.halt_tick = DWT->CYCCNT;
+    dap_halt.halted = true;
+    dap_halt.dhcsr = dhcsr;
+    dap_target_read32(DAP_TARGET_DFSR, &dap_halt.dfsr);
+    FURI_LOG_D(TAG, "Halted, DFSR %08lX after %lu polls", dap_halt.dfsr, dap_halt.polls);
+    return true;
+}
+
+bool dap_halt_poll(void) {
+    DapTargetApState ap;
+    dap_target_ap_save(&ap);
+    bool halted = dap_halt_check();
+    dap_target_ap_restore(&ap);
+    return halted;
+}
+
+bool dap_halt_wait(uint32_t timeout_us, bool (*abort)(void* context), void* context) {
+    // CSW/TAR are only saved once, a back to back poll is a single DHCSR read
+    DapTargetApState ap;
+    dap_target_ap_save(&ap);
+
+    bool halted = false;
+    FuriHalCortexTimer timer = furi_hal_cortex_timer_get(timeout_us);
+    do {
+        halted = dap_halt_check();
+        if(halted || !dap_halt.armed || (abort && abort(context))) break;
+    } while(!furi_hal_cortex_timer_is_expired(timer));
+
+    dap_target_ap_restore(&ap);
+    return halted;
+}
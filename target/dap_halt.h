@@ -0,0 +1,44 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Probe-side halt watcher.
+ *
+ * Once armed, DHCSR is polled over SWD between host commands and the first
+ * S_HALT is latched together with DFSR and the time it was seen. Hosts ask
+ * the probe instead of polling DHCSR over USB themselves.
+ */
+
+typedef struct {
+    bool armed;
+    bool halted; // latched until the next arm
+    uint32_t dhcsr;
+    uint32_t dfsr; // halt reason
+    uint32_t polls;
+    uint32_t halt_tick; // DWT cycle counter when the halt was seen
+} DapHaltStatus;
+
+/**
+ * Start watching, clears a latched halt
+ */
+void dap_halt_arm(void);
+
+void dap_halt_disarm(void);
+
+bool dap_halt_is_pending(void);
+
+/**
+ * Single DHCSR poll, CSW/TAR are restored afterwards
+ * @return true once a halt is latched
+ */
+bool dap_halt_poll(void);
+
+/**
+ * Poll back to back until the core halts.
+ * @param abort called between polls, stops the wait early when it returns true
+ * @return true once a halt is latched
+ */
+bool dap_halt_wait(uint32_t timeout_us, bool (*abort)(void* context), void* context);
+
+void dap_halt_get_status(DapHaltStatus* status);
@@ -0,0 +1,136 @@
+#include <furi.h>
+
+#include "dap_jtag.h"
+#include "../dap_config.h"
+
+#define TAG "DapJtag"
+
+typedef struct {
+    DapJtagState state;
+    uint32_t delay;
+} DapJtag;
+
+static DapJtag dap_jtag;
+
+// next state for TMS low and high
+static const uint8_t dap_jtag_next[DapJtagStateCount][2] = {
+    [DapJtagStateReset] = {DapJtagStateIdle, DapJtagStateReset},
+    [DapJtagStateIdle] = {DapJtagStateIdle, DapJtagStateDrSelect},
+    [DapJtagStateDrSelect] = {DapJtagStateDrCapture, DapJtagStateIrSelect},
+    [DapJtagStateDrCapture] = {DapJtagStateDrShift, DapJtagStateDrExit1},
+    [DapJtagStateDrShift] = {DapJtagStateDrShift, DapJtagStateDrExit1},
+    [DapJtagStateDrExit1] = {DapJtagStateDrPause, DapJtagStateDrUpdate},
+    [DapJtagStateDrPause] = {DapJtagStateDrPause, DapJtagStateDrExit2},
+    [DapJtagStateDrExit2] = {DapJtagStateDrShift, DapJtagStateDrUpdate},
+    [DapJtagStateDrUpdate] = {DapJtagStateIdle, DapJtagStateDrSelect},
+    [DapJtagStateIrSelect] = {DapJtagStateIrCapture, DapJtagStateReset},
+    [DapJtagStateIrCapture] = {DapJtagStateIrShift, DapJtagStateIrExit1},
+    [DapJtagStateIrShift] = {DapJtagStateIrShift, DapJtagStateIrExit1},
+    [DapJtagStateIrExit1] = {DapJtagStateIrPause, DapJtagStateIrUpdate},
+    [DapJtagStateIrPause] = {DapJtagStateIrPause, DapJtagStateIrExit2},
+    [DapJtagStateIrExit2] = {DapJtagStateIrShift, DapJtagStateIrUpdate},
+    [DapJtagStateIrUpdate] = {DapJtagStateIdle, DapJtagStateDrSelect},
+};
+
+static inline void dap_jtag_delay(void) {
+    if(dap_jtag.delay) DAP_CONFIG_DELAY(dap_jtag.delay);
+}
+
+// TDO changes on the falling edge, it is sampled just before the rising one
+static inline int dap_jtag_clock(int tms, int tdi) {
+    DAP_CONFIG_SWDIO_TMS_write(tms);
+    DAP_CONFIG_TDI_write(tdi);
+    DAP_CONFIG_SWCLK_TCK_write(0);
+    dap_jtag_delay();
+    int tdo = DAP_CONFIG_TDO_read();
+    DAP_CONFIG_SWCLK_TCK_write(1);
+    dap_jtag_delay();
+
+    dap_jtag.state = dap_jtag_next[dap_jtag.state][tms];
+    return tdo;
+}
+
+void dap_jtag_set_frequency(uint32_t frequency) {
+    // same scale as Free-DAP's DAP_SWJ_Clock
+    if(frequency == 0 || frequency >= DAP_CONFIG_FAST_CLOCK) {
+        dap_jtag.delay = 0;
+    } else {
+        dap_jtag.delay = (DAP_CONFIG_DELAY_CONSTANT * 1000) / frequency;
+    }
+}
+
+void dap_jtag_init(uint32_t frequency) {
+    DAP_CONFIG_CONNECT_JTAG();
+    dap_jtag_set_frequency(frequency);
+    dap_jtag.state = DapJtagStateReset;
+    dap_jtag_goto(DapJtagStateReset);
+}
+
+void dap_jtag_deinit(void) {
+    DAP_CONFIG_DISCONNECT();
+}
+
+DapJtagState dap_jtag_get_state(void) {
+    return dap_jtag.state;
+}
+
+void dap_jtag_goto(DapJtagState state) {
+    if(state == DapJtagStateReset) {
+        for(size_t i = 0; i < 5; i++) {
+            dap_jtag_clock(1, 1);
+        }
+        return;
+    }
+
+    // breadth-first search over the 16 states, remembering the edge into each
+    uint8_t from[DapJtagStateCount];
+    uint8_t tms[DapJtagStateCount];
+    uint8_t queue[DapJtagStateCount];
+    size_t head = 0;
+    size_t tail = 0;
+    bool seen[DapJtagStateCount] = {false};
+
+    seen[dap_jtag.state] = true;
+    queue[tail++] = dap_jtag.state;
+    while(head < tail && !seen[state]) {
+        uint8_t current = queue[head++];
+        for(uint8_t bit = 0; bit < 2; bit++) {
+            uint8_t next = dap_jtag_next[current][bit];
+            if(seen[next]) continue;
+            seen[next] = true;
+            from[next] = current;
+            tms[next] = bit;
+            queue[tail++] = next;
+        }
+    }
+
+    uint8_t path[DapJtagStateCount];
+    size_t length = 0;
+    for(uint8_t s = state; s != dap_jtag.state; s = from[s]) {
+        path[length++] = tms[s];
+    }
+    while(length > 0) {
+        dap_jtag_clock(path[--length], 1);
+    }
+}
+
+void dap_jtag_clocks(uint32_t count) {
+    const int tms = dap_jtag.state == DapJtagStateReset;
+    while(count--) {
+        dap_jtag_clock(tms, 1);
+    }
+}
+
+void dap_jtag_shift(const uint8_t* tdi, uint8_t* tdo, size_t bits, bool last) {
+    furi_assert(
+        dap_jtag.state == DapJtagStateDrShift || dap_jtag.state == DapJtagStateIrShift);
+
+    for(size_t i = 0; i < bits; i++) {
+        const uint8_t mask = 1 << (i % 8);
+        const int tms = last && i == bits - 1;
+        const int in = tdi ? (tdi[i / 8] & mask) != 0 : 0;
+
+        if(tdo && (i % 8) == 0) tdo[i / 8] = 0;
+        if(dap_jtag_clock(tms, in) && tdo) tdo[i / 8] |= mask;
+    }
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Bit-banged JTAG TAP engine for the offline players.
+ *
+ * Drives TCK/TMS on the SWD pins and TDI/TDO directly, without going
+ * through Free-DAP's sequence packets. States are numbered like the
+ * XSVF state codes. Bit buffers are LSB first: bit i is byte i / 8,
+ * bit i % 8, and bit 0 is shifted first.
+ */
+
+typedef enum {
+    DapJtagStateReset,
+    DapJtagStateIdle,
+    DapJtagStateDrSelect,
+    DapJtagStateDrCapture,
+    DapJtagStateDrShift,
+    DapJtagStateDrExit1,
+    DapJtagStateDrPause,
+    DapJtagStateDrExit2,
+    DapJtagStateDrUpdate,
+    DapJtagStateIrSelect,
+    DapJtagStateIrCapture,
+    DapJtagStateIrShift,
+    DapJtagStateIrExit1,
+    DapJtagStateIrPause,
+    DapJtagStateIrExit2,
+    DapJtagStateIrUpdate,
+    DapJtagStateCount,
+} DapJtagState;
+
+/**
+ * Take over the pins and reset the TAP
+ * @param frequency TCK in Hz, 0 for as fast as possible
+ */
+void dap_jtag_init(uint32_t frequency);
+
+void dap_jtag_deinit(void);
+
+void dap_jtag_set_frequency(uint32_t frequency);
+
+DapJtagState dap_jtag_get_state(void);
+
+/**
+ * Shortest TMS path to a state, Reset always takes five TMS high clocks
+ */
+void dap_jtag_goto(DapJtagState state);
+
+/**
+ * Clock in the current state, which should be a stable one
+ */
+void dap_jtag_clocks(uint32_t count);
+
+/**
+ * Shift in Shift-IR/DR
+ * @param tdo captured bits, may be NULL
+ * @param last leave to Exit1 with the last bit
+ */
+void dap_jtag_shift(const uint8_t* tdi, uint8_t* tdo, size_t bits, bool last);
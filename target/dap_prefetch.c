@@ -0,0 +1,366 @@
+#include <furi.h>
+
+#include "dap_prefetch.h"
+#include "dap_target.h"
+#include "../dap_cmsis.h"
+
+#define TAG "DapPrefetch"
+
+// the target keeps running, older data is read again
+#define DAP_PREFETCH_MAX_AGE_MS 10
+
+// code and SRAM only, peripheral registers may have read side effects
+#define DAP_PREFETCH_REGION_END 0x40000000UL
+
+// CSW size and address increment fields: word, single
+#define DAP_PREFETCH_CSW_MASK 0x37
+#define DAP_PREFETCH_CSW_WORD_INC 0x12
+
+#define DAP_PREFETCH_ABORT_CLEAR 0x1E
+
+#define DAP_PREFETCH_REG_MASK (DAP_TRANSFER_APnDP | 0x0C)
+#define DAP_PREFETCH_DRW (DAP_TRANSFER_APnDP | DAP_TARGET_AP_DRW)
+#define DAP_PREFETCH_DRW_READ (DAP_PREFETCH_DRW | DAP_TRANSFER_RnW)
+#define DAP_PREFETCH_SELECT_WRITE DAP_TARGET_DP_SELECT
+#define DAP_PREFETCH_CSW_WRITE (DAP_TRANSFER_APnDP | DAP_TARGET_AP_CSW)
+#define DAP_PREFETCH_TAR_WRITE (DAP_TRANSFER_APnDP | DAP_TARGET_AP_TAR)
+
+typedef enum {
+    DapPrefetchKnownSelect = (1 << 0),
+    DapPrefetchKnownCsw = (1 << 1),
+    DapPrefetchKnownTar = (1 << 2),
+    DapPrefetchKnownAll = 0x07,
+} DapPrefetchKnown;
+
+typedef struct {
+    DapPrefetchStatus status;
+
+    // AP state as the host sees it
+    uint8_t known;
+    uint32_t select;
+    uint32_t csw;
+    uint32_t tar;
+    bool tar_moved; // a read-ahead left the target TAR past the host's
+
+    // size of the last DRW block read, 0 if the last request was anything else
+    size_t sequential;
+
+    // words[offset] is the word at the host's TAR
+    uint32_t words[DAP_TARGET_BLOCK_READ_MAX];
+    size_t offset;
+    size_t count;
+    uint32_t tick;
+} DapPrefetch;
+
+static DapPrefetch dap_prefetch = {.status.enabled = true};
+
+static void dap_prefetch_drop(void) {
+    dap_prefetch.status.wasted += dap_prefetch.count - dap_prefetch.offset;
+    dap_prefetch.offset = 0;
+    dap_prefetch.count = 0;
+}
+
+static void dap_prefetch_restore_tar(void) {
+    if(!dap_prefetch.tar_moved) return;
+    dap_prefetch.tar_moved = false;
+
+    // SELECT is AP bank 0 whenever a read-ahead ran, so this rewrites it unchanged
+    if(!dap_target_ap_write(dap_prefetch.select >> 24, DAP_TARGET_AP_TAR, dap_prefetch.tar)) {
+        dap_prefetch.known = 0;
+    }
+}
+
+void dap_prefetch_set_enabled(bool enabled) {
+    if(!enabled) {
+        dap_prefetch_drop();
+        dap_prefetch_restore_tar();
+        dap_prefetch.sequential = 0;
+    }
+    dap_prefetch.status.enabled = enabled;
+}
+
+void dap_prefetch_invalidate(void) {
+    dap_prefetch_drop();
+    dap_prefetch_restore_tar();
+    dap_prefetch.known = 0;
+    dap_prefetch.sequential = 0;
+}
+
+void dap_prefetch_get_status(DapPrefetchStatus* status) {
+    *status = dap_prefetch.status;
+}
+
+void dap_prefetch_reset_stats(void) {
+    dap_prefetch.status.fills = 0;
+    dap_prefetch.status.hits = 0;
+    dap_prefetch.status.misses = 0;
+    dap_prefetch.status.wasted = 0;
+}
+
+static bool dap_prefetch_word_inc(void) {
+    return (dap_prefetch.known & DapPrefetchKnownCsw) &&
+           (dap_prefetch.csw & DAP_PREFETCH_CSW_MASK) == DAP_PREFETCH_CSW_WORD_INC;
+}
+
+// TAR only wraps inside its 1 KB window, what happens at the end is up to the AP
+static void dap_prefetch_advance(size_t count) {
+    const uint32_t offset = dap_prefetch.tar & (DAP_TARGET_TAR_WRAP - 1);
+    if(!dap_prefetch_word_inc() || offset + count * 4 >= DAP_TARGET_TAR_WRAP) {
+        dap_prefetch.known &= ~DapPrefetchKnownTar;
+        return;
+    }
+    dap_prefetch.tar += count * 4;
+}
+
+static void dap_prefetch_access(uint8_t op, uint32_t value, size_t count) {
+    const uint8_t reg = op & 0x0C;
+    const bool read = op & DAP_TRANSFER_RnW;
+
+    // writing the match mask is no target access
+    if(!read && (op & DAP_TRANSFER_MATCH_MASK)) return;
+
+    if(!(op & DAP_TRANSFER_APnDP)) {
+        if(!read && reg == DAP_TARGET_DP_SELECT) {
+            // CSW and TAR belong to the AP selected before
+            if(!(dap_prefetch.known & DapPrefetchKnownSelect) ||
+               (dap_prefetch.select >> 24) != (value >> 24)) {
+                dap_prefetch.known = 0;
+            }
+            dap_prefetch.select = value;
+            dap_prefetch.known |= DapPrefetchKnownSelect;
+            dap_target_set_host_select(value);
+        }
+        return;
+    }
+
+    if(!(dap_prefetch.known & DapPrefetchKnownSelect)) {
+        dap_prefetch.known = 0;
+        return;
+    }
+    if(dap_prefetch.select & 0xF0) return;
+
+    if(reg == DAP_TARGET_AP_CSW && !read) {
+        dap_prefetch.csw = value;
+        dap_prefetch.known |= DapPrefetchKnownCsw;
+    } else if(reg == DAP_TARGET_AP_TAR && !read) {
+        dap_prefetch.tar = value;
+        dap_prefetch.known |= DapPrefetchKnownTar;
+    } else if(reg == DAP_TARGET_AP_DRW) {
+        // match reads repeat for as long as it takes
+        if(op & DAP_TRANSFER_MATCH_VALUE) {
+            dap_prefetch.known &= ~DapPrefetchKnownTar;
+        } else {
+            dap_prefetch_advance(count);
+        }
+    }
+}
+
+static void dap_prefetch_observe_transfer(
+    const uint8_t* request,
+    size_t request_size,
+    const uint8_t* response) {
+    const size_t done = response[1];
+    size_t offset = 3;
+
+    for(size_t i = 0; i < done && offset < request_size; i++) {
+        const uint8_t op = request[offset++];
+        uint32_t value = 0;
+
+        if(op & DAP_TRANSFER_TIMESTAMP) {
+            dap_prefetch.known = 0;
+            return;
+        }
+        if(!(op & DAP_TRANSFER_RnW) || (op & DAP_TRANSFER_MATCH_VALUE)) {
+            if(offset + 4 > request_size) break;
+            value = dap_get_u32(&request[offset]);
+            offset += 4;
+        }
+        dap_prefetch_access(op, value, 1);
+    }
+
+    // a failed AP access may or may not have moved TAR
+    if((response[2] & DAP_TRANSFER_ACK_MASK) != DAP_TRANSFER_ACK_OK) {
+        dap_prefetch.known &= DapPrefetchKnownSelect;
+    }
+}
+
+void dap_prefetch_observe(const uint8_t* request, size_t request_size, const uint8_t* response) {
+    if(request_size == 0) return;
+
+    switch(request[0]) {
+    case DAP_CMD_INFO:
+    case DAP_CMD_HOST_STATUS:
+    case DAP_CMD_TRANSFER_CONFIGURE:
+    case DAP_CMD_DELAY:
+    case DAP_CMD_SWJ_CLOCK:
+    case DAP_CMD_SWD_CONFIGURE:
+        return;
+    case DAP_CMD_TRANSFER:
+        dap_prefetch.sequential = 0;
+        if(request_size >= 3 && response[0] == DAP_CMD_TRANSFER) {
+            dap_prefetch_observe_transfer(request, request_size, response);
+            return;
+        }
+        break;
+    case DAP_CMD_TRANSFER_BLOCK:
+        dap_prefetch.sequential = 0;
+        if(request_size >= 5 && response[0] == DAP_CMD_TRANSFER_BLOCK) {
+            const uint8_t op = request[4];
+            const size_t count = dap_get_u16(&request[2]);
+            const size_t done = dap_get_u16(&response[1]);
+            const bool ok = (response[3] & DAP_TRANSFER_ACK_MASK) == DAP_TRANSFER_ACK_OK;
+
+            if((op & DAP_PREFETCH_REG_MASK) == DAP_PREFETCH_DRW) {
+                dap_prefetch_access(op, 0, done);
+                if(!ok) dap_prefetch.known &= DapPrefetchKnownSelect;
+                if(ok && done == count && op == DAP_PREFETCH_DRW_READ) {
+                    dap_prefetch.sequential = MIN(done, (size_t)DAP_TARGET_BLOCK_READ_MAX);
+                }
+            } else if(op & DAP_TRANSFER_APnDP) {
+                dap_prefetch.known &= DapPrefetchKnownSelect;
+            }
+            return;
+        }
+        break;
+    }
+
+    // anything else may reconnect, reset or re-program the AP
+    dap_prefetch.known = 0;
+    dap_prefetch.sequential = 0;
+}
+
+static bool dap_prefetch_block_hit(
+    const uint8_t* request,
+    size_t request_size,
+    uint8_t* response,
+    size_t* response_length) {
+    if(request_size < 5 || request[4] != DAP_PREFETCH_DRW_READ) return false;
+
+    const size_t count = dap_get_u16(&request[2]);
+    if(count == 0 || count > dap_prefetch.count - dap_prefetch.offset ||
+       furi_get_tick() - dap_prefetch.tick > furi_ms_to_ticks(DAP_PREFETCH_MAX_AGE_MS)) {
+        dap_prefetch.status.misses++;
+        return false;
+    }
+
+    response[0] = DAP_CMD_TRANSFER_BLOCK;
+    dap_put_u16(&response[1], count);
+    response[3] = DAP_TRANSFER_ACK_OK;
+    for(size_t i = 0; i < count; i++) {
+        dap_put_u32(&response[4 + i * 4], dap_prefetch.words[dap_prefetch.offset + i]);
+    }
+    *response_length = 4 + count * 4;
+
+    dap_prefetch.offset += count;
+    dap_prefetch.tar += count * 4;
+    dap_prefetch.sequential = count;
+    dap_prefetch.status.hits++;
+
+    if(dap_prefetch.offset == dap_prefetch.count) {
+        // the target TAR caught up, unless the read-ahead ended on a window edge
+        dap_prefetch.tar_moved = false;
+        if(!(dap_prefetch.tar & (DAP_TARGET_TAR_WRAP - 1))) {
+            dap_prefetch.known &= ~DapPrefetchKnownTar;
+        }
+    }
+    return true;
+}
+
+// SELECT, CSW and TAR writes that leave the host's view as it is
+static bool dap_prefetch_transfer_hit(
+    const uint8_t* request,
+    size_t request_size,
+    uint8_t* response,
+    size_t* response_length) {
+    if(request_size < 3 || request[2] == 0) return false;
+
+    size_t offset = 3;
+    for(size_t i = 0; i < request[2]; i++) {
+        if(offset + 5 > request_size) return false;
+        const uint8_t op = request[offset];
+        const uint32_t value = dap_get_u32(&request[offset + 1]);
+        offset += 5;
+
+        if(op == DAP_PREFETCH_SELECT_WRITE) {
+            if(value != dap_prefetch.select) return false;
+        } else if(op == DAP_PREFETCH_CSW_WRITE) {
+            if(value != dap_prefetch.csw) return false;
+        } else if(op == DAP_PREFETCH_TAR_WRITE) {
+            if(value != dap_prefetch.tar) return false;
+        } else {
+            return false;
+        }
+    }
+
+    response[0] = DAP_CMD_TRANSFER;
+    response[1] = request[2];
+    response[2] = DAP_TRANSFER_ACK_OK;
+    *response_length = 3;
+    return true;
+}
+
+bool dap_prefetch_request(
+    const uint8_t* request,
+    size_t request_size,
+    uint8_t* response,
+    size_t* response_length) {
+    if(request_size == 0) return false;
+    const bool buffered = dap_prefetch.offset < dap_prefetch.count;
+
+    switch(request[0]) {
+    case DAP_CMD_INFO:
+    case DAP_CMD_HOST_STATUS:
+    case DAP_CMD_TRANSFER_CONFIGURE:
+    case DAP_CMD_DELAY:
+    case DAP_CMD_SWJ_CLOCK:
+    case DAP_CMD_SWD_CONFIGURE:
+        return false;
+    case DAP_CMD_TRANSFER_BLOCK:
+        if(buffered &&
+           dap_prefetch_block_hit(request, request_size, response, response_length)) {
+            return true;
+        }
+        break;
+    case DAP_CMD_TRANSFER:
+        if(buffered &&
+           dap_prefetch_transfer_hit(request, request_size, response, response_length)) {
+            return true;
+        }
+        break;
+    }
+
+    dap_prefetch_drop();
+    dap_prefetch_restore_tar();
+    return false;
+}
+
+void dap_prefetch_fill(void) {
+    if(!dap_prefetch.status.enabled || !dap_prefetch.sequential ||
+       dap_prefetch.offset < dap_prefetch.count) {
+        return;
+    }
+    if(dap_prefetch.known != DapPrefetchKnownAll || (dap_prefetch.select & 0x00FFFFFF) ||
+       !dap_prefetch_word_inc() || dap_prefetch.tar >= DAP_PREFETCH_REGION_END) {
+        return;
+    }
+
+    const size_t window =
+        (DAP_TARGET_TAR_WRAP - (dap_prefetch.tar & (DAP_TARGET_TAR_WRAP - 1))) / 4;
+    const size_t count = MIN(dap_prefetch.sequential, window);
+    dap_prefetch.sequential = 0;
+    dap_prefetch.offset = 0;
+    dap_prefetch.count = 0;
+
+    // console, halt and stream engines may have run since the host's last request
+    dap_prefetch.tar_moved = true;
+    if(!dap_target_ap_setup(dap_prefetch.select, dap_prefetch.csw, dap_prefetch.tar) ||
+       !dap_target_poll_read(dap_prefetch.words, count)) {
+        // a speculative fault must not show up in the host's next transfer
+        dap_target_dp_write(DAP_TARGET_DP_ABORT, DAP_PREFETCH_ABORT_CLEAR);
+        return;
+    }
+
+    dap_prefetch.count = count;
+    dap_prefetch.tick = furi_get_tick();
+    dap_prefetch.status.fills++;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Read-ahead for sequential MEM-AP block reads from the host.
+ *
+ * Host requests are watched to shadow SELECT, CSW and TAR. After a
+ * DAP_TransferBlock read of DRW with word auto-increment, the next block of
+ * the same size is read while the response travels to the host, and the
+ * following request is answered from it if it continues at that address.
+ * Only code and SRAM regions are read ahead, never across a 1 KB TAR window.
+ * A read-ahead writes the shadowed SELECT, CSW and TAR first, the background
+ * engines share the AP with the host.
+ * Any other access drops the buffer and puts TAR back where the host left it.
+ */
+
+typedef struct {
+    bool enabled;
+    uint32_t fills; // blocks read ahead
+    uint32_t hits; // block reads answered from the buffer
+    uint32_t misses; // block reads passed to the target
+    uint32_t wasted; // words read ahead and dropped
+} DapPrefetchStatus;
+
+void dap_prefetch_set_enabled(bool enabled);
+
+/**
+ * Put TAR back and forget the shadowed AP state, for anything that touches
+ * the target outside of host requests
+ */
+void dap_prefetch_invalidate(void);
+
+/**
+ * Answer a host request from the buffer. Otherwise restores TAR if it was
+ * moved by a read-ahead, the request then goes to dap_process_request().
+ * @return true if response holds the answer
+ */
+bool dap_prefetch_request(
+    const uint8_t* request,
+    size_t request_size,
+    uint8_t* response,
+    size_t* response_length);
+
+/**
+ * Track the AP state after dap_process_request() executed a host request
+ */
+void dap_prefetch_observe(const uint8_t* request, size_t request_size, const uint8_t* response);
+
+/**
+ * Read the next block ahead if the last host request was a sequential read
+ */
+void dap_prefetch_fill(void);
+
+void dap_prefetch_get_status(DapPrefetchStatus* status);
+
+void dap_prefetch_reset_stats(void);
@@ -0,0 +1,131 @@
+#include <furi.h>
+#include <furi_hal_cortex.h>
+
+#include "dap_profile.h"
+#include "dap_target.h"
+
+#define TAG "DapProfile"
+
+#define DAP_PROFILE_IDLE_PC 0xFFFFFFFF
+#define DAP_PROFILE_ERROR_WAIT_US 100000
+
+typedef struct {
+    DapProfileStatus status;
+    FuriStreamBuffer* out;
+    uint32_t period; // in cycles of the probe
+    uint32_t next;
+} DapProfile;
+
+static DapProfile dap_profile;
+
+bool dap_profile_start(uint32_t rate_hz, FuriStreamBuffer* out) {
+    memset(&dap_profile, 0, sizeof(DapProfile));
+
+    // DWT registers only work with trace enabled
+    uint32_t demcr;
+    if(!dap_target_read32(DAP_TARGET_DEMCR, &demcr) ||
+       !dap_target_write32(DAP_TARGET_DEMCR, demcr | DAP_TARGET_DEMCR_TRCENA)) {
+        return false;
+    }
+
+    const uint32_t header[] = {DAP_PROFILE_MAGIC, rate_hz};
+    furi_stream_buffer_reset(out);
+    furi_stream_buffer_send(out, header, sizeof(header), 0);
+
+    const uint32_t clock = furi_hal_cortex_instructions_per_microsecond() * 1000000;
+    dap_profile.out = out;
+    dap_profile.period = rate_hz ? clock / MIN(rate_hz, clock) : 0;
+    dap_profile.next = DWT->CYCCNT;
+    dap_profile.status.rate_hz = rate_hz;
+    dap_profile.status.active = true;
+    return true;
+}
+
+void dap_profile_stop(void) {
+    if(dap_profile.status.active) {
+        FURI_LOG_I(
+            TAG,
+            "%lu samples, %lu idle, %lu dropped",
+            dap_profile.status.samples,
+            dap_profile.status.idle,
+            dap_profile.status.dropped);
+    }
+    dap_profile.status.active = false;
+}
+
+bool dap_profile_is_active(void) {
+    return dap_profile.status.active;
+}
+
+void dap_profile_get_status(DapProfileStatus* status) {
+    *status = dap_profile.status;
+}
+
+static void dap_profile_store(const uint32_t* samples, size_t count) {
+    // whole samples only, a partial word would shift everything after it
+    if(furi_stream_buffer_spaces_available(dap_profile.out) < count * sizeof(uint32_t)) {
+        dap_profile.status.dropped += count;
+        return;
+    }
+
+    furi_stream_buffer_send(dap_profile.out, samples, count * sizeof(uint32_t), 0);
+    dap_profile.status.samples += count;
+    for(size_t i = 0; i < count; i++) {
+        if(samples[i] == DAP_PROFILE_IDLE_PC) dap_profile.status.idle++;
+    }
+}
+
+uint32_t dap_profile_run(uint32_t slice_us, bool (*abort)(void* context), void* context) {
+    if(!dap_profile.status.active) return UINT32_MAX;
+
+    const uint32_t ipus = furi_hal_cortex_instructions_per_microsecond();
+    const uint32_t slice = slice_us * ipus;
+    const uint32_t start = DWT->CYCCNT;
+    const bool paced = dap_profile.period > 0;
+
+    // nothing due in this slice, leave the target alone
+    if(paced && (int32_t)(dap_profile.next - start) > (int32_t)slice) {
+        return (dap_profile.next - start) / ipus;
+    }
+
+    DapTargetApState ap;
+    dap_target_ap_save(&ap);
+    if(!dap_target_poll_setup(DAP_TARGET_DWT_PCSR)) {
+        dap_profile.status.errors++;
+        dap_target_ap_restore(&ap);
+        return DAP_PROFILE_ERROR_WAIT_US;
+    }
+
+    uint32_t samples[DAP_TARGET_BLOCK_READ_MAX];
+    bool failed = false;
+    while(DWT->CYCCNT - start < slice && !(abort && abort(context))) {
+        size_t count = DAP_TARGET_BLOCK_READ_MAX;
+
+        if(paced) {
+            uint32_t now = DWT->CYCCNT;
+            if((int32_t)(dap_profile.next - now) > 0) {
+                if(dap_profile.next - start >= slice) break;
+                continue;
+            }
+
+            // after a stall restart the grid instead of catching up in a burst
+            dap_profile.next += dap_profile.period;
+            if((int32_t)(now - dap_profile.next) > 0) dap_profile.next = now + dap_profile.period;
+            count = 1;
+        }
+
+        if(!dap_target_poll_read(samples, count)) {
+            dap_profile.status.errors++;
+            failed = true;
+            break;
+        }
+        dap_profile_store(samples, count);
+    }
+
+    dap_target_ap_restore(&ap);
+
+    if(failed) return DAP_PROFILE_ERROR_WAIT_US;
+    if(!paced) return 0;
+    int32_t wait = dap_profile.next - DWT->CYCCNT;
+    return wait > 0 ? (uint32_t)wait / ipus : 0;
+}
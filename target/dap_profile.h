@@ -0,0 +1,42 @@
+#pragma once
+#include <furi.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Statistical profiler sampling DWT_PCSR over SWD.
+ *
+ * PCSR is read without halting the core, so the target runs at full speed.
+ * The output starts with a header (magic, rate) followed by one little
+ * endian word per sample, 0xFFFFFFFF while the core is halted or asleep.
+ * Samples that don't fit into the stream are counted and dropped.
+ */
+
+#define DAP_PROFILE_MAGIC 0x31534350 // "PCS1"
+
+typedef struct {
+    bool active;
+    uint32_t rate_hz; // 0 samples back to back
+    uint32_t samples;
+    uint32_t dropped;
+    uint32_t idle; // samples with the core halted or asleep
+    uint32_t errors;
+} DapProfileStatus;
+
+/**
+ * Enable the DWT and write the stream header
+ */
+bool dap_profile_start(uint32_t rate_hz, FuriStreamBuffer* out);
+
+void dap_profile_stop(void);
+
+bool dap_profile_is_active(void);
+
+/**
+ * Sample for up to one slice, paced by the cycle counter.
+ * @param abort called between samples, ends the slice early when it returns true
+ * @return time until the next sample is due in us
+ */
+uint32_t dap_profile_run(uint32_t slice_us, bool (*abort)(void* context), void* context);
+
+void dap_profile_get_status(DapProfileStatus* status);
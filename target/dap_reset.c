@@ -0,0 +1,132 @@
+#include <furi.h>
+#include <furi_hal_cortex.h>
+
+#include "dap_reset.h"
+#include "dap_target.h"
+#include "../dap_config.h"
+
+#define TAG "DapReset"
+
+void dap_reset_params_default(DapResetParams* params) {
+    params->assert_us = DAP_RESET_ASSERT_US_DEFAULT;
+    params->settle_us = DAP_RESET_SETTLE_US_DEFAULT;
+    params->timeout_us = DAP_RESET_TIMEOUT_US_DEFAULT;
+    params->halt = false;
+}
+
+static void dap_reset_delay_us(uint32_t us) {
+    if(us >= 1000) {
+        furi_delay_ms(us / 1000);
+        us %= 1000;
+    }
+    if(us > 0) {
+        furi_delay_us(us);
+    }
+}
+
+// the pin is only an output while Free-DAP holds the port connected
+static bool dap_reset_pin_driven(void) {
+    return LL_GPIO_GetPinMode(flipper_dap_reset_pin.port, flipper_dap_reset_pin.pin) ==
+           LL_GPIO_MODE_OUTPUT;
+}
+
+// hand the line back to the target's own reset circuit and button
+static void dap_reset_restore(bool driven) {
+    if(!driven) {
+        furi_hal_gpio_init(&flipper_dap_reset_pin, GpioModeInput, GpioPullNo, GpioSpeedVeryHigh);
+    }
+}
+
+static void dap_reset_assert(void) {
+    furi_hal_gpio_init(
+        &flipper_dap_reset_pin, flipper_dap_reset_mode, GpioPullNo, GpioSpeedVeryHigh);
+    furi_hal_gpio_write(&flipper_dap_reset_pin, false);
+}
+
+static void dap_reset_release(const DapResetParams* params, DapResetResult* result) {
+    FuriHalCortexTimer timer = furi_hal_cortex_timer_get(params->timeout_us);
+    furi_hal_gpio_write(&flipper_dap_reset_pin, true);
+
+    // in open-drain mode the target may keep nRST low with its own supervisor
+    result->released = false;
+    do {
+        if(furi_hal_gpio_read(&flipper_dap_reset_pin)) {
+            result->released = true;
+            break;
+        }
+    } while(!furi_hal_cortex_timer_is_expired(timer));
+
+    result->release_us =
+        (DWT->CYCCNT - timer.start) / furi_hal_cortex_instructions_per_microsecond();
+}
+
+void dap_reset_pulse(const DapResetParams* params, DapResetResult* result) {
+    memset(result, 0, sizeof(DapResetResult));
+    const bool driven = dap_reset_pin_driven();
+
+    dap_reset_assert();
+    dap_reset_delay_us(params->assert_us);
+    dap_reset_release(params, result);
+    dap_reset_restore(driven);
+    dap_reset_delay_us(params->settle_us);
+}
+
+static bool dap_reset_request_halt(uint32_t* demcr) {
+    return dap_target_read32(DAP_TARGET_DEMCR, demcr) &&
+           dap_target_write32(DAP_TARGET_DEMCR, *demcr | DAP_TARGET_DEMCR_VC_CORERESET) &&
+           dap_target_write32(
+               DAP_TARGET_DHCSR,
+               DAP_TARGET_DHCSR_DBGKEY | DAP_TARGET_DHCSR_C_DEBUGEN | DAP_TARGET_DHCSR_C_HALT);
+}
+
+static bool dap_reset_wait_halt(uint32_t timeout_us, uint32_t* dhcsr) {
+    FuriHalCortexTimer timer = furi_hal_cortex_timer_get(timeout_us);
+    do {
+        if(dap_target_read32(DAP_TARGET_DHCSR, dhcsr) && (*dhcsr & DAP_TARGET_DHCSR_S_HALT)) {
+            return true;
+        }
+    } while(!furi_hal_cortex_timer_is_expired(timer));
+    return false;
+}
+
+bool dap_reset_run(const DapResetParams* params, DapResetResult* result) {
+    if(!params->halt) {
+        dap_reset_pulse(params, result);
+        return result->released;
+    }
+
+    memset(result, 0, sizeof(DapResetResult));
+    uint32_t demcr = 0;
+    const bool driven = dap_reset_pin_driven();
+
+    dap_reset_assert();
+    dap_reset_delay_us(params->assert_us);
+
+    // most cores keep the debug domain alive while nRST is low
+    bool armed = dap_target_connect(NULL) && dap_reset_request_halt(&demcr);
+
+    dap_reset_release(params, result);
+    dap_reset_restore(driven);
+    dap_reset_delay_us(params->settle_us);
+
+    if(!armed) {
+        // debug port gated under reset, attach as early as possible instead
+        FURI_LOG_W(TAG, "Connect under reset failed, halting after release");
+        armed = dap_target_connect(NULL) && dap_reset_request_halt(&demcr);
+    }
+
+    if(armed) {
+        result->halted = dap_reset_wait_halt(params->timeout_us, &result->dhcsr);
+        dap_target_write32(DAP_TARGET_DEMCR, demcr & ~DAP_TARGET_DEMCR_VC_CORERESET);
+    }
+
+    FURI_LOG_D(
+        TAG,
+        "Released %d in %luus, halted %d, DHCSR %08lX",
+        result->released,
+        result->release_us,
+        result->halted,
+        result->dhcsr);
+
+    return result->released && result->halted;
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+#define DAP_RESET_ASSERT_US_DEFAULT 20000
+#define DAP_RESET_SETTLE_US_DEFAULT 1000
+#define DAP_RESET_TIMEOUT_US_DEFAULT 500000
+
+typedef struct {
+    uint32_t assert_us; // how long nRST is held low
+    uint32_t settle_us; // delay after the line is seen high
+    uint32_t timeout_us; // limit for the line to rise and the core to halt
+    bool halt; // connect-under-reset: attach and halt while nRST is held
+} DapResetParams;
+
+typedef struct {
+    bool released; // nRST line was seen high within the timeout
+    bool halted; // core halted on the reset vector
+    uint32_t release_us; // time from deassert until the line went high
+    uint32_t dhcsr; // DHCSR after the sequence, 0 without halt
+} DapResetResult;
+
+void dap_reset_params_default(DapResetParams* params);
+
+/**
+ * Pin-only reset pulse. Safe to call from inside dap_process_request().
+ */
+void dap_reset_pulse(const DapResetParams* params, DapResetResult* result);
+
+/**
+ * Reset pulse with optional connect-under-reset. Uses the SWD engine, so
+ * it must run in the DAP thread outside of dap_process_request().
+ */
+bool dap_reset_run(const DapResetParams* params, DapResetResult* result);
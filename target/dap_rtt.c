@@ -0,0 +1,212 @@
+#include "dap_rtt.h"
+#include "dap_target.h"
+
+#define TAG "DapRtt"
+
+#define DAP_RTT_INTERVAL_MIN_MS 1
+#define DAP_RTT_INTERVAL_MAX_MS 64
+#define DAP_RTT_RESCAN_MS 1000
+#define DAP_RTT_ERROR_LIMIT 8
+
+#define DAP_RTT_ID "SEGGER RTT"
+#define DAP_RTT_ID_SIZE 16
+#define DAP_RTT_SCAN_WORDS 64
+#define DAP_RTT_CHUNK_SIZE 256
+#define DAP_RTT_BUFFER_COUNT_MAX 32
+
+// SEGGER_RTT_BUFFER_UP/DOWN: sName, pBuffer, SizeOfBuffer, WrOff, RdOff, Flags
+#define DAP_RTT_DESC_SIZE 24
+#define DAP_RTT_DESC_BUFFER 4
+#define DAP_RTT_DESC_WR_OFF 12
+#define DAP_RTT_DESC_RD_OFF 16
+
+typedef struct {
+    uint32_t buffer;
+    uint32_t size;
+    uint32_t wr_off;
+    uint32_t rd_off;
+} DapRttRing;
+
+typedef struct {
+    DapRttStatus status;
+    uint32_t scan_address;
+    uint32_t scan_size;
+    uint32_t up_desc;
+    uint32_t down_desc; // 0 if the target has no down buffer
+    uint32_t errors;
+} DapRtt;
+
+static DapRtt dap_rtt;
+static uint32_t dap_rtt_words[DAP_RTT_SCAN_WORDS];
+static uint8_t dap_rtt_chunk[DAP_RTT_CHUNK_SIZE];
+
+void dap_rtt_start(uint32_t scan_address, uint32_t scan_size) {
+    memset(&dap_rtt, 0, sizeof(DapRtt));
+    dap_rtt.scan_address = scan_address & ~3UL;
+    dap_rtt.scan_size = scan_size;
+    dap_rtt.status.active = true;
+    dap_rtt.status.interval_ms = DAP_RTT_INTERVAL_MIN_MS;
+}
+
+void dap_rtt_stop(void) {
+    dap_rtt.status.active = false;
+}
+
+bool dap_rtt_is_active(void) {
+    return dap_rtt.status.active;
+}
+
+void dap_rtt_get_status(DapRttStatus* status) {
+    *status = dap_rtt.status;
+}
+
+static bool dap_rtt_attach(uint32_t control_block) {
+    uint32_t counts[2];
+    if(!dap_target_read_block(control_block + DAP_RTT_ID_SIZE, counts, COUNT_OF(counts)) ||
+       counts[0] == 0 || counts[0] > DAP_RTT_BUFFER_COUNT_MAX ||
+       counts[1] > DAP_RTT_BUFFER_COUNT_MAX) {
+        return false;
+    }
+
+    dap_rtt.status.control_block = control_block;
+    dap_rtt.up_desc = control_block + DAP_RTT_ID_SIZE + 8;
+    dap_rtt.down_desc = counts[1] ? dap_rtt.up_desc + counts[0] * DAP_RTT_DESC_SIZE : 0;
+    FURI_LOG_I(
+        TAG, "Control block at %08lX, %lu up, %lu down", control_block, counts[0], counts[1]);
+    return true;
+}
+
+static bool dap_rtt_scan(void) {
+    const size_t step = sizeof(dap_rtt_words) - DAP_RTT_ID_SIZE;
+    const uint32_t end = dap_rtt.scan_address + dap_rtt.scan_size;
+
+    // consecutive windows overlap, so an ID crossing a boundary is still found
+    for(uint32_t address = dap_rtt.scan_address; address < end; address += step) {
+        size_t words = MIN(end - address, sizeof(dap_rtt_words)) / 4;
+        if(words * 4 < DAP_RTT_ID_SIZE) break;
+        if(!dap_target_read_block(address, dap_rtt_words, words)) return false;
+
+        const uint8_t* data = (const uint8_t*)dap_rtt_words;
+        for(size_t offset = 0; offset + DAP_RTT_ID_SIZE <= words * 4; offset += 4) {
+            if(memcmp(&data[offset], DAP_RTT_ID, sizeof(DAP_RTT_ID)) == 0 &&
+               dap_rtt_attach(address + offset)) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+static bool dap_rtt_read_ring(uint32_t desc, DapRttRing* ring) {
+    uint32_t words[4];
+    if(!dap_target_read_block(desc + DAP_RTT_DESC_BUFFER, words, COUNT_OF(words))) return false;
+
+    ring->buffer = words[0];
+    ring->size = words[1];
+    ring->wr_off = words[2];
+    ring->rd_off = words[3];
+    return ring->size > 0 && ring->wr_off < ring->size && ring->rd_off < ring->size;
+}
+
+static size_t dap_rtt_service_up(FuriStreamBuffer* up) {
+    DapRttRing ring;
+    size_t moved = 0;
+    if(!dap_rtt_read_ring(dap_rtt.up_desc, &ring)) return SIZE_MAX;
+
+    // at most two runs: up to the end of the ring, then from its start
+    while(ring.rd_off != ring.wr_off) {
+        size_t size = ring.wr_off > ring.rd_off ? ring.wr_off - ring.rd_off :
+                                                  ring.size - ring.rd_off;
+        size = MIN(size, sizeof(dap_rtt_chunk));
+        size = MIN(size, furi_stream_buffer_spaces_available(up));
+        if(size == 0) break;
+
+        if(!dap_target_read_bytes(ring.buffer + ring.rd_off, dap_rtt_chunk, size)) {
+            return SIZE_MAX;
+        }
+        furi_stream_buffer_send(up, dap_rtt_chunk, size, 0);
+
+        ring.rd_off = (ring.rd_off + size) % ring.size;
+        moved += size;
+    }
+
+    if(moved && !dap_target_write32(dap_rtt.up_desc + DAP_RTT_DESC_RD_OFF, ring.rd_off)) {
+        return SIZE_MAX;
+    }
+
+    dap_rtt.status.up_bytes += moved;
+    return moved;
+}
+
+static size_t dap_rtt_service_down(FuriStreamBuffer* down) {
+    DapRttRing ring;
+    size_t moved = 0;
+    if(!dap_rtt.down_desc || furi_stream_buffer_is_empty(down)) return 0;
+    if(!dap_rtt_read_ring(dap_rtt.down_desc, &ring)) return SIZE_MAX;
+
+    while(true) {
+        // one slot always stays free to tell a full ring from an empty one
+        size_t space = ring.rd_off > ring.wr_off ? ring.rd_off - ring.wr_off - 1 :
+                                                   ring.size - ring.wr_off - (ring.rd_off == 0);
+        size_t size = MIN(space, sizeof(dap_rtt_chunk));
+        if(size == 0) break;
+
+        size = furi_stream_buffer_receive(down, dap_rtt_chunk, size, 0);
+        if(size == 0) break;
+
+        if(!dap_target_write_bytes(ring.buffer + ring.wr_off, dap_rtt_chunk, size)) {
+            return SIZE_MAX;
+        }
+
+        ring.wr_off = (ring.wr_off + size) % ring.size;
+        moved += size;
+    }
+
+    if(moved && !dap_target_write32(dap_rtt.down_desc + DAP_RTT_DESC_WR_OFF, ring.wr_off)) {
+        return SIZE_MAX;
+    }
+
+    dap_rtt.status.down_bytes += moved;
+    return moved;
+}
+
+uint32_t dap_rtt_poll(FuriStreamBuffer* up, FuriStreamBuffer* down) {
+    if(!dap_rtt.status.active) return FuriWaitForever;
+
+    // leave the MEM-AP as the debugger programmed it
+    DapTargetApState ap;
+    bool saved = dap_target_ap_save(&ap);
+
+    if(!dap_rtt.status.control_block) {
+        if(!saved || !dap_rtt_scan()) {
+            dap_rtt.status.interval_ms = DAP_RTT_RESCAN_MS;
+        } else {
+            dap_rtt.status.interval_ms = DAP_RTT_INTERVAL_MIN_MS;
+        }
+    } else {
+        size_t up_moved = dap_rtt_service_up(up);
+        size_t down_moved = dap_rtt_service_down(down);
+
+        if(up_moved == SIZE_MAX || down_moved == SIZE_MAX) {
+            // target reset or went away, look for the control block again
+            if(++dap_rtt.errors >= DAP_RTT_ERROR_LIMIT) {
+                FURI_LOG_W(TAG, "Control block lost");
+                dap_rtt.status.control_block = 0;
+                dap_rtt.errors = 0;
+            }
+            dap_rtt.status.interval_ms = DAP_RTT_INTERVAL_MAX_MS;
+        } else if(up_moved || down_moved) {
+            dap_rtt.errors = 0;
+            dap_rtt.status.interval_ms = DAP_RTT_INTERVAL_MIN_MS;
+        } else {
+            dap_rtt.errors = 0;
+            dap_rtt.status.interval_ms =
+                MIN(dap_rtt.status.interval_ms * 2, (uint32_t)DAP_RTT_INTERVAL_MAX_MS);
+        }
+    }
+
+    dap_target_ap_restore(&ap);
+
+    return dap_rtt.status.interval_ms;
+}
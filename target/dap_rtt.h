@@ -0,0 +1,41 @@
+#pragma once
+#include <furi.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * SEGGER RTT channel 0 serviced by the probe.
+ *
+ * The control block is located once by scanning a RAM range, afterwards
+ * only the ring buffer descriptors and new data are transferred. The poll
+ * interval shrinks while data flows and backs off while the target is
+ * quiet. CSW and TAR of AP0 are restored after each poll, so a debugger
+ * caching them is not disturbed.
+ */
+
+#define DAP_RTT_SCAN_ADDRESS_DEFAULT 0x20000000
+#define DAP_RTT_SCAN_SIZE_DEFAULT 0x10000
+
+typedef struct {
+    bool active;
+    uint32_t control_block; // 0 until found
+    uint32_t interval_ms;
+    uint32_t up_bytes; // target to host
+    uint32_t down_bytes; // host to target
+} DapRttStatus;
+
+void dap_rtt_start(uint32_t scan_address, uint32_t scan_size);
+
+void dap_rtt_stop(void);
+
+bool dap_rtt_is_active(void);
+
+/**
+ * Move data between the target ring buffers and the streams.
+ * @param up receives target output
+ * @param down holds input for the target
+ * @return delay until the next poll in ms
+ */
+uint32_t dap_rtt_poll(FuriStreamBuffer* up, FuriStreamBuffer* down);
+
+void dap_rtt_get_status(DapRttStatus* status);
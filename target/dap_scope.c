@@ -0,0 +1,244 @@
+#include <furi.h>
+#include <furi_hal_cortex.h>
+
+#include "dap_scope.h"
+#include "dap_target.h"
+#include "../dap_cmsis.h"
+
+#define TAG "DapScope"
+
+#define DAP_SCOPE_WORDS_MAX 64
+#define DAP_SCOPE_RATE_MAX 100000
+#define DAP_SCOPE_ERROR_WAIT_US 100000
+
+// reading a few unused words is cheaper than re-programming TAR
+#define DAP_SCOPE_GAP_WORDS 2
+
+// timestamp and drop counter
+#define DAP_SCOPE_RECORD_HEADER 8
+
+typedef struct {
+    uint32_t address;
+    uint8_t width;
+    uint8_t offset; // byte offset into the word buffer
+} DapScopeEntry;
+
+typedef struct {
+    uint32_t address;
+    uint8_t words;
+    uint8_t offset; // word offset into the word buffer
+} DapScopeGroup;
+
+typedef struct {
+    DapScopeStatus status;
+    FuriStreamBuffer* out;
+    uint32_t period;
+    uint32_t next;
+
+    DapScopeEntry entries[DAP_SCOPE_ENTRY_MAX];
+    DapScopeGroup groups[DAP_SCOPE_ENTRY_MAX];
+    uint8_t group_count;
+    uint8_t record_size;
+} DapScope;
+
+static DapScope dap_scope;
+static uint32_t dap_scope_words[DAP_SCOPE_WORDS_MAX];
+static uint8_t dap_scope_record[DAP_SCOPE_RECORD_HEADER + DAP_SCOPE_ENTRY_MAX * 4];
+
+void dap_scope_clear(void) {
+    if(dap_scope.status.active) return;
+    dap_scope.status.entries = 0;
+}
+
+bool dap_scope_add(uint32_t address, uint8_t width) {
+    if(dap_scope.status.active || dap_scope.status.entries >= DAP_SCOPE_ENTRY_MAX) return false;
+    if((width != 1 && width != 2 && width != 4) || (address & (width - 1))) return false;
+
+    DapScopeEntry* entry = &dap_scope.entries[dap_scope.status.entries++];
+    entry->address = address;
+    entry->width = width;
+    return true;
+}
+
+// merge the word ranges of all entries into as few block reads as possible
+static bool dap_scope_plan(void) {
+    uint8_t order[DAP_SCOPE_ENTRY_MAX];
+    const size_t count = dap_scope.status.entries;
+
+    for(size_t i = 0; i < count; i++) {
+        order[i] = i;
+    }
+    for(size_t i = 1; i < count; i++) {
+        for(size_t j = i; j > 0; j--) {
+            if(dap_scope.entries[order[j - 1]].address <= dap_scope.entries[order[j]].address) {
+                break;
+            }
+            uint8_t swap = order[j];
+            order[j] = order[j - 1];
+            order[j - 1] = swap;
+        }
+    }
+
+    size_t words = 0;
+    dap_scope.group_count = 0;
+    DapScopeGroup* group = NULL;
+
+    for(size_t i = 0; i < count; i++) {
+        DapScopeEntry* entry = &dap_scope.entries[order[i]];
+        const uint32_t first = entry->address & ~3UL;
+        const uint32_t end = (entry->address + entry->width + 3) & ~3UL;
+
+        if(!group || first > group->address + (group->words + DAP_SCOPE_GAP_WORDS) * 4) {
+            group = &dap_scope.groups[dap_scope.group_count++];
+            group->address = first;
+            group->words = 0;
+            group->offset = words;
+        }
+
+        const uint32_t group_end = group->address + group->words * 4;
+        if(end > group_end) {
+            words += (end - group_end) / 4;
+            group->words += (end - group_end) / 4;
+        }
+        if(words > DAP_SCOPE_WORDS_MAX) return false;
+
+        entry->offset = group->offset * 4 + (entry->address - group->address);
+    }
+
+    dap_scope.record_size = DAP_SCOPE_RECORD_HEADER;
+    for(size_t i = 0; i < count; i++) {
+        dap_scope.record_size += dap_scope.entries[i].width;
+    }
+
+    FURI_LOG_I(TAG, "%zu entries in %u reads, %zu words", count, dap_scope.group_count, words);
+    return true;
+}
+
+bool dap_scope_start(uint32_t rate_hz, FuriStreamBuffer* out) {
+    if(dap_scope.status.entries == 0 || rate_hz == 0 || rate_hz > DAP_SCOPE_RATE_MAX) {
+        return false;
+    }
+    if(!dap_scope_plan()) return false;
+
+    uint8_t header[12 + DAP_SCOPE_ENTRY_MAX * 5];
+    size_t size = 0;
+    dap_put_u32(&header[size], DAP_SCOPE_MAGIC);
+    size += 4;
+    dap_put_u32(&header[size], rate_hz);
+    size += 4;
+    dap_put_u32(&header[size], dap_scope.status.entries);
+    size += 4;
+    for(size_t i = 0; i < dap_scope.status.entries; i++) {
+        dap_put_u32(&header[size], dap_scope.entries[i].address);
+        header[size + 4] = dap_scope.entries[i].width;
+        size += 5;
+    }
+    furi_stream_buffer_reset(out);
+    furi_stream_buffer_send(out, header, size, 0);
+
+    const uint32_t clock = furi_hal_cortex_instructions_per_microsecond() * 1000000;
+    dap_scope.out = out;
+    dap_scope.period = clock / rate_hz;
+    dap_scope.next = DWT->CYCCNT;
+    dap_scope.status.rate_hz = rate_hz;
+    dap_scope.status.records = 0;
+    dap_scope.status.dropped = 0;
+    dap_scope.status.errors = 0;
+    dap_scope.status.active = true;
+    return true;
+}
+
+void dap_scope_stop(void) {
+    if(dap_scope.status.active) {
+        FURI_LOG_I(
+            TAG,
+            "%lu records, %lu dropped, %lu errors",
+            dap_scope.status.records,
+            dap_scope.status.dropped,
+            dap_scope.status.errors);
+    }
+    dap_scope.status.active = false;
+}
+
+bool dap_scope_is_active(void) {
+    return dap_scope.status.active;
+}
+
+void dap_scope_get_status(DapScopeStatus* status) {
+    *status = dap_scope.status;
+}
+
+static bool dap_scope_sample(uint32_t timestamp) {
+    for(size_t i = 0; i < dap_scope.group_count; i++) {
+        const DapScopeGroup* group = &dap_scope.groups[i];
+        if(!dap_target_read_block(
+               group->address, &dap_scope_words[group->offset], group->words)) {
+            return false;
+        }
+    }
+
+    // whole records only, the host finds them by size
+    if(furi_stream_buffer_spaces_available(dap_scope.out) < dap_scope.record_size) {
+        dap_scope.status.dropped++;
+        return true;
+    }
+
+    const uint8_t* words = (const uint8_t*)dap_scope_words;
+    uint8_t* record = dap_scope_record;
+    dap_put_u32(&record[0], timestamp);
+    dap_put_u32(&record[4], dap_scope.status.dropped);
+
+    size_t size = DAP_SCOPE_RECORD_HEADER;
+    for(size_t i = 0; i < dap_scope.status.entries; i++) {
+        const DapScopeEntry* entry = &dap_scope.entries[i];
+        memcpy(&record[size], &words[entry->offset], entry->width);
+        size += entry->width;
+    }
+
+    furi_stream_buffer_send(dap_scope.out, record, size, 0);
+    dap_scope.status.records++;
+    return true;
+}
+
+uint32_t dap_scope_run(uint32_t slice_us, bool (*abort)(void* context), void* context) {
+    if(!dap_scope.status.active) return UINT32_MAX;
+
+    const uint32_t ipus = furi_hal_cortex_instructions_per_microsecond();
+    const uint32_t slice = slice_us * ipus;
+    const uint32_t start = DWT->CYCCNT;
+
+    if((int32_t)(dap_scope.next - start) > (int32_t)slice) {
+        return (dap_scope.next - start) / ipus;
+    }
+
+    DapTargetApState ap;
+    dap_target_ap_save(&ap);
+
+    bool failed = false;
+    while(DWT->CYCCNT - start < slice && !(abort && abort(context))) {
+        uint32_t now = DWT->CYCCNT;
+        if((int32_t)(dap_scope.next - now) > 0) {
+            if(dap_scope.next - start >= slice) break;
+            continue;
+        }
+
+        // after a stall restart the grid, the drop counter tells the host about the gap
+        dap_scope.next += dap_scope.period;
+        if((int32_t)(now - dap_scope.next) > 0) {
+            dap_scope.status.dropped += (now - dap_scope.next) / dap_scope.period + 1;
+            dap_scope.next = now + dap_scope.period;
+        }
+
+        if(!dap_scope_sample(now)) {
+            dap_scope.status.errors++;
+            failed = true;
+            break;
+        }
+    }
+
+    dap_target_ap_restore(&ap);
+
+    if(failed) return DAP_SCOPE_ERROR_WAIT_US;
+    int32_t wait = dap_scope.next - DWT->CYCCNT;
+    return wait > 0 ? (uint32_t)wait / ipus : 0;
+}
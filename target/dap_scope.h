@@ -0,0 +1,50 @@
+#pragma once
+#include <furi.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Live variable sampling over SWD.
+ *
+ * A list of (address, width) entries is read at a fixed rate while the
+ * target runs. Entries close to each other are fetched with one
+ * auto-increment block read. The output starts with a header (magic, rate,
+ * entry count, address and width per entry) followed by one record per
+ * sample: DWT cycle count of the probe, drop counter, then the values
+ * packed in entry order with their own widths, little endian.
+ */
+
+#define DAP_SCOPE_MAGIC 0x31435344 // "DSC1"
+#define DAP_SCOPE_ENTRY_MAX 16
+
+typedef struct {
+    bool active;
+    uint8_t entries;
+    uint32_t rate_hz;
+    uint32_t records;
+    uint32_t dropped;
+    uint32_t errors;
+} DapScopeStatus;
+
+void dap_scope_clear(void);
+
+/**
+ * Append an entry, only allowed while stopped
+ * @param width 1, 2 or 4 bytes, address aligned to it
+ */
+bool dap_scope_add(uint32_t address, uint8_t width);
+
+bool dap_scope_start(uint32_t rate_hz, FuriStreamBuffer* out);
+
+void dap_scope_stop(void);
+
+bool dap_scope_is_active(void);
+
+/**
+ * Sample for up to one slice, paced by the cycle counter.
+ * @param abort called between records, ends the slice early when it returns true
+ * @return time until the next record is due in us
+ */
+uint32_t dap_scope_run(uint32_t slice_us, bool (*abort)(void* context), void* context);
+
+void dap_scope_get_status(DapScopeStatus* status);
@@ -0,0 +1,263 @@
+#include <furi.h>
+
+#include "dap_script.h"
+#include "dap_target.h"
+#include "../dap_cmsis.h"
+
+#define TAG "DapScript"
+
+typedef struct {
+    uint16_t start;
+    uint32_t count;
+} DapScriptLoop;
+
+typedef struct {
+    uint8_t program[DAP_SCRIPT_SIZE];
+    size_t size;
+
+    DapScriptStatus status;
+    DapScriptLoop loops[DAP_SCRIPT_LOOPS];
+    size_t loop_depth;
+    uint32_t deadline;
+    bool swd;
+} DapScript;
+
+static DapScript dap_script;
+
+bool dap_script_load(size_t offset, const uint8_t* data, size_t size) {
+    if(offset == 0) dap_script.size = 0;
+    if(offset != dap_script.size || offset + size > DAP_SCRIPT_SIZE) return false;
+
+    memcpy(&dap_script.program[offset], data, size);
+    dap_script.size += size;
+    return true;
+}
+
+size_t dap_script_get_size(void) {
+    return dap_script.size;
+}
+
+void dap_script_get_status(DapScriptStatus* status) {
+    *status = dap_script.status;
+}
+
+static bool dap_script_push(uint32_t value) {
+    if(dap_script.status.depth >= DAP_SCRIPT_STACK) return false;
+    dap_script.status.stack[dap_script.status.depth++] = value;
+    return true;
+}
+
+static bool dap_script_pop(uint32_t* value) {
+    if(dap_script.status.depth == 0) return false;
+    *value = dap_script.status.stack[--dap_script.status.depth];
+    return true;
+}
+
+static bool dap_script_expired(void) {
+    return (int32_t)(furi_get_tick() - dap_script.deadline) >= 0;
+}
+
+// immediates must lie inside the program, pc moves past them
+static bool dap_script_fetch(size_t* pc, void* value, size_t size) {
+    if(*pc + size > dap_script.size) return false;
+    memcpy(value, &dap_script.program[*pc], size);
+    *pc += size;
+    return true;
+}
+
+static bool dap_script_jump(size_t* pc, int16_t offset) {
+    int32_t target = (int32_t)*pc + offset;
+    if(target < 0 || target > (int32_t)dap_script.size) return false;
+    *pc = target;
+    return true;
+}
+
+static DapScriptResult dap_script_poll(
+    uint16_t timeout_ms,
+    uint32_t address,
+    uint32_t mask,
+    uint32_t value,
+    bool (*abort)(void* context),
+    void* context) {
+    const uint32_t start = furi_get_tick();
+    uint32_t data;
+    bool matched = false;
+
+    while(true) {
+        if(!dap_target_read32(address, &data)) return DapScriptResultFault;
+        matched = (data & mask) == value;
+
+        if(matched || furi_get_tick() - start >= furi_ms_to_ticks(timeout_ms)) break;
+        if(dap_script_expired()) return DapScriptResultTimeout;
+        if(abort && abort(context)) return DapScriptResultAborted;
+        furi_delay_tick(1);
+    }
+
+    return dap_script_push(matched) ? DapScriptResultOk : DapScriptResultInvalid;
+}
+
+static DapScriptResult dap_script_delay(uint32_t us, bool (*abort)(void* context), void* context) {
+    while(us >= 1000) {
+        if(dap_script_expired()) return DapScriptResultTimeout;
+        if(abort && abort(context)) return DapScriptResultAborted;
+        furi_delay_ms(1);
+        us -= 1000;
+    }
+    if(us) furi_delay_us(us);
+    return DapScriptResultOk;
+}
+
+static DapScriptResult dap_script_step(size_t* pc, bool (*abort)(void* context), void* context) {
+    uint8_t op;
+    uint8_t ap;
+    uint8_t reg;
+    uint16_t timeout;
+    int16_t offset;
+    uint32_t a, b, c;
+
+    if(!dap_script_fetch(pc, &op, 1)) return DapScriptResultInvalid;
+
+    switch(op) {
+    case DapScriptOpFail:
+        if(!dap_script_fetch(pc, &dap_script.status.code, 1)) break;
+        return DapScriptResultFail;
+    case DapScriptOpConnect:
+        // dap_target_connect() always brings the wire up as SWD, a JTAG host would lose its chain
+        if(!dap_script.swd) break;
+        return dap_target_connect(NULL) ? DapScriptResultOk : DapScriptResultFault;
+
+    case DapScriptOpPush:
+        if(!dap_script_fetch(pc, &a, 4) || !dap_script_push(a)) break;
+        return DapScriptResultOk;
+    case DapScriptOpDrop:
+        if(!dap_script_pop(&a)) break;
+        return DapScriptResultOk;
+    case DapScriptOpDup:
+        if(!dap_script_pop(&a) || !dap_script_push(a) || !dap_script_push(a)) break;
+        return DapScriptResultOk;
+    case DapScriptOpAnd:
+    case DapScriptOpOr:
+        if(!dap_script_pop(&b) || !dap_script_pop(&a)) break;
+        dap_script_push(op == DapScriptOpAnd ? (a & b) : (a | b));
+        return DapScriptResultOk;
+
+    case DapScriptOpRead:
+        if(!dap_script_pop(&a)) break;
+        if(!dap_target_read32(a, &b)) return DapScriptResultFault;
+        dap_script_push(b);
+        return DapScriptResultOk;
+    case DapScriptOpWrite:
+        if(!dap_script_pop(&b) || !dap_script_pop(&a)) break;
+        return dap_target_write32(a, b) ? DapScriptResultOk : DapScriptResultFault;
+    case DapScriptOpDpRead:
+        if(!dap_script_fetch(pc, &reg, 1)) break;
+        if(!dap_target_dp_read(reg, &a)) return DapScriptResultFault;
+        if(!dap_script_push(a)) break;
+        return DapScriptResultOk;
+    case DapScriptOpDpWrite:
+        if(!dap_script_fetch(pc, &reg, 1) || !dap_script_pop(&a)) break;
+        return dap_target_dp_write(reg, a) ? DapScriptResultOk : DapScriptResultFault;
+    case DapScriptOpApRead:
+        if(!dap_script_fetch(pc, &ap, 1) || !dap_script_fetch(pc, &reg, 1)) break;
+        if(!dap_target_ap_read(ap, reg, &a)) return DapScriptResultFault;
+        if(!dap_script_push(a)) break;
+        return DapScriptResultOk;
+    case DapScriptOpApWrite:
+        if(!dap_script_fetch(pc, &ap, 1) || !dap_script_fetch(pc, &reg, 1) ||
+           !dap_script_pop(&a)) {
+            break;
+        }
+        return dap_target_ap_write(ap, reg, a) ? DapScriptResultOk : DapScriptResultFault;
+    case DapScriptOpPoll:
+        if(!dap_script_fetch(pc, &timeout, 2) || !dap_script_pop(&c) || !dap_script_pop(&b) ||
+           !dap_script_pop(&a)) {
+            break;
+        }
+        return dap_script_poll(timeout, a, b, c, abort, context);
+    case DapScriptOpDelay:
+        if(!dap_script_fetch(pc, &a, 4)) break;
+        return dap_script_delay(a, abort, context);
+
+    case DapScriptOpJump:
+        if(!dap_script_fetch(pc, &offset, 2) || !dap_script_jump(pc, offset)) break;
+        return DapScriptResultOk;
+    case DapScriptOpJumpZero:
+        if(!dap_script_fetch(pc, &offset, 2) || !dap_script_pop(&a)) break;
+        if(a == 0 && !dap_script_jump(pc, offset)) break;
+        return DapScriptResultOk;
+    case DapScriptOpJumpEqual:
+        if(!dap_script_fetch(pc, &b, 4) || !dap_script_fetch(pc, &offset, 2) ||
+           !dap_script_pop(&a)) {
+            break;
+        }
+        if(a == b && !dap_script_jump(pc, offset)) break;
+        return DapScriptResultOk;
+    case DapScriptOpLoop:
+        if(!dap_script_fetch(pc, &offset, 2) || !dap_script_pop(&a)) break;
+        if(a == 0) {
+            if(!dap_script_jump(pc, offset)) break;
+            return DapScriptResultOk;
+        }
+        if(dap_script.loop_depth >= DAP_SCRIPT_LOOPS) break;
+        dap_script.loops[dap_script.loop_depth].start = *pc;
+        dap_script.loops[dap_script.loop_depth].count = a;
+        dap_script.loop_depth++;
+        return DapScriptResultOk;
+    case DapScriptOpNext: {
+        if(dap_script.loop_depth == 0) break;
+        DapScriptLoop* loop = &dap_script.loops[dap_script.loop_depth - 1];
+        if(--loop->count) {
+            *pc = loop->start;
+        } else {
+            dap_script.loop_depth--;
+        }
+        return DapScriptResultOk;
+    }
+    }
+
+    return DapScriptResultInvalid;
+}
+
+DapScriptResult dap_script_run(
+    const uint32_t* args,
+    size_t count,
+    uint32_t timeout_ms,
+    bool swd,
+    bool (*abort)(void* context),
+    void* context) {
+    DapScriptStatus* status = &dap_script.status;
+    memset(status, 0, sizeof(DapScriptStatus));
+    dap_script.loop_depth = 0;
+    dap_script.swd = swd;
+    dap_script.deadline =
+        furi_get_tick() + furi_ms_to_ticks(MIN(timeout_ms, (uint32_t)DAP_SCRIPT_TIMEOUT_MAX_MS));
+
+    status->result = DapScriptResultOk;
+    for(size_t i = 0; i < count && status->result == DapScriptResultOk; i++) {
+        if(!dap_script_push(args[i])) status->result = DapScriptResultInvalid;
+    }
+
+    size_t pc = 0;
+    while(status->result == DapScriptResultOk) {
+        // running off the end is the same as End
+        if(pc == dap_script.size) break;
+        if(status->steps >= DAP_SCRIPT_STEP_MAX || dap_script_expired()) {
+            status->result = DapScriptResultTimeout;
+            break;
+        }
+        if(abort && abort(context)) {
+            status->result = DapScriptResultAborted;
+            break;
+        }
+
+        status->pc = pc;
+        if(dap_script.program[pc] == DapScriptOpEnd) break;
+        status->steps++;
+        status->result = dap_script_step(&pc, abort, context);
+    }
+
+    if(status->result != DapScriptResultOk) {
+        FURI_LOG_W(TAG, "Stopped at %u with %d", status->pc, status->result);
+    }
+    return status->result;
+}
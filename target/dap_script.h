@@ -0,0 +1,85 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Bytecode interpreter for vendor connect, unlock and init sequences.
+ *
+ * A stack machine over the target access layer: immediates follow the
+ * opcode little endian, branch offsets are signed and relative to the next
+ * instruction. The stack and loop depth are fixed, every run is bounded by
+ * a step budget and a deadline. Arguments are pushed before the first
+ * instruction, the stack is returned as the result.
+ */
+
+#define DAP_SCRIPT_SIZE 512
+#define DAP_SCRIPT_STACK 12
+#define DAP_SCRIPT_LOOPS 4
+#define DAP_SCRIPT_STEP_MAX 100000
+#define DAP_SCRIPT_TIMEOUT_MAX_MS 10000
+
+typedef enum {
+    DapScriptOpEnd = 0x00, // stop successfully
+    DapScriptOpFail = 0x01, // code u8, stop with an error code
+    DapScriptOpConnect = 0x02, // SWD line reset and debug power-up, invalid in JTAG mode
+    DapScriptOpPush = 0x10, // value u32
+    DapScriptOpDrop = 0x11,
+    DapScriptOpDup = 0x12,
+    DapScriptOpAnd = 0x13, // a b -> a & b
+    DapScriptOpOr = 0x14, // a b -> a | b
+    DapScriptOpRead = 0x20, // address -> value
+    DapScriptOpWrite = 0x21, // address value ->
+    DapScriptOpDpRead = 0x22, // reg u8, -> value
+    DapScriptOpDpWrite = 0x23, // reg u8, value ->
+    DapScriptOpApRead = 0x24, // ap u8, reg u8, -> value
+    DapScriptOpApWrite = 0x25, // ap u8, reg u8, value ->
+    DapScriptOpPoll = 0x26, // timeout_ms u16, address mask value -> 1 on match, 0 on timeout
+    DapScriptOpDelay = 0x27, // us u32
+    DapScriptOpJump = 0x30, // offset s16
+    DapScriptOpJumpZero = 0x31, // offset s16, value ->
+    DapScriptOpJumpEqual = 0x32, // compare u32, offset s16, value ->
+    DapScriptOpLoop = 0x33, // end s16, count -> , body up to Next runs count times
+    DapScriptOpNext = 0x34,
+} DapScriptOp;
+
+typedef enum {
+    DapScriptResultOk,
+    DapScriptResultFail, // the script gave up, see code
+    DapScriptResultFault, // target access failed
+    DapScriptResultTimeout,
+    DapScriptResultAborted,
+    DapScriptResultInvalid, // bad opcode, jump or stack/loop over- or underflow
+} DapScriptResult;
+
+typedef struct {
+    DapScriptResult result;
+    uint8_t code;
+    uint16_t pc;
+    uint32_t steps;
+    uint8_t depth;
+    uint32_t stack[DAP_SCRIPT_STACK];
+} DapScriptStatus;
+
+/**
+ * Store part of a script, offset 0 starts a new one
+ */
+bool dap_script_load(size_t offset, const uint8_t* data, size_t size);
+
+size_t dap_script_get_size(void);
+
+/**
+ * @param args pushed in order before the first instruction
+ * @param swd the probe is in SWD mode, Connect switches the wire to SWD and is
+ *            rejected otherwise
+ * @param abort polled between instructions and while waiting
+ */
+DapScriptResult dap_script_run(
+    const uint32_t* args,
+    size_t count,
+    uint32_t timeout_ms,
+    bool swd,
+    bool (*abort)(void* context),
+    void* context);
+
+void dap_script_get_status(DapScriptStatus* status);
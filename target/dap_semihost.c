@@ -0,0 +1,236 @@
+#include "dap_semihost.h"
+#include "dap_target.h"
+
+#define TAG "DapSemihost"
+
+#define DAP_SEMIHOST_INTERVAL_MAX_MS 16
+#define DAP_SEMIHOST_WAIT_MS 10
+#define DAP_SEMIHOST_CHUNK_SIZE 256
+
+// Thumb BKPT 0xAB
+#define DAP_SEMIHOST_BKPT 0xBEAB
+
+#define DAP_SEMIHOST_SYS_OPEN 0x01
+#define DAP_SEMIHOST_SYS_CLOSE 0x02
+#define DAP_SEMIHOST_SYS_WRITEC 0x03
+#define DAP_SEMIHOST_SYS_WRITE0 0x04
+#define DAP_SEMIHOST_SYS_WRITE 0x05
+#define DAP_SEMIHOST_SYS_READ 0x06
+#define DAP_SEMIHOST_SYS_READC 0x07
+#define DAP_SEMIHOST_SYS_ISTTY 0x09
+
+// ":tt" opened for reading, writing and appending
+#define DAP_SEMIHOST_HANDLE_STDIN 1
+#define DAP_SEMIHOST_HANDLE_STDOUT 2
+#define DAP_SEMIHOST_HANDLE_STDERR 3
+
+typedef enum {
+    DapSemihostResultDone, // r0 holds the return value, resume
+    DapSemihostResultWait, // console full or no input yet, poll again later
+    DapSemihostResultHost, // not a console call, leave it to the host
+    DapSemihostResultError,
+} DapSemihostResult;
+
+static DapSemihostStatus dap_semihost;
+static uint8_t dap_semihost_chunk[DAP_SEMIHOST_CHUNK_SIZE];
+
+void dap_semihost_start(void) {
+    memset(&dap_semihost, 0, sizeof(DapSemihostStatus));
+    dap_semihost.active = true;
+    dap_semihost.interval_ms = 1;
+}
+
+void dap_semihost_stop(void) {
+    dap_semihost.active = false;
+}
+
+bool dap_semihost_is_active(void) {
+    return dap_semihost.active;
+}
+
+void dap_semihost_get_status(DapSemihostStatus* status) {
+    *status = dap_semihost;
+}
+
+static bool dap_semihost_is_console(uint32_t handle) {
+    return handle >= DAP_SEMIHOST_HANDLE_STDIN && handle <= DAP_SEMIHOST_HANDLE_STDERR;
+}
+
+static bool dap_semihost_write0(FuriStreamBuffer* up, uint32_t address) {
+    while(true) {
+        // stay inside the current 1 KB page, the string may end right before unmapped memory
+        size_t chunk = MIN(sizeof(dap_semihost_chunk), 0x400 - (address & 0x3FF));
+        if(!dap_target_read_bytes(address, dap_semihost_chunk, chunk)) return false;
+
+        // no partial result exists for this call, what does not fit is dropped
+        uint8_t* end = memchr(dap_semihost_chunk, 0, chunk);
+        size_t size = end ? (size_t)(end - dap_semihost_chunk) : chunk;
+        furi_stream_buffer_send(up, dap_semihost_chunk, size, 0);
+        if(end) return true;
+        address += chunk;
+    }
+}
+
+static DapSemihostResult dap_semihost_call(
+    uint32_t op,
+    uint32_t param,
+    FuriStreamBuffer* up,
+    FuriStreamBuffer* down,
+    uint32_t* result) {
+    uint32_t args[3];
+
+    switch(op) {
+    case DAP_SEMIHOST_SYS_OPEN: {
+        // only the console, ":tt" with mode 0-3 read, 4-7 write, 8-11 append
+        char name[4];
+        if(!dap_target_read_block(param, args, 3) ||
+           !dap_target_read_bytes(args[0], (uint8_t*)name, sizeof(name))) {
+            return DapSemihostResultError;
+        }
+        if(args[2] != 3 || memcmp(name, ":tt", sizeof(name)) != 0) return DapSemihostResultHost;
+        *result = DAP_SEMIHOST_HANDLE_STDIN + MIN(args[1] / 4, 2UL);
+        return DapSemihostResultDone;
+    }
+    case DAP_SEMIHOST_SYS_CLOSE:
+    case DAP_SEMIHOST_SYS_ISTTY:
+        if(!dap_target_read32(param, &args[0])) return DapSemihostResultError;
+        if(!dap_semihost_is_console(args[0])) return DapSemihostResultHost;
+        *result = op == DAP_SEMIHOST_SYS_ISTTY ? 1 : 0;
+        return DapSemihostResultDone;
+    case DAP_SEMIHOST_SYS_WRITEC: {
+        uint8_t c;
+        if(furi_stream_buffer_spaces_available(up) == 0) return DapSemihostResultWait;
+        if(!dap_target_read_bytes(param, &c, 1)) return DapSemihostResultError;
+        furi_stream_buffer_send(up, &c, 1, 0);
+        *result = 0;
+        return DapSemihostResultDone;
+    }
+    case DAP_SEMIHOST_SYS_WRITE0:
+        if(!dap_semihost_write0(up, param)) return DapSemihostResultError;
+        *result = 0;
+        return DapSemihostResultDone;
+    case DAP_SEMIHOST_SYS_WRITE: {
+        // handle, buffer, length, returns the number of bytes not written
+        if(!dap_target_read_block(param, args, 3)) return DapSemihostResultError;
+        if(!dap_semihost_is_console(args[0])) return DapSemihostResultHost;
+
+        // a short write makes the C library call again for the rest
+        size_t size = MIN(args[2], sizeof(dap_semihost_chunk));
+        size = MIN(size, furi_stream_buffer_spaces_available(up));
+        if(size == 0 && args[2] > 0) return DapSemihostResultWait;
+        if(!dap_target_read_bytes(args[1], dap_semihost_chunk, size)) {
+            return DapSemihostResultError;
+        }
+        furi_stream_buffer_send(up, dap_semihost_chunk, size, 0);
+        *result = args[2] - size;
+        return DapSemihostResultDone;
+    }
+    case DAP_SEMIHOST_SYS_READ: {
+        // handle, buffer, length, returns the number of bytes not read
+        if(!dap_target_read_block(param, args, 3)) return DapSemihostResultError;
+        if(!dap_semihost_is_console(args[0])) return DapSemihostResultHost;
+        if(args[2] == 0) {
+            *result = 0;
+            return DapSemihostResultDone;
+        }
+
+        size_t size = MIN(args[2], sizeof(dap_semihost_chunk));
+        size = furi_stream_buffer_receive(down, dap_semihost_chunk, size, 0);
+        if(size == 0) return DapSemihostResultWait;
+        if(!dap_target_write_bytes(args[1], dap_semihost_chunk, size)) {
+            return DapSemihostResultError;
+        }
+        *result = args[2] - size;
+        return DapSemihostResultDone;
+    }
+    case DAP_SEMIHOST_SYS_READC: {
+        uint8_t c;
+        if(furi_stream_buffer_receive(down, &c, 1, 0) == 0) return DapSemihostResultWait;
+        *result = c;
+        return DapSemihostResultDone;
+    }
+    default:
+        return DapSemihostResultHost;
+    }
+}
+
+// returns false if the core is not halted on a semihosting breakpoint
+static bool dap_semihost_check(uint32_t dhcsr, uint32_t* pc) {
+    uint32_t dfsr, opcode;
+    uint16_t bkpt;
+    if(!(dhcsr & DAP_TARGET_DHCSR_S_HALT)) return false;
+    if(!dap_target_read32(DAP_TARGET_DFSR, &dfsr) || !(dfsr & DAP_TARGET_DFSR_BKPT)) {
+        return false;
+    }
+    if(!dap_target_read_reg(DAP_TARGET_REG_PC, pc)) return false;
+
+    if(!dap_target_read32(*pc & ~3UL, &opcode)) return false;
+    bkpt = (*pc & 2) ? opcode >> 16 : opcode & 0xFFFF;
+    return bkpt == DAP_SEMIHOST_BKPT;
+}
+
+static DapSemihostResult dap_semihost_service(FuriStreamBuffer* up, FuriStreamBuffer* down) {
+    uint32_t dhcsr, pc, op, param, result = 0;
+
+    if(!dap_target_read32(DAP_TARGET_DHCSR, &dhcsr)) return DapSemihostResultError;
+    dap_semihost.attached = true;
+
+    // BKPT escalates to HardFault unless halting debug is enabled
+    if(!(dhcsr & DAP_TARGET_DHCSR_C_DEBUGEN)) {
+        dap_target_write32(DAP_TARGET_DHCSR, DAP_TARGET_DHCSR_DBGKEY | DAP_TARGET_DHCSR_C_DEBUGEN);
+        return DapSemihostResultHost;
+    }
+
+    if(!dap_semihost_check(dhcsr, &pc)) return DapSemihostResultHost;
+    if(!dap_target_read_reg(DAP_TARGET_REG_R0, &op) ||
+       !dap_target_read_reg(DAP_TARGET_REG_R0 + 1, &param)) {
+        return DapSemihostResultError;
+    }
+
+    DapSemihostResult status = dap_semihost_call(op, param, up, down, &result);
+    dap_semihost.last_op = op;
+    if(status != DapSemihostResultDone) {
+        if(status == DapSemihostResultHost) dap_semihost.unhandled++;
+        return status;
+    }
+
+    // step over the BKPT and continue
+    if(!dap_target_write_reg(DAP_TARGET_REG_R0, result) ||
+       !dap_target_write_reg(DAP_TARGET_REG_PC, pc + 2) ||
+       !dap_target_write32(DAP_TARGET_DFSR, DAP_TARGET_DFSR_CLEAR) ||
+       !dap_target_resume(dhcsr & DAP_TARGET_DHCSR_C_MASKINTS)) {
+        return DapSemihostResultError;
+    }
+
+    dap_semihost.calls++;
+    return DapSemihostResultDone;
+}
+
+uint32_t dap_semihost_poll(FuriStreamBuffer* up, FuriStreamBuffer* down) {
+    if(!dap_semihost.active) return FuriWaitForever;
+
+    DapTargetApState ap;
+    dap_target_ap_save(&ap);
+
+    switch(dap_semihost_service(up, down)) {
+    case DapSemihostResultDone:
+        // calls come in bursts, look again right away
+        dap_semihost.interval_ms = 0;
+        break;
+    case DapSemihostResultWait:
+        dap_semihost.interval_ms = DAP_SEMIHOST_WAIT_MS;
+        break;
+    case DapSemihostResultHost:
+        dap_semihost.interval_ms = dap_semihost.interval_ms ? dap_semihost.interval_ms * 2 : 1;
+        dap_semihost.interval_ms =
+            MIN(dap_semihost.interval_ms, (uint32_t)DAP_SEMIHOST_INTERVAL_MAX_MS);
+        break;
+    case DapSemihostResultError:
+        dap_semihost.attached = false;
+        dap_semihost.interval_ms = DAP_SEMIHOST_INTERVAL_MAX_MS;
+        break;
+    }
+
+    dap_target_ap_restore(&ap);
+    return dap_semihost.interval_ms;
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <furi.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * ARM semihosting console serviced by the probe.
+ *
+ * DHCSR is polled between host commands. A core halted on BKPT 0xAB with a
+ * console operation in r0 is serviced against the streams and resumed right
+ * away, without a host round trip. Anything else (file I/O, plain
+ * breakpoints) stays halted for the host debugger to handle.
+ */
+
+typedef struct {
+    bool active;
+    bool attached; // last DHCSR poll succeeded
+    uint32_t interval_ms;
+    uint32_t calls; // serviced operations
+    uint32_t unhandled; // halts left to the host
+    uint32_t last_op;
+} DapSemihostStatus;
+
+void dap_semihost_start(void);
+
+void dap_semihost_stop(void);
+
+bool dap_semihost_is_active(void);
+
+/**
+ * Check for a semihosting halt and service it.
+ * @param up receives console output of the target
+ * @param down holds console input for the target
+ * @return delay until the next poll in ms
+ */
+uint32_t dap_semihost_poll(FuriStreamBuffer* up, FuriStreamBuffer* down);
+
+void dap_semihost_get_status(DapSemihostStatus* status);
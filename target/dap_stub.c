@@ -0,0 +1,190 @@
+#include <furi.h>
+#include <furi_hal_cortex.h>
+
+#include "dap_stub.h"
+#include "dap_target.h"
+
+#define TAG "DapStub"
+
+#define DAP_STUB_CPUID 0xE000ED00
+#define DAP_STUB_CPUID_PARTNO(cpuid) (((cpuid) >> 4) & 0xFFF)
+
+#define DAP_STUB_HALT_TIMEOUT_US 100000
+
+typedef struct {
+    uint16_t partno;
+    const char* name;
+} DapStubCore;
+
+static const DapStubCore dap_stub_cores[] = {
+    {0xC20, "Cortex-M0"},
+    {0xC60, "Cortex-M0+"},
+    {0xC23, "Cortex-M3"},
+    {0xC24, "Cortex-M4"},
+    {0xC27, "Cortex-M7"},
+    {0xD20, "Cortex-M23"},
+    {0xD21, "Cortex-M33"},
+};
+
+// Registers clobbered by a stub run, restored afterwards
+static const uint8_t dap_stub_saved_regs[] = {
+    0, 1, 2, 3, 4, 5, DAP_TARGET_REG_SP, DAP_TARGET_REG_PC, DAP_TARGET_REG_XPSR};
+
+/*
+ * r0 = address, r1 = length, r2 = 0xFFFFFFFF, returns r0 = CRC32
+ *
+ * 0x00 ldr   r3, [pc, #28]     ; poly
+ * 0x02 cmp   r1, #0
+ * 0x04 beq   0x1C
+ * 0x06 ldrb  r4, [r0]
+ * 0x08 adds  r0, #1
+ * 0x0A eors  r2, r4
+ * 0x0C movs  r5, #8
+ * 0x0E lsrs  r2, r2, #1
+ * 0x10 bcc   0x14
+ * 0x12 eors  r2, r3
+ * 0x14 subs  r5, #1
+ * 0x16 bne   0x0E
+ * 0x18 subs  r1, #1
+ * 0x1A b     0x02
+ * 0x1C mvns  r0, r2
+ * 0x1E bkpt  #0
+ * 0x20 .word 0xEDB88320
+ */
+static const uint32_t dap_stub_crc32_image[] = {
+    0x29004B07,
+    0x7804D00A,
+    0x40623001,
+    0x08522508,
+    0x405AD300,
+    0xD1FA3D01,
+    0xE7F23901,
+    0xBE0043D0,
+    0xEDB88320,
+};
+
+static const DapStub dap_stub_crc32_stub = {
+    .image = dap_stub_crc32_image,
+    .words = COUNT_OF(dap_stub_crc32_image),
+    .exit_offset = 0x1E,
+};
+
+static DapStubExecuteHook dap_stub_execute_hook = NULL;
+static void* dap_stub_execute_context = NULL;
+
+void dap_stub_set_execute_hook(DapStubExecuteHook hook, void* context) {
+    dap_stub_execute_hook = hook;
+    dap_stub_execute_context = context;
+}
+
+bool dap_stub_is_supported(void) {
+    uint32_t cpuid;
+    if(!dap_target_read32(DAP_STUB_CPUID, &cpuid)) return false;
+
+    for(size_t i = 0; i < COUNT_OF(dap_stub_cores); i++) {
+        if(dap_stub_cores[i].partno == DAP_STUB_CPUID_PARTNO(cpuid)) {
+            FURI_LOG_D(TAG, "Core %s", dap_stub_cores[i].name);
+            return true;
+        }
+    }
+
+    FURI_LOG_W(TAG, "Unsupported core, CPUID %08lX", cpuid);
+    return false;
+}
+
+static bool dap_stub_execute(
+    const DapStub* stub,
+    uint32_t workarea,
+    uint32_t args[DAP_STUB_ARG_COUNT],
+    uint32_t timeout_us) {
+    bool halted = false;
+    if(dap_stub_execute_hook) {
+        if(!dap_stub_execute_hook(dap_stub_execute_context, timeout_us, &halted)) return false;
+    } else {
+        if(!dap_target_resume(true)) return false;
+
+        FuriHalCortexTimer timer = furi_hal_cortex_timer_get(timeout_us);
+        do {
+            if(!dap_target_is_halted(&halted)) return false;
+        } while(!halted && !furi_hal_cortex_timer_is_expired(timer));
+    }
+
+    if(!halted) {
+        FURI_LOG_W(TAG, "Stub timeout");
+        dap_target_halt(DAP_STUB_HALT_TIMEOUT_US);
+        return false;
+    }
+
+    // anything but the final BKPT is a fault or a stray breakpoint
+    uint32_t pc;
+    if(!dap_target_read_reg(DAP_TARGET_REG_PC, &pc) || pc != workarea + stub->exit_offset) {
+        FURI_LOG_W(TAG, "Stub stopped at %08lX", pc);
+        return false;
+    }
+
+    for(size_t i = 0; i < DAP_STUB_ARG_COUNT; i++) {
+        if(!dap_target_read_reg(DAP_TARGET_REG_R0 + i, &args[i])) return false;
+    }
+
+    return true;
+}
+
+bool dap_stub_run(
+    const DapStub* stub,
+    uint32_t workarea,
+    uint32_t args[DAP_STUB_ARG_COUNT],
+    uint32_t timeout_us) {
+    furi_assert((workarea & 3) == 0);
+    furi_assert(stub->words * 4 < DAP_STUB_WORKAREA_SIZE);
+
+    uint32_t saved[COUNT_OF(dap_stub_saved_regs)];
+    bool was_halted = false;
+
+    if(!dap_target_is_halted(&was_halted)) return false;
+    if(!was_halted && !dap_target_halt(DAP_STUB_HALT_TIMEOUT_US)) return false;
+
+    bool ok = true;
+    for(size_t i = 0; ok && i < COUNT_OF(dap_stub_saved_regs); i++) {
+        ok = dap_target_read_reg(dap_stub_saved_regs[i], &saved[i]);
+    }
+
+    if(ok) {
+        uint32_t stack = (workarea + DAP_STUB_WORKAREA_SIZE) & ~7UL;
+        ok = dap_target_write_block(workarea, stub->image, stub->words) &&
+             dap_target_write_reg(DAP_TARGET_REG_SP, stack) &&
+             dap_target_write_reg(DAP_TARGET_REG_PC, workarea) &&
+             dap_target_write_reg(DAP_TARGET_REG_XPSR, DAP_TARGET_XPSR_THUMB);
+        for(size_t i = 0; ok && i < DAP_STUB_ARG_COUNT; i++) {
+            ok = dap_target_write_reg(DAP_TARGET_REG_R0 + i, args[i]);
+        }
+
+        ok = ok && dap_stub_execute(stub, workarea, args, timeout_us);
+
+        // leave the core exactly as we found it, even after a failed run
+        dap_target_write32(
+            DAP_TARGET_DHCSR,
+            DAP_TARGET_DHCSR_DBGKEY | DAP_TARGET_DHCSR_C_DEBUGEN | DAP_TARGET_DHCSR_C_HALT);
+        dap_target_write32(DAP_TARGET_DFSR, DAP_TARGET_DFSR_CLEAR);
+        for(size_t i = 0; i < COUNT_OF(dap_stub_saved_regs); i++) {
+            dap_target_write_reg(dap_stub_saved_regs[i], saved[i]);
+        }
+    }
+
+    if(!was_halted) dap_target_resume(false);
+
+    return ok;
+}
+
+bool dap_stub_crc32(
+    uint32_t workarea,
+    uint32_t address,
+    uint32_t length,
+    uint32_t timeout_us,
+    uint32_t* crc) {
+    uint32_t args[DAP_STUB_ARG_COUNT] = {address, length, 0xFFFFFFFF, 0};
+
+    if(!dap_stub_run(&dap_stub_crc32_stub, workarea, args, timeout_us)) return false;
+
+    *crc = args[0];
+    return true;
+}
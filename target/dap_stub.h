@@ -0,0 +1,59 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Target-executed helpers.
+ *
+ * A stub is a small position independent Thumb-1 routine that is loaded into
+ * a RAM work area, started with its arguments in r0..r3 and ends with BKPT.
+ * Thumb-1 keeps one image valid for every ARMv6-M, ARMv7-M and ARMv8-M core.
+ * The core is halted for the duration and its registers are restored after.
+ */
+
+#define DAP_STUB_ARG_COUNT 4
+
+// image plus stack for a fault handler entry, target RAM must be this large
+#define DAP_STUB_WORKAREA_SIZE 0x80
+
+typedef struct {
+    const uint32_t* image;
+    size_t words;
+    uint32_t exit_offset; // offset of the final BKPT
+} DapStub;
+
+/**
+ * Replaces "resume and poll for the halt" with a simulated core, the BKPT
+ * check and everything around it still run against the target layer.
+ * @param halted set if the core stopped within timeout_us
+ * @return false to report a target access error
+ */
+typedef bool (*DapStubExecuteHook)(void* context, uint32_t timeout_us, bool* halted);
+
+void dap_stub_set_execute_hook(DapStubExecuteHook hook, void* context);
+
+/**
+ * Check CPUID against the cores the stub library was validated on
+ */
+bool dap_stub_is_supported(void);
+
+/**
+ * Load and run a stub on the halted target.
+ * @param args r0..r3 on entry, r0..r3 when the stub hits its BKPT
+ */
+bool dap_stub_run(
+    const DapStub* stub,
+    uint32_t workarea,
+    uint32_t args[DAP_STUB_ARG_COUNT],
+    uint32_t timeout_us);
+
+/**
+ * zlib-compatible CRC32 of target memory, computed by the target itself
+ */
+bool dap_stub_crc32(
+    uint32_t workarea,
+    uint32_t address,
+    uint32_t length,
+    uint32_t timeout_us,
+    uint32_t* crc);
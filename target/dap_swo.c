@@ -0,0 +1,395 @@
+#include <furi.h>
+#include <furi_hal_uart.h>
+#include <furi_hal_console.h>
+#include <stm32wbxx_ll_bus.h>
+#include <stm32wbxx_ll_dma.h>
+#include <stm32wbxx_ll_rcc.h>
+#include <stm32wbxx_ll_tim.h>
+#include <stm32wbxx_ll_usart.h>
+#include <stm32wbxx_ll_lpuart.h>
+
+#include "dap_swo.h"
+#include "../dap_config.h"
+#include "../helpers/dap_manchester.h"
+#include "../helpers/dap_uart_dma.h"
+
+#define TAG "DapSwo"
+
+#define DAP_SWO_DMA_CHANNEL DAP_UART_DMA_CHANNEL_SWO
+
+#define DAP_SWO_BUFFER_MASK (DAP_SWO_BUFFER_SIZE - 1)
+
+// Manchester edges are captured by TIM2 channel 2 on the TDO pin
+#define DAP_SWO_EDGE_COUNT 4096
+#define DAP_SWO_DECODE_CHUNK 256
+#define DAP_SWO_MANCHESTER_RATE_MAX 2000000
+#define DAP_SWO_MANCHESTER_RATE_MIN 1000
+
+// LPUART BRR limits at the prescaler of 1
+#define DAP_SWO_LPUART_BRR_MIN 0x300
+#define DAP_SWO_LPUART_BRR_MAX 0xFFFFF
+
+typedef struct {
+    DapSwoUart uart;
+    DapSwoTransport transport;
+    DapSwoMode mode;
+    uint32_t baudrate;
+    bool active;
+    uint8_t status;
+
+    // the DMA ring in UART mode, decoded bytes in Manchester mode
+    uint8_t* buffer;
+    uint32_t head; // bytes decoded since the start
+    uint32_t tail; // bytes handed to the host
+
+    DapSwoCallback callback;
+    void* context;
+
+    uint32_t* edges; // the DMA ring in Manchester mode
+    DapManchester manchester;
+} DapSwo;
+
+static DapSwo dap_swo = {
+    .uart = DapSwoUartUsart1,
+};
+
+static void dap_swo_dma_callback(void* context) {
+    UNUSED(context);
+    // decoding and streaming happen in the caller's thread
+    if(dap_swo.callback) dap_swo.callback(dap_swo.context);
+}
+
+static FuriHalUartId dap_swo_uart_id(void) {
+    return dap_swo.uart == DapSwoUartUsart1 ? FuriHalUartIdUSART1 : FuriHalUartIdLPUART1;
+}
+
+static void dap_swo_take_uart(void) {
+    if(dap_swo.uart == DapSwoUartUsart1) furi_hal_console_disable();
+    furi_hal_uart_deinit(dap_swo_uart_id());
+    furi_hal_uart_init(dap_swo_uart_id(), 115200);
+    // the DMA reads RDR, the byte interrupt would race it
+    furi_hal_uart_set_irq_cb(dap_swo_uart_id(), NULL, NULL);
+}
+
+static void dap_swo_release_uart(void) {
+    furi_hal_uart_deinit(dap_swo_uart_id());
+    if(dap_swo.uart == DapSwoUartUsart1) furi_hal_console_init();
+}
+
+static uint32_t dap_swo_usart_baudrate(uint32_t baudrate) {
+    const uint32_t clock = LL_RCC_GetUSARTClockFreq(LL_RCC_USART1_CLKSOURCE);
+    if(baudrate < clock / 0xFFFF || baudrate > clock / 8) return 0;
+
+    // 8x oversampling doubles the top rate at the cost of noise immunity
+    const uint32_t oversampling = baudrate > clock / 16 ? LL_USART_OVERSAMPLING_8 :
+                                                          LL_USART_OVERSAMPLING_16;
+    LL_USART_Disable(USART1);
+    LL_USART_SetOverSampling(USART1, oversampling);
+    LL_USART_SetBaudRate(USART1, clock, LL_USART_PRESCALER_DIV1, oversampling, baudrate);
+    LL_USART_Enable(USART1);
+    return LL_USART_GetBaudRate(USART1, clock, LL_USART_PRESCALER_DIV1, oversampling);
+}
+
+static uint32_t dap_swo_lpuart_baudrate(uint32_t baudrate) {
+    if(baudrate == 0) return 0;
+    const uint32_t clock = LL_RCC_GetLPUARTClockFreq(LL_RCC_LPUART1_CLKSOURCE);
+    const uint64_t brr = ((uint64_t)clock * 256 + baudrate / 2) / baudrate;
+    if(brr < DAP_SWO_LPUART_BRR_MIN || brr > DAP_SWO_LPUART_BRR_MAX) return 0;
+
+    LL_LPUART_Disable(LPUART1);
+    LL_LPUART_SetPrescaler(LPUART1, LL_LPUART_PRESCALER_DIV1);
+    LL_LPUART_SetBaudRate(LPUART1, clock, LL_LPUART_PRESCALER_DIV1, baudrate);
+    LL_LPUART_Enable(LPUART1);
+    return LL_LPUART_GetBaudRate(LPUART1, clock, LL_LPUART_PRESCALER_DIV1);
+}
+
+static void dap_swo_uart_start(void) {
+    dap_uart_dma_start(
+        DAP_SWO_DMA_CHANNEL,
+        dap_swo_uart_id(),
+        dap_swo.buffer,
+        DAP_SWO_BUFFER_SIZE,
+        dap_swo_dma_callback,
+        NULL);
+}
+
+static void dap_swo_take_timer(void) {
+    flipper_dap_tdo_swo = true;
+    furi_hal_gpio_init_ex(
+        &flipper_dap_tdo_pin,
+        GpioModeAltFunctionPushPull,
+        GpioPullDown,
+        GpioSpeedVeryHigh,
+        GpioAltFn1TIM2);
+
+    LL_APB1_GRP1_EnableClock(LL_APB1_GRP1_PERIPH_TIM2);
+    LL_TIM_DeInit(TIM2);
+    LL_TIM_SetPrescaler(TIM2, 0);
+    LL_TIM_SetAutoReload(TIM2, 0xFFFFFFFF);
+    LL_TIM_IC_SetActiveInput(TIM2, LL_TIM_CHANNEL_CH2, LL_TIM_ACTIVEINPUT_DIRECTTI);
+    LL_TIM_IC_SetPrescaler(TIM2, LL_TIM_CHANNEL_CH2, LL_TIM_ICPSC_DIV1);
+    LL_TIM_IC_SetFilter(TIM2, LL_TIM_CHANNEL_CH2, LL_TIM_IC_FILTER_FDIV1);
+    LL_TIM_IC_SetPolarity(TIM2, LL_TIM_CHANNEL_CH2, LL_TIM_IC_POLARITY_BOTHEDGE);
+    LL_TIM_CC_EnableChannel(TIM2, LL_TIM_CHANNEL_CH2);
+}
+
+static void dap_swo_release_timer(void) {
+    LL_TIM_DeInit(TIM2);
+    LL_APB1_GRP1_DisableClock(LL_APB1_GRP1_PERIPH_TIM2);
+    furi_hal_gpio_init(&flipper_dap_tdo_pin, GpioModeInput, GpioPullNo, GpioSpeedVeryHigh);
+    flipper_dap_tdo_swo = false;
+}
+
+static void dap_swo_timer_start(void) {
+    dap_manchester_reset(&dap_swo.manchester, furi_hal_gpio_read(&flipper_dap_tdo_pin));
+
+    dap_uart_dma_start_register(
+        DAP_SWO_DMA_CHANNEL,
+        LL_DMAMUX_REQ_TIM2_CH2,
+        (uint32_t)&TIM2->CCR2,
+        dap_swo.edges,
+        DAP_SWO_EDGE_COUNT,
+        sizeof(uint32_t),
+        dap_swo_dma_callback,
+        NULL);
+    LL_TIM_EnableDMAReq_CC2(TIM2);
+    LL_TIM_SetCounter(TIM2, 0);
+    LL_TIM_EnableCounter(TIM2);
+}
+
+static void dap_swo_timer_stop(void) {
+    LL_TIM_DisableCounter(TIM2);
+    LL_TIM_DisableDMAReq_CC2(TIM2);
+    dap_uart_dma_stop(DAP_SWO_DMA_CHANNEL);
+
+    FURI_LOG_I(
+        TAG,
+        "Manchester at %lu bit/s, %lu frames, %lu errors",
+        dap_manchester_get_rate(&dap_swo.manchester, SystemCoreClock),
+        dap_swo.manchester.frames,
+        dap_swo.manchester.errors);
+}
+
+// decoded bytes that don't fit are dropped, the unread ones stay intact
+static void dap_swo_push(const uint8_t* data, size_t size) {
+    for(size_t i = 0; i < size; i++) {
+        if(dap_swo.head - dap_swo.tail == DAP_SWO_BUFFER_SIZE) {
+            dap_swo.status |= DAP_SWO_STATUS_OVERRUN;
+            break;
+        }
+        dap_swo.buffer[dap_swo.head & DAP_SWO_BUFFER_MASK] = data[i];
+        dap_swo.head++;
+    }
+}
+
+static void dap_swo_decode(void) {
+    uint8_t data[DAP_SWO_DECODE_CHUNK / 8 + 1];
+    const void* edges;
+    bool lost;
+
+    while(true) {
+        size_t count = dap_uart_dma_peek(DAP_SWO_DMA_CHANNEL, &edges, &lost);
+        if(lost) {
+            // the decoder would take the gap for a bit
+            dap_swo.status |= DAP_SWO_STATUS_OVERRUN;
+            dap_manchester_reset(&dap_swo.manchester, true);
+        }
+        if(count == 0) break;
+        count = MIN(count, (size_t)DAP_SWO_DECODE_CHUNK);
+
+        size_t size = dap_manchester_decode(&dap_swo.manchester, edges, count, data);
+        dap_swo_push(data, size);
+        dap_uart_dma_skip(DAP_SWO_DMA_CHANNEL, count);
+    }
+}
+
+static void dap_swo_sync(void) {
+    if(dap_swo.mode == DapSwoModeManchester) {
+        if(dap_swo.active) dap_swo_decode();
+    } else if(dap_swo.mode == DapSwoModeUart) {
+        bool lost;
+        dap_uart_dma_available(DAP_SWO_DMA_CHANNEL, &lost);
+        if(lost) dap_swo.status |= DAP_SWO_STATUS_OVERRUN;
+    }
+}
+
+// bytes waiting for the host
+static uint32_t dap_swo_count(void) {
+    if(dap_swo.mode == DapSwoModeUart) return dap_uart_dma_available(DAP_SWO_DMA_CHANNEL, NULL);
+    return dap_swo.head - dap_swo.tail;
+}
+
+// unread bytes in place, up to the end of the buffer
+static size_t dap_swo_peek(const uint8_t** data) {
+    if(dap_swo.mode == DapSwoModeUart) {
+        const void* ring;
+        bool lost;
+        const size_t count = dap_uart_dma_peek(DAP_SWO_DMA_CHANNEL, &ring, &lost);
+        if(lost) dap_swo.status |= DAP_SWO_STATUS_OVERRUN;
+        *data = ring;
+        return count;
+    }
+
+    const size_t offset = dap_swo.tail & DAP_SWO_BUFFER_MASK;
+    *data = &dap_swo.buffer[offset];
+    return MIN(dap_swo.head - dap_swo.tail, DAP_SWO_BUFFER_SIZE - offset);
+}
+
+static void dap_swo_skip(size_t count) {
+    if(dap_swo.mode == DapSwoModeUart) {
+        dap_uart_dma_skip(DAP_SWO_DMA_CHANNEL, count);
+    } else {
+        dap_swo.tail += count;
+    }
+}
+
+void dap_swo_set_uart(DapSwoUart uart) {
+    if(uart == dap_swo.uart) return;
+    dap_swo_control(false);
+    dap_swo_set_mode(DapSwoModeOff);
+    dap_swo.uart = uart;
+}
+
+bool dap_swo_set_transport(DapSwoTransport transport) {
+    if(dap_swo.active || transport > DapSwoTransportStream) return false;
+    dap_swo.transport = transport;
+    return true;
+}
+
+DapSwoTransport dap_swo_get_transport(void) {
+    return dap_swo.transport;
+}
+
+bool dap_swo_set_mode(DapSwoMode mode) {
+    if(dap_swo.active || mode > DapSwoModeManchester) return false;
+    if(mode == DapSwoModeUart && dap_swo.uart == DapSwoUartNone) return false;
+    if(mode == dap_swo.mode) return true;
+
+    if(dap_swo.mode == DapSwoModeUart) {
+        dap_swo_release_uart();
+    } else if(dap_swo.mode == DapSwoModeManchester) {
+        dap_swo_release_timer();
+    }
+    dap_uart_dma_clear(DAP_SWO_DMA_CHANNEL);
+    free(dap_swo.edges);
+    dap_swo.edges = NULL;
+    free(dap_swo.buffer);
+    dap_swo.buffer = NULL;
+    dap_swo.baudrate = 0;
+    dap_swo.head = dap_swo.tail = 0;
+
+    switch(mode) {
+    case DapSwoModeOff:
+        break;
+    case DapSwoModeUart:
+        dap_swo.buffer = malloc(DAP_SWO_BUFFER_SIZE);
+        dap_swo_take_uart();
+        break;
+    case DapSwoModeManchester:
+        dap_swo.buffer = malloc(DAP_SWO_BUFFER_SIZE);
+        dap_swo.edges = malloc(DAP_SWO_EDGE_COUNT * sizeof(uint32_t));
+        dap_swo_take_timer();
+        break;
+    }
+
+    dap_swo.mode = mode;
+    return true;
+}
+
+uint32_t dap_swo_set_baudrate(uint32_t baudrate) {
+    if(dap_swo.active || dap_swo.mode == DapSwoModeOff) return 0;
+
+    if(dap_swo.mode == DapSwoModeManchester) {
+        // only a hint, the decoder measures the rate on every start bit
+        dap_swo.baudrate = baudrate;
+        if(baudrate < DAP_SWO_MANCHESTER_RATE_MIN || baudrate > DAP_SWO_MANCHESTER_RATE_MAX) {
+            dap_swo.baudrate = 0;
+        }
+    } else if(dap_swo.uart == DapSwoUartUsart1) {
+        dap_swo.baudrate = dap_swo_usart_baudrate(baudrate);
+    } else {
+        dap_swo.baudrate = dap_swo_lpuart_baudrate(baudrate);
+    }
+
+    FURI_LOG_I(TAG, "Baudrate %lu requested, %lu set", baudrate, dap_swo.baudrate);
+    return dap_swo.baudrate;
+}
+
+bool dap_swo_control(bool start) {
+    if(!start) {
+        if(dap_swo.active) {
+            dap_swo_sync();
+            if(dap_swo.mode == DapSwoModeManchester) {
+                dap_swo_timer_stop();
+            } else {
+                dap_uart_dma_stop(DAP_SWO_DMA_CHANNEL);
+            }
+            dap_swo.active = false;
+        }
+        return true;
+    }
+
+    if(dap_swo.active) return true;
+    if(dap_swo.mode == DapSwoModeOff || dap_swo.baudrate == 0 ||
+       dap_swo.transport == DapSwoTransportNone) {
+        return false;
+    }
+
+    dap_swo.head = dap_swo.tail = 0;
+    dap_swo.status = 0;
+    if(dap_swo.mode == DapSwoModeManchester) {
+        dap_swo_timer_start();
+    } else {
+        dap_swo_uart_start();
+    }
+    dap_swo.active = true;
+    return true;
+}
+
+bool dap_swo_is_active(void) {
+    return dap_swo.active;
+}
+
+void dap_swo_set_callback(DapSwoCallback callback, void* context) {
+    dap_swo.callback = callback;
+    dap_swo.context = context;
+}
+
+void dap_swo_poll(void) {
+    dap_swo_sync();
+}
+
+uint8_t dap_swo_get_status(uint32_t* count) {
+    dap_swo_sync();
+    *count = dap_swo_count();
+    return dap_swo.status | (dap_swo.active ? DAP_SWO_STATUS_ACTIVE : 0);
+}
+
+size_t dap_swo_read(uint8_t* data, size_t size) {
+    dap_swo_sync();
+
+    size_t done = 0;
+    while(done < size) {
+        const uint8_t* ring;
+        const size_t chunk = MIN(size - done, dap_swo_peek(&ring));
+        if(chunk == 0) break;
+        memcpy(&data[done], ring, chunk);
+        dap_swo_skip(chunk);
+        done += chunk;
+    }
+
+    return done;
+}
+
+void dap_swo_stream(FuriStreamBuffer* out) {
+    dap_swo_sync();
+
+    while(true) {
+        const uint8_t* ring;
+        const size_t chunk = dap_swo_peek(&ring);
+        if(chunk == 0) break;
+        const size_t sent = furi_stream_buffer_send(out, ring, chunk, 0);
+        dap_swo_skip(sent);
+        if(sent < chunk) break;
+    }
+}
@@ -0,0 +1,97 @@
+#pragma once
+#include <furi.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * SWO trace capture for the CMSIS-DAP DAP_SWO_* commands.
+ *
+ * In UART (NRZ) mode the RX pin of USART1 or LPUART1 feeds a circular DMA
+ * into the trace buffer, so the CPU only touches the data when the host
+ * asks for it. The DMA half and full transfer interrupts count laps, which
+ * turns the DMA position into a running byte count; the host falling more
+ * than one buffer behind is reported as an overrun and the backlog is
+ * dropped. Data captured before a stop stays readable.
+ *
+ * Manchester mode has no UART to lean on: TIM2 channel 2 timestamps both
+ * edges on the TDO pin (pin 5, where SWO sits on the 10 pin connector) and
+ * the DMA collects them. The edges are decoded into the same trace buffer
+ * in chunks whenever the buffer is polled or read, the bit rate is measured
+ * by the decoder and the host baudrate only has to be in range.
+ */
+
+// must be a power of two, the DMA counts at most 65535 bytes
+#define DAP_SWO_BUFFER_SIZE 16384
+
+// DAP_SWO_Status trace status bits
+#define DAP_SWO_STATUS_ACTIVE (1 << 0)
+#define DAP_SWO_STATUS_STREAM_ERROR (1 << 6)
+#define DAP_SWO_STATUS_OVERRUN (1 << 7)
+
+/**
+ * Called from the DMA interrupt each time half of its buffer is filled
+ */
+typedef void (*DapSwoCallback)(void* context);
+
+typedef enum {
+    DapSwoUartUsart1, // RX on pin 14
+    DapSwoUartLpuart1, // RX on pin 16
+    DapSwoUartNone, // both UARTs are taken, UART mode is refused
+} DapSwoUart;
+
+typedef enum {
+    DapSwoTransportNone,
+    DapSwoTransportData, // read with DAP_SWO_Data
+    DapSwoTransportStream, // CMSIS-DAP v2 streaming trace endpoint
+} DapSwoTransport;
+
+typedef enum {
+    DapSwoModeOff,
+    DapSwoModeUart,
+    DapSwoModeManchester,
+} DapSwoMode;
+
+/**
+ * Pick the UART for the next DAP_SWO_Mode, an active one is released
+ */
+void dap_swo_set_uart(DapSwoUart uart);
+
+bool dap_swo_set_transport(DapSwoTransport transport);
+
+DapSwoTransport dap_swo_get_transport(void);
+
+/**
+ * UART mode takes the UART and its pins, Manchester mode TIM2 and the TDO
+ * pin, until the mode goes back to off
+ */
+bool dap_swo_set_mode(DapSwoMode mode);
+
+/**
+ * @return the baudrate the UART actually runs at, 0 if it can't be set
+ */
+uint32_t dap_swo_set_baudrate(uint32_t baudrate);
+
+bool dap_swo_control(bool start);
+
+bool dap_swo_is_active(void);
+
+void dap_swo_set_callback(DapSwoCallback callback, void* context);
+
+/**
+ * Catch up with the capture, keeps the Manchester decoder ahead of the DMA
+ */
+void dap_swo_poll(void);
+
+/**
+ * @param count bytes waiting in the trace buffer
+ * @return DAP_SWO_STATUS_* bits
+ */
+uint8_t dap_swo_get_status(uint32_t* count);
+
+size_t dap_swo_read(uint8_t* data, size_t size);
+
+/**
+ * Move captured data into the stream, what doesn't fit stays buffered
+ */
+void dap_swo_stream(FuriStreamBuffer* out);
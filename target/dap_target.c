@@ -0,0 +1,557 @@
+#include <furi.h>
+#include <furi_hal_cortex.h>
+#include <dap.h>
+
+#include "dap_target.h"
+#include "../dap_cmsis.h"
+#include "../dap_config.h"
+
+#define TAG "DapTarget"
+
+// 32-bit access, single auto-increment, privileged data access
+#define DAP_TARGET_CSW_VALUE 0x23000052
+// same without auto-increment
+#define DAP_TARGET_CSW_FIXED 0x23000002
+
+#define DAP_TARGET_CTRL_STAT_CDBGPWRUPREQ (1UL << 28)
+#define DAP_TARGET_CTRL_STAT_CDBGPWRUPACK (1UL << 29)
+#define DAP_TARGET_CTRL_STAT_CSYSPWRUPREQ (1UL << 30)
+#define DAP_TARGET_CTRL_STAT_CSYSPWRUPACK (1UL << 31)
+
+// STKCMPCLR | STKERRCLR | WDERRCLR | ORUNERRCLR
+#define DAP_TARGET_ABORT_CLEAR 0x1E
+
+#define DAP_TARGET_POWER_UP_TIMEOUT_US 100000
+
+#define DAP_TARGET_TRANSFER_MAX 12
+
+#define DAP_TARGET_REGRDY_RETRY 100
+
+#define DAP_TARGET_BYTES_WORDS 64
+
+typedef struct {
+    uint8_t request;
+    uint32_t value;
+    uint32_t* result;
+} DapTargetTransfer;
+
+static uint8_t dap_target_request[DAP_CONFIG_PACKET_SIZE];
+static uint8_t dap_target_response[DAP_CONFIG_PACKET_SIZE];
+static uint8_t dap_target_ack = 0;
+// an access failed and may have left STICKYERR or STICKYORUN behind
+static bool dap_target_fault = false;
+// last DP SELECT of the host, the AP state snapshot puts it back
+static uint32_t dap_target_host_select = 0;
+
+static size_t dap_target_execute(size_t request_size) {
+    memset(dap_target_response, 0, sizeof(dap_target_response));
+    return dap_process_request(
+        dap_target_request, request_size, dap_target_response, sizeof(dap_target_response));
+}
+
+static uint8_t dap_target_request_dp(uint8_t reg, bool read) {
+    return (reg & 0x0C) | (read ? DAP_TRANSFER_RnW : 0);
+}
+
+static uint8_t dap_target_request_ap(uint8_t reg, bool read) {
+    return DAP_TRANSFER_APnDP | (reg & 0x0C) | (read ? DAP_TRANSFER_RnW : 0);
+}
+
+static uint32_t dap_target_select(uint8_t ap, uint8_t reg) {
+    return ((uint32_t)ap << 24) | (reg & 0xF0);
+}
+
+static void dap_target_set_ack(uint8_t ack) {
+    dap_target_ack = ack;
+    if((ack & DAP_TRANSFER_ACK_MASK) != DAP_TRANSFER_ACK_OK || (ack & DAP_TRANSFER_ERROR)) {
+        dap_target_fault = true;
+    }
+}
+
+static bool dap_target_transfer(const DapTargetTransfer* transfers, size_t count) {
+    furi_assert(count <= DAP_TARGET_TRANSFER_MAX);
+
+    size_t size = 0;
+    dap_target_request[size++] = DAP_CMD_TRANSFER;
+    dap_target_request[size++] = 0; // DAP index, ignored in SWD mode
+    dap_target_request[size++] = count;
+
+    for(size_t i = 0; i < count; i++) {
+        uint8_t request = transfers[i].request;
+        dap_target_request[size++] = request;
+        if(!(request & DAP_TRANSFER_RnW) || (request & DAP_TRANSFER_MATCH_VALUE)) {
+            dap_put_u32(&dap_target_request[size], transfers[i].value);
+            size += 4;
+        }
+    }
+
+    dap_target_execute(size);
+
+    uint8_t done = dap_target_response[1];
+    dap_target_set_ack(dap_target_response[2]);
+
+    const uint8_t* data = &dap_target_response[3];
+    for(size_t i = 0; i < done && i < count; i++) {
+        uint8_t request = transfers[i].request;
+        if((request & DAP_TRANSFER_RnW) && !(request & DAP_TRANSFER_MATCH_VALUE)) {
+            if(transfers[i].result) {
+                *transfers[i].result = dap_get_u32(data);
+            }
+            data += 4;
+        }
+    }
+
+    return (done == count) && ((dap_target_ack & DAP_TRANSFER_ACK_MASK) == DAP_TRANSFER_ACK_OK) &&
+           !(dap_target_ack & (DAP_TRANSFER_ERROR | DAP_TRANSFER_MISMATCH));
+}
+
+static bool dap_target_swj_sequence(size_t bits, const uint8_t* data) {
+    furi_assert(bits > 0 && bits <= 256);
+
+    size_t size = 0;
+    dap_target_request[size++] = DAP_CMD_SWJ_SEQUENCE;
+    dap_target_request[size++] = bits & 0xFF;
+    memcpy(&dap_target_request[size], data, (bits + 7) / 8);
+    size += (bits + 7) / 8;
+
+    dap_target_execute(size);
+    return dap_target_response[1] == DAP_STATUS_OK;
+}
+
+bool dap_target_connect(uint32_t* idcode) {
+    static const uint8_t line_reset[] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+    static const uint8_t jtag_to_swd[] = {0x9E, 0xE7};
+    static const uint8_t idle[] = {0x00};
+
+    dap_target_request[0] = DAP_CMD_CONNECT;
+    dap_target_request[1] = DAP_CONNECT_SWD;
+    dap_target_execute(2);
+    if(dap_target_response[1] != DAP_CONNECT_SWD) {
+        FURI_LOG_E(TAG, "SWD port unavailable");
+        return false;
+    }
+
+    dap_target_swj_sequence(51, line_reset);
+    dap_target_swj_sequence(16, jtag_to_swd);
+    dap_target_swj_sequence(51, line_reset);
+    dap_target_swj_sequence(8, idle);
+
+    uint32_t dpidr = 0;
+    if(!dap_target_dp_read(DAP_TARGET_DP_IDCODE, &dpidr)) {
+        FURI_LOG_E(TAG, "No DPIDR response, ack %02X", dap_target_ack);
+        return false;
+    }
+    if(idcode) *idcode = dpidr;
+
+    const DapTargetTransfer power_up[] = {
+        {dap_target_request_dp(DAP_TARGET_DP_ABORT, false), DAP_TARGET_ABORT_CLEAR, NULL},
+        {dap_target_request_dp(DAP_TARGET_DP_SELECT, false), 0, NULL},
+        {dap_target_request_dp(DAP_TARGET_DP_CTRL_STAT, false),
+         DAP_TARGET_CTRL_STAT_CDBGPWRUPREQ | DAP_TARGET_CTRL_STAT_CSYSPWRUPREQ,
+         NULL},
+    };
+    if(!dap_target_transfer(power_up, COUNT_OF(power_up))) {
+        return false;
+    }
+    dap_target_fault = false;
+
+    const uint32_t ack_mask = DAP_TARGET_CTRL_STAT_CDBGPWRUPACK |
+                              DAP_TARGET_CTRL_STAT_CSYSPWRUPACK;
+    FuriHalCortexTimer timer = furi_hal_cortex_timer_get(DAP_TARGET_POWER_UP_TIMEOUT_US);
+    uint32_t ctrl_stat = 0;
+    do {
+        if(!dap_target_dp_read(DAP_TARGET_DP_CTRL_STAT, &ctrl_stat)) {
+            return false;
+        }
+        if((ctrl_stat & ack_mask) == ack_mask) {
+            return true;
+        }
+    } while(!furi_hal_cortex_timer_is_expired(timer));
+
+    FURI_LOG_E(TAG, "Debug power-up timeout, CTRL/STAT %08lX", ctrl_stat);
+    return false;
+}
+
+bool dap_target_dp_read(uint8_t reg, uint32_t* value) {
+    const DapTargetTransfer transfer = {dap_target_request_dp(reg, true), 0, value};
+    return dap_target_transfer(&transfer, 1);
+}
+
+bool dap_target_dp_write(uint8_t reg, uint32_t value) {
+    const DapTargetTransfer transfer = {dap_target_request_dp(reg, false), value, NULL};
+    return dap_target_transfer(&transfer, 1);
+}
+
+bool dap_target_ap_read(uint8_t ap, uint8_t reg, uint32_t* value) {
+    const DapTargetTransfer transfers[] = {
+        {dap_target_request_dp(DAP_TARGET_DP_SELECT, false), dap_target_select(ap, reg), NULL},
+        {dap_target_request_ap(reg, true), 0, value},
+    };
+    return dap_target_transfer(transfers, COUNT_OF(transfers));
+}
+
+bool dap_target_ap_write(uint8_t ap, uint8_t reg, uint32_t value) {
+    const DapTargetTransfer transfers[] = {
+        {dap_target_request_dp(DAP_TARGET_DP_SELECT, false), dap_target_select(ap, reg), NULL},
+        {dap_target_request_ap(reg, false), value, NULL},
+    };
+    return dap_target_transfer(transfers, COUNT_OF(transfers));
+}
+
+void dap_target_set_host_select(uint32_t select) {
+    dap_target_host_select = select;
+}
+
+bool dap_target_ap_save(DapTargetApState* state) {
+    state->select = dap_target_host_select;
+    state->valid = dap_target_ap_read(0, DAP_TARGET_AP_CSW, &state->csw) &&
+                   dap_target_ap_read(0, DAP_TARGET_AP_TAR, &state->tar);
+    return state->valid;
+}
+
+void dap_target_ap_restore(const DapTargetApState* state) {
+    // the host would trip over sticky flags it didn't cause
+    if(dap_target_fault && dap_target_dp_write(DAP_TARGET_DP_ABORT, DAP_TARGET_ABORT_CLEAR)) {
+        dap_target_fault = false;
+    }
+
+    if(!state->valid) {
+        dap_target_dp_write(DAP_TARGET_DP_SELECT, state->select);
+        return;
+    }
+
+    const DapTargetTransfer transfers[] = {
+        {dap_target_request_dp(DAP_TARGET_DP_SELECT, false), 0, NULL},
+        {dap_target_request_ap(DAP_TARGET_AP_CSW, false), state->csw, NULL},
+        {dap_target_request_ap(DAP_TARGET_AP_TAR, false), state->tar, NULL},
+        {dap_target_request_dp(DAP_TARGET_DP_SELECT, false), state->select, NULL},
+    };
+    dap_target_transfer(transfers, COUNT_OF(transfers));
+}
+
+bool dap_target_read32(uint32_t address, uint32_t* value) {
+    const DapTargetTransfer transfers[] = {
+        {dap_target_request_dp(DAP_TARGET_DP_SELECT, false), 0, NULL},
+        {dap_target_request_ap(DAP_TARGET_AP_CSW, false), DAP_TARGET_CSW_VALUE, NULL},
+        {dap_target_request_ap(DAP_TARGET_AP_TAR, false), address, NULL},
+        {dap_target_request_ap(DAP_TARGET_AP_DRW, true), 0, value},
+    };
+    return dap_target_transfer(transfers, COUNT_OF(transfers));
+}
+
+bool dap_target_write32(uint32_t address, uint32_t value) {
+    const DapTargetTransfer transfers[] = {
+        {dap_target_request_dp(DAP_TARGET_DP_SELECT, false), 0, NULL},
+        {dap_target_request_ap(DAP_TARGET_AP_CSW, false), DAP_TARGET_CSW_VALUE, NULL},
+        {dap_target_request_ap(DAP_TARGET_AP_TAR, false), address, NULL},
+        {dap_target_request_ap(DAP_TARGET_AP_DRW, false), value, NULL},
+    };
+    return dap_target_transfer(transfers, COUNT_OF(transfers));
+}
+
+static bool dap_target_set_tar(uint32_t address) {
+    const DapTargetTransfer transfers[] = {
+        {dap_target_request_dp(DAP_TARGET_DP_SELECT, false), 0, NULL},
+        {dap_target_request_ap(DAP_TARGET_AP_CSW, false), DAP_TARGET_CSW_VALUE, NULL},
+        {dap_target_request_ap(DAP_TARGET_AP_TAR, false), address, NULL},
+    };
+    return dap_target_transfer(transfers, COUNT_OF(transfers));
+}
+
+static size_t dap_target_chunk(uint32_t address, size_t count, size_t max) {
+    size_t wrap = (DAP_TARGET_TAR_WRAP - (address & (DAP_TARGET_TAR_WRAP - 1))) / 4;
+    if(count > max) count = max;
+    if(count > wrap) count = wrap;
+    return count;
+}
+
+bool dap_target_read_block(uint32_t address, uint32_t* data, size_t count) {
+    furi_assert((address & 3) == 0);
+    bool tar_valid = false;
+
+    while(count > 0) {
+        size_t chunk = dap_target_chunk(address, count, DAP_TARGET_BLOCK_READ_MAX);
+
+        if(!tar_valid) {
+            if(!dap_target_set_tar(address)) return false;
+            tar_valid = true;
+        }
+
+        dap_target_request[0] = DAP_CMD_TRANSFER_BLOCK;
+        dap_target_request[1] = 0;
+        dap_put_u16(&dap_target_request[2], chunk);
+        dap_target_request[4] = dap_target_request_ap(DAP_TARGET_AP_DRW, true);
+        dap_target_execute(5);
+
+        dap_target_set_ack(dap_target_response[3]);
+        if(dap_get_u16(&dap_target_response[1]) != chunk ||
+           (dap_target_ack & DAP_TRANSFER_ACK_MASK) != DAP_TRANSFER_ACK_OK) {
+            return false;
+        }
+
+        for(size_t i = 0; i < chunk; i++) {
+            data[i] = dap_get_u32(&dap_target_response[4 + i * 4]);
+        }
+
+        data += chunk;
+        count -= chunk;
+        address += chunk * 4;
+        if((address & (DAP_TARGET_TAR_WRAP - 1)) == 0) tar_valid = false;
+    }
+
+    return true;
+}
+
+bool dap_target_write_block(uint32_t address, const uint32_t* data, size_t count) {
+    furi_assert((address & 3) == 0);
+    bool tar_valid = false;
+
+    while(count > 0) {
+        size_t chunk = dap_target_chunk(address, count, DAP_TARGET_BLOCK_WRITE_MAX);
+
+        if(!tar_valid) {
+            if(!dap_target_set_tar(address)) return false;
+            tar_valid = true;
+        }
+
+        dap_target_request[0] = DAP_CMD_TRANSFER_BLOCK;
+        dap_target_request[1] = 0;
+        dap_put_u16(&dap_target_request[2], chunk);
+        dap_target_request[4] = dap_target_request_ap(DAP_TARGET_AP_DRW, false);
+        for(size_t i = 0; i < chunk; i++) {
+            dap_put_u32(&dap_target_request[5 + i * 4], data[i]);
+        }
+        dap_target_execute(5 + chunk * 4);
+
+        dap_target_set_ack(dap_target_response[3]);
+        if(dap_get_u16(&dap_target_response[1]) != chunk ||
+           (dap_target_ack & DAP_TRANSFER_ACK_MASK) != DAP_TRANSFER_ACK_OK) {
+            return false;
+        }
+
+        data += chunk;
+        count -= chunk;
+        address += chunk * 4;
+        if((address & (DAP_TARGET_TAR_WRAP - 1)) == 0) tar_valid = false;
+    }
+
+    return true;
+}
+
+bool dap_target_ap_setup(uint32_t select, uint32_t csw, uint32_t tar) {
+    const DapTargetTransfer transfers[] = {
+        {dap_target_request_dp(DAP_TARGET_DP_SELECT, false), select, NULL},
+        {dap_target_request_ap(DAP_TARGET_AP_CSW, false), csw, NULL},
+        {dap_target_request_ap(DAP_TARGET_AP_TAR, false), tar, NULL},
+    };
+    return dap_target_transfer(transfers, COUNT_OF(transfers));
+}
+
+bool dap_target_poll_setup(uint32_t address) {
+    return dap_target_ap_setup(0, DAP_TARGET_CSW_FIXED, address);
+}
+
+bool dap_target_poll_read(uint32_t* data, size_t count) {
+    furi_assert(count <= DAP_TARGET_BLOCK_READ_MAX);
+
+    dap_target_request[0] = DAP_CMD_TRANSFER_BLOCK;
+    dap_target_request[1] = 0;
+    dap_put_u16(&dap_target_request[2], count);
+    dap_target_request[4] = dap_target_request_ap(DAP_TARGET_AP_DRW, true);
+    dap_target_execute(5);
+
+    dap_target_set_ack(dap_target_response[3]);
+    if(dap_get_u16(&dap_target_response[1]) != count ||
+       (dap_target_ack & DAP_TRANSFER_ACK_MASK) != DAP_TRANSFER_ACK_OK) {
+        return false;
+    }
+
+    for(size_t i = 0; i < count; i++) {
+        data[i] = dap_get_u32(&dap_target_response[4 + i * 4]);
+    }
+    return true;
+}
+
+static uint32_t dap_target_words[DAP_TARGET_BYTES_WORDS];
+
+bool dap_target_read_bytes(uint32_t address, uint8_t* data, size_t size) {
+    while(size > 0) {
+        const uint32_t head = address & 3;
+        const size_t chunk = MIN(size, sizeof(dap_target_words) - head);
+        const size_t words = (head + chunk + 3) / 4;
+
+        if(!dap_target_read_block(address - head, dap_target_words, words)) return false;
+        memcpy(data, (uint8_t*)dap_target_words + head, chunk);
+
+        address += chunk;
+        data += chunk;
+        size -= chunk;
+    }
+    return true;
+}
+
+bool dap_target_write_bytes(uint32_t address, const uint8_t* data, size_t size) {
+    while(size > 0) {
+        const uint32_t head = address & 3;
+        const uint32_t start = address - head;
+        const size_t chunk = MIN(size, sizeof(dap_target_words) - head);
+        const size_t words = (head + chunk + 3) / 4;
+
+        // keep the target bytes around a partial word
+        if(head && !dap_target_read32(start, &dap_target_words[0])) return false;
+        if(((head + chunk) & 3) &&
+           !dap_target_read32(start + (words - 1) * 4, &dap_target_words[words - 1])) {
+            return false;
+        }
+
+        memcpy((uint8_t*)dap_target_words + head, data, chunk);
+        if(!dap_target_write_block(start, dap_target_words, words)) return false;
+
+        address += chunk;
+        data += chunk;
+        size -= chunk;
+    }
+    return true;
+}
+
+void dap_target_disconnect(void) {
+    dap_target_request[0] = DAP_CMD_DISCONNECT;
+    dap_target_execute(1);
+}
+
+bool dap_target_run_reset(void) {
+    // the reset request is not acknowledged, the core may be gone before the ACK
+    if(!dap_target_write32(DAP_TARGET_DHCSR, DAP_TARGET_DHCSR_DBGKEY)) return false;
+    dap_target_write32(
+        DAP_TARGET_AIRCR, DAP_TARGET_AIRCR_VECTKEY | DAP_TARGET_AIRCR_SYSRESETREQ);
+    return true;
+}
+
+bool dap_target_halt(uint32_t timeout_us) {
+    if(!dap_target_write32(
+           DAP_TARGET_DHCSR,
+           DAP_TARGET_DHCSR_DBGKEY | DAP_TARGET_DHCSR_C_DEBUGEN | DAP_TARGET_DHCSR_C_HALT)) {
+        return false;
+    }
+
+    FuriHalCortexTimer timer = furi_hal_cortex_timer_get(timeout_us);
+    bool halted = false;
+    do {
+        if(!dap_target_is_halted(&halted)) return false;
+        if(halted) return true;
+    } while(!furi_hal_cortex_timer_is_expired(timer));
+
+    return false;
+}
+
+bool dap_target_resume(bool mask_interrupts) {
+    uint32_t dhcsr = DAP_TARGET_DHCSR_DBGKEY | DAP_TARGET_DHCSR_C_DEBUGEN;
+    if(mask_interrupts) {
+        // C_MASKINTS may only change while the core is halted
+        if(!dap_target_write32(
+               DAP_TARGET_DHCSR,
+               dhcsr | DAP_TARGET_DHCSR_C_HALT | DAP_TARGET_DHCSR_C_MASKINTS)) {
+            return false;
+        }
+        dhcsr |= DAP_TARGET_DHCSR_C_MASKINTS;
+    }
+    return dap_target_write32(DAP_TARGET_DHCSR, dhcsr);
+}
+
+bool dap_target_is_halted(bool* halted) {
+    uint32_t dhcsr;
+    if(!dap_target_read32(DAP_TARGET_DHCSR, &dhcsr)) return false;
+    *halted = (dhcsr & DAP_TARGET_DHCSR_S_HALT) != 0;
+    return true;
+}
+
+static bool dap_target_wait_regrdy(void) {
+    uint32_t dhcsr;
+    for(size_t i = 0; i < DAP_TARGET_REGRDY_RETRY; i++) {
+        if(!dap_target_read32(DAP_TARGET_DHCSR, &dhcsr)) return false;
+        if(dhcsr & DAP_TARGET_DHCSR_S_REGRDY) return true;
+    }
+    return false;
+}
+
+static bool dap_target_read_reg_polled(uint8_t reg, uint32_t* value) {
+    return dap_target_write32(DAP_TARGET_DCRSR, reg) && dap_target_wait_regrdy() &&
+           dap_target_read32(DAP_TARGET_DCRDR, value);
+}
+
+static bool dap_target_write_reg_polled(uint8_t reg, uint32_t value) {
+    return dap_target_write32(DAP_TARGET_DCRDR, value) &&
+           dap_target_write32(DAP_TARGET_DCRSR, reg | DAP_TARGET_DCRSR_REGWnR) &&
+           dap_target_wait_regrdy();
+}
+
+bool dap_target_read_regs(const uint8_t* regs, uint32_t* values, size_t count) {
+    for(size_t i = 0; i < count; i++) {
+        // one packet per register, Free-DAP's value match waits for S_REGRDY
+        const DapTargetTransfer transfers[] = {
+            {dap_target_request_dp(DAP_TARGET_DP_SELECT, false), 0, NULL},
+            {dap_target_request_ap(DAP_TARGET_AP_CSW, false), DAP_TARGET_CSW_VALUE, NULL},
+            {dap_target_request_ap(DAP_TARGET_AP_TAR, false), DAP_TARGET_DCRSR, NULL},
+            {dap_target_request_ap(DAP_TARGET_AP_DRW, false), regs[i], NULL},
+            {DAP_TRANSFER_MATCH_MASK, DAP_TARGET_DHCSR_S_REGRDY, NULL},
+            {dap_target_request_ap(DAP_TARGET_AP_TAR, false), DAP_TARGET_DHCSR, NULL},
+            {dap_target_request_ap(DAP_TARGET_AP_DRW, true) | DAP_TRANSFER_MATCH_VALUE,
+             DAP_TARGET_DHCSR_S_REGRDY,
+             NULL},
+            {dap_target_request_ap(DAP_TARGET_AP_TAR, false), DAP_TARGET_DCRDR, NULL},
+            {dap_target_request_ap(DAP_TARGET_AP_DRW, true), 0, &values[i]},
+        };
+        if(!dap_target_transfer(transfers, COUNT_OF(transfers)) &&
+           !dap_target_read_reg_polled(regs[i], &values[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool dap_target_write_regs(const uint8_t* regs, const uint32_t* values, size_t count) {
+    for(size_t i = 0; i < count; i++) {
+        const DapTargetTransfer transfers[] = {
+            {dap_target_request_dp(DAP_TARGET_DP_SELECT, false), 0, NULL},
+            {dap_target_request_ap(DAP_TARGET_AP_CSW, false), DAP_TARGET_CSW_VALUE, NULL},
+            {dap_target_request_ap(DAP_TARGET_AP_TAR, false), DAP_TARGET_DCRDR, NULL},
+            {dap_target_request_ap(DAP_TARGET_AP_DRW, false), values[i], NULL},
+            {dap_target_request_ap(DAP_TARGET_AP_TAR, false), DAP_TARGET_DCRSR, NULL},
+            {dap_target_request_ap(DAP_TARGET_AP_DRW, false),
+             regs[i] | DAP_TARGET_DCRSR_REGWnR,
+             NULL},
+            {DAP_TRANSFER_MATCH_MASK, DAP_TARGET_DHCSR_S_REGRDY, NULL},
+            {dap_target_request_ap(DAP_TARGET_AP_TAR, false), DAP_TARGET_DHCSR, NULL},
+            {dap_target_request_ap(DAP_TARGET_AP_DRW, true) | DAP_TRANSFER_MATCH_VALUE,
+             DAP_TARGET_DHCSR_S_REGRDY,
+             NULL},
+        };
+        if(!dap_target_transfer(transfers, COUNT_OF(transfers)) &&
+           !dap_target_write_reg_polled(regs[i], values[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool dap_target_read_reg(uint8_t reg, uint32_t* value) {
+    return dap_target_read_regs(&reg, value, 1);
+}
+
+bool dap_target_write_reg(uint8_t reg, uint32_t value) {
+    return dap_target_write_regs(&reg, &value, 1);
+}
+
+size_t dap_target_command(
+    const uint8_t* request,
+    size_t request_size,
+    uint8_t* response,
+    size_t response_size) {
+    furi_assert(request_size <= sizeof(dap_target_request));
+    memcpy(dap_target_request, request, request_size);
+    return dap_process_request(dap_target_request, request_size, response, response_size);
+}
+
+uint8_t dap_target_get_ack(void) {
+    return dap_target_ack;
+}
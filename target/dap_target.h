@@ -0,0 +1,207 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Target access for probe-side engines.
+ *
+ * Every operation is encoded as a CMSIS-DAP request and executed through
+ * dap_process_request(), so the engines share Free-DAP's SWD timing, WAIT
+ * retries and turnaround configuration with the host. Must only be called
+ * from the DAP thread and never from inside dap_process_request().
+ */
+
+#define DAP_TARGET_DP_IDCODE 0x00
+#define DAP_TARGET_DP_ABORT 0x00
+#define DAP_TARGET_DP_CTRL_STAT 0x04
+#define DAP_TARGET_DP_SELECT 0x08
+#define DAP_TARGET_DP_RDBUFF 0x0C
+
+#define DAP_TARGET_AP_CSW 0x00
+#define DAP_TARGET_AP_TAR 0x04
+#define DAP_TARGET_AP_DRW 0x0C
+#define DAP_TARGET_AP_IDR 0xFC
+
+#define DAP_TARGET_DHCSR 0xE000EDF0
+#define DAP_TARGET_DCRSR 0xE000EDF4
+#define DAP_TARGET_DCRDR 0xE000EDF8
+#define DAP_TARGET_DEMCR 0xE000EDFC
+#define DAP_TARGET_AIRCR 0xE000ED0C
+#define DAP_TARGET_VTOR 0xE000ED08
+
+#define DAP_TARGET_DHCSR_DBGKEY (0xA05FUL << 16)
+#define DAP_TARGET_DHCSR_C_DEBUGEN (1UL << 0)
+#define DAP_TARGET_DHCSR_C_HALT (1UL << 1)
+#define DAP_TARGET_DHCSR_C_STEP (1UL << 2)
+#define DAP_TARGET_DHCSR_C_MASKINTS (1UL << 3)
+#define DAP_TARGET_DHCSR_S_REGRDY (1UL << 16)
+#define DAP_TARGET_DHCSR_S_HALT (1UL << 17)
+#define DAP_TARGET_DHCSR_S_LOCKUP (1UL << 19)
+#define DAP_TARGET_DHCSR_S_RESET_ST (1UL << 25)
+
+#define DAP_TARGET_AIRCR_VECTKEY (0x05FAUL << 16)
+#define DAP_TARGET_AIRCR_SYSRESETREQ (1UL << 2)
+
+#define DAP_TARGET_DCRSR_REGWnR (1UL << 16)
+
+#define DAP_TARGET_DFSR 0xE000ED30
+#define DAP_TARGET_DFSR_BKPT (1UL << 1)
+#define DAP_TARGET_DFSR_CLEAR 0x1F
+
+#define DAP_TARGET_DWT_CTRL 0xE0001000
+#define DAP_TARGET_DWT_PCSR 0xE000101C
+#define DAP_TARGET_DWT_COMP0 0xE0001020
+#define DAP_TARGET_DWT_COMP_STRIDE 0x10
+
+#define DAP_TARGET_FP_CTRL 0xE0002000
+#define DAP_TARGET_FP_COMP0 0xE0002008
+
+#define DAP_TARGET_DEMCR_VC_CORERESET (1UL << 0)
+#define DAP_TARGET_DEMCR_TRCENA (1UL << 24)
+
+// Core register selectors for DCRSR
+#define DAP_TARGET_REG_R0 0
+#define DAP_TARGET_REG_SP 13
+#define DAP_TARGET_REG_LR 14
+#define DAP_TARGET_REG_PC 15
+#define DAP_TARGET_REG_XPSR 16
+#define DAP_TARGET_REG_MSP 17
+#define DAP_TARGET_REG_PSP 18
+#define DAP_TARGET_REG_SPECIAL 20 // CONTROL, FAULTMASK, BASEPRI, PRIMASK
+#define DAP_TARGET_REG_FPSCR 33
+#define DAP_TARGET_REG_S0 64
+
+#define DAP_TARGET_XPSR_THUMB (1UL << 24)
+
+// Largest DAP_TransferBlock that fits into one request/response packet
+#define DAP_TARGET_BLOCK_READ_MAX 15
+#define DAP_TARGET_BLOCK_WRITE_MAX 14
+
+// MEM-AP TAR auto-increment is only guaranteed inside a 1 KB window
+#define DAP_TARGET_TAR_WRAP 0x400
+
+typedef struct {
+    bool valid; // CSW and TAR were read
+    uint32_t select;
+    uint32_t csw;
+    uint32_t tar;
+} DapTargetApState;
+
+/**
+ * Line reset, JTAG-to-SWD switch, DPIDR read and debug power-up.
+ * @param idcode optional DPIDR output
+ */
+bool dap_target_connect(uint32_t* idcode);
+
+/**
+ * Release the debug port, Free-DAP goes back to idle
+ */
+void dap_target_disconnect(void);
+
+/**
+ * Leave debug state and request a system reset through AIRCR
+ */
+bool dap_target_run_reset(void);
+
+bool dap_target_dp_read(uint8_t reg, uint32_t* value);
+
+bool dap_target_dp_write(uint8_t reg, uint32_t value);
+
+bool dap_target_ap_read(uint8_t ap, uint8_t reg, uint32_t* value);
+
+bool dap_target_ap_write(uint8_t ap, uint8_t reg, uint32_t value);
+
+/**
+ * Record a DP SELECT write of the host. SELECT is write-only, this is the
+ * value dap_target_ap_save() hands back.
+ */
+void dap_target_set_host_select(uint32_t select);
+
+/**
+ * Snapshot of AP0 CSW/TAR and the host's SELECT for engines running between
+ * host commands, host debuggers cache all three and skip re-programming them.
+ */
+bool dap_target_ap_save(DapTargetApState* state);
+
+/**
+ * Put the snapshot back. Sticky errors from failed engine accesses are
+ * cleared through ABORT first.
+ */
+void dap_target_ap_restore(const DapTargetApState* state);
+
+bool dap_target_read32(uint32_t address, uint32_t* value);
+
+bool dap_target_write32(uint32_t address, uint32_t value);
+
+/**
+ * Word-aligned MEM-AP block read using TAR auto-increment.
+ * TAR is re-programmed at every 1 KB boundary.
+ */
+bool dap_target_read_block(uint32_t address, uint32_t* data, size_t count);
+
+bool dap_target_write_block(uint32_t address, const uint32_t* data, size_t count);
+
+/**
+ * Program SELECT, then CSW and TAR of the AP it selects, in one transfer
+ */
+bool dap_target_ap_setup(uint32_t select, uint32_t csw, uint32_t tar);
+
+/**
+ * Repeated reads of one register with TAR auto-increment off. After the
+ * setup every poll is a single DAP_TransferBlock of DRW reads, until any
+ * other call re-programs CSW/TAR.
+ */
+bool dap_target_poll_setup(uint32_t address);
+
+bool dap_target_poll_read(uint32_t* data, size_t count);
+
+/**
+ * Byte-granular access on top of word transfers, partial words at either
+ * end of a write are read-modify-written.
+ */
+bool dap_target_read_bytes(uint32_t address, uint8_t* data, size_t size);
+
+bool dap_target_write_bytes(uint32_t address, const uint8_t* data, size_t size);
+
+/**
+ * Request a halt and wait for S_HALT
+ */
+bool dap_target_halt(uint32_t timeout_us);
+
+/**
+ * Leave debug state, optionally with interrupts masked
+ */
+bool dap_target_resume(bool mask_interrupts);
+
+bool dap_target_is_halted(bool* halted);
+
+/**
+ * Core register access through DCRSR/DCRDR, core must be halted
+ */
+bool dap_target_read_reg(uint8_t reg, uint32_t* value);
+
+bool dap_target_write_reg(uint8_t reg, uint32_t value);
+
+/**
+ * One DAP_Transfer per register, S_REGRDY is awaited on the probe with a
+ * value match. Falls back to explicit polling if the match gives up.
+ */
+bool dap_target_read_regs(const uint8_t* regs, uint32_t* values, size_t count);
+
+bool dap_target_write_regs(const uint8_t* regs, const uint32_t* values, size_t count);
+
+/**
+ * Execute a raw CMSIS-DAP command (JTAG sequences, pin control, ...)
+ * @return response length
+ */
+size_t dap_target_command(
+    const uint8_t* request,
+    size_t request_size,
+    uint8_t* response,
+    size_t response_size);
+
+/**
+ * Response byte of the last transfer (ACK in bits 0..2)
+ */
+uint8_t dap_target_get_ack(void);
@@ -0,0 +1,293 @@
+/*
+ * Host-side check of the SWO Manchester decoder.
+ *
+ * Random frames are turned into the edge timestamps the capture timer would
+ * record, with a random bit rate, per edge jitter, timer wrap-around and
+ * random chunking, and must decode to the same bytes without errors. A second
+ * pass corrupts one frame per capture and expects the decoder to be back in
+ * sync once the line has been idle for a few frames.
+ *
+ *   make -C test
+ *   ./test/dap_manchester_test [seed] [captures]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "../helpers/dap_manchester.h"
+
+#ifndef MIN
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#endif
+#ifndef MAX
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+#endif
+
+#define TEST_CLOCK 64000000UL
+
+#define TEST_CAPTURES_DEFAULT 2000
+#define TEST_FRAMES_MAX 8
+#define TEST_FRAME_BYTES_MAX 6
+#define TEST_IDLE_BITS_MAX 8
+#define TEST_EDGES_MAX 8192
+#define TEST_BYTES_MAX 1024
+
+// half bit period in timer ticks, 16 ticks is already 2 MBit/s
+#define TEST_HALF_MIN 16.0
+#define TEST_HALF_MAX 4000.0
+
+// per edge, quantisation to whole ticks comes on top
+#define TEST_JITTER 0.03
+
+// a corrupted frame may throw off the rate, the next start bits pull it back
+#define TEST_RECOVERY_FRAMES 24
+#define TEST_RECOVERY_IDLE_BITS 8
+#define TEST_CHECKED_FRAMES 4
+
+typedef struct {
+    uint32_t base; // timer value at time 0
+    double time; // in ticks since base
+    double half;
+    bool level;
+
+    uint32_t edges[TEST_EDGES_MAX];
+    size_t count;
+
+    uint8_t bytes[TEST_BYTES_MAX];
+    size_t size;
+} TestCapture;
+
+static uint32_t test_seed;
+static size_t test_flagged; // corrupted frames the decoder counted as errors
+
+static uint32_t test_random(void) {
+    // xorshift32, captures can be replayed from the seed
+    test_seed ^= test_seed << 13;
+    test_seed ^= test_seed >> 17;
+    test_seed ^= test_seed << 5;
+    return test_seed;
+}
+
+static uint32_t test_random_range(uint32_t min, uint32_t max) {
+    return min + test_random() % (max - min + 1);
+}
+
+static double test_random_unit(void) {
+    return (double)test_random() / UINT32_MAX;
+}
+
+static void test_capture_init(TestCapture* capture) {
+    memset(capture, 0, sizeof(TestCapture));
+    capture->base = test_random();
+    capture->half = TEST_HALF_MIN * pow(TEST_HALF_MAX / TEST_HALF_MIN, test_random_unit());
+    capture->time = capture->half * test_random_range(2, 40);
+}
+
+static void test_capture_half(TestCapture* capture, bool level) {
+    if(level != capture->level) {
+        if(capture->count == TEST_EDGES_MAX) {
+            fprintf(stderr, "Edge buffer too small\n");
+            exit(2);
+        }
+        const double jitter = (2 * test_random_unit() - 1) * TEST_JITTER * capture->half;
+        // the timer wraps, deltas stay right
+        const uint32_t time = llround(capture->time + jitter);
+        capture->edges[capture->count++] = capture->base + time;
+        capture->level = level;
+    }
+    capture->time += capture->half;
+}
+
+static void test_capture_bit(TestCapture* capture, bool bit) {
+    // the level of the first half is the bit
+    test_capture_half(capture, bit);
+    test_capture_half(capture, !bit);
+}
+
+static void test_capture_frame(TestCapture* capture, size_t bytes, uint32_t idle_bits) {
+    test_capture_bit(capture, true);
+
+    for(size_t i = 0; i < bytes; i++) {
+        const uint8_t byte = test_random();
+        if(capture->size < TEST_BYTES_MAX) capture->bytes[capture->size++] = byte;
+        for(uint8_t bit = 0; bit < 8; bit++) {
+            test_capture_bit(capture, (byte >> bit) & 1);
+        }
+    }
+
+    for(uint32_t i = 0; i < idle_bits * 2; i++) {
+        test_capture_half(capture, false);
+    }
+}
+
+static void test_capture_random_frame(TestCapture* capture, uint32_t idle_min) {
+    test_capture_frame(
+        capture,
+        test_random_range(1, TEST_FRAME_BYTES_MAX),
+        test_random_range(idle_min, TEST_IDLE_BITS_MAX));
+}
+
+// feed edges[from..to) in random chunks
+static size_t test_decode(
+    DapManchester* decoder,
+    const TestCapture* capture,
+    size_t from,
+    size_t to,
+    uint8_t* out) {
+    size_t size = 0;
+    while(from < to) {
+        size_t chunk = test_random_range(1, 64);
+        chunk = MIN(chunk, to - from);
+        size += dap_manchester_decode(decoder, &capture->edges[from], chunk, &out[size]);
+        from += chunk;
+    }
+    return size;
+}
+
+static void test_decoder_init(DapManchester* decoder, bool level) {
+    memset(decoder, 0, sizeof(DapManchester));
+    dap_manchester_reset(decoder, level);
+}
+
+static bool test_fail(size_t index, const TestCapture* capture, const char* message) {
+    fprintf(
+        stderr,
+        "Capture %zu, half %.1f ticks, %zu edges: %s\n",
+        index,
+        capture->half,
+        capture->count,
+        message);
+    return false;
+}
+
+static bool test_clean(size_t index) {
+    static TestCapture capture;
+    static uint8_t out[TEST_BYTES_MAX + TEST_EDGES_MAX / 8 + 64];
+
+    test_capture_init(&capture);
+    const uint32_t frames = test_random_range(1, TEST_FRAMES_MAX);
+    for(uint32_t i = 0; i < frames; i++) {
+        test_capture_random_frame(&capture, 1);
+    }
+
+    DapManchester decoder;
+    test_decoder_init(&decoder, false);
+    const size_t size = test_decode(&decoder, &capture, 0, capture.count, out);
+
+    if(size != capture.size || memcmp(out, capture.bytes, size) != 0) {
+        return test_fail(index, &capture, "decoded bytes differ");
+    }
+    if(decoder.errors != 0) return test_fail(index, &capture, "decoder errors");
+    if(decoder.frames != frames) return test_fail(index, &capture, "frame count");
+
+    // a single start bit is off by the jitter of two edges and a tick
+    const uint32_t rate = dap_manchester_get_rate(&decoder, TEST_CLOCK);
+    const double half = rate ? TEST_CLOCK / (2.0 * rate) : 0;
+    if(fabs(half - capture.half) > 2 * TEST_JITTER * capture.half + 1) {
+        return test_fail(index, &capture, "bit rate off");
+    }
+    return true;
+}
+
+static void test_corrupt(TestCapture* capture, size_t from) {
+    const size_t count = capture->count - from;
+    if(count < 3) return;
+    const size_t at = from + 1 + test_random() % (count - 2);
+
+    if(test_random() & 1) {
+        // a missed edge
+        memmove(&capture->edges[at], &capture->edges[at + 1], (capture->count - at - 1) * 4);
+        capture->count--;
+    } else if(capture->count + 2 <= TEST_EDGES_MAX) {
+        // a short spike between two edges
+        const uint32_t gap = capture->edges[at] - capture->edges[at - 1];
+        const uint32_t start = capture->edges[at - 1] + 1 + test_random() % MAX(gap / 2, 1U);
+        const uint32_t width = 1 + test_random() % MAX(gap / 4, 1U);
+        memmove(&capture->edges[at + 2], &capture->edges[at], (capture->count - at) * 4);
+        capture->edges[at] = start;
+        capture->edges[at + 1] = start + width;
+        capture->count += 2;
+    }
+}
+
+static bool test_resync(size_t index) {
+    static TestCapture capture;
+    static uint8_t out[TEST_BYTES_MAX + TEST_EDGES_MAX / 8 + 64];
+
+    test_capture_init(&capture);
+
+    // the decoder starts on a high line and has to wait for it to idle
+    test_capture_half(&capture, true);
+    for(uint32_t i = 0; i < TEST_RECOVERY_IDLE_BITS * 2; i++) {
+        test_capture_half(&capture, false);
+    }
+    const size_t first = capture.count;
+
+    const uint32_t clean = test_random_range(1, TEST_FRAMES_MAX);
+    for(uint32_t i = 0; i < clean; i++) {
+        test_capture_random_frame(&capture, 1);
+    }
+    const size_t clean_edges = capture.count;
+    const size_t clean_size = capture.size;
+
+    test_capture_frame(&capture, TEST_FRAME_BYTES_MAX, TEST_RECOVERY_IDLE_BITS);
+    test_corrupt(&capture, clean_edges);
+    for(uint32_t i = 0; i < TEST_RECOVERY_FRAMES; i++) {
+        test_capture_random_frame(&capture, TEST_RECOVERY_IDLE_BITS);
+    }
+    const size_t recovered_edges = capture.count;
+    const size_t recovered_size = capture.size;
+
+    for(uint32_t i = 0; i < TEST_CHECKED_FRAMES; i++) {
+        test_capture_random_frame(&capture, 1);
+    }
+
+    DapManchester decoder;
+    test_decoder_init(&decoder, true);
+    dap_manchester_decode(&decoder, capture.edges, first, out);
+    if(decoder.state == DapManchesterStateLost) {
+        return test_fail(index, &capture, "no sync on an idle line");
+    }
+
+    size_t size = test_decode(&decoder, &capture, first, clean_edges, out);
+    if(size != clean_size || memcmp(out, capture.bytes, size) != 0 || decoder.errors != 0) {
+        return test_fail(index, &capture, "frames before the corruption differ");
+    }
+
+    test_decode(&decoder, &capture, clean_edges, recovered_edges, out);
+    const uint32_t errors = decoder.errors;
+    if(errors) test_flagged++;
+
+    size = test_decode(&decoder, &capture, recovered_edges, capture.count, out);
+    if(size != capture.size - recovered_size ||
+       memcmp(out, &capture.bytes[recovered_size], size) != 0) {
+        return test_fail(index, &capture, "no resync after the corruption");
+    }
+    if(decoder.errors != errors) return test_fail(index, &capture, "errors after the resync");
+    return true;
+}
+
+int main(int argc, char** argv) {
+    const uint32_t seed = argc > 1 ? strtoul(argv[1], NULL, 0) : 1;
+    const size_t captures = argc > 2 ? strtoul(argv[2], NULL, 0) : TEST_CAPTURES_DEFAULT;
+    test_seed = seed ? seed : 1;
+
+    size_t failed = 0;
+    for(size_t i = 0; i < captures; i++) {
+        if(!test_clean(i)) failed++;
+    }
+    for(size_t i = 0; i < captures; i++) {
+        if(!test_resync(i)) failed++;
+    }
+
+    printf(
+        "Seed %lu: %zu of %zu captures failed, %zu of %zu corruptions flagged\n",
+        (unsigned long)seed,
+        failed,
+        captures * 2,
+        test_flagged,
+        captures);
+    return failed ? 1 : 0;
+}
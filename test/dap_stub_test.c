@@ -0,0 +1,544 @@
+/*
+ * Host-side check of the target-executed stubs.
+ *
+ * The dap_target layer is replaced by a simulated Cortex-M: flash and RAM
+ * images, core registers that are only reachable while halted, DHCSR and
+ * DFSR. The execute hook runs the loaded Thumb code on a small interpreter
+ * for the instructions the stubs use, so the hand assembled images are
+ * checked along with the control flow around them. Every target access can
+ * be made to fail once to walk the error paths.
+ *
+ *   make -C test
+ *   ./test/dap_stub_test [seed]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <furi_hal_cortex.h>
+
+#include "../target/dap_stub.h"
+#include "../target/dap_target.h"
+
+#define TEST_FLASH_BASE 0x08000000UL
+#define TEST_FLASH_SIZE 0x8000
+#define TEST_RAM_BASE 0x20000000UL
+#define TEST_RAM_SIZE 0x8000
+
+// where a simulated fault leaves the core
+#define TEST_FAULT_PC 0x08000200UL
+
+#define TEST_CPUID_M4 0x410FC241
+#define TEST_INSTRUCTIONS_PER_US 16
+#define TEST_TIMEOUT_US 1000000
+#define TEST_RUNS 300
+
+#define TEST_REG_COUNT 17
+#define TEST_XPSR_N (1UL << 31)
+#define TEST_XPSR_Z (1UL << 30)
+#define TEST_XPSR_C (1UL << 29)
+#define TEST_XPSR_V (1UL << 28)
+
+typedef struct {
+    uint8_t flash[TEST_FLASH_SIZE];
+    uint8_t ram[TEST_RAM_SIZE];
+    uint32_t regs[TEST_REG_COUNT];
+    uint32_t cpuid;
+    uint32_t dfsr;
+    bool halted;
+    bool mask_interrupts;
+
+    // access fault injection, fail_at < 0 never fails
+    int32_t accesses;
+    int32_t fail_at;
+    bool failed;
+    bool failed_restoring;
+    int32_t failed_reg;
+
+    // execute hook
+    bool ran;
+    bool restoring;
+    uint32_t entry[TEST_REG_COUNT];
+    bool entry_masked;
+    uint32_t halts;
+} TestTarget;
+
+static TestTarget test_target;
+static uint32_t test_seed;
+
+static uint32_t test_random(void) {
+    test_seed ^= test_seed << 13;
+    test_seed ^= test_seed >> 17;
+    test_seed ^= test_seed << 5;
+    return test_seed;
+}
+
+static bool test_access(void) {
+    if(test_target.accesses++ != test_target.fail_at) return true;
+    test_target.failed = true;
+    test_target.failed_restoring = test_target.restoring;
+    return false;
+}
+
+static uint8_t* test_memory(uint32_t address, size_t size, bool write) {
+    if(address >= TEST_RAM_BASE && address - TEST_RAM_BASE + size <= TEST_RAM_SIZE) {
+        return &test_target.ram[address - TEST_RAM_BASE];
+    }
+    if(!write && address >= TEST_FLASH_BASE &&
+       address - TEST_FLASH_BASE + size <= TEST_FLASH_SIZE) {
+        return &test_target.flash[address - TEST_FLASH_BASE];
+    }
+    return NULL;
+}
+
+/* dap_target layer */
+
+bool dap_target_read32(uint32_t address, uint32_t* value) {
+    if(!test_access()) return false;
+
+    if(address == 0xE000ED00) {
+        *value = test_target.cpuid;
+    } else if(address == DAP_TARGET_DHCSR) {
+        *value = DAP_TARGET_DHCSR_S_REGRDY | (test_target.halted ? DAP_TARGET_DHCSR_S_HALT : 0);
+    } else if(address == DAP_TARGET_DFSR) {
+        *value = test_target.dfsr;
+    } else {
+        const uint8_t* memory = test_memory(address, 4, false);
+        if(!memory || (address & 3)) return false;
+        memcpy(value, memory, 4);
+    }
+    return true;
+}
+
+bool dap_target_write32(uint32_t address, uint32_t value) {
+    if(test_target.ran && address == DAP_TARGET_DHCSR) test_target.restoring = true;
+    if(!test_access()) return false;
+
+    if(address == DAP_TARGET_DHCSR) {
+        if((value & 0xFFFF0000) != DAP_TARGET_DHCSR_DBGKEY) return true;
+        test_target.halted = value & DAP_TARGET_DHCSR_C_HALT;
+        test_target.mask_interrupts = value & DAP_TARGET_DHCSR_C_MASKINTS;
+    } else if(address == DAP_TARGET_DFSR) {
+        test_target.dfsr &= ~value;
+    } else {
+        uint8_t* memory = test_memory(address, 4, true);
+        if(!memory || (address & 3)) return false;
+        memcpy(memory, &value, 4);
+    }
+    return true;
+}
+
+bool dap_target_write_block(uint32_t address, const uint32_t* data, size_t count) {
+    if(!test_access()) return false;
+    uint8_t* memory = test_memory(address, count * 4, true);
+    if(!memory || (address & 3)) return false;
+    memcpy(memory, data, count * 4);
+    return true;
+}
+
+bool dap_target_is_halted(bool* halted) {
+    if(!test_access()) return false;
+    *halted = test_target.halted;
+    return true;
+}
+
+bool dap_target_halt(uint32_t timeout_us) {
+    (void)timeout_us;
+    if(!test_access()) return false;
+    test_target.halted = true;
+    test_target.halts++;
+    return true;
+}
+
+bool dap_target_resume(bool mask_interrupts) {
+    if(!test_access()) return false;
+    test_target.halted = false;
+    test_target.mask_interrupts = mask_interrupts;
+    return true;
+}
+
+// DCRSR only transfers while the core is halted
+bool dap_target_read_reg(uint8_t reg, uint32_t* value) {
+    if(!test_access()) return false;
+    if(!test_target.halted || reg >= TEST_REG_COUNT) return false;
+    *value = test_target.regs[reg];
+    return true;
+}
+
+bool dap_target_write_reg(uint8_t reg, uint32_t value) {
+    if(!test_access()) {
+        test_target.failed_reg = reg;
+        return false;
+    }
+    if(!test_target.halted || reg >= TEST_REG_COUNT) return false;
+    test_target.regs[reg] = value;
+    return true;
+}
+
+// only the execute hook path runs here
+FuriHalCortexTimer furi_hal_cortex_timer_get(uint32_t timeout_us) {
+    return (FuriHalCortexTimer){.start = 0, .value = timeout_us};
+}
+
+bool furi_hal_cortex_timer_is_expired(FuriHalCortexTimer cortex_timer) {
+    (void)cortex_timer;
+    return true;
+}
+
+/* Thumb-1 subset */
+
+static void test_flags_nz(uint32_t result) {
+    uint32_t* xpsr = &test_target.regs[DAP_TARGET_REG_XPSR];
+    *xpsr &= ~(TEST_XPSR_N | TEST_XPSR_Z);
+    if(result & 0x80000000) *xpsr |= TEST_XPSR_N;
+    if(result == 0) *xpsr |= TEST_XPSR_Z;
+}
+
+static void test_flag(uint32_t flag, bool set) {
+    uint32_t* xpsr = &test_target.regs[DAP_TARGET_REG_XPSR];
+    *xpsr = set ? (*xpsr | flag) : (*xpsr & ~flag);
+}
+
+static uint32_t test_add(uint32_t a, uint32_t b, bool carry) {
+    const uint64_t sum = (uint64_t)a + b + carry;
+    const uint32_t result = sum;
+    test_flags_nz(result);
+    test_flag(TEST_XPSR_C, sum >> 32);
+    test_flag(TEST_XPSR_V, (~(a ^ b) & (a ^ result)) >> 31);
+    return result;
+}
+
+static bool test_condition(uint8_t cond) {
+    const uint32_t xpsr = test_target.regs[DAP_TARGET_REG_XPSR];
+    switch(cond) {
+    case 0x0:
+        return xpsr & TEST_XPSR_Z;
+    case 0x1:
+        return !(xpsr & TEST_XPSR_Z);
+    case 0x2:
+        return xpsr & TEST_XPSR_C;
+    case 0x3:
+        return !(xpsr & TEST_XPSR_C);
+    default:
+        return false;
+    }
+}
+
+typedef enum {
+    TestStepNext,
+    TestStepBkpt,
+    TestStepFault,
+} TestStep;
+
+static TestStep test_step(void) {
+    uint32_t* r = test_target.regs;
+    const uint32_t pc = r[DAP_TARGET_REG_PC];
+    const uint8_t* fetch = test_memory(pc, 2, false);
+    if(!fetch || (pc & 1)) return TestStepFault;
+
+    const uint16_t op = fetch[0] | (fetch[1] << 8);
+    const uint8_t rd = op & 7;
+    const uint8_t rm = (op >> 3) & 7;
+    const uint8_t r8 = (op >> 8) & 7;
+    const uint8_t imm8 = op & 0xFF;
+    uint32_t next = pc + 2;
+
+    if((op & 0xF800) == 0x4800) {
+        // LDR Rt, [PC, #imm8 * 4]
+        const uint8_t* memory = test_memory(((pc + 4) & ~3UL) + imm8 * 4, 4, false);
+        if(!memory) return TestStepFault;
+        memcpy(&r[r8], memory, 4);
+    } else if((op & 0xF800) == 0x2000) {
+        r[r8] = imm8;
+        test_flags_nz(r[r8]);
+    } else if((op & 0xF800) == 0x2800) {
+        test_add(r[r8], ~(uint32_t)imm8, true);
+    } else if((op & 0xF800) == 0x3000) {
+        r[r8] = test_add(r[r8], imm8, false);
+    } else if((op & 0xF800) == 0x3800) {
+        r[r8] = test_add(r[r8], ~(uint32_t)imm8, true);
+    } else if((op & 0xF800) == 0x7800) {
+        // LDRB Rt, [Rn, #imm5]
+        const uint8_t* memory = test_memory(r[rm] + ((op >> 6) & 0x1F), 1, false);
+        if(!memory) return TestStepFault;
+        r[rd] = *memory;
+    } else if((op & 0xF800) == 0x0800) {
+        // LSRS Rd, Rm, #imm5, 0 encodes 32
+        const uint8_t shift = ((op >> 6) & 0x1F) ? ((op >> 6) & 0x1F) : 32;
+        const uint64_t value = r[rm];
+        test_flag(TEST_XPSR_C, (value >> (shift - 1)) & 1);
+        r[rd] = value >> shift;
+        test_flags_nz(r[rd]);
+    } else if((op & 0xFFC0) == 0x4040) {
+        r[rd] ^= r[rm];
+        test_flags_nz(r[rd]);
+    } else if((op & 0xFFC0) == 0x43C0) {
+        r[rd] = ~r[rm];
+        test_flags_nz(r[rd]);
+    } else if((op & 0xF000) == 0xD000) {
+        // B<cond>, conditions past CC are not used by any stub
+        const uint8_t cond = (op >> 8) & 0xF;
+        if(cond > 0x3) return TestStepFault;
+        if(test_condition(cond)) next = pc + 4 + (int8_t)imm8 * 2;
+    } else if((op & 0xF800) == 0xE000) {
+        const int32_t offset = (int32_t)((uint32_t)(op & 0x7FF) << 21) >> 20;
+        next = pc + 4 + offset;
+    } else if((op & 0xFF00) == 0xBE00) {
+        return TestStepBkpt;
+    } else {
+        return TestStepFault;
+    }
+
+    r[DAP_TARGET_REG_PC] = next;
+    return TestStepNext;
+}
+
+static bool test_execute(void* context, uint32_t timeout_us, bool* halted) {
+    (void)context;
+    test_target.ran = true;
+    if(!test_target.halted) {
+        fprintf(stderr, "Stub started on a running core\n");
+        exit(2);
+    }
+    if(!test_access()) return false;
+
+    memcpy(test_target.entry, test_target.regs, sizeof(test_target.regs));
+    test_target.halted = false;
+    test_target.entry_masked = true;
+
+    for(uint64_t i = 0; i < (uint64_t)timeout_us * TEST_INSTRUCTIONS_PER_US; i++) {
+        const TestStep step = test_step();
+        if(step == TestStepNext) continue;
+
+        if(step == TestStepBkpt) {
+            test_target.dfsr |= DAP_TARGET_DFSR_BKPT;
+        } else {
+            // lockup, the debugger finds the core in the fault handler
+            test_target.regs[DAP_TARGET_REG_PC] = TEST_FAULT_PC;
+        }
+        test_target.halted = true;
+        break;
+    }
+
+    *halted = test_target.halted;
+    return true;
+}
+
+/* checks */
+
+// zlib CRC32, bit by bit like the stub
+static uint32_t test_crc32(const uint8_t* data, size_t size) {
+    uint32_t crc = 0xFFFFFFFF;
+    for(size_t i = 0; i < size; i++) {
+        crc ^= data[i];
+        for(uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ ((crc & 1) ? 0xEDB88320 : 0);
+        }
+    }
+    return ~crc;
+}
+
+static void test_target_init(bool halted) {
+    memset(&test_target, 0, sizeof(test_target));
+    for(size_t i = 0; i < TEST_FLASH_SIZE; i++) {
+        test_target.flash[i] = test_random();
+    }
+    for(size_t i = 0; i < TEST_REG_COUNT; i++) {
+        test_target.regs[i] = test_random();
+    }
+    test_target.cpuid = TEST_CPUID_M4;
+    test_target.halted = halted;
+    test_target.fail_at = -1;
+    test_target.failed_reg = -1;
+}
+
+// registers the stub clobbers must be back, apart from one whose restore failed
+static bool test_check_restored(const uint32_t* regs, bool halted) {
+    static const uint8_t saved[] = {
+        0, 1, 2, 3, 4, 5, DAP_TARGET_REG_SP, DAP_TARGET_REG_PC, DAP_TARGET_REG_XPSR};
+    for(size_t i = 0; i < sizeof(saved); i++) {
+        if(saved[i] == test_target.failed_reg) continue;
+        if(test_target.regs[saved[i]] != regs[saved[i]]) return false;
+    }
+    // only the final resume may leave the core halted
+    return test_target.halted == halted || (test_target.failed && test_target.failed_restoring);
+}
+
+static bool test_fail(const char* name, uint32_t run, const char* message) {
+    fprintf(stderr, "%s %lu: %s\n", name, (unsigned long)run, message);
+    return false;
+}
+
+typedef struct {
+    uint32_t workarea;
+    uint32_t address;
+    uint32_t length;
+    uint32_t timeout_us;
+    bool halted;
+} TestRun;
+
+static void test_run_random(TestRun* run) {
+    run->workarea = TEST_RAM_BASE + (test_random() % (TEST_RAM_SIZE / 2 / 4)) * 4;
+    run->length = test_random() % 1500;
+    if(test_random() & 1) {
+        run->address = TEST_FLASH_BASE + test_random() % (TEST_FLASH_SIZE - run->length);
+    } else {
+        // RAM past the work area
+        run->address = TEST_RAM_BASE + TEST_RAM_SIZE / 2 +
+                       test_random() % (TEST_RAM_SIZE / 2 - run->length);
+    }
+    run->timeout_us = TEST_TIMEOUT_US;
+    run->halted = test_random() & 1;
+}
+
+static bool test_run(const TestRun* run, uint32_t* crc) {
+    return dap_stub_crc32(run->workarea, run->address, run->length, run->timeout_us, crc);
+}
+
+static uint32_t test_expected(const TestRun* run) {
+    return test_crc32(test_memory(run->address, run->length, false), run->length);
+}
+
+static bool test_crc(uint32_t index) {
+    TestRun run;
+    test_target_init(false);
+    test_run_random(&run);
+    test_target.halted = run.halted;
+
+    uint32_t regs[TEST_REG_COUNT];
+    memcpy(regs, test_target.regs, sizeof(regs));
+    const uint32_t expected = test_expected(&run);
+
+    uint32_t crc = 0;
+    if(!test_run(&run, &crc)) return test_fail("CRC", index, "run failed");
+    if(crc != expected) return test_fail("CRC", index, "wrong CRC");
+
+    const uint32_t* entry = test_target.entry;
+    if(entry[0] != run.address || entry[1] != run.length || entry[2] != 0xFFFFFFFF ||
+       entry[3] != 0) {
+        return test_fail("CRC", index, "arguments");
+    }
+    if(entry[DAP_TARGET_REG_PC] != run.workarea ||
+       entry[DAP_TARGET_REG_SP] != ((run.workarea + DAP_STUB_WORKAREA_SIZE) & ~7UL) ||
+       entry[DAP_TARGET_REG_XPSR] != DAP_TARGET_XPSR_THUMB) {
+        return test_fail("CRC", index, "entry state");
+    }
+    if(!test_target.entry_masked) return test_fail("CRC", index, "interrupts not masked");
+    if(test_target.dfsr & DAP_TARGET_DFSR_BKPT) return test_fail("CRC", index, "DFSR left set");
+    if(!test_check_restored(regs, run.halted)) return test_fail("CRC", index, "not restored");
+    return true;
+}
+
+static bool test_timeout(void) {
+    TestRun run;
+    test_target_init(false);
+    test_run_random(&run);
+    run.length = 1000;
+    run.address = TEST_FLASH_BASE;
+    run.timeout_us = 10;
+
+    uint32_t regs[TEST_REG_COUNT];
+    memcpy(regs, test_target.regs, sizeof(regs));
+
+    uint32_t crc;
+    if(test_run(&run, &crc)) return test_fail("Timeout", 0, "run succeeded");
+    if(test_target.halts != 2) return test_fail("Timeout", 0, "core not halted after timeout");
+    if(!test_check_restored(regs, false)) return test_fail("Timeout", 0, "not restored");
+    return true;
+}
+
+static bool test_fault(void) {
+    TestRun run;
+    test_target_init(true);
+    test_run_random(&run);
+    run.address = 0x60000000;
+    run.length = 16;
+
+    uint32_t regs[TEST_REG_COUNT];
+    memcpy(regs, test_target.regs, sizeof(regs));
+
+    uint32_t crc;
+    if(test_run(&run, &crc)) return test_fail("Fault", 0, "run succeeded");
+    if(!test_check_restored(regs, true)) return test_fail("Fault", 0, "not restored");
+    return true;
+}
+
+// every single target access failing once
+static bool test_access_errors(void) {
+    TestRun run;
+    const uint32_t seed = test_random();
+
+    test_seed = seed;
+    test_target_init(false);
+    test_run_random(&run);
+    run.length = 64;
+    test_target.halted = run.halted;
+    uint32_t crc;
+    test_run(&run, &crc);
+    const int32_t accesses = test_target.accesses;
+
+    for(int32_t at = 0; at < accesses; at++) {
+        test_seed = seed;
+        test_target_init(false);
+        test_run_random(&run);
+        run.length = 64;
+        test_target.halted = run.halted;
+        test_target.fail_at = at;
+
+        uint32_t regs[TEST_REG_COUNT];
+        memcpy(regs, test_target.regs, sizeof(regs));
+        const uint32_t expected = test_expected(&run);
+
+        crc = 0;
+        const bool ok = test_run(&run, &crc);
+        if(!test_target.failed) return test_fail("Access", at, "no access failed");
+        if(ok && !test_target.failed_restoring) return test_fail("Access", at, "error lost");
+        if(ok && crc != expected) return test_fail("Access", at, "wrong CRC");
+        if(!test_check_restored(regs, run.halted)) return test_fail("Access", at, "not restored");
+    }
+    return true;
+}
+
+static bool test_cores(void) {
+    static const struct {
+        uint32_t cpuid;
+        bool supported;
+    } cores[] = {
+        {0x410CC200, true}, // M0
+        {0x410CC601, true}, // M0+
+        {0x412FC231, true}, // M3
+        {0x410FC241, true}, // M4
+        {0x411FD210, true}, // M33
+        {0x410FC150, false}, // R5
+        {0x00000000, false},
+    };
+
+    for(size_t i = 0; i < sizeof(cores) / sizeof(cores[0]); i++) {
+        test_target_init(true);
+        test_target.cpuid = cores[i].cpuid;
+        if(dap_stub_is_supported() != cores[i].supported) return test_fail("Core", i, "CPUID");
+    }
+
+    test_target_init(true);
+    test_target.fail_at = 0;
+    if(dap_stub_is_supported()) return test_fail("Core", 0, "read error ignored");
+    return true;
+}
+
+int main(int argc, char** argv) {
+    const uint32_t seed = argc > 1 ? strtoul(argv[1], NULL, 0) : 1;
+    test_seed = seed ? seed : 1;
+    dap_stub_set_execute_hook(test_execute, NULL);
+
+    size_t failed = 0;
+    for(uint32_t i = 0; i < TEST_RUNS; i++) {
+        if(!test_crc(i)) failed++;
+    }
+    if(!test_timeout()) failed++;
+    if(!test_fault()) failed++;
+    if(!test_access_errors()) failed++;
+    if(!test_cores()) failed++;
+
+    printf("Seed %lu: %zu checks failed\n", (unsigned long)seed, failed);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,32 @@
+#pragma once
+/*
+ * Just enough of furi.h to build target independent sources on the host
+ */
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define COUNT_OF(x) (sizeof(x) / sizeof(x[0]))
+
+#ifndef MIN
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#endif
+#ifndef MAX
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+#endif
+
+#define furi_assert(x) assert(x)
+#define furi_check(x) assert(x)
+
+// logs are dropped, the arguments still count as used
+static inline void furi_log_discard(const char* tag, const char* format, ...) {
+    (void)tag;
+    (void)format;
+}
+
+#define FURI_LOG_E(tag, ...) furi_log_discard(tag, __VA_ARGS__)
+#define FURI_LOG_W(tag, ...) furi_log_discard(tag, __VA_ARGS__)
+#define FURI_LOG_I(tag, ...) furi_log_discard(tag, __VA_ARGS__)
+#define FURI_LOG_D(tag, ...) furi_log_discard(tag, __VA_ARGS__)
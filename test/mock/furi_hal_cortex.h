@@ -0,0 +1,16 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Cortex timer of the host tests, the test provides the clock
+ */
+
+typedef struct {
+    uint32_t start;
+    uint32_t value;
+} FuriHalCortexTimer;
+
+FuriHalCortexTimer furi_hal_cortex_timer_get(uint32_t timeout_us);
+
+bool furi_hal_cortex_timer_is_expired(FuriHalCortexTimer cortex_timer);
@@ -0,0 +1,120 @@
+#!/usr/bin/env python3
+"""Function histogram from a DAP Link PC sampling capture.
+
+The capture is either the profile.pcs file written to the SD card or data
+read from the stream endpoint of the CMSIS-DAP v2 interface (--usb). Both
+start with the "PCS1" magic and the sample rate, followed by one little
+endian PC per sample, 0xFFFFFFFF while the core was halted or asleep.
+
+    dap_profile.py firmware.elf profile.pcs
+    dap_profile.py firmware.elf --usb 10 --save capture.pcs
+
+Needs pyelftools, and pyusb for --usb.
+"""
+
+import argparse
+import bisect
+import struct
+import sys
+import time
+
+MAGIC = 0x31534350
+IDLE_PC = 0xFFFFFFFF
+
+USB_VID = 0x0483
+USB_PID = 0x5740
+USB_STREAM_EP = 0x83
+
+
+def capture_usb(seconds):
+    import usb.core
+
+    dev = usb.core.find(idVendor=USB_VID, idProduct=USB_PID)
+    if dev is None:
+        sys.exit("DAP Link not found")
+
+    data = bytearray()
+    end = time.monotonic() + seconds
+    while time.monotonic() < end:
+        try:
+            data += dev.read(USB_STREAM_EP, 4096, timeout=100)
+        except usb.core.USBTimeoutError:
+            pass
+    return bytes(data)
+
+
+def load_symbols(path):
+    from elftools.elf.elffile import ELFFile
+
+    functions = []
+    with open(path, "rb") as f:
+        symtab = ELFFile(f).get_section_by_name(".symtab")
+        if symtab is None:
+            sys.exit("%s has no symbol table" % path)
+        for sym in symtab.iter_symbols():
+            if sym["st_info"]["type"] == "STT_FUNC" and sym["st_value"]:
+                # Thumb addresses carry bit 0
+                start = sym["st_value"] & ~1
+                functions.append((start, start + max(sym["st_size"], 2), sym.name))
+
+    functions.sort()
+    return functions
+
+
+def parse(data):
+    if len(data) < 8:
+        sys.exit("Capture too short")
+    magic, rate = struct.unpack_from("<II", data)
+    if magic != MAGIC:
+        sys.exit("Not a PC sampling capture")
+    count = (len(data) - 8) // 4
+    return rate, struct.unpack_from("<%dI" % count, data, 8)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("elf")
+    parser.add_argument("capture", nargs="?")
+    parser.add_argument("--usb", type=float, metavar="SECONDS", help="capture over USB")
+    parser.add_argument("--save", metavar="FILE", help="keep the USB capture")
+    parser.add_argument("--top", type=int, default=30)
+    args = parser.parse_args()
+
+    if args.usb:
+        data = capture_usb(args.usb)
+        if args.save:
+            with open(args.save, "wb") as f:
+                f.write(data)
+    elif args.capture:
+        with open(args.capture, "rb") as f:
+            data = f.read()
+    else:
+        parser.error("capture file or --usb required")
+
+    rate, samples = parse(data)
+    functions = load_symbols(args.elf)
+    starts = [f[0] for f in functions]
+
+    histogram = {}
+    idle = 0
+    for pc in samples:
+        if pc == IDLE_PC:
+            idle += 1
+            continue
+        i = bisect.bisect_right(starts, pc) - 1
+        if i >= 0 and pc < functions[i][1]:
+            name = functions[i][2]
+        else:
+            name = "0x%08x" % pc
+        histogram[name] = histogram.get(name, 0) + 1
+
+    total = len(samples)
+    print("%d samples at %s, %d idle" % (total, "%d Hz" % rate if rate else "max rate", idle))
+    if total == 0:
+        return
+    for name, count in sorted(histogram.items(), key=lambda x: -x[1])[: args.top]:
+        print("%6.2f%% %8d  %s" % (100.0 * count / total, count, name))
+
+
+if __name__ == "__main__":
+    main()
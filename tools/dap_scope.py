@@ -0,0 +1,85 @@
+#!/usr/bin/env python3
+"""CSV from a DAP Link data scope capture.
+
+The capture is either the scope.dsc file written to the SD card or data read
+from the stream endpoint of the CMSIS-DAP v2 interface (--usb). It starts
+with the "DSC1" magic, the sample rate, the entry count and the address and
+width of every entry. Each record then holds the probe cycle count, the
+number of records dropped so far and the entry values, little endian.
+
+    dap_scope.py scope.dsc > scope.csv
+    dap_scope.py --usb 10 --save capture.dsc > scope.csv
+
+Needs pyusb for --usb.
+"""
+
+import argparse
+import struct
+import sys
+
+from dap_profile import capture_usb
+
+MAGIC = 0x31435344
+FORMATS = {1: "B", 2: "H", 4: "I"}
+
+
+def parse(data):
+    if len(data) < 12:
+        sys.exit("Capture too short")
+    magic, rate, count = struct.unpack_from("<III", data)
+    if magic != MAGIC:
+        sys.exit("Not a data scope capture")
+
+    entries = []
+    offset = 12
+    for _ in range(count):
+        address, width = struct.unpack_from("<IB", data, offset)
+        entries.append((address, width))
+        offset += 5
+
+    record = struct.Struct("<II" + "".join(FORMATS[w] for _, w in entries))
+    records = []
+    while offset + record.size <= len(data):
+        records.append(record.unpack_from(data, offset))
+        offset += record.size
+    return rate, entries, records
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("capture", nargs="?")
+    parser.add_argument("--usb", type=float, metavar="SECONDS", help="capture over USB")
+    parser.add_argument("--save", metavar="FILE", help="keep the USB capture")
+    parser.add_argument("--clock", type=float, default=64e6, help="probe core clock in Hz")
+    args = parser.parse_args()
+
+    if args.usb:
+        data = capture_usb(args.usb)
+        if args.save:
+            with open(args.save, "wb") as f:
+                f.write(data)
+    elif args.capture:
+        with open(args.capture, "rb") as f:
+            data = f.read()
+    else:
+        parser.error("capture file or --usb required")
+
+    rate, entries, records = parse(data)
+    print("time,dropped," + ",".join("0x%08x" % a for a, _ in entries))
+
+    # the cycle counter wraps after a minute, unwrap it for the time column
+    start = records[0][0] if records else 0
+    cycles = 0
+    last = start
+    for record in records:
+        cycles += (record[0] - last) & 0xFFFFFFFF
+        last = record[0]
+        values = ",".join(str(v) for v in record[2:])
+        print("%.6f,%d,%s" % (cycles / args.clock, record[1], values))
+
+    dropped = records[-1][1] if records else 0
+    print("%d records at %d Hz, %d dropped" % (len(records), rate, dropped), file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
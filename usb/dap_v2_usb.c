@@ -11,19 +11,8 @@
 
 #define HID_EP_IN 0x80
 #define HID_EP_OUT 0x00
-
-#define DAP_HID_EP_SEND 1
-#define DAP_HID_EP_RECV 2
-#define DAP_HID_EP_BULK_RECV 3
-#define DAP_HID_EP_BULK_SEND 4
-#define DAP_CDC_EP_COMM 5
-#define DAP_CDC_EP_SEND 6
-#define DAP_CDC_EP_RECV 7
-
-#define DAP_HID_EP_IN (HID_EP_IN | DAP_HID_EP_SEND)
-#define DAP_HID_EP_OUT (HID_EP_OUT | DAP_HID_EP_RECV)
-#define DAP_HID_EP_BULK_IN (HID_EP_IN | DAP_HID_EP_BULK_SEND)
-#define DAP_HID_EP_BULK_OUT (HID_EP_OUT | DAP_HID_EP_BULK_RECV)
+#define DAP_EP_NUMBER_MASK 0x07
+#define DAP_EP_NUMBER_MAX 7
 
 #define DAP_HID_EP_SIZE 64
 #define DAP_CDC_COMM_EP_SIZE 8
@@ -32,24 +21,21 @@
 #define DAP_BULK_INTERVAL 0
 #define DAP_HID_INTERVAL 1
 #define DAP_CDC_INTERVAL 0
-#define DAP_CDC_COMM_INTERVAL 1
+// no serial state notifications are ever sent, so the host may poll rarely
+#define DAP_CDC_COMM_INTERVAL 255
 
 #define DAP_HID_VID 0x0483
 #define DAP_HID_PID 0x5740
 
 #define DAP_USB_EP0_SIZE 8
 
+#define DAP_USB_CFG_DESC_SIZE 256
+#define DAP_USB_EP_COUNT 12
+#define DAP_USB_NO_INTERFACE 0xFF
+
 #define EP_CFG_DECONFIGURE 0
 #define EP_CFG_CONFIGURE 1
 
-enum {
-    USB_INTF_HID,
-    USB_INTF_BULK,
-    USB_INTF_CDC_COMM,
-    USB_INTF_CDC_DATA,
-    USB_INTF_COUNT,
-};
-
 enum {
     USB_STR_ZERO,
     USB_STR_MANUFACTURER,
@@ -58,6 +44,7 @@ enum {
     USB_STR_CMSIS_DAP_V1,
     USB_STR_CMSIS_DAP_V2,
     USB_STR_COM_PORT,
+    USB_STR_COM_PORT_2,
     USB_STR_COUNT,
 };
 
@@ -86,21 +73,33 @@ static const struct usb_string_descriptor dev_dap_v2_descr =
 
 static const struct usb_string_descriptor dev_com_descr = USB_STRING_DESC("Virtual COM-Port");
 
-struct HidConfigDescriptor {
-    struct usb_config_descriptor configuration;
+static const struct usb_string_descriptor dev_com_2_descr =
+    USB_STRING_DESC("Virtual COM-Port 2");
+
+/*
+ * The configuration descriptor is put together from one block per function.
+ * Interface numbers and endpoint numbers are handed out in order, so every
+ * function gets an endpoint number of its own (IN and OUT share it).
+ */
 
-    // CMSIS-DAP v1
+// CMSIS-DAP v1
+struct HidFunctionDescriptor {
     struct usb_interface_descriptor hid_interface;
     struct usb_hid_descriptor hid;
     struct usb_endpoint_descriptor hid_ep_in;
     struct usb_endpoint_descriptor hid_ep_out;
+} __attribute__((packed));
 
-    // CMSIS-DAP v2
+// CMSIS-DAP v2
+struct BulkFunctionDescriptor {
     struct usb_interface_descriptor bulk_interface;
     struct usb_endpoint_descriptor bulk_ep_out;
     struct usb_endpoint_descriptor bulk_ep_in;
+    struct usb_endpoint_descriptor bulk_ep_stream;
+} __attribute__((packed));
 
-    // CDC
+// CDC
+struct CdcFunctionDescriptor {
     struct usb_iad_descriptor iad;
     struct usb_interface_descriptor interface_comm;
     struct usb_cdc_header_desc cdc_header;
@@ -111,10 +110,10 @@ struct HidConfigDescriptor {
     struct usb_interface_descriptor interface_data;
     struct usb_endpoint_descriptor ep_in;
     struct usb_endpoint_descriptor ep_out;
-
 } __attribute__((packed));
 
-static const struct usb_device_descriptor hid_device_desc = {
+// bcdUSB is 2.1 only with the v2 interface, older hosts never ask for the BOS then
+static struct usb_device_descriptor hid_device_desc = {
     .bLength = sizeof(struct usb_device_descriptor),
     .bDescriptorType = USB_DTYPE_DEVICE,
     .bcdUSB = VERSION_BCD(2, 1, 0),
@@ -148,25 +147,24 @@ static const uint8_t hid_report_desc[] = {
     0xc0, // End Collection
 };
 
-static const struct HidConfigDescriptor hid_cfg_desc = {
-    .configuration =
-        {
-            .bLength = sizeof(struct usb_config_descriptor),
-            .bDescriptorType = USB_DTYPE_CONFIGURATION,
-            .wTotalLength = sizeof(struct HidConfigDescriptor),
-            .bNumInterfaces = USB_INTF_COUNT,
-            .bConfigurationValue = 1,
-            .iConfiguration = NO_DESCRIPTOR,
-            .bmAttributes = USB_CFG_ATTR_RESERVED,
-            .bMaxPower = USB_CFG_POWER_MA(500),
-        },
+static const struct usb_config_descriptor hid_cfg_desc = {
+    .bLength = sizeof(struct usb_config_descriptor),
+    .bDescriptorType = USB_DTYPE_CONFIGURATION,
+    .wTotalLength = 0, // set by the layout
+    .bNumInterfaces = 0, // set by the layout
+    .bConfigurationValue = 1,
+    .iConfiguration = NO_DESCRIPTOR,
+    .bmAttributes = USB_CFG_ATTR_RESERVED,
+    .bMaxPower = USB_CFG_POWER_MA(500),
+};
 
-    // CMSIS-DAP v1
+// interface numbers and endpoint numbers are filled in by the layout
+static const struct HidFunctionDescriptor hid_function_desc = {
     .hid_interface =
         {
             .bLength = sizeof(struct usb_interface_descriptor),
             .bDescriptorType = USB_DTYPE_INTERFACE,
-            .bInterfaceNumber = USB_INTF_HID,
+            .bInterfaceNumber = 0,
             .bAlternateSetting = 0,
             .bNumEndpoints = 2,
             .bInterfaceClass = USB_CLASS_HID,
@@ -190,7 +188,7 @@ static const struct HidConfigDescriptor hid_cfg_desc = {
         {
             .bLength = sizeof(struct usb_endpoint_descriptor),
             .bDescriptorType = USB_DTYPE_ENDPOINT,
-            .bEndpointAddress = DAP_HID_EP_IN,
+            .bEndpointAddress = HID_EP_IN,
             .bmAttributes = USB_EPTYPE_INTERRUPT,
             .wMaxPacketSize = DAP_HID_EP_SIZE,
             .bInterval = DAP_HID_INTERVAL,
@@ -200,20 +198,21 @@ static const struct HidConfigDescriptor hid_cfg_desc = {
         {
             .bLength = sizeof(struct usb_endpoint_descriptor),
             .bDescriptorType = USB_DTYPE_ENDPOINT,
-            .bEndpointAddress = DAP_HID_EP_OUT,
+            .bEndpointAddress = HID_EP_OUT,
             .bmAttributes = USB_EPTYPE_INTERRUPT,
             .wMaxPacketSize = DAP_HID_EP_SIZE,
             .bInterval = DAP_HID_INTERVAL,
         },
+};
 
-    // CMSIS-DAP v2
+static const struct BulkFunctionDescriptor bulk_function_desc = {
     .bulk_interface =
         {
             .bLength = sizeof(struct usb_interface_descriptor),
             .bDescriptorType = USB_DTYPE_INTERFACE,
-            .bInterfaceNumber = USB_INTF_BULK,
+            .bInterfaceNumber = 0,
             .bAlternateSetting = 0,
-            .bNumEndpoints = 2,
+            .bNumEndpoints = 3,
             .bInterfaceClass = USB_CLASS_VENDOR,
             .bInterfaceSubClass = 0,
             .bInterfaceProtocol = 0,
@@ -224,7 +223,7 @@ static const struct HidConfigDescriptor hid_cfg_desc = {
         {
             .bLength = sizeof(struct usb_endpoint_descriptor),
             .bDescriptorType = USB_DTYPE_ENDPOINT,
-            .bEndpointAddress = DAP_HID_EP_BULK_OUT,
+            .bEndpointAddress = HID_EP_OUT,
             .bmAttributes = USB_EPTYPE_BULK,
             .wMaxPacketSize = DAP_HID_EP_SIZE,
             .bInterval = DAP_BULK_INTERVAL,
@@ -234,18 +233,30 @@ static const struct HidConfigDescriptor hid_cfg_desc = {
         {
             .bLength = sizeof(struct usb_endpoint_descriptor),
             .bDescriptorType = USB_DTYPE_ENDPOINT,
-            .bEndpointAddress = DAP_HID_EP_BULK_IN,
+            .bEndpointAddress = HID_EP_IN,
+            .bmAttributes = USB_EPTYPE_BULK,
+            .wMaxPacketSize = DAP_HID_EP_SIZE,
+            .bInterval = DAP_BULK_INTERVAL,
+        },
+
+    // third endpoint is where CMSIS-DAP v2 hosts look for SWO data
+    .bulk_ep_stream =
+        {
+            .bLength = sizeof(struct usb_endpoint_descriptor),
+            .bDescriptorType = USB_DTYPE_ENDPOINT,
+            .bEndpointAddress = HID_EP_IN,
             .bmAttributes = USB_EPTYPE_BULK,
             .wMaxPacketSize = DAP_HID_EP_SIZE,
             .bInterval = DAP_BULK_INTERVAL,
         },
+};
 
-    // CDC
+static const struct CdcFunctionDescriptor cdc_function_desc = {
     .iad =
         {
             .bLength = sizeof(struct usb_iad_descriptor),
             .bDescriptorType = USB_DTYPE_INTERFASEASSOC,
-            .bFirstInterface = USB_INTF_CDC_COMM,
+            .bFirstInterface = 0,
             .bInterfaceCount = 2,
             .bFunctionClass = USB_CLASS_CDC,
             .bFunctionSubClass = USB_CDC_SUBCLASS_ACM,
@@ -256,7 +267,7 @@ static const struct HidConfigDescriptor hid_cfg_desc = {
         {
             .bLength = sizeof(struct usb_interface_descriptor),
             .bDescriptorType = USB_DTYPE_INTERFACE,
-            .bInterfaceNumber = USB_INTF_CDC_COMM,
+            .bInterfaceNumber = 0,
             .bAlternateSetting = 0,
             .bNumEndpoints = 1,
             .bInterfaceClass = USB_CLASS_CDC,
@@ -296,15 +307,15 @@ static const struct HidConfigDescriptor hid_cfg_desc = {
             .bFunctionLength = sizeof(struct usb_cdc_union_desc),
             .bDescriptorType = USB_DTYPE_CS_INTERFACE,
             .bDescriptorSubType = USB_DTYPE_CDC_UNION,
-            .bMasterInterface0 = USB_INTF_CDC_COMM,
-            .bSlaveInterface0 = USB_INTF_CDC_DATA,
+            .bMasterInterface0 = 0,
+            .bSlaveInterface0 = 0,
         },
 
     .ep_comm =
         {
             .bLength = sizeof(struct usb_endpoint_descriptor),
             .bDescriptorType = USB_DTYPE_ENDPOINT,
-            .bEndpointAddress = HID_EP_IN | DAP_CDC_EP_COMM,
+            .bEndpointAddress = HID_EP_IN,
             .bmAttributes = USB_EPTYPE_INTERRUPT,
             .wMaxPacketSize = DAP_CDC_COMM_EP_SIZE,
             .bInterval = DAP_CDC_COMM_INTERVAL,
@@ -314,7 +325,7 @@ static const struct HidConfigDescriptor hid_cfg_desc = {
         {
             .bLength = sizeof(struct usb_interface_descriptor),
             .bDescriptorType = USB_DTYPE_INTERFACE,
-            .bInterfaceNumber = USB_INTF_CDC_DATA,
+            .bInterfaceNumber = 0,
             .bAlternateSetting = 0,
             .bNumEndpoints = 2,
             .bInterfaceClass = USB_CLASS_CDC_DATA,
@@ -327,7 +338,7 @@ static const struct HidConfigDescriptor hid_cfg_desc = {
         {
             .bLength = sizeof(struct usb_endpoint_descriptor),
             .bDescriptorType = USB_DTYPE_ENDPOINT,
-            .bEndpointAddress = HID_EP_IN | DAP_CDC_EP_SEND,
+            .bEndpointAddress = HID_EP_IN,
             .bmAttributes = USB_EPTYPE_BULK,
             .wMaxPacketSize = DAP_CDC_EP_SIZE,
             .bInterval = DAP_CDC_INTERVAL,
@@ -337,7 +348,7 @@ static const struct HidConfigDescriptor hid_cfg_desc = {
         {
             .bLength = sizeof(struct usb_endpoint_descriptor),
             .bDescriptorType = USB_DTYPE_ENDPOINT,
-            .bEndpointAddress = HID_EP_OUT | DAP_CDC_EP_RECV,
+            .bEndpointAddress = HID_EP_OUT,
             .bmAttributes = USB_EPTYPE_BULK,
             .wMaxPacketSize = DAP_CDC_EP_SIZE,
             .bInterval = DAP_CDC_INTERVAL,
@@ -352,22 +363,23 @@ typedef struct USB_PACK {
     usb_winusb_capability_descriptor_t winusb;
 } usb_bos_hierarchy_t;
 
+// device-wide for the single interface profiles, a function subset otherwise
 typedef struct USB_PACK {
-    usb_winusb_subset_header_function_t header;
     usb_winusb_feature_compatble_id_t comp_id;
     usb_winusb_feature_reg_property_guids_t property;
-} usb_msos_descriptor_subset_t;
+} usb_msos_features_t;
 
 typedef struct USB_PACK {
     usb_winusb_set_header_descriptor_t header;
-    usb_msos_descriptor_subset_t subset;
+    usb_winusb_subset_header_function_t subset;
+    usb_msos_features_t features;
 } usb_msos_descriptor_set_t;
 
 #define USB_DTYPE_BINARY_OBJECT_STORE 15
 #define USB_DTYPE_DEVICE_CAPABILITY_DESCRIPTOR 16
 #define USB_DC_TYPE_PLATFORM 5
 
-const usb_bos_hierarchy_t usb_bos_hierarchy = {
+static usb_bos_hierarchy_t usb_bos_hierarchy = {
     .bos =
         {
             .bLength = sizeof(usb_binary_object_store_descriptor_t),
@@ -383,96 +395,113 @@ const usb_bos_hierarchy_t usb_bos_hierarchy = {
             .bReserved = 0,
             .PlatformCapabilityUUID = USB_WINUSB_PLATFORM_CAPABILITY_ID,
             .dwWindowsVersion = USB_WINUSB_WINDOWS_VERSION,
-            .wMSOSDescriptorSetTotalLength = sizeof(usb_msos_descriptor_set_t),
+            .wMSOSDescriptorSetTotalLength = 0, // set by the layout
             .bMS_VendorCode = USB_WINUSB_VENDOR_CODE,
             .bAltEnumCode = 0,
         },
 };
 
-const usb_msos_descriptor_set_t usb_msos_descriptor_set = {
-    .header =
+static const usb_msos_features_t usb_msos_features = {
+    .comp_id =
         {
-            .wLength = sizeof(usb_winusb_set_header_descriptor_t),
-            .wDescriptorType = USB_WINUSB_SET_HEADER_DESCRIPTOR,
-            .dwWindowsVersion = USB_WINUSB_WINDOWS_VERSION,
-            .wDescriptorSetTotalLength = sizeof(usb_msos_descriptor_set_t),
+            .wLength = sizeof(usb_winusb_feature_compatble_id_t),
+            .wDescriptorType = USB_WINUSB_FEATURE_COMPATBLE_ID,
+            .CompatibleID = "WINUSB\0\0",
+            .SubCompatibleID = {0},
         },
 
-    .subset =
+    .property =
         {
-            .header =
-                {
-                    .wLength = sizeof(usb_winusb_subset_header_function_t),
-                    .wDescriptorType = USB_WINUSB_SUBSET_HEADER_FUNCTION,
-                    .bFirstInterface = USB_INTF_BULK,
-                    .bReserved = 0,
-                    .wSubsetLength = sizeof(usb_msos_descriptor_subset_t),
-                },
-
-            .comp_id =
-                {
-                    .wLength = sizeof(usb_winusb_feature_compatble_id_t),
-                    .wDescriptorType = USB_WINUSB_FEATURE_COMPATBLE_ID,
-                    .CompatibleID = "WINUSB\0\0",
-                    .SubCompatibleID = {0},
-                },
-
-            .property =
-                {
-                    .wLength = sizeof(usb_winusb_feature_reg_property_guids_t),
-                    .wDescriptorType = USB_WINUSB_FEATURE_REG_PROPERTY,
-                    .wPropertyDataType = USB_WINUSB_PROPERTY_DATA_TYPE_MULTI_SZ,
-                    .wPropertyNameLength =
-                        sizeof(usb_msos_descriptor_set.subset.property.PropertyName),
-                    .PropertyName = {'D', 0, 'e', 0, 'v', 0, 'i', 0, 'c', 0, 'e', 0, 'I', 0,
-                                     'n', 0, 't', 0, 'e', 0, 'r', 0, 'f', 0, 'a', 0, 'c', 0,
-                                     'e', 0, 'G', 0, 'U', 0, 'I', 0, 'D', 0, 's', 0, 0,   0},
-                    .wPropertyDataLength =
-                        sizeof(usb_msos_descriptor_set.subset.property.PropertyData),
-                    .PropertyData = {'{', 0, 'C', 0, 'D', 0, 'B', 0, '3', 0, 'B', 0, '5', 0,
-                                     'A', 0, 'D', 0, '-', 0, '2', 0, '9', 0, '3', 0, 'B', 0,
-                                     '-', 0, '4', 0, '6', 0, '6', 0, '3', 0, '-', 0, 'A', 0,
-                                     'A', 0, '3', 0, '6', 0, '-', 0, '1', 0, 'A', 0, 'A', 0,
-                                     'E', 0, '4', 0, '6', 0, '4', 0, '6', 0, '3', 0, '7', 0,
-                                     '7', 0, '6', 0, '}', 0, 0,   0, 0,   0},
-                },
+            .wLength = sizeof(usb_winusb_feature_reg_property_guids_t),
+            .wDescriptorType = USB_WINUSB_FEATURE_REG_PROPERTY,
+            .wPropertyDataType = USB_WINUSB_PROPERTY_DATA_TYPE_MULTI_SZ,
+            .wPropertyNameLength = sizeof(usb_msos_features.property.PropertyName),
+            .PropertyName = {'D', 0, 'e', 0, 'v', 0, 'i', 0, 'c', 0, 'e', 0, 'I', 0,
+                             'n', 0, 't', 0, 'e', 0, 'r', 0, 'f', 0, 'a', 0, 'c', 0,
+                             'e', 0, 'G', 0, 'U', 0, 'I', 0, 'D', 0, 's', 0, 0,   0},
+            .wPropertyDataLength = sizeof(usb_msos_features.property.PropertyData),
+            .PropertyData = {'{', 0, 'C', 0, 'D', 0, 'B', 0, '3', 0, 'B', 0, '5', 0,
+                             'A', 0, 'D', 0, '-', 0, '2', 0, '9', 0, '3', 0, 'B', 0,
+                             '-', 0, '4', 0, '6', 0, '6', 0, '3', 0, '-', 0, 'A', 0,
+                             'A', 0, '3', 0, '6', 0, '-', 0, '1', 0, 'A', 0, 'A', 0,
+                             'E', 0, '4', 0, '6', 0, '4', 0, '6', 0, '3', 0, '7', 0,
+                             '7', 0, '6', 0, '}', 0, 0,   0, 0,   0},
         },
 };
 
+typedef struct {
+    uint8_t address;
+    uint8_t type;
+    uint16_t size;
+    usbd_evt_callback callback;
+} DapUsbEndpoint;
+
+typedef struct {
+    uint8_t functions;
+
+    uint8_t cfg_desc[DAP_USB_CFG_DESC_SIZE];
+    size_t cfg_size;
+    uint8_t msos_desc[sizeof(usb_msos_descriptor_set_t)];
+    size_t msos_size;
+
+    DapUsbEndpoint endpoints[DAP_USB_EP_COUNT];
+    size_t endpoint_count;
+    uint8_t ep_number; // last endpoint number handed out
+    uint8_t interface_count;
+
+    // DAP_USB_NO_INTERFACE and endpoint address 0 for missing functions
+    uint8_t hid_interface;
+    uint8_t bulk_interface;
+    uint8_t cdc_interface[DAP_CDC_PORT_COUNT]; // communication interface of the port
+    uint8_t hid_ep_in;
+    uint8_t hid_ep_out;
+    uint8_t bulk_ep_in;
+    uint8_t bulk_ep_out;
+    uint8_t stream_ep_in;
+    uint8_t cdc_ep_in[DAP_CDC_PORT_COUNT];
+    uint8_t cdc_ep_out[DAP_CDC_PORT_COUNT];
+} DapUsbLayout;
+
+static DapUsbLayout dap_usb_layout;
+
 typedef struct {
     FuriSemaphore* semaphore_v1;
     FuriSemaphore* semaphore_v2;
-    FuriSemaphore* semaphore_cdc;
+    FuriSemaphore* semaphore_cdc[DAP_CDC_PORT_COUNT];
     bool connected;
     usbd_device* usb_dev;
     DapStateCallback state_callback;
     DapRxCallback rx_callback_v1;
     DapRxCallback rx_callback_v2;
-    DapRxCallback rx_callback_cdc;
-    DapCDCControlLineCallback control_line_callback_cdc;
-    DapCDCConfigCallback config_callback_cdc;
+    DapRxCallback rx_callback_cdc[DAP_CDC_PORT_COUNT];
+    DapCDCControlLineCallback control_line_callback_cdc[DAP_CDC_PORT_COUNT];
+    DapCDCConfigCallback config_callback_cdc[DAP_CDC_PORT_COUNT];
     void* context;
-    void* context_cdc;
+    void* context_cdc[DAP_CDC_PORT_COUNT];
+    FuriStreamBuffer* stream;
+    bool stream_busy;
 } DAPState;
 
 static DAPState dap_state = {
     .semaphore_v1 = NULL,
     .semaphore_v2 = NULL,
-    .semaphore_cdc = NULL,
+    .semaphore_cdc = {NULL},
     .connected = false,
     .usb_dev = NULL,
     .state_callback = NULL,
     .rx_callback_v1 = NULL,
     .rx_callback_v2 = NULL,
-    .rx_callback_cdc = NULL,
-    .control_line_callback_cdc = NULL,
-    .config_callback_cdc = NULL,
+    .rx_callback_cdc = {NULL},
+    .control_line_callback_cdc = {NULL},
+    .config_callback_cdc = {NULL},
     .context = NULL,
-    .context_cdc = NULL,
+    .context_cdc = {NULL},
+    .stream = NULL,
+    .stream_busy = false,
 };
 
-static struct usb_cdc_line_coding cdc_config = {0};
-static uint8_t cdc_ctrl_line_state = 0;
+static struct usb_cdc_line_coding cdc_config[DAP_CDC_PORT_COUNT] = {0};
+static uint8_t cdc_ctrl_line_state[DAP_CDC_PORT_COUNT] = {0};
 
 #ifdef DAP_USB_LOG
 void furi_console_log_printf(const char* format, ...) _ATTRIBUTE((__format__(__printf__, 1, 2)));
@@ -493,11 +522,12 @@ void furi_console_log_printf(const char* format, ...) {
 
 int32_t dap_v1_usb_tx(uint8_t* buffer, uint8_t size) {
     if((dap_state.semaphore_v1 == NULL) || (dap_state.connected == false)) return 0;
+    if(!dap_usb_layout.hid_ep_in) return 0;
 
     furi_check(furi_semaphore_acquire(dap_state.semaphore_v1, FuriWaitForever) == FuriStatusOk);
 
     if(dap_state.connected) {
-        int32_t len = usbd_ep_write(dap_state.usb_dev, DAP_HID_EP_IN, buffer, size);
+        int32_t len = usbd_ep_write(dap_state.usb_dev, dap_usb_layout.hid_ep_in, buffer, size);
         furi_console_log_printf("v1 tx %ld", len);
         return len;
     } else {
@@ -507,11 +537,12 @@ int32_t dap_v1_usb_tx(uint8_t* buffer, uint8_t size) {
 
 int32_t dap_v2_usb_tx(uint8_t* buffer, uint8_t size) {
     if((dap_state.semaphore_v2 == NULL) || (dap_state.connected == false)) return 0;
+    if(!dap_usb_layout.bulk_ep_in) return 0;
 
     furi_check(furi_semaphore_acquire(dap_state.semaphore_v2, FuriWaitForever) == FuriStatusOk);
 
     if(dap_state.connected) {
-        int32_t len = usbd_ep_write(dap_state.usb_dev, DAP_HID_EP_BULK_IN, buffer, size);
+        int32_t len = usbd_ep_write(dap_state.usb_dev, dap_usb_layout.bulk_ep_in, buffer, size);
         furi_console_log_printf("v2 tx %ld", len);
         return len;
     } else {
@@ -519,20 +550,59 @@ int32_t dap_v2_usb_tx(uint8_t* buffer, uint8_t size) {
     }
 }
 
-int32_t dap_cdc_usb_tx(uint8_t* buffer, uint8_t size) {
-    if((dap_state.semaphore_cdc == NULL) || (dap_state.connected == false)) return 0;
+int32_t dap_cdc_usb_tx(uint8_t port, uint8_t* buffer, uint8_t size) {
+    furi_assert(port < DAP_CDC_PORT_COUNT);
+    if((dap_state.semaphore_cdc[port] == NULL) || (dap_state.connected == false)) return 0;
+    if(!dap_usb_layout.cdc_ep_in[port]) return 0;
 
-    furi_check(furi_semaphore_acquire(dap_state.semaphore_cdc, FuriWaitForever) == FuriStatusOk);
+    furi_check(
+        furi_semaphore_acquire(dap_state.semaphore_cdc[port], FuriWaitForever) == FuriStatusOk);
 
     if(dap_state.connected) {
-        int32_t len = usbd_ep_write(dap_state.usb_dev, HID_EP_IN | DAP_CDC_EP_SEND, buffer, size);
-        furi_console_log_printf("cdc tx %ld", len);
+        int32_t len =
+            usbd_ep_write(dap_state.usb_dev, dap_usb_layout.cdc_ep_in[port], buffer, size);
+        furi_console_log_printf("cdc%u tx %ld", port, len);
         return len;
     } else {
         return 0;
     }
 }
 
+bool dap_cdc_usb_tx_ready(uint8_t port) {
+    furi_assert(port < DAP_CDC_PORT_COUNT);
+    if((dap_state.semaphore_cdc[port] == NULL) || (dap_state.connected == false)) return false;
+
+    return dap_usb_layout.cdc_ep_in[port] &&
+           furi_semaphore_get_count(dap_state.semaphore_cdc[port]) > 0;
+}
+
+// runs in the TX complete interrupt or under a critical section
+static void dap_stream_usb_send_next(void) {
+    uint8_t buffer[DAP_HID_EP_SIZE];
+    size_t len = 0;
+
+    if(dap_state.connected && dap_state.stream && dap_usb_layout.stream_ep_in) {
+        len = furi_stream_buffer_receive(dap_state.stream, buffer, sizeof(buffer), 0);
+    }
+
+    dap_state.stream_busy = len > 0;
+    if(len > 0) {
+        usbd_ep_write(dap_state.usb_dev, dap_usb_layout.stream_ep_in, buffer, len);
+    }
+}
+
+void dap_stream_usb_set_source(FuriStreamBuffer* stream) {
+    FURI_CRITICAL_ENTER();
+    dap_state.stream = stream;
+    FURI_CRITICAL_EXIT();
+}
+
+void dap_stream_usb_kick(void) {
+    FURI_CRITICAL_ENTER();
+    if(!dap_state.stream_busy) dap_stream_usb_send_next();
+    FURI_CRITICAL_EXIT();
+}
+
 void dap_v1_usb_set_rx_callback(DapRxCallback callback) {
     dap_state.rx_callback_v1 = callback;
 }
@@ -541,20 +611,24 @@ void dap_v2_usb_set_rx_callback(DapRxCallback callback) {
     dap_state.rx_callback_v2 = callback;
 }
 
-void dap_cdc_usb_set_rx_callback(DapRxCallback callback) {
-    dap_state.rx_callback_cdc = callback;
+void dap_cdc_usb_set_rx_callback(uint8_t port, DapRxCallback callback) {
+    furi_assert(port < DAP_CDC_PORT_COUNT);
+    dap_state.rx_callback_cdc[port] = callback;
 }
 
-void dap_cdc_usb_set_control_line_callback(DapCDCControlLineCallback callback) {
-    dap_state.control_line_callback_cdc = callback;
+void dap_cdc_usb_set_control_line_callback(uint8_t port, DapCDCControlLineCallback callback) {
+    furi_assert(port < DAP_CDC_PORT_COUNT);
+    dap_state.control_line_callback_cdc[port] = callback;
 }
 
-void dap_cdc_usb_set_config_callback(DapCDCConfigCallback callback) {
-    dap_state.config_callback_cdc = callback;
+void dap_cdc_usb_set_config_callback(uint8_t port, DapCDCConfigCallback callback) {
+    furi_assert(port < DAP_CDC_PORT_COUNT);
+    dap_state.config_callback_cdc[port] = callback;
 }
 
-void dap_cdc_usb_set_context(void* context) {
-    dap_state.context_cdc = context;
+void dap_cdc_usb_set_context(uint8_t port, void* context) {
+    furi_assert(port < DAP_CDC_PORT_COUNT);
+    dap_state.context_cdc[port] = context;
 }
 
 void dap_common_usb_set_context(void* context) {
@@ -588,6 +662,173 @@ void dap_common_usb_free_name() {
     free(dev_serial_descr);
 }
 
+void dap_common_usb_free(void) {
+    furi_semaphore_free(dap_state.semaphore_v1);
+    furi_semaphore_free(dap_state.semaphore_v2);
+    dap_state.semaphore_v1 = NULL;
+    dap_state.semaphore_v2 = NULL;
+    for(size_t port = 0; port < DAP_CDC_PORT_COUNT; port++) {
+        furi_semaphore_free(dap_state.semaphore_cdc[port]);
+        dap_state.semaphore_cdc[port] = NULL;
+    }
+}
+
+static void hid_txrx_ep_callback(usbd_device* dev, uint8_t event, uint8_t ep);
+static void hid_txrx_ep_bulk_callback(usbd_device* dev, uint8_t event, uint8_t ep);
+static void stream_ep_callback(usbd_device* dev, uint8_t event, uint8_t ep);
+static void cdc_txrx_ep_callback(usbd_device* dev, uint8_t event, uint8_t ep);
+
+/********************************** Layout *************************************/
+
+static void* dap_usb_layout_add(const void* desc, size_t size) {
+    furi_check(dap_usb_layout.cfg_size + size <= DAP_USB_CFG_DESC_SIZE);
+    void* block = &dap_usb_layout.cfg_desc[dap_usb_layout.cfg_size];
+    memcpy(block, desc, size);
+    dap_usb_layout.cfg_size += size;
+    return block;
+}
+
+static uint8_t dap_usb_layout_ep_number(void) {
+    furi_check(dap_usb_layout.ep_number < DAP_EP_NUMBER_MAX);
+    return ++dap_usb_layout.ep_number;
+}
+
+// give the descriptor its endpoint number and add it to the endpoint table
+static uint8_t dap_usb_layout_add_ep(
+    struct usb_endpoint_descriptor* desc,
+    uint8_t number,
+    usbd_evt_callback callback) {
+    furi_check(dap_usb_layout.endpoint_count < DAP_USB_EP_COUNT);
+    desc->bEndpointAddress = (desc->bEndpointAddress & HID_EP_IN) | number;
+
+    DapUsbEndpoint* endpoint = &dap_usb_layout.endpoints[dap_usb_layout.endpoint_count++];
+    endpoint->address = desc->bEndpointAddress;
+    endpoint->type = desc->bmAttributes;
+    endpoint->size = desc->wMaxPacketSize;
+    endpoint->callback = callback;
+    return desc->bEndpointAddress;
+}
+
+static void dap_usb_layout_add_hid(void) {
+    struct HidFunctionDescriptor* desc =
+        dap_usb_layout_add(&hid_function_desc, sizeof(struct HidFunctionDescriptor));
+    const uint8_t number = dap_usb_layout_ep_number();
+
+    dap_usb_layout.hid_interface = dap_usb_layout.interface_count++;
+    desc->hid_interface.bInterfaceNumber = dap_usb_layout.hid_interface;
+    dap_usb_layout.hid_ep_in =
+        dap_usb_layout_add_ep(&desc->hid_ep_in, number, hid_txrx_ep_callback);
+    dap_usb_layout.hid_ep_out =
+        dap_usb_layout_add_ep(&desc->hid_ep_out, number, hid_txrx_ep_callback);
+}
+
+static void dap_usb_layout_add_bulk(bool stream) {
+    size_t size = sizeof(struct BulkFunctionDescriptor);
+    if(!stream) size -= sizeof(struct usb_endpoint_descriptor);
+    struct BulkFunctionDescriptor* desc = dap_usb_layout_add(&bulk_function_desc, size);
+    const uint8_t number = dap_usb_layout_ep_number();
+
+    dap_usb_layout.bulk_interface = dap_usb_layout.interface_count++;
+    desc->bulk_interface.bInterfaceNumber = dap_usb_layout.bulk_interface;
+    dap_usb_layout.bulk_ep_out =
+        dap_usb_layout_add_ep(&desc->bulk_ep_out, number, hid_txrx_ep_bulk_callback);
+    dap_usb_layout.bulk_ep_in =
+        dap_usb_layout_add_ep(&desc->bulk_ep_in, number, hid_txrx_ep_bulk_callback);
+
+    if(stream) {
+        dap_usb_layout.stream_ep_in = dap_usb_layout_add_ep(
+            &desc->bulk_ep_stream, dap_usb_layout_ep_number(), stream_ep_callback);
+    } else {
+        desc->bulk_interface.bNumEndpoints = 2;
+    }
+}
+
+static void dap_usb_layout_add_cdc(uint8_t port) {
+    struct CdcFunctionDescriptor* desc =
+        dap_usb_layout_add(&cdc_function_desc, sizeof(struct CdcFunctionDescriptor));
+    const uint8_t comm = dap_usb_layout.interface_count++;
+    const uint8_t data = dap_usb_layout.interface_count++;
+
+    dap_usb_layout.cdc_interface[port] = comm;
+    desc->iad.bFirstInterface = comm;
+    desc->iad.iFunction = port == 0 ? USB_STR_COM_PORT : USB_STR_COM_PORT_2;
+    desc->interface_comm.bInterfaceNumber = comm;
+    desc->cdc_union.bMasterInterface0 = comm;
+    desc->cdc_union.bSlaveInterface0 = data;
+    desc->interface_data.bInterfaceNumber = data;
+
+    // nothing is ever sent on the notification endpoint, it only has to exist
+    dap_usb_layout_add_ep(&desc->ep_comm, dap_usb_layout_ep_number(), NULL);
+
+    const uint8_t number = dap_usb_layout_ep_number();
+    dap_usb_layout.cdc_ep_in[port] =
+        dap_usb_layout_add_ep(&desc->ep_in, number, cdc_txrx_ep_callback);
+    dap_usb_layout.cdc_ep_out[port] =
+        dap_usb_layout_add_ep(&desc->ep_out, number, cdc_txrx_ep_callback);
+}
+
+static void dap_usb_layout_add_msos(void) {
+    usb_msos_descriptor_set_t* set = (usb_msos_descriptor_set_t*)dap_usb_layout.msos_desc;
+    const bool composite = dap_usb_layout.interface_count > 1;
+
+    set->header.wLength = sizeof(usb_winusb_set_header_descriptor_t);
+    set->header.wDescriptorType = USB_WINUSB_SET_HEADER_DESCRIPTOR;
+    set->header.dwWindowsVersion = USB_WINUSB_WINDOWS_VERSION;
+
+    // Windows ignores function subsets on a device with a single interface
+    if(composite) {
+        set->subset.wLength = sizeof(usb_winusb_subset_header_function_t);
+        set->subset.wDescriptorType = USB_WINUSB_SUBSET_HEADER_FUNCTION;
+        set->subset.bFirstInterface = dap_usb_layout.bulk_interface;
+        set->subset.bReserved = 0;
+        set->subset.wSubsetLength =
+            sizeof(usb_winusb_subset_header_function_t) + sizeof(usb_msos_features_t);
+        set->features = usb_msos_features;
+        dap_usb_layout.msos_size = sizeof(usb_msos_descriptor_set_t);
+    } else {
+        memcpy(&set->subset, &usb_msos_features, sizeof(usb_msos_features_t));
+        dap_usb_layout.msos_size =
+            sizeof(usb_winusb_set_header_descriptor_t) + sizeof(usb_msos_features_t);
+    }
+
+    set->header.wDescriptorSetTotalLength = dap_usb_layout.msos_size;
+    usb_bos_hierarchy.winusb.wMSOSDescriptorSetTotalLength = dap_usb_layout.msos_size;
+}
+
+void dap_common_usb_set_functions(uint8_t functions) {
+    if(functions & DAP_USB_FUNCTION_STREAM) functions |= DAP_USB_FUNCTION_V2;
+    if(functions & DAP_USB_FUNCTION_CDC_2) functions |= DAP_USB_FUNCTION_CDC;
+
+    memset(&dap_usb_layout, 0, sizeof(DapUsbLayout));
+    dap_usb_layout.functions = functions;
+    dap_usb_layout.hid_interface = DAP_USB_NO_INTERFACE;
+    dap_usb_layout.bulk_interface = DAP_USB_NO_INTERFACE;
+    for(size_t port = 0; port < DAP_CDC_PORT_COUNT; port++) {
+        dap_usb_layout.cdc_interface[port] = DAP_USB_NO_INTERFACE;
+    }
+
+    struct usb_config_descriptor* config =
+        dap_usb_layout_add(&hid_cfg_desc, sizeof(struct usb_config_descriptor));
+    if(functions & DAP_USB_FUNCTION_V1) dap_usb_layout_add_hid();
+    if(functions & DAP_USB_FUNCTION_V2) {
+        dap_usb_layout_add_bulk(functions & DAP_USB_FUNCTION_STREAM);
+        dap_usb_layout_add_msos();
+    }
+    if(functions & DAP_USB_FUNCTION_CDC) dap_usb_layout_add_cdc(0);
+    if(functions & DAP_USB_FUNCTION_CDC_2) dap_usb_layout_add_cdc(1);
+
+    config->wTotalLength = dap_usb_layout.cfg_size;
+    config->bNumInterfaces = dap_usb_layout.interface_count;
+    hid_device_desc.bcdUSB =
+        (functions & DAP_USB_FUNCTION_V2) ? VERSION_BCD(2, 1, 0) : VERSION_BCD(2, 0, 0);
+}
+
+bool dap_common_usb_has_function(uint8_t function) {
+    return (dap_usb_layout.functions & function) == function;
+}
+
+/********************************** Device *************************************/
+
 static void hid_init(usbd_device* dev, FuriHalUsbInterface* intf, void* ctx);
 static void hid_deinit(usbd_device* dev);
 static void hid_on_wakeup(usbd_device* dev);
@@ -602,13 +843,24 @@ FuriHalUsbInterface dap_v2_usb_hid = {
     .wakeup = hid_on_wakeup,
     .suspend = hid_on_suspend,
     .dev_descr = (struct usb_device_descriptor*)&hid_device_desc,
-    .cfg_descr = (void*)&hid_cfg_desc,
+    .cfg_descr = (void*)dap_usb_layout.cfg_desc,
 };
 
+// a writer may still wait for a TX complete that the old setup never delivers
+static void dap_usb_release_writers(void) {
+    furi_semaphore_release(dap_state.semaphore_v1);
+    furi_semaphore_release(dap_state.semaphore_v2);
+    for(size_t port = 0; port < DAP_CDC_PORT_COUNT; port++) {
+        furi_semaphore_release(dap_state.semaphore_cdc[port]);
+    }
+}
+
 static void hid_init(usbd_device* dev, FuriHalUsbInterface* intf, void* ctx) {
     UNUSED(intf);
     UNUSED(ctx);
 
+    if(!dap_usb_layout.cfg_size) dap_common_usb_set_functions(DAP_USB_FUNCTIONS_DEFAULT);
+
     dap_v2_usb_hid.str_manuf_descr = (void*)&dev_manuf_descr;
     dap_v2_usb_hid.str_prod_descr = (void*)&dev_prod_descr;
     dap_v2_usb_hid.str_serial_descr = (void*)dev_serial_descr;
@@ -616,7 +868,11 @@ static void hid_init(usbd_device* dev, FuriHalUsbInterface* intf, void* ctx) {
     dap_state.usb_dev = dev;
     if(dap_state.semaphore_v1 == NULL) dap_state.semaphore_v1 = furi_semaphore_alloc(1, 1);
     if(dap_state.semaphore_v2 == NULL) dap_state.semaphore_v2 = furi_semaphore_alloc(1, 1);
-    if(dap_state.semaphore_cdc == NULL) dap_state.semaphore_cdc = furi_semaphore_alloc(1, 1);
+    for(size_t port = 0; port < DAP_CDC_PORT_COUNT; port++) {
+        if(dap_state.semaphore_cdc[port] == NULL) {
+            dap_state.semaphore_cdc[port] = furi_semaphore_alloc(1, 1);
+        }
+    }
 
     usbd_reg_config(dev, hid_ep_config);
     usbd_reg_control(dev, hid_control);
@@ -624,15 +880,10 @@ static void hid_init(usbd_device* dev, FuriHalUsbInterface* intf, void* ctx) {
     usbd_connect(dev, true);
 }
 
+// semaphores outlive a profile switch, dap_common_usb_free() drops them
 static void hid_deinit(usbd_device* dev) {
     dap_state.usb_dev = NULL;
-
-    furi_semaphore_free(dap_state.semaphore_v1);
-    furi_semaphore_free(dap_state.semaphore_v2);
-    furi_semaphore_free(dap_state.semaphore_cdc);
-    dap_state.semaphore_v1 = NULL;
-    dap_state.semaphore_v2 = NULL;
-    dap_state.semaphore_cdc = NULL;
+    dap_usb_release_writers();
 
     usbd_reg_config(dev, NULL);
     usbd_reg_control(dev, NULL);
@@ -661,8 +912,8 @@ static void hid_on_suspend(usbd_device* dev) {
 size_t dap_v1_usb_rx(uint8_t* buffer, size_t size) {
     size_t len = 0;
 
-    if(dap_state.connected) {
-        len = usbd_ep_read(dap_state.usb_dev, DAP_HID_EP_OUT, buffer, size);
+    if(dap_state.connected && dap_usb_layout.hid_ep_out) {
+        len = usbd_ep_read(dap_state.usb_dev, dap_usb_layout.hid_ep_out, buffer, size);
     }
 
     return len;
@@ -671,18 +922,19 @@ size_t dap_v1_usb_rx(uint8_t* buffer, size_t size) {
 size_t dap_v2_usb_rx(uint8_t* buffer, size_t size) {
     size_t len = 0;
 
-    if(dap_state.connected) {
-        len = usbd_ep_read(dap_state.usb_dev, DAP_HID_EP_BULK_OUT, buffer, size);
+    if(dap_state.connected && dap_usb_layout.bulk_ep_out) {
+        len = usbd_ep_read(dap_state.usb_dev, dap_usb_layout.bulk_ep_out, buffer, size);
     }
 
     return len;
 }
 
-size_t dap_cdc_usb_rx(uint8_t* buffer, size_t size) {
+size_t dap_cdc_usb_rx(uint8_t port, uint8_t* buffer, size_t size) {
+    furi_assert(port < DAP_CDC_PORT_COUNT);
     size_t len = 0;
 
-    if(dap_state.connected) {
-        len = usbd_ep_read(dap_state.usb_dev, HID_EP_OUT | DAP_CDC_EP_RECV, buffer, size);
+    if(dap_state.connected && dap_usb_layout.cdc_ep_out[port]) {
+        len = usbd_ep_read(dap_state.usb_dev, dap_usb_layout.cdc_ep_out[port], buffer, size);
     }
 
     return len;
@@ -728,60 +980,60 @@ static void hid_txrx_ep_bulk_callback(usbd_device* dev, uint8_t event, uint8_t e
     }
 }
 
-static void cdc_txrx_ep_callback(usbd_device* dev, uint8_t event, uint8_t ep) {
+static void stream_ep_callback(usbd_device* dev, uint8_t event, uint8_t ep) {
     UNUSED(dev);
     UNUSED(ep);
 
+    if(event == usbd_evt_eptx) {
+        dap_stream_usb_send_next();
+    }
+}
+
+static void cdc_txrx_ep_callback(usbd_device* dev, uint8_t event, uint8_t ep) {
+    UNUSED(dev);
+
+    // callbacks are per endpoint number, both ports share this one
+    uint8_t port = 0;
+    while(port < DAP_CDC_PORT_COUNT - 1 &&
+          (dap_usb_layout.cdc_ep_in[port] & DAP_EP_NUMBER_MASK) != (ep & DAP_EP_NUMBER_MASK)) {
+        port++;
+    }
+
     switch(event) {
     case usbd_evt_eptx:
-        furi_semaphore_release(dap_state.semaphore_cdc);
-        furi_console_log_printf("cdc tx complete");
+        furi_semaphore_release(dap_state.semaphore_cdc[port]);
+        furi_console_log_printf("cdc%u tx complete", port);
         break;
     case usbd_evt_eprx:
-        if(dap_state.rx_callback_cdc != NULL) {
-            dap_state.rx_callback_cdc(dap_state.context_cdc);
+        if(dap_state.rx_callback_cdc[port] != NULL) {
+            dap_state.rx_callback_cdc[port](dap_state.context_cdc[port]);
         }
         break;
     default:
-        furi_console_log_printf("cdc %d, %d", event, ep);
+        furi_console_log_printf("cdc%u %d, %d", port, event, ep);
         break;
     }
 }
 
+// only the endpoints of the current layout are touched
 static usbd_respond hid_ep_config(usbd_device* dev, uint8_t cfg) {
     switch(cfg) {
     case EP_CFG_DECONFIGURE:
-        usbd_ep_deconfig(dev, DAP_HID_EP_OUT);
-        usbd_ep_deconfig(dev, DAP_HID_EP_IN);
-        usbd_ep_deconfig(dev, DAP_HID_EP_BULK_IN);
-        usbd_ep_deconfig(dev, DAP_HID_EP_BULK_OUT);
-        usbd_ep_deconfig(dev, HID_EP_IN | DAP_CDC_EP_COMM);
-        usbd_ep_deconfig(dev, HID_EP_IN | DAP_CDC_EP_SEND);
-        usbd_ep_deconfig(dev, HID_EP_OUT | DAP_CDC_EP_RECV);
-        usbd_reg_endpoint(dev, DAP_HID_EP_OUT, NULL);
-        usbd_reg_endpoint(dev, DAP_HID_EP_IN, NULL);
-        usbd_reg_endpoint(dev, DAP_HID_EP_BULK_IN, NULL);
-        usbd_reg_endpoint(dev, DAP_HID_EP_BULK_OUT, NULL);
-        usbd_reg_endpoint(dev, HID_EP_IN | DAP_CDC_EP_SEND, 0);
-        usbd_reg_endpoint(dev, HID_EP_OUT | DAP_CDC_EP_RECV, 0);
+        for(size_t i = 0; i < dap_usb_layout.endpoint_count; i++) {
+            usbd_ep_deconfig(dev, dap_usb_layout.endpoints[i].address);
+            usbd_reg_endpoint(dev, dap_usb_layout.endpoints[i].address, NULL);
+        }
         return usbd_ack;
     case EP_CFG_CONFIGURE:
-        usbd_ep_config(dev, DAP_HID_EP_IN, USB_EPTYPE_INTERRUPT, DAP_HID_EP_SIZE);
-        usbd_ep_config(dev, DAP_HID_EP_OUT, USB_EPTYPE_INTERRUPT, DAP_HID_EP_SIZE);
-        usbd_ep_config(dev, DAP_HID_EP_BULK_OUT, USB_EPTYPE_BULK, DAP_HID_EP_SIZE);
-        usbd_ep_config(dev, DAP_HID_EP_BULK_IN, USB_EPTYPE_BULK, DAP_HID_EP_SIZE);
-        usbd_ep_config(dev, HID_EP_OUT | DAP_CDC_EP_RECV, USB_EPTYPE_BULK, DAP_CDC_EP_SIZE);
-        usbd_ep_config(dev, HID_EP_IN | DAP_CDC_EP_SEND, USB_EPTYPE_BULK, DAP_CDC_EP_SIZE);
-        usbd_ep_config(dev, HID_EP_IN | DAP_CDC_EP_COMM, USB_EPTYPE_INTERRUPT, DAP_CDC_EP_SIZE);
-        usbd_reg_endpoint(dev, DAP_HID_EP_IN, hid_txrx_ep_callback);
-        usbd_reg_endpoint(dev, DAP_HID_EP_OUT, hid_txrx_ep_callback);
-        usbd_reg_endpoint(dev, DAP_HID_EP_BULK_OUT, hid_txrx_ep_bulk_callback);
-        usbd_reg_endpoint(dev, DAP_HID_EP_BULK_IN, hid_txrx_ep_bulk_callback);
-        usbd_reg_endpoint(dev, HID_EP_OUT | DAP_CDC_EP_RECV, cdc_txrx_ep_callback);
-        usbd_reg_endpoint(dev, HID_EP_IN | DAP_CDC_EP_SEND, cdc_txrx_ep_callback);
-        // usbd_ep_write(dev, DAP_HID_EP_IN, NULL, 0);
-        // usbd_ep_write(dev, DAP_HID_EP_BULK_IN, NULL, 0);
-        // usbd_ep_write(dev, HID_EP_IN | DAP_CDC_EP_SEND, NULL, 0);
+        for(size_t i = 0; i < dap_usb_layout.endpoint_count; i++) {
+            const DapUsbEndpoint* endpoint = &dap_usb_layout.endpoints[i];
+            usbd_ep_config(dev, endpoint->address, endpoint->type, endpoint->size);
+            if(endpoint->callback) {
+                usbd_reg_endpoint(dev, endpoint->address, endpoint->callback);
+            }
+        }
+        dap_state.stream_busy = false;
+        dap_usb_release_writers();
         return usbd_ack;
     default:
         return usbd_fail;
@@ -845,7 +1097,8 @@ static usbd_respond hid_control(usbd_device* dev, usbd_ctlreq* req, usbd_rqc_cal
         req->wLength);
 
     if(((USB_REQ_RECIPIENT | USB_REQ_TYPE | USB_REQ_DIRECTION) & req->bmRequestType) ==
-       (USB_REQ_STANDARD | USB_REQ_VENDOR | USB_REQ_DEVTOHOST)) {
+           (USB_REQ_STANDARD | USB_REQ_VENDOR | USB_REQ_DEVTOHOST) &&
+       dap_usb_layout.msos_size) {
         // vendor request, device to host
         furi_console_log_printf("vendor request");
         if(USB_WINUSB_VENDOR_CODE == req->bRequest) {
@@ -853,11 +1106,11 @@ static usbd_respond hid_control(usbd_device* dev, usbd_ctlreq* req, usbd_rqc_cal
             if(USB_WINUSB_DESCRIPTOR_INDEX == req->wIndex) {
                 furi_console_log_printf("WINUSB descriptor");
                 uint16_t length = req->wLength;
-                if(length > sizeof(usb_msos_descriptor_set_t)) {
-                    length = sizeof(usb_msos_descriptor_set_t);
+                if(length > dap_usb_layout.msos_size) {
+                    length = dap_usb_layout.msos_size;
                 }
 
-                dev->status.data_ptr = (uint8_t*)&usb_msos_descriptor_set;
+                dev->status.data_ptr = dap_usb_layout.msos_desc;
                 dev->status.data_count = length;
                 return usbd_ack;
             }
@@ -887,8 +1140,13 @@ static usbd_respond hid_control(usbd_device* dev, usbd_ctlreq* req, usbd_rqc_cal
                     dev->status.data_ptr = (uint8_t*)&dev_com_descr;
                     dev->status.data_count = dev_com_descr.bLength;
                     return usbd_ack;
+                } else if(dnumber == USB_STR_COM_PORT_2) {
+                    furi_console_log_printf("str COM port 2");
+                    dev->status.data_ptr = (uint8_t*)&dev_com_2_descr;
+                    dev->status.data_count = dev_com_2_descr.bLength;
+                    return usbd_ack;
                 }
-            } else if(USB_DTYPE_BINARY_OBJECT_STORE == dtype) {
+            } else if(USB_DTYPE_BINARY_OBJECT_STORE == dtype && dap_usb_layout.msos_size) {
                 furi_console_log_printf("BOS descriptor");
                 uint16_t length = req->wLength;
                 if(length > sizeof(usb_bos_hierarchy_t)) {
@@ -903,7 +1161,7 @@ static usbd_respond hid_control(usbd_device* dev, usbd_ctlreq* req, usbd_rqc_cal
 
     if(((USB_REQ_RECIPIENT | USB_REQ_TYPE) & req->bmRequestType) ==
            (USB_REQ_INTERFACE | USB_REQ_CLASS) &&
-       req->wIndex == 0) {
+       req->wIndex == dap_usb_layout.hid_interface) {
         // class request
         switch(req->bRequest) {
         // get hid descriptor
@@ -919,32 +1177,38 @@ static usbd_respond hid_control(usbd_device* dev, usbd_ctlreq* req, usbd_rqc_cal
         }
     }
 
-    if(((USB_REQ_RECIPIENT | USB_REQ_TYPE) & req->bmRequestType) ==
-           (USB_REQ_INTERFACE | USB_REQ_CLASS) &&
-       req->wIndex == 2) {
+    for(uint8_t port = 0; port < DAP_CDC_PORT_COUNT; port++) {
+        if(((USB_REQ_RECIPIENT | USB_REQ_TYPE) & req->bmRequestType) !=
+               (USB_REQ_INTERFACE | USB_REQ_CLASS) ||
+           req->wIndex != dap_usb_layout.cdc_interface[port]) {
+            continue;
+        }
+
         // class request
         switch(req->bRequest) {
         // control line state
         case USB_CDC_SET_CONTROL_LINE_STATE:
-            furi_console_log_printf("set control line state");
-            cdc_ctrl_line_state = req->wValue;
-            if(dap_state.control_line_callback_cdc != NULL) {
-                dap_state.control_line_callback_cdc(cdc_ctrl_line_state, dap_state.context_cdc);
+            furi_console_log_printf("cdc%u set control line state", port);
+            cdc_ctrl_line_state[port] = req->wValue;
+            if(dap_state.control_line_callback_cdc[port] != NULL) {
+                dap_state.control_line_callback_cdc[port](
+                    cdc_ctrl_line_state[port], dap_state.context_cdc[port]);
             }
             return usbd_ack;
         // set cdc line coding
         case USB_CDC_SET_LINE_CODING:
-            furi_console_log_printf("set line coding");
-            memcpy(&cdc_config, req->data, sizeof(cdc_config));
-            if(dap_state.config_callback_cdc != NULL) {
-                dap_state.config_callback_cdc(&cdc_config, dap_state.context_cdc);
+            furi_console_log_printf("cdc%u set line coding", port);
+            memcpy(&cdc_config[port], req->data, sizeof(struct usb_cdc_line_coding));
+            if(dap_state.config_callback_cdc[port] != NULL) {
+                dap_state.config_callback_cdc[port](
+                    &cdc_config[port], dap_state.context_cdc[port]);
             }
             return usbd_ack;
         // get cdc line coding
         case USB_CDC_GET_LINE_CODING:
-            furi_console_log_printf("get line coding");
-            dev->status.data_ptr = &cdc_config;
-            dev->status.data_count = sizeof(cdc_config);
+            furi_console_log_printf("cdc%u get line coding", port);
+            dev->status.data_ptr = &cdc_config[port];
+            dev->status.data_count = sizeof(struct usb_cdc_line_coding);
             return usbd_ack;
         default:
             break;
@@ -953,14 +1217,14 @@ static usbd_respond hid_control(usbd_device* dev, usbd_ctlreq* req, usbd_rqc_cal
 
     if(((USB_REQ_RECIPIENT | USB_REQ_TYPE) & req->bmRequestType) ==
            (USB_REQ_INTERFACE | USB_REQ_STANDARD) &&
-       req->wIndex == 0 && req->bRequest == USB_STD_GET_DESCRIPTOR) {
+       req->wIndex == dap_usb_layout.hid_interface && req->bRequest == USB_STD_GET_DESCRIPTOR) {
         // standard request
         switch(req->wValue >> 8) {
         // get hid descriptor
         case USB_DTYPE_HID:
             furi_console_log_printf("get hid descriptor");
-            dev->status.data_ptr = (uint8_t*)&(hid_cfg_desc.hid);
-            dev->status.data_count = sizeof(hid_cfg_desc.hid);
+            dev->status.data_ptr = (uint8_t*)&(hid_function_desc.hid);
+            dev->status.data_count = sizeof(hid_function_desc.hid);
             return usbd_ack;
         // get hid report descriptor
         case USB_DTYPE_HID_REPORT:
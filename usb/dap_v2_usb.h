@@ -4,6 +4,18 @@
 
 extern FuriHalUsbInterface dap_v2_usb_hid;
 
+#define DAP_CDC_PORT_COUNT 2
+
+// functions of the composite device, see dap_common_usb_set_functions()
+#define DAP_USB_FUNCTION_V1 (1 << 0)
+#define DAP_USB_FUNCTION_V2 (1 << 1)
+#define DAP_USB_FUNCTION_STREAM (1 << 2) // third endpoint of the v2 interface
+#define DAP_USB_FUNCTION_CDC (1 << 3)
+#define DAP_USB_FUNCTION_CDC_2 (1 << 4)
+
+#define DAP_USB_FUNCTIONS_DEFAULT \
+    (DAP_USB_FUNCTION_V1 | DAP_USB_FUNCTION_V2 | DAP_USB_FUNCTION_STREAM | DAP_USB_FUNCTION_CDC)
+
 // receive callback type
 typedef void (*DapRxCallback)(void* context);
 
@@ -30,17 +42,33 @@ void dap_v2_usb_set_rx_callback(DapRxCallback callback);
 typedef void (*DapCDCControlLineCallback)(uint8_t state, void* context);
 typedef void (*DapCDCConfigCallback)(struct usb_cdc_line_coding* config, void* context);
 
-int32_t dap_cdc_usb_tx(uint8_t* buffer, uint8_t size);
+// port is 0 or 1, the second port only exists with DAP_USB_FUNCTION_CDC_2
+int32_t dap_cdc_usb_tx(uint8_t port, uint8_t* buffer, uint8_t size);
+
+size_t dap_cdc_usb_rx(uint8_t port, uint8_t* buffer, size_t size);
+
+/**
+ * The port exists and its last packet went out, dap_cdc_usb_tx() won't block
+ */
+bool dap_cdc_usb_tx_ready(uint8_t port);
 
-size_t dap_cdc_usb_rx(uint8_t* buffer, size_t size);
+void dap_cdc_usb_set_rx_callback(uint8_t port, DapRxCallback callback);
 
-void dap_cdc_usb_set_rx_callback(DapRxCallback callback);
+void dap_cdc_usb_set_control_line_callback(uint8_t port, DapCDCControlLineCallback callback);
 
-void dap_cdc_usb_set_control_line_callback(DapCDCControlLineCallback callback);
+void dap_cdc_usb_set_config_callback(uint8_t port, DapCDCConfigCallback callback);
 
-void dap_cdc_usb_set_config_callback(DapCDCConfigCallback callback);
+void dap_cdc_usb_set_context(uint8_t port, void* context);
 
-void dap_cdc_usb_set_context(void* context);
+/*********************************** Stream ************************************/
+
+/**
+ * Bulk IN endpoint of the CMSIS-DAP v2 interface. Data is pulled from the
+ * stream buffer in the TX complete interrupt, producers only kick it.
+ */
+void dap_stream_usb_set_source(FuriStreamBuffer* stream);
+
+void dap_stream_usb_kick(void);
 
 /*********************************** Common ************************************/
 
@@ -51,3 +79,16 @@ void dap_common_usb_set_state_callback(DapStateCallback callback);
 void dap_common_usb_alloc_name(const char* name);
 
 void dap_common_usb_free_name();
+
+/**
+ * Build the descriptors and endpoint table for a set of DAP_USB_FUNCTION_*.
+ * Only while the interface is not active, i.e. before furi_hal_usb_set_config().
+ */
+void dap_common_usb_set_functions(uint8_t functions);
+
+bool dap_common_usb_has_function(uint8_t function);
+
+/**
+ * Free what outlives the interface, after it was switched away
+ */
+void dap_common_usb_free(void);